@@ -422,6 +422,7 @@ void base_txn_btree<Transaction, P>::do_tree_put(
                                // to not be present, so we assert this doesn't happen
                                // for now [since this would indicate a suboptimality]
   t.ensure_active();
+  t.check_wounded();
 
   if (unlikely(t.is_snapshot())) {
     const transaction_base::abort_reason r = transaction_base::ABORT_REASON_USER;
@@ -464,7 +465,7 @@ retry:
         if(t.find_write_lock_set(px) == t.write_lock_set.end()) {
             if(!px->start_write(t.get_tid(), t.get_state(), t.not_sorted()))
             {
-                const transaction_base::abort_reason r = transaction_base::ABORT_REASON_LOCK_CONFLICT;
+                const transaction_base::abort_reason r = t.lock_conflict_reason();
                 t.abort_impl(r);
                 throw transaction_abort_exception(r);
             }
@@ -482,6 +483,7 @@ retry:
     //INVARIANT(t.find_write_set(px) != t.write_set.end());
     //INVARIANT(t.find_write_set(px)->is_insert());
   }
+  t.release_locks_early();
 }
 
 template <template <typename> class Transaction, typename P>
@@ -517,7 +519,8 @@ base_txn_btree<Transaction, P>
   if (t->do_tuple_read(tuple, *value_reader, true, acc_id))
     return caller_callback->invoke(
         (*key_reader)(k), value_reader->results());
-  return true;
+  // a status abort ends the scan, the caller sees should_abort()
+  return !t->status_aborted();
 }
 
 template <template <typename> class Transaction, typename P>
@@ -140,6 +140,12 @@ public:
    */
   virtual void abort_txn(void *txn) = 0;
 
+  /**
+   * True iff a read failed the txn under TXN_FLAG_STATUS_ABORTS; the caller
+   * then calls abort_txn() instead of catching an abort exception
+   */
+  virtual bool should_abort(void *txn) { return false; }
+
   virtual void print_txn_debug(void *txn) const {}
 
   virtual abstract_ordered_index *
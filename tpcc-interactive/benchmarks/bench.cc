@@ -15,6 +15,7 @@
 #include "../counter.h"
 #include "../scopedperf.hh"
 #include "../allocator.h"
+#include "../learn.h"
 
 #ifdef USE_JEMALLOC
 //cannot include this header b/c conflicts with malloc.h
@@ -124,6 +125,8 @@ bench_worker::run()
     double d = r.next_uniform();
     for (size_t i = 0; i < workload.size(); i++) {
       if ((i + 1) == workload.size() || d < workload[i].frequency) {
+        // the retries below keep the age of the first attempt
+        xact::BeginAttempts();
       retry:
         timer t;
         const unsigned long old_seed = r.get_seed();
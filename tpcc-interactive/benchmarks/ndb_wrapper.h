@@ -94,6 +94,7 @@ public:
       TxnProfileHint hint);
   virtual bool commit_txn(void *txn);
   virtual void abort_txn(void *txn);
+  virtual bool should_abort(void *txn);
   virtual void print_txn_debug(void *txn) const;
   virtual std::map<std::string, uint64_t> get_txn_counters(void *txn) const;
 
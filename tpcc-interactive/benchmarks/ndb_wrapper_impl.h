@@ -404,6 +404,26 @@ ndb_wrapper<Transaction>::abort_txn(void *txn)
 #undef MY_OP_X
 }
 
+template <template <typename> class Transaction>
+bool
+ndb_wrapper<Transaction>::should_abort(void *txn)
+{
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+#define MY_OP_X(a, b) \
+  case a: \
+    { \
+      auto t = cast< b >()(p); \
+      return t->should_abort(); \
+    }
+  switch (p->hint) {
+    TXN_PROFILE_HINT_OP(MY_OP_X)
+  default:
+    ALWAYS_ASSERT(false);
+  }
+#undef MY_OP_X
+  return false;
+}
+
 template <template <typename> class Transaction>
 void
 ndb_wrapper<Transaction>::print_txn_debug(void *txn) const
@@ -187,6 +187,7 @@ static int g_enable_partition_locks = 0;
 static int g_enable_separate_tree_per_partition = 0;
 static int g_new_order_remote_item_pct = 1;
 static int g_new_order_fast_id_gen = 0;
+static int g_status_aborts = 0;
 static int g_uniform_item_dist = 0;
 static int g_order_status_scan_hack = 0;
 static unsigned g_txn_workload_mix[] = { 45, 43, 4, 4, 4 }; // default TPC-C workload mix
@@ -214,6 +215,37 @@ release_dis_range_lock(int wid, int dis)
   dis_range_lock[wid - 1][dis - 1].unlock();
 }
 
+// the range locks of every district of a warehouse, held until release()
+// or the end of the scope, whichever way the txn leaves it
+class scoped_dis_range_locks {
+public:
+  explicit scoped_dis_range_locks(int wid)
+    : wid(wid), held(true)
+  {
+    for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++)
+      acquire_dis_range_lock(wid, d);
+  }
+
+  ~scoped_dis_range_locks()
+  {
+    release();
+  }
+
+  void
+  release()
+  {
+    if (!held)
+      return;
+    held = false;
+    for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++)
+      release_dis_range_lock(wid, d);
+  }
+
+private:
+  const int wid;
+  bool held;
+};
+
 static aligned_padded_elem<spinlock> *g_partition_locks = nullptr;
 static aligned_padded_elem<atomic<uint64_t>> *g_district_ids = nullptr;
 
@@ -594,6 +626,15 @@ public:
   // XXX(stephentu): tune this
   static const size_t NMaxCustomerIdxScanElems = 512;
 
+  // the flags each procedure starts its txn with: with --status-aborts a
+  // read whose lock cannot be taken returns false instead of throwing, see
+  // TXN_STATUS_ABORT_CHECK
+  inline uint64_t
+  procedure_txn_flags() const
+  {
+    return txn_flags | (g_status_aborts ? transaction_base::TXN_FLAG_STATUS_ABORTS : 0);
+  }
+
   txn_result txn_new_order();
 
   static txn_result
@@ -1309,6 +1350,24 @@ private:
 static event_counter evt_tpcc_cross_partition_new_order_txns("tpcc_cross_partition_new_order_txns");
 static event_counter evt_tpcc_cross_partition_payment_txns("tpcc_cross_partition_payment_txns");
 
+// with --status-aborts every procedure runs with TXN_FLAG_STATUS_ABORTS: a
+// read whose lock cannot be taken aborts the txn and fails instead of
+// throwing (a get returns false, a scan stops), and the procedure returns
+// through these
+#define TXN_STATUS_ABORT_CHECK() \
+  if (unlikely(db->should_abort(txn))) { \
+    db->abort_txn(txn); \
+    return txn_result(false, 0); \
+  }
+
+#define TXN_GET_OR_STATUS_ABORT(get) \
+  do { \
+    if (unlikely(!(get))) { \
+      TXN_STATUS_ABORT_CHECK(); \
+      ALWAYS_ASSERT(false); \
+    } \
+  } while (0)
+
 tpcc_worker::txn_result
 tpcc_worker::txn_new_order()
 {
@@ -1362,7 +1421,7 @@ tpcc_worker::txn_new_order()
   //   max_read_set_size : 15
   //   max_write_set_size : 15
   //   num_txn_contexts : 9
-  void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_TPCC_NEW_ORDER);
+  void *txn = db->new_txn(procedure_txn_flags(), arena, txn_buf(), abstract_db::HINT_TPCC_NEW_ORDER);
   scoped_str_arena s_arena(arena);
   scoped_multilock<spinlock> mlock;
   if (g_enable_partition_locks) {
@@ -1388,7 +1447,7 @@ tpcc_worker::txn_new_order()
     // access 1: read warehouse table (access 0 for no specified case's CC policy)
     access_id ++;
     const warehouse::key k_w(warehouse_id);
-    ALWAYS_ASSERT(tbl_warehouse(warehouse_id)->get_for_read(txn, Encode(obj_key0, k_w), obj_v, D_SIZE, access_id));
+    TXN_GET_OR_STATUS_ABORT(tbl_warehouse(warehouse_id)->get_for_read(txn, Encode(obj_key0, k_w), obj_v, D_SIZE, access_id));
     warehouse::value v_w_temp;
     const warehouse::value *v_w = Decode(obj_v, v_w_temp);
     checker::SanityCheckWarehouse(&k_w, v_w);
@@ -1396,7 +1455,7 @@ tpcc_worker::txn_new_order()
     // access 2: read modify write district table
     access_id ++;
     const district::key k_d(warehouse_id, districtID);
-    ALWAYS_ASSERT(tbl_district(warehouse_id)->get(txn, Encode(obj_key0, k_d), obj_v, D_SIZE, access_id));
+    TXN_GET_OR_STATUS_ABORT(tbl_district(warehouse_id)->get(txn, Encode(obj_key0, k_d), obj_v, D_SIZE, access_id));
     district::value v_d_temp;
     const district::value *v_d = Decode(obj_v, v_d_temp);
     checker::SanityCheckDistrict(&k_d, v_d);
@@ -1416,7 +1475,7 @@ tpcc_worker::txn_new_order()
       const uint ol_i_id = itemIDs[ol_number - 1];
 
       const item::key k_i(ol_i_id);
-      ALWAYS_ASSERT(tbl_item(1)->get_for_read(txn, Encode(obj_key0, k_i), obj_v, D_SIZE, access_id));
+      TXN_GET_OR_STATUS_ABORT(tbl_item(1)->get_for_read(txn, Encode(obj_key0, k_i), obj_v, D_SIZE, access_id));
       item::value v_i_temp;
       const item::value *v_i = Decode(obj_v, v_i_temp);
       checker::SanityCheckItem(&k_i, v_i);
@@ -1430,7 +1489,7 @@ tpcc_worker::txn_new_order()
       const uint ol_quantity = orderQuantities[ol_number - 1];
 
       const stock::key k_s(ol_supply_w_id, ol_i_id);
-      ALWAYS_ASSERT(tbl_stock(ol_supply_w_id)->get(txn, Encode(obj_key0, k_s), obj_v, D_SIZE, access_id));
+      TXN_GET_OR_STATUS_ABORT(tbl_stock(ol_supply_w_id)->get(txn, Encode(obj_key0, k_s), obj_v, D_SIZE, access_id));
       stock::value v_s_temp;
       const stock::value *v_s = Decode(obj_v, v_s_temp);
       checker::SanityCheckStock(&k_s, v_s);
@@ -1499,7 +1558,7 @@ tpcc_worker::txn_new_order()
     // access 8: read customer
     access_id ++;
     const customer::key k_c(warehouse_id, districtID, customerID);
-    ALWAYS_ASSERT(tbl_customer(warehouse_id)->get_for_read(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
+    TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get_for_read(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
     customer::value v_c_temp;
     const customer::value *v_c = Decode(obj_v, v_c_temp);
     checker::SanityCheckCustomer(&k_c, v_c);
@@ -1581,7 +1640,7 @@ tpcc_worker::txn_delivery()
   //   max_read_set_size : 133
   //   max_write_set_size : 133
   //   num_txn_contexts : 4
-  void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_TPCC_DELIVERY);
+  void *txn = db->new_txn(procedure_txn_flags(), arena, txn_buf(), abstract_db::HINT_TPCC_DELIVERY);
   scoped_str_arena s_arena(arena);
   scoped_lock_guard<spinlock> slock(
       g_enable_partition_locks ? &LockForPartition(warehouse_id) : nullptr);
@@ -1596,9 +1655,7 @@ tpcc_worker::txn_delivery()
 
     // access xx: scan the new order table.
     // Instead of learning a policy for scan, we adopt a explicit lock policy.
-    for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++) {
-      acquire_dis_range_lock(warehouse_id, d);
-    }
+    scoped_dis_range_locks range_locks(warehouse_id);
 
     for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++) {
 
@@ -1608,6 +1665,7 @@ tpcc_worker::txn_delivery()
       {
         ANON_REGION("DeliverNewOrderScan:", &delivery_probe0_cg);
         tbl_new_order(warehouse_id)->scan(txn, Encode(obj_key0, k_no_0), &Encode(obj_key1, k_no_1), new_order_c, s_arena.get());
+        TXN_STATUS_ABORT_CHECK();
       }
 
       const new_order::key *k_no = new_order_c.get_key();
@@ -1648,6 +1706,7 @@ tpcc_worker::txn_delivery()
         // even if we read the new order entry, there's no guarantee
         // we will read the oorder entry: in this case the txn will abort,
         // but we're simply bailing out early
+        TXN_STATUS_ABORT_CHECK();
         ALWAYS_ASSERT(false);
         db->abort_txn(txn);
         return txn_result(false, 0);
@@ -1679,6 +1738,7 @@ tpcc_worker::txn_delivery()
 
       // XXX(stephentu): mutable scans would help here
       tbl_order_line(warehouse_id)->scan(txn, Encode(obj_key0, k_oo_0), &Encode(obj_key1, k_oo_1), c, s_arena.get());
+      TXN_STATUS_ABORT_CHECK();
       float sum = 0.0;
       for (size_t i = 0; i < c.size(); i++) {
         order_line::value v_ol_temp;
@@ -1709,7 +1769,7 @@ tpcc_worker::txn_delivery()
       }
       // update customer
       const customer::key k_c(warehouse_id, d, c_id[d - 1]);
-      ALWAYS_ASSERT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
 
       customer::value v_c_temp;
       const customer::value *v_c = Decode(obj_v, v_c_temp);
@@ -1718,9 +1778,7 @@ tpcc_worker::txn_delivery()
       tbl_customer(warehouse_id)->put(txn, Encode(str(), k_c), Encode(str(), v_c_new), access_id);
     }
 
-    for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++) {
-      release_dis_range_lock(warehouse_id, d);
-    }
+    range_locks.release();
 
     assert(access_id == N_DELIVERY_ACCESS);
 
@@ -1730,9 +1788,6 @@ tpcc_worker::txn_delivery()
   } catch (abstract_db::abstract_abort_exception &ex) {
     db->abort_txn(txn);
   }
-  for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++) {
-    release_dis_range_lock(warehouse_id, d);
-  }
   return txn_result(false, 0);
 }
 
@@ -1766,7 +1821,7 @@ tpcc_worker::txn_payment()
   //   max_read_set_size : 71
   //   max_write_set_size : 1
   //   num_txn_contexts : 5
-  void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_TPCC_PAYMENT);
+  void *txn = db->new_txn(procedure_txn_flags(), arena, txn_buf(), abstract_db::HINT_TPCC_PAYMENT);
   scoped_str_arena s_arena(arena);
   scoped_multilock<spinlock> mlock;
   if (g_enable_partition_locks) {
@@ -1784,7 +1839,7 @@ tpcc_worker::txn_payment()
     // access 13: read modify write warehouse table, update YTD
     access_id ++;
     const warehouse::key k_w(warehouse_id);
-    ALWAYS_ASSERT(tbl_warehouse(warehouse_id)->get(txn, Encode(obj_key0, k_w), obj_v, D_SIZE, access_id));
+    TXN_GET_OR_STATUS_ABORT(tbl_warehouse(warehouse_id)->get(txn, Encode(obj_key0, k_w), obj_v, D_SIZE, access_id));
     warehouse::value v_w_temp;
     const warehouse::value *v_w = Decode(obj_v, v_w_temp);
     checker::SanityCheckWarehouse(&k_w, v_w);
@@ -1796,7 +1851,7 @@ tpcc_worker::txn_payment()
     // access 14: read modify write district table, update total payment amount.
     access_id ++;
     const district::key k_d(warehouse_id, districtID);
-    ALWAYS_ASSERT(tbl_district(warehouse_id)->get(txn, Encode(obj_key0, k_d), obj_v, D_SIZE, access_id));
+    TXN_GET_OR_STATUS_ABORT(tbl_district(warehouse_id)->get(txn, Encode(obj_key0, k_d), obj_v, D_SIZE, access_id));
     district::value v_d_temp;
     const district::value *v_d = Decode(obj_v, v_d_temp);
     checker::SanityCheckDistrict(&k_d, v_d);
@@ -1833,6 +1888,7 @@ tpcc_worker::txn_payment()
 
       static_limit_callback<NMaxCustomerIdxScanElems> c(s_arena.get(), true); // probably a safe bet for now
       tbl_customer_name_idx(customerWarehouseID)->scan(txn, Encode(obj_key0, k_c_idx_0), &Encode(obj_key1, k_c_idx_1), c, s_arena.get());
+      TXN_STATUS_ABORT_CHECK();
       ALWAYS_ASSERT(c.size() > 0);
       INVARIANT(c.size() < NMaxCustomerIdxScanElems); // we should detect this
       int index = c.size() / 2;
@@ -1846,7 +1902,7 @@ tpcc_worker::txn_payment()
       k_c.c_w_id = customerWarehouseID;
       k_c.c_d_id = customerDistrictID;
       k_c.c_id = v_c_idx->c_id;
-      ALWAYS_ASSERT(tbl_customer(customerWarehouseID)->get(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(customerWarehouseID)->get(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
       Decode(obj_v, v_c);
 
     } else {
@@ -1855,7 +1911,7 @@ tpcc_worker::txn_payment()
       k_c.c_w_id = customerWarehouseID;
       k_c.c_d_id = customerDistrictID;
       k_c.c_id = customerID;
-      ALWAYS_ASSERT(tbl_customer(customerWarehouseID)->get(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(customerWarehouseID)->get(txn, Encode(obj_key0, k_c), obj_v, D_SIZE, access_id));
       Decode(obj_v, v_c);
     }
     checker::SanityCheckCustomer(&k_c, &v_c);
@@ -1950,7 +2006,7 @@ tpcc_worker::txn_order_status()
     g_disable_read_only_scans ?
       abstract_db::HINT_TPCC_ORDER_STATUS :
       abstract_db::HINT_TPCC_ORDER_STATUS_READ_ONLY;
-  void *txn = db->new_txn(txn_flags | read_only_mask, arena, txn_buf(), hint);
+  void *txn = db->new_txn(procedure_txn_flags() | read_only_mask, arena, txn_buf(), hint);
   scoped_str_arena s_arena(arena);
   // NB: since txn_order_status() is a RO txn, we assume that
   // locking is un-necessary (since we can just read from some old snapshot)
@@ -1982,6 +2038,7 @@ tpcc_worker::txn_order_status()
 
       static_limit_callback<NMaxCustomerIdxScanElems> c(s_arena.get(), true); // probably a safe bet for now
       tbl_customer_name_idx(warehouse_id)->scan(txn, Encode(obj_key0, k_c_idx_0), &Encode(obj_key1, k_c_idx_1), c, s_arena.get());
+      TXN_STATUS_ABORT_CHECK();
       ALWAYS_ASSERT(c.size() > 0);
       INVARIANT(c.size() < NMaxCustomerIdxScanElems); // we should detect this
       int index = c.size() / 2;
@@ -1995,7 +2052,7 @@ tpcc_worker::txn_order_status()
       k_c.c_w_id = warehouse_id;
       k_c.c_d_id = districtID;
       k_c.c_id = v_c_idx->c_id;
-      ALWAYS_ASSERT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v));
       Decode(obj_v, v_c);
 
     } else {
@@ -2004,7 +2061,7 @@ tpcc_worker::txn_order_status()
       k_c.c_w_id = warehouse_id;
       k_c.c_d_id = districtID;
       k_c.c_id = customerID;
-      ALWAYS_ASSERT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v));
       Decode(obj_v, v_c);
     }
     checker::SanityCheckCustomer(&k_c, &v_c);
@@ -2026,12 +2083,14 @@ tpcc_worker::txn_order_status()
       {
         ANON_REGION("OrderStatusOOrderScan:", &order_status_probe0_cg);
         tbl_oorder_c_id_idx(warehouse_id)->scan(txn, Encode(obj_key0, k_oo_idx_0), &Encode(obj_key1, k_oo_idx_1), c_oorder, s_arena.get());
+        TXN_STATUS_ABORT_CHECK();
       }
       ALWAYS_ASSERT(c_oorder.size());
     } else {
       latest_key_callback c_oorder(*newest_o_c_id, 1);
       const oorder_c_id_idx::key k_oo_idx_hi(warehouse_id, districtID, k_c.c_id, numeric_limits<int32_t>::max());
       tbl_oorder_c_id_idx(warehouse_id)->rscan(txn, Encode(obj_key0, k_oo_idx_hi), nullptr, c_oorder, s_arena.get());
+      TXN_STATUS_ABORT_CHECK();
       ALWAYS_ASSERT(c_oorder.size() == 1);
     }
 
@@ -2043,6 +2102,7 @@ tpcc_worker::txn_order_status()
     const order_line::key k_ol_0(warehouse_id, districtID, o_id, 0);
     const order_line::key k_ol_1(warehouse_id, districtID, o_id, numeric_limits<int32_t>::max());
     tbl_order_line(warehouse_id)->scan(txn, Encode(obj_key0, k_ol_0), &Encode(obj_key1, k_ol_1), c_order_line, s_arena.get());
+    TXN_STATUS_ABORT_CHECK();
     ALWAYS_ASSERT(c_order_line.n >= 5 && c_order_line.n <= 15);
 
     measure_txn_counters(txn, "txn_order_status");
@@ -2107,13 +2167,13 @@ tpcc_worker::txn_stock_level()
     g_disable_read_only_scans ?
       abstract_db::HINT_TPCC_STOCK_LEVEL :
       abstract_db::HINT_TPCC_STOCK_LEVEL_READ_ONLY;
-  void *txn = db->new_txn(txn_flags | read_only_mask, arena, txn_buf(), hint);
+  void *txn = db->new_txn(procedure_txn_flags() | read_only_mask, arena, txn_buf(), hint);
   scoped_str_arena s_arena(arena);
   // NB: since txn_stock_level() is a RO txn, we assume that
   // locking is un-necessary (since we can just read from some old snapshot)
   try {
     const district::key k_d(warehouse_id, districtID);
-    ALWAYS_ASSERT(tbl_district(warehouse_id)->get(txn, Encode(obj_key0, k_d), obj_v));
+    TXN_GET_OR_STATUS_ABORT(tbl_district(warehouse_id)->get(txn, Encode(obj_key0, k_d), obj_v));
     district::value v_d_temp;
     const district::value *v_d = Decode(obj_v, v_d_temp);
     checker::SanityCheckDistrict(&k_d, v_d);
@@ -2130,6 +2190,7 @@ tpcc_worker::txn_stock_level()
     {
       ANON_REGION("StockLevelOrderLineScan:", &stock_level_probe0_cg);
       tbl_order_line(warehouse_id)->scan(txn, Encode(obj_key0, k_ol_0), &Encode(obj_key1, k_ol_1), c, s_arena.get());
+      TXN_STATUS_ABORT_CHECK();
     }
     {
       small_unordered_map<uint, bool, 512> s_i_ids_distinct;
@@ -2142,7 +2203,7 @@ tpcc_worker::txn_stock_level()
         INVARIANT(p.first >= 1 && p.first <= NumItems());
         {
           ANON_REGION("StockLevelLoopJoinGet:", &stock_level_probe2_cg);
-          ALWAYS_ASSERT(tbl_stock(warehouse_id)->get(txn, Encode(obj_key0, k_s), obj_v, nbytesread));
+          TXN_GET_OR_STATUS_ABORT(tbl_stock(warehouse_id)->get(txn, Encode(obj_key0, k_s), obj_v, nbytesread));
         }
         INVARIANT(obj_v.size() <= nbytesread);
         const uint8_t *ptr = (const uint8_t *) obj_v.data();
@@ -2351,6 +2412,7 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
       {"enable-separate-tree-per-partition"   , no_argument       , &g_enable_separate_tree_per_partition , 1}   ,
       {"new-order-remote-item-pct"            , required_argument , 0                                     , 'r'} ,
       {"new-order-fast-id-gen"                , no_argument       , &g_new_order_fast_id_gen              , 1}   ,
+      {"status-aborts"                        , no_argument       , &g_status_aborts                      , 1}   ,
       {"uniform-item-dist"                    , no_argument       , &g_uniform_item_dist                  , 1}   ,
       {"order-status-scan-hack"               , no_argument       , &g_order_status_scan_hack             , 1}   ,
       {"workload-mix"                         , required_argument , 0                                     , 'w'} ,
@@ -2410,6 +2472,7 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
     cerr << "  separate_tree_per_partition  : " << g_enable_separate_tree_per_partition << endl;
     cerr << "  new_order_remote_item_pct    : " << g_new_order_remote_item_pct << endl;
     cerr << "  new_order_fast_id_gen        : " << g_new_order_fast_id_gen << endl;
+    cerr << "  status_aborts                : " << g_status_aborts << endl;
     cerr << "  uniform_item_dist            : " << g_uniform_item_dist << endl;
     cerr << "  order_status_scan_hack       : " << g_order_status_scan_hack << endl;
     cerr << "  workload_mix                 : " <<
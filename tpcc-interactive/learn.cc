@@ -1,5 +1,6 @@
 #include "learn.h"
 #include "tuple.h"
+#include "counter.h"
 #include <cassert>
 #include <chrono>
 
@@ -9,6 +10,8 @@ Policy policy[2];
 int max_k = 0;
 plan_listener global_listener;
 contention_encoder global_encoder;
+std::atomic<uint64_t> xact::g_start_ts(0);
+__thread uint64_t xact::tl_start_ts = 0;
 
 void xact::update_dependency(xact *blocked, bool is_remove)
 {
@@ -44,6 +47,68 @@ void xact::update_dependency(xact *blocked, bool is_remove)
 #endif
 }
 
+static event_counter evt_deadlock_wounds("deadlock_wounds");
+static event_counter evt_deadlock_bit_check_hits("deadlock_bit_check_hits");
+static event_counter evt_deadlock_bit_check_false_positives("deadlock_bit_check_false_positives");
+
+// whether the waits-for chain from owner leads back to self. it follows one
+// owner per blocked xact, so deadlock_bit_check_false_positives is an upper
+// bound
+static bool chain_reaches(xact *owner, const xact *self)
+{
+    xact *x = owner;
+    for (int i = 0; i < 16 && x; i++) {
+        if (x == self) return true;
+        x = x->waiting_for;
+    }
+    return false;
+}
+
+bool xact::can_wait_for(xact *owner, DeadlockPolicy dl)
+{
+    switch (dl) {
+    case dl_default:
+#if DEADLOCK == BIT_CHECK
+        return can_wait_for(owner, dl_bit_check);
+#else
+        return !has_deadlock(owner);
+#endif
+    case dl_wait_die:
+        return owner->start_ts >= start_ts;
+    case dl_wound_wait:
+        if (owner->start_ts > start_ts && !owner->wounded) {
+            owner->wounded = true;
+            ++evt_deadlock_wounds;
+        }
+        return true;
+    case dl_no_wait:
+        return false;
+    case dl_bit_check:
+        if (!bits_have_deadlock(owner)) return true;
+        ++evt_deadlock_bit_check_hits;
+        if (!chain_reaches(owner, this)) ++evt_deadlock_bit_check_false_positives;
+        return false;
+    case dl_cautious_wait:
+        return !owner->is_blocked;
+    }
+    return false;
+}
+
+bool xact::wait_commit_deps(uint32_t timeout)
+{
+    timespec start{}, now{};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < n_commit_deps; i++) {
+        while (commit_deps[i]->outcome == XACT_RUNNING) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long elapsed = (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+            if (elapsed >= timeout * 1000) return false;
+            nop_pause();
+        }
+    }
+    return true;
+}
+
 inline int min(int x, int y)
 {
     if (x < y) return x;
@@ -2,6 +2,7 @@
 #define FLEXIL_LEARN_H
 
 #include <set>
+#include <atomic>
 #include "policy.h"
 #include "cstring"
 #include <pthread.h>
@@ -25,10 +26,9 @@
 #define PROFILING(expr) (expr)
 #define PROFILE_LOCK false
 
-#if DEADLOCK == BIT_CHECK
-    #define DL_TID_TO_BIT1(id) (1ULL<<((id)%53))
-    #define DL_TID_TO_BIT2(id) (1ULL<<((id)%59))
-#endif
+// the waits-for bits of dl_bit_check (and DEADLOCK == BIT_CHECK)
+#define DL_TID_TO_BIT1(id) (1ULL<<((id)%53))
+#define DL_TID_TO_BIT2(id) (1ULL<<((id)%59))
 
 enum OpType {
     OpRead,
@@ -157,8 +157,17 @@ struct contention_encoder {
 
 extern contention_encoder global_encoder;
 
+#define MAX_COMMIT_DEPS 8
+#define XACT_RUNNING   0
+#define XACT_COMMITTED 1
+#define XACT_ABORTED   2
+
 struct xact {
     uint64_t tid;
+    // when the txn was first tried, kept while it is retried (see
+    // BeginAttempts()). the tid only names the core, so wait-die and
+    // wound-wait order txns by this instead
+    uint64_t start_ts;
     uint8_t conflict_mask;
     bool validating;
     bool is_blocked;
@@ -177,6 +186,17 @@ struct xact {
 #endif
     uint8_t debug_bits; // for debugging purpose.
     uint32_t state;
+    // early lock release: the xacts this one was handed a lock by before they
+    // resolved, it must commit after them. xacts are never freed, so the
+    // pointers stay valid after the releaser is gone
+    xact *commit_deps[MAX_COMMIT_DEPS];
+    uint32_t n_commit_deps;
+    volatile uint8_t outcome;   // XACT_RUNNING, XACT_COMMITTED or XACT_ABORTED
+    bool released_early;  // no read lock in the read lock set is held
+    // set by an older xact under dl_wound_wait, this xact aborts at its next
+    // access, lock wait or commit, whichever comes first
+    volatile bool wounded;
+    xact *volatile waiting_for;  // an owner of the lock it waits on, if blocked
     CACHE_PADOUT;
 
     ALWAYS_INLINE uint32_t encode() const {
@@ -196,6 +216,7 @@ struct xact {
 
     explicit xact(uint64_t _tid) {
         tid = _tid;
+        start_ts = tl_start_ts ? tl_start_ts : NewStartTs();
         conflict_mask = 0;
         is_blocked = false;
         cached_policy = nullptr;
@@ -211,39 +232,59 @@ struct xact {
         tx_cur_op = OpNone;
 #endif
         validating = false;
-#if DEADLOCK == BIT_CHECK
         deadlock_check_bits_mask1 = 0;
         deadlock_check_bits_mask2 = 0;
-#endif
         state = 0;
+        n_commit_deps = 0;
+        outcome = XACT_RUNNING;
+        released_early = false;
+        wounded = false;
+        waiting_for = nullptr;
+    }
+
+    bool bits_have_deadlock(xact* blocked_on) const {
+        return (deadlock_check_bits_mask1 & DL_TID_TO_BIT1(blocked_on->tid))
+                && (deadlock_check_bits_mask2 & DL_TID_TO_BIT2(blocked_on->tid));
     }
 
     // check_deadlock could report false positive.
     bool has_deadlock(xact* blocked_on) const {
 #if DEADLOCK == BIT_CHECK
-        return (deadlock_check_bits_mask1 & DL_TID_TO_BIT1(blocked_on->tid))
-                && (deadlock_check_bits_mask2 & DL_TID_TO_BIT2(blocked_on->tid));
+        return bits_have_deadlock(blocked_on);
 #elif DEADLOCK == CAUTIOUS_WAIT
         assert(!is_blocked);
         return blocked_on->is_blocked;
 #elif DEADLOCK == WAIT_DIE
-        return blocked_on->tid < tid;
+        return blocked_on->start_ts < start_ts;
 #endif
     }
 
+    // the bits are kept whatever the scheme, since each state may pick
+    // dl_bit_check
     void merge(xact *blocked_on) {
-#if DEADLOCK == BIT_CHECK
         deadlock_check_bits_mask1 |= blocked_on->deadlock_check_bits_mask1;
         deadlock_check_bits_mask2 |= blocked_on->deadlock_check_bits_mask2;
         deadlock_check_bits_mask1 |= DL_TID_TO_BIT1(blocked_on->tid);
         deadlock_check_bits_mask2 |= DL_TID_TO_BIT2(blocked_on->tid);
-#elif DEADLOCK == CAUTIOUS_WAIT
-        assert(!blocked_on->is_blocked);
-#elif DEADLOCK == WAIT_DIE
-        assert(blocked_on->tid > tid);
-#endif
     }
 
+    // whether this xact may wait on the lock owner holds, under scheme dl.
+    // dl_wound_wait wounds a younger owner as a side effect
+    bool can_wait_for(xact *owner, DeadlockPolicy dl);
+
+    // the xacts this thread makes from now on are retries of one txn, and
+    // keep its start_ts. called before the first attempt
+    static inline void BeginAttempts() {
+        tl_start_ts = NewStartTs();
+    }
+
+    static inline uint64_t NewStartTs() {
+        return g_start_ts.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    static std::atomic<uint64_t> g_start_ts;
+    static __thread uint64_t tl_start_ts; // 0: every xact starts anew
+
     ALWAYS_INLINE PolicyAction* get_cur_policy(const Policy *pg) {
         assert(tx_type > 0);
         state = encode();
@@ -268,13 +309,34 @@ struct xact {
         return cached_policy
                && cached_policy->access == detect_critical;
     }
+    inline bool need_release()
+    {
+        return cached_policy
+               && cached_policy->access == release_early;
+    }
+
+    // called by the releaser, under the latch of the lock it hands over and
+    // before the waiter sees lock_ready. if the list is full the order is
+    // left to read validation, which still catches a violation
+    void add_commit_dep(xact *releaser)
+    {
+        for (uint32_t i = 0; i < n_commit_deps; i++)
+            if (commit_deps[i] == releaser) return;
+        if (n_commit_deps < MAX_COMMIT_DEPS)
+            commit_deps[n_commit_deps++] = releaser;
+    }
+
+    // waits until every releaser this xact depends on resolved, false if one
+    // did not within timeout ms. an aborted releaser needs no cascade: writes
+    // are buffered until commit, so nothing uncommitted was ever handed out
+    bool wait_commit_deps(uint32_t timeout);
 };
 
 extern void load_policy(const std::string &f);
 extern void profiling();
 
 struct plan_listener {
-    int abort_distribution[14] = {0};
+    int abort_distribution[16] = {0};
     int state_distribution[MAX_STATE] = {0};
     uint64_t blocking_span[6] = {0};
     int n_lock_get = 0;
@@ -313,9 +375,11 @@ struct plan_listener {
                 "ABORT_REASON_LOCK_CONFLICT",
                 "ABORT_REASON_LEARNED_ABORT",
                 "ABORT_REASON_VALIDATION_LOCK_FAIL",
-                "ABORT_REASON_EARLY_VALIDATION_FAIL"
+                "ABORT_REASON_EARLY_VALIDATION_FAIL",
+                "ABORT_REASON_COMMIT_DEPENDENCY",
+                "ABORT_REASON_WOUNDED"
         };
-        for (int i=0;i<14;i++)
+        for (int i=0;i<16;i++)
             printf("%s: %d\n", names[i].c_str(), abort_distribution[i]);
         printf("<--------------------------------------->\n");
     }
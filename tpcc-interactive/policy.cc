@@ -19,6 +19,8 @@ void Policy::print_policy(std::string bench) {
         REP(j, 0, global_encoder.max_state) printf("%.2f,", policy[j].rank);
         printf("\ntimeout\n");
         REP(j, 0, global_encoder.max_state) printf("%d,", policy[j].timeout);
+        printf("\ndeadlock\n");
+        REP(j, 0, global_encoder.max_state) printf("%d,", policy[j].deadlock);
         printf("\n");
     } else if (bench == "ycsb") {
         assert(false);
@@ -80,6 +82,8 @@ void Policy::init(std::ifstream *pol_file) {
                            return detect_existing;
                        else if (ac == '3')
                            return detect_future;
+                       else if (ac == '4')
+                           return release_early;
                        else
                            ALWAYS_ASSERT(false);
                    });
@@ -91,6 +95,18 @@ void Policy::init(std::ifstream *pol_file) {
     std::vector<float> timeout_vec = parseFloatString(timeout_str);
     s = 0;
     for (auto it: timeout_vec) policy[s++].timeout = static_cast<uint32_t>(it);
+
+    // optional, older policies leave every state at dl_default
+    std::string deadlock_str;
+    if (std::getline(*pol_file, not_using) && not_using.rfind("deadlock", 0) == 0 &&
+        std::getline(*pol_file, deadlock_str)) {
+        s = 0;
+        for (char dl: deadlock_str) {
+            if (dl < '0' || dl > '5') continue;
+            ALWAYS_ASSERT(s < global_encoder.max_state);
+            policy[s++].deadlock = static_cast<DeadlockPolicy>(dl - '0');
+        }
+    }
 }
 
 void Policy::policy_gradient(const std::string &policy_f)
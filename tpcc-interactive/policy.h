@@ -71,7 +71,21 @@ enum AccessPolicy : unsigned char {
     no_detect = 0,
     detect_critical = 1,
     detect_existing = 2,
-    detect_future = 3
+    detect_future = 3,
+    // as detect_existing, but once the access is done the txn hands its read
+    // locks to their waiters, which then commit after it (early lock release)
+    release_early = 4
+};
+
+// how a lock request which would wait on the owners of an unsorted lock
+// avoids deadlocks (requests in lock order can not deadlock and always wait)
+enum DeadlockPolicy : unsigned char {
+    dl_default = 0,       // the compile time DEADLOCK scheme
+    dl_wait_die = 1,      // wait on younger owners, abort otherwise
+    dl_wound_wait = 2,    // wound younger owners, then wait
+    dl_no_wait = 3,       // abort
+    dl_bit_check = 4,     // abort if the waits-for bits say it closes a cycle
+    dl_cautious_wait = 5  // wait on owners that are not blocked themselves
 };
 
 // PolicyAction contains the basic unit of policy.
@@ -81,6 +95,7 @@ struct PolicyAction {
 #if ADD_TIMEOUT
     uint32_t timeout;
 #endif
+    DeadlockPolicy deadlock;
     CACHE_PADOUT;
 
     PolicyAction() {
@@ -89,6 +104,7 @@ struct PolicyAction {
 #if ADD_TIMEOUT
         timeout = blocked_wait;
 #endif
+        deadlock = dl_default;
     }
 
     void copy(PolicyAction *act) {
@@ -97,14 +113,17 @@ struct PolicyAction {
 #if ADD_TIMEOUT
         timeout = act->timeout;
 #endif
+        deadlock = act->deadlock;
     }
 
-    PolicyAction(AccessPolicy c_detect, WaitPriority c_rank, uint32_t c_resolve_tl) {
+    PolicyAction(AccessPolicy c_detect, WaitPriority c_rank, uint32_t c_resolve_tl,
+                 DeadlockPolicy c_deadlock = dl_default) {
         access = c_detect;
         rank = c_rank;
 #if ADD_TIMEOUT
         timeout = c_resolve_tl;
 #endif
+        deadlock = c_deadlock;
     }
 };
 
@@ -18,6 +18,7 @@ RWLock::RWLock() {
     waiters_tail = NULL;
     owner_cnt = 0;
     sorted = true;
+    early_releaser = nullptr;
 
     latch = new pthread_mutex_t;
     pthread_mutex_init(latch, NULL);
@@ -55,6 +56,29 @@ void RWLock::unlockR(uint64_t tid) {
     return lock_release(tid);
 }
 
+void RWLock::unlockR_early(uint64_t tid, xact* releaser) {
+    assert(tid == releaser->tid);
+    return lock_release(tid, releaser);
+}
+
+// under the latch, before entry is granted (and before the waiter sees
+// lock_ready). a read does not conflict with the released read, so only a
+// writer has to commit after the releaser
+inline void RWLock::add_early_release_dep(LockEntry *entry)
+{
+    xact *releaser = early_releaser;
+    if (!releaser)
+        return;
+    if (releaser->outcome != XACT_RUNNING) {
+        early_releaser = nullptr;
+        return;
+    }
+    if (entry->type == LOCK_EX && entry->locked_xact != releaser) {
+        entry->locked_xact->add_commit_dep(releaser);
+        COMPILER_MEMORY_FENCE;
+    }
+}
+
 bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact) {
 #if PROFILE_LOCK
     auto begin_ts = get_clock_ts();
@@ -88,8 +112,9 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
     if (conflict) {
         bool can_wait = true;
         if (not_sorted) {
+            const DeadlockPolicy dl = xact->cached_policy->deadlock;
             for (auto en = owners; en != nullptr && can_wait; en = en->next) {
-                if (xact->has_deadlock(en->locked_xact)) can_wait = false;
+                if (!xact->can_wait_for(en->locked_xact, dl)) can_wait = false;
             }
         }
 #if PROFILE_LOCK
@@ -117,6 +142,7 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
 
             put_waiter(entry);
             xact->is_blocked = true;
+            xact->waiting_for = owners ? owners->locked_xact : nullptr;
             pthread_mutex_unlock(latch);
 #if PROFILE_LOCK
             // blocking stage 4: in case of wait, add waiter and lock release.
@@ -124,12 +150,12 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
             begin_ts = get_clock_ts();
 #endif
             if (timeout == 0)
-                while (!entry->lock_ready) nop_pause();
+                while (!entry->lock_ready && !xact->wounded) nop_pause();
             else
             {
                 timespec start{}, now{};
                 clock_gettime(CLOCK_MONOTONIC, &start);
-                while (!entry->lock_ready)
+                while (!entry->lock_ready && !xact->wounded)
                 {
                     clock_gettime(CLOCK_MONOTONIC, &now);
                     long elapsed = (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
@@ -143,7 +169,26 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
             begin_ts = get_clock_ts();
 #endif
             xact->is_blocked = false;
-            return entry->lock_ready;
+            xact->waiting_for = nullptr;
+            if (entry->lock_ready)
+                return true;
+            // gave up (timeout or wounded): take our own waiter entry out.
+            // not lock_release(tid), an upgrade also has an owner entry of
+            // tid, which the txn still holds and releases at its abort
+            pthread_mutex_lock(latch);
+            if (entry->lock_ready) {
+                // granted meanwhile, the txn releases it like any other
+                pthread_mutex_unlock(latch);
+                return true;
+            }
+            LIST_REMOVE_HT(entry, waiters_head, waiters_tail);
+            for (auto it = owners; it; it = it->next)
+                it->locked_xact->update_dependency(xact, true);
+            return_entry(entry);
+            // the ones queued behind us may go now
+            promote();
+            pthread_mutex_unlock(latch);
+            return false;
         } else {
             pthread_mutex_unlock(latch);
             return false;
@@ -154,6 +199,7 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
         entry->tid = tid;
         entry->rank = rank;
         entry->locked_xact = xact;
+        add_early_release_dep(entry);
         STACK_PUSH(owners, entry);
 #if !ONLY_COUNT_PASSIVE_WAIT
         for (auto it = waiters_head; it; it = it->next)
@@ -167,7 +213,7 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
     }
 }
 
-void RWLock::lock_release(uint64_t tid) {
+void RWLock::lock_release(uint64_t tid, xact* releaser) {
     pthread_mutex_lock(latch);
     LockEntry* en = owners;
     LockEntry* prev = nullptr;
@@ -196,6 +242,8 @@ void RWLock::lock_release(uint64_t tid) {
             it->locked_xact->update_dependency(en->locked_xact, true);
         return_entry(en);
     }
+    if (releaser)
+        early_releaser = releaser;
     promote();
     pthread_mutex_unlock(latch);
 }
@@ -250,6 +298,7 @@ void RWLock::promote()
 #endif
         STACK_PUSH(owners, entry);
         owner_cnt++;
+        add_early_release_dep(entry);
         entry->lock_ready = true;
         lock_type = entry->type;
     }
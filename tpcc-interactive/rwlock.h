@@ -85,8 +85,11 @@ public:
     void unlockW(uint64_t tid);
     bool lockR(uint64_t tid, xact* xact, bool not_sorted = false);
     void unlockR(uint64_t tid);
+    // releases a read lock before the owner resolved, every txn taking the
+    // lock exclusively afterwards (waiting or not) must commit after releaser
+    void unlockR_early(uint64_t tid, xact* releaser);
     bool lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact);
-    void lock_release(uint64_t tid);
+    void lock_release(uint64_t tid, xact* releaser = nullptr);
     void promote();
     LockEntry* pop_best();  // pop out the transaction with optimal priority.
     void put_waiter(LockEntry *entry);
@@ -99,11 +102,16 @@ private:
     LockEntry *owners;
     LockEntry *waiters_head;
     LockEntry *waiters_tail;
+    // the last txn which released its read lock early, see unlockR_early().
+    // only one is kept: the order against an earlier one is left to its
+    // read validation
+    xact *early_releaser;
 
     bool conflict_lock(uint16_t l1, uint16_t l2);
     LockEntry* get_entry();
     void return_entry(LockEntry* entry);
     void check_correctness();
+    inline void add_early_release_dep(LockEntry *entry);
 };
 
 #endif // _RWLOCK_H_
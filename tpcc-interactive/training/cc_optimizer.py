@@ -24,7 +24,7 @@ nearly_linear = 1.1
 class CCLearner(object):
 
     def setup(self, k, v):
-        assert k in ["expose", "wait", "wait_guard", "rank", "access", "timeout"]
+        assert k in ["expose", "wait", "wait_guard", "rank", "access", "timeout", "deadlock"]
         self.setting[k] = v
         self.set_bounds()
 
@@ -39,7 +39,7 @@ class CCLearner(object):
         # Access policy parameters (adaptive field)
         access_parameters = []
         if self.setting["access"]:
-            access_parameters.extend([ng.p.Choice([0, 1, 2, 3], repetitions=self.max_state)])
+            access_parameters.extend([ng.p.Choice([0, 1, 2, 3, 4], repetitions=self.max_state)])
             check_length += self.max_state
 
         # Priority policy parameters (adaptive field)
@@ -57,11 +57,19 @@ class CCLearner(object):
                                                    upper=1000000, init=100000) for _ in range(self.max_state)])
             check_length += self.max_state
 
+        # Deadlock handling parameters (adaptive field): default, wait-die,
+        # wound-wait, no-wait, bit check, cautious wait
+        deadlock_parameters = []
+        if self.setting.get("deadlock", False):
+            deadlock_parameters.extend([ng.p.Choice([0, 1, 2, 3, 4, 5], repetitions=self.max_state)])
+            check_length += self.max_state
+
         # Combine the policies into the Instrumentation
         self.bounds = ng.p.Instrumentation(
             access=ng.p.Tuple(*access_parameters),
             rank=ng.p.Tuple(*rank_parameters),
-            timeout=ng.p.Tuple(*timeout_parameters)
+            timeout=ng.p.Tuple(*timeout_parameters),
+            deadlock=ng.p.Tuple(*deadlock_parameters)
         )
 
         self.check_encoder_length = check_length
@@ -210,6 +218,7 @@ class Policy(object):
             self.access = np.array(_access)
             self.rank = np.array(_rank)
             self.timeout_policy = _timeout
+            self.deadlock = np.zeros(self.max_state, dtype=int)
         self._hash = hash(self.__str__())
 
     # float_correction is used to correct the .
@@ -228,6 +237,9 @@ class Policy(object):
         expose_str = [str(value) + ' ' for value in self.timeout_policy]
         f_out.writelines(expose_str)
         f_out.write("\n")
+        f_out.write("deadlock handling:\n")
+        f_out.writelines([str(int(value)) for value in self.deadlock])
+        f_out.write("\n")
         f_out.write("learner encoding = \n{encoded_params}\n".format(encoded_params=self.encode()))
 
     def read_from_file(self, file):
@@ -248,6 +260,13 @@ class Policy(object):
             values = file.readline().strip().split()
             self.timeout_policy = np.array([float(value) for value in values])
             assert len(values) == n
+        # optional, older policies use the default scheme everywhere
+        self.deadlock = np.zeros(n, dtype=int)
+        cur_line = file.readline()
+        if "deadlock" in cur_line:
+            values = file.readline().strip()
+            self.deadlock = np.array([int(value) for value in values])
+            assert len(values) == n
         return res
 
     def save_to_path(self, path):
@@ -262,6 +281,7 @@ class Policy(object):
         access_params = ()
         rank_params = ()
         timeout_params = ()
+        deadlock_params = ()
 
         # Encode the 'access' policy parameters
         if self.learner.setting["access"]:
@@ -276,10 +296,15 @@ class Policy(object):
         if self.learner.setting["timeout"]:
             timeout_params = tuple(self.timeout_policy)
 
+        # Encode the 'deadlock' policy parameters
+        if self.learner.setting.get("deadlock", False):
+            deadlock_params = (tuple(self.deadlock),)
+
         return {
             "access": access_params,
             "rank": rank_params,
-            "timeout": timeout_params
+            "timeout": timeout_params,
+            "deadlock": deadlock_params
         }
 
     def decode(self, param_dict):
@@ -310,6 +335,14 @@ class Policy(object):
         else:
             self.timeout_policy = self.learner.best_policy.timeout_policy
 
+        # Handle 'deadlock' policy
+        if self.learner.setting.get("deadlock", False):
+            deadlock_values = param_dict.get("deadlock", None)[0]
+            assert deadlock_values is not None, "Expected deadlock_values to be provided, but got None."
+            self.deadlock = np.array(deadlock_values, dtype=int)
+        else:
+            self.deadlock = self.learner.best_policy.deadlock
+
     def hash(self):
         return hash(json.dumps(self.encode(), sort_keys=True, default=convert_np))
 
@@ -77,7 +77,9 @@ training_pipeline = [
      "learner": ng.optimizers.ParametrizedBO(gp_parameters={'alpha': 1e-2}).set_name("BO")},
     {"rank": False, "access": False, "timeout": True, "patient": 100,
      "learner": ng.optimizers.ParametrizedBO(gp_parameters={'alpha': 1e-2}).set_name("BO")},
-    {"rank": True, "access": True, "timeout": True, "patient": 10000,
+    {"rank": False, "access": False, "timeout": False, "deadlock": True, "patient": 100,
+     "learner": ng.optimizers.ParametrizedBO(gp_parameters={'alpha': 1e-2}).set_name("BO")},
+    {"rank": True, "access": True, "timeout": True, "deadlock": True, "patient": 10000,
      "learner": ng.optimizers.ParametrizedBO(gp_parameters={'alpha': 1e-2}).set_name("BO")},
 ]
 
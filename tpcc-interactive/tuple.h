@@ -426,6 +426,11 @@ public:
     rwlock.unlockR(txn_id);
   }
 
+  inline void end_read_early(uint64_t txn_id, xact* xact)
+  {
+    rwlock.unlockR_early(txn_id, xact);
+  }
+
   inline bool start_write(uint64_t txn_id, xact* xact, bool not_sorted = true)
   {
       return rwlock.lockW(txn_id, xact, not_sorted);
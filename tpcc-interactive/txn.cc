@@ -61,6 +61,12 @@ event_counter transaction_base::g_evt_dbtuple_write_search_failed
     ("dbtuple_write_search_failed");
 event_counter transaction_base::g_evt_dbtuple_write_insert_failed
     ("dbtuple_write_insert_failed");
+event_counter transaction_base::g_evt_early_lock_releases
+    ("early_lock_releases");
+event_counter transaction_base::g_evt_commit_dep_waits
+    ("commit_dep_waits");
+event_counter transaction_base::g_evt_status_aborts("status_aborts");
+event_avg_counter transaction_base::g_evt_avg_abort_unwind_cycles("avg_abort_unwind_cycles");
 
 event_counter transaction_base::evt_local_search_lookups("local_search_lookups");
 event_counter transaction_base::evt_local_search_write_set_hits("local_search_write_set_hits");
@@ -76,6 +76,11 @@ public:
     // txn is aborted
     TXN_FLAG_READ_ONLY = 0x2,
 
+    // a read whose lock cannot be taken marks the txn aborted and fails
+    // instead of throwing transaction_abort_exception. the caller checks
+    // should_abort() when a read fails, every other abort still throws
+    TXN_FLAG_STATUS_ABORTS = 0x4,
+
     // XXX: more flags in the future, things like consistency levels
   };
 
@@ -93,7 +98,9 @@ public:
     x(ABORT_REASON_LOCK_CONFLICT)\
     x(ABORT_REASON_LEARNED_ABORT)\
     x(ABORT_REASON_VALIDATION_LOCK_FAIL)\
-    x(ABORT_REASON_EARLY_VALIDATION_FAIL)
+    x(ABORT_REASON_EARLY_VALIDATION_FAIL)\
+    x(ABORT_REASON_COMMIT_DEPENDENCY)\
+    x(ABORT_REASON_WOUNDED)
 
   enum abort_reason {
 #define ENUM_X(x) x,
@@ -371,6 +378,13 @@ protected:
   static event_counter g_evt_read_logical_deleted_node_scan;
   static event_counter g_evt_dbtuple_write_search_failed;
   static event_counter g_evt_dbtuple_write_insert_failed;
+  static event_counter g_evt_early_lock_releases;
+  static event_counter g_evt_commit_dep_waits;
+
+  // reads failed by fail_access(), and the cycles from there until the
+  // procedure called abort(), which is what unwinding the abort costs
+  static event_counter g_evt_status_aborts;
+  static event_avg_counter g_evt_avg_abort_unwind_cycles;
 
   static event_counter evt_local_search_lookups;
   static event_counter evt_local_search_write_set_hits;
@@ -687,9 +701,23 @@ public:
   inline void
   abort()
   {
+    if (access_abort_tsc)
+      g_evt_avg_abort_unwind_cycles.offer(rdtsc() - access_abort_tsc);
     abort_impl(ABORT_REASON_USER);
   }
 
+  inline bool
+  should_abort() const
+  {
+    return state == TXN_ABRT;
+  }
+
+  inline bool
+  status_aborted() const
+  {
+    return (get_flags() & TXN_FLAG_STATUS_ABORTS) && state == TXN_ABRT;
+  }
+
   void dump_debug_info() const;
 
 #ifdef DIE_ON_ABORT
@@ -868,6 +896,43 @@ protected:
 protected:
   inline void clear();
 
+  // an older txn wounded this one (dl_wound_wait)
+  inline void check_wounded();
+
+  // aborts the txn from within a read: releases its locks and throws r, or
+  // with TXN_FLAG_STATUS_ABORTS returns false for the read to fail
+  inline bool fail_access(abort_reason r);
+
+  // why a lock could not be taken
+  inline transaction_base::abort_reason
+  lock_conflict_reason() const
+  {
+    return unlikely(get_state()->wounded) ?
+      transaction_base::ABORT_REASON_WOUNDED :
+      transaction_base::ABORT_REASON_LOCK_CONFLICT;
+  }
+
+  // the access just done runs under release_early: hand every read lock
+  // held to its waiters now instead of at commit. do_tuple_read() records
+  // every locked read in the read set, so commit validates them like the
+  // reads of an unlocked access: a writer committing in between aborts us.
+  // the writers which take a released lock commit after us instead (see
+  // RWLock::unlockR_early()). until the next read lock is taken, commit and
+  // abort have no read lock left to walk
+  inline void release_locks_early()
+  {
+    if (likely(!get_state()->need_release()))
+      return;
+    typename lock_set_map::iterator it     = read_lock_set.begin();
+    typename lock_set_map::iterator it_end = read_lock_set.end();
+    for (; it != it_end; ++it) if (it->get_locked()) {
+      it->unlock();
+      const_cast<dbtuple *>(it->get_tuple())->end_read_early(get_tid(), get_state());
+      ++g_evt_early_lock_releases;
+    }
+    get_state()->released_early = true;
+  }
+
   // SLOW accessor methods- used for invariant checking
 
   inline void release_read_lock(const dbtuple* tuple)
@@ -959,6 +1024,9 @@ protected:
   std::string lock_key;
   bool sorted = false;
 
+  // rdtsc() when fail_access() aborted the txn, 0 if it did not
+  uint64_t access_abort_tsc = 0;
+
   volatile tid_t tid;
 
   string_allocator_type *sa;
@@ -56,6 +56,31 @@ transaction<Protocol, Traits>::clear()
   sorted = true;
 }
 
+template <template <typename> class Protocol, typename Traits>
+void
+transaction<Protocol, Traits>::check_wounded()
+{
+  if (unlikely(get_state()->wounded)) {
+    const transaction_base::abort_reason r = transaction_base::ABORT_REASON_WOUNDED;
+    abort_impl(r);
+    throw transaction_abort_exception(r);
+  }
+}
+
+template <template <typename> class Protocol, typename Traits>
+bool
+transaction<Protocol, Traits>::fail_access(abort_reason r)
+{
+  abort_impl(r);
+  state = TXN_ABRT;
+  access_abort_tsc = rdtsc();
+  if (!(get_flags() & TXN_FLAG_STATUS_ABORTS))
+    throw transaction_abort_exception(r);
+  reason = r;
+  ++g_evt_status_aborts;
+  return false;
+}
+
 template <template <typename> class Protocol, typename Traits>
 void
 transaction<Protocol, Traits>::abort_impl(abort_reason reason)
@@ -73,7 +98,8 @@ transaction<Protocol, Traits>::abort_impl(abort_reason reason)
     }
   }
 
-  if (!read_lock_set.empty()) {
+  // see release_locks_early()
+  if (!read_lock_set.empty() && !get_state()->released_early) {
     typename lock_set_map::iterator it = read_lock_set.begin();
     typename lock_set_map::iterator it_end = read_lock_set.end();
     for (; it != it_end; ++it) if(it->get_locked()) {
@@ -81,6 +107,7 @@ transaction<Protocol, Traits>::abort_impl(abort_reason reason)
         tuple->end_read(get_tid());
     }
   }
+  get_state()->outcome = XACT_ABORTED;
   clear();
 }
 
@@ -308,6 +335,22 @@ transaction<Protocol, Traits>::commit(bool doThrow)
   INVARIANT(!is_snapshot() || write_set.empty());
   INVARIANT(!is_snapshot() || absent_set.empty());
   if (!is_snapshot()) {
+    if (unlikely(get_state()->wounded)) {
+      abort_trap((reason = ABORT_REASON_WOUNDED));
+      goto do_abort;
+    }
+
+    // commit after every txn which handed us a lock early, so its read
+    // validation is not failed by our writes
+    if (get_state()->n_commit_deps) {
+      ++g_evt_commit_dep_waits;
+      const PolicyAction *act = get_state()->cached_policy;
+      if (unlikely(!get_state()->wait_commit_deps(act ? act->timeout : blocked_wait))) {
+        abort_trap((reason = ABORT_REASON_COMMIT_DEPENDENCY));
+        goto do_abort;
+      }
+    }
+
     // we don't have consistent tids, or not a read-only txn
     // lock write nodes
     if (!write_dbtuples.empty()) {
@@ -472,7 +515,8 @@ transaction<Protocol, Traits>::commit(bool doThrow)
         tuple->end_write(get_tid());
       }
     }
-    if (!read_lock_set.empty()) {
+    // see release_locks_early()
+    if (!read_lock_set.empty() && !get_state()->released_early) {
       typename lock_set_map::iterator it = read_lock_set.begin();
       typename lock_set_map::iterator it_end = read_lock_set.end();
       for (; it != it_end; ++it) {
@@ -483,6 +527,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
     }
   }
   state = TXN_COMMITED;
+  get_state()->outcome = XACT_COMMITTED;
   if (commit_tid.first)
     cast()->on_tid_finish(commit_tid.second);
   clear();
@@ -578,7 +623,7 @@ transaction<Protocol, Traits>::try_insert_new_tuple(
       {
           if (!tuple->start_write(get_tid(), get_state(), not_sorted()))
           {
-              const transaction_base::abort_reason r = transaction_base::ABORT_REASON_LOCK_CONFLICT;
+              const transaction_base::abort_reason r = lock_conflict_reason();
               abort_impl(r);
               throw transaction_abort_exception(r);
           }
@@ -644,6 +689,7 @@ transaction<Protocol, Traits>::do_tuple_read(
   } else {
     get_state()->cached_policy = nullptr;
   }
+  check_wounded();
 
   // do the actual tuple read
   dbtuple::ReadStatus stat;
@@ -667,12 +713,9 @@ transaction<Protocol, Traits>::do_tuple_read(
           if (it_r == read_set.end())
           {
             if (!t_ptr->start_read(get_tid(), get_state(), not_sorted()))
-            {
-              const transaction_base::abort_reason r = transaction_base::ABORT_REASON_LOCK_CONFLICT;
-              abort_impl(r);
-              throw transaction_abort_exception(r);
-            }
+              return fail_access(lock_conflict_reason());
             read_lock_set.emplace_back(tuple, true);
+            get_state()->released_early = false;
             stat = tuple->stable_read(snapshot_tid, start_t, value_reader, this->string_allocator(), is_snapshot_txn);
           } else {
             stat = tuple->stable_read(snapshot_tid, start_t, value_reader, this->string_allocator(), is_snapshot_txn);
@@ -689,11 +732,7 @@ transaction<Protocol, Traits>::do_tuple_read(
           if (it_r == write_set.end())
           {
             if (!t_ptr->start_write(get_tid(), get_state(), not_sorted()))
-            {
-              const transaction_base::abort_reason r = transaction_base::ABORT_REASON_LOCK_CONFLICT;
-              abort_impl(r);
-              throw transaction_abort_exception(r);
-            }
+              return fail_access(lock_conflict_reason());
             write_lock_set.emplace_back(tuple, true);
             stat = tuple->read(snapshot_tid, start_t, value_reader, this->string_allocator());
           } else {
@@ -726,10 +765,13 @@ transaction<Protocol, Traits>::do_tuple_read(
     ++transaction_base::g_evt_read_logical_deleted_node_search;
   if (!is_snapshot_txn && !get_state()->need_lock())
      // read-only txns do not need read-set tracking
-     // (b/c we know the values are consistent)
+     // (b/c we know the values are consistent). locked reads were recorded
+     // above, release_locks_early() relies on them being validated
      read_set.emplace_back(tuple, start_t);
   if (!is_snapshot_txn && get_state()->need_validate())
      early_validation();
+  if (!is_snapshot_txn)
+     release_locks_early();
   return !v_empty;
 }
 
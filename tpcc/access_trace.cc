@@ -0,0 +1,71 @@
+#include <iostream>
+#include <fstream>
+#include <tuple>
+
+#include "access_trace.h"
+#include "learn.h"
+#include "lockguard.h"
+
+using namespace std;
+
+bool access_trace::g_enabled = false;
+percore_lazy<map<access_trace::entry, uint64_t>> access_trace::g_entries;
+map<const void *, string> access_trace::g_tables;
+spinlock access_trace::g_tables_lock;
+
+static string
+op_name(uint8_t op, uint8_t kind)
+{
+  switch (op) {
+  case OpRead:    return "read";
+  case OpUpdate:  return "update";
+  case OpInsert:  return "insert";
+  case OpScan:    return "scan";
+  case OpCommute: return string("commute_") + commutative_kind_name(commutative_kind(kind));
+  default:        return "other";
+  }
+}
+
+void
+access_trace::RegisterTable(const void *btr, const string &name)
+{
+  ::lock_guard<spinlock> l(g_tables_lock);
+  g_tables[btr] = name;
+}
+
+string
+access_trace::TableName(const void *btr)
+{
+  ::lock_guard<spinlock> l(g_tables_lock);
+  auto it = g_tables.find(btr);
+  return it == g_tables.end() ? "<unknown>" : it->second;
+}
+
+void
+access_trace::Dump(const string &file)
+{
+  // merge the cores, and the trees of one table
+  map<tuple<uint32_t, uint32_t, string, uint32_t, uint8_t, uint8_t>, uint64_t> merged;
+  for (size_t i = 0; i < NMAXCORES; i++) {
+    const map<entry, uint64_t> *m = g_entries.view(i);
+    if (!m)
+      continue;
+    for (auto &p : *m) {
+      merged[make_tuple(p.first.txn_type_, p.first.acc_id_, TableName(p.first.btr_),
+                        p.first.key_class_, p.first.op_, p.first.kind_)] += p.second;
+    }
+  }
+
+  ofstream out(file);
+  if (!out.is_open()) {
+    cerr << "Could not open access trace file: " << file << endl;
+    ALWAYS_ASSERT(false);
+  }
+  out << "# txn_type acc_id table key_class op count" << endl;
+  for (auto &p : merged)
+    out << get<0>(p.first) << " " << get<1>(p.first) << " "
+        << get<2>(p.first) << " " << get<3>(p.first) << " "
+        << op_name(get<4>(p.first), get<5>(p.first)) << " " << p.second << endl;
+  cerr << "access trace: " << merged.size() << " tuples written to "
+       << file << endl;
+}
@@ -0,0 +1,81 @@
+#ifndef _ACCESS_TRACE_H_
+#define _ACCESS_TRACE_H_
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+#include "conflict_graph.h"
+#include "macros.h"
+#include "core.h"
+#include "spinlock.h"
+
+// access tracing, to derive the static chopping of a workload instead of
+// analysing it by hand (see benchmarks/derive_chopping.cc).
+//
+// while enabled every policy governed access, and every commutative update,
+// records a
+//   (txn type, access id, table, key class, op)
+// tuple, where the key class is the length of the key (which tells apart
+// the differently shaped keys one tree may hold) and op is an OpType, for a
+// commutative update together with its commutative_kind. the
+// tuples are aggregated per core, so a short run is enough and the counts
+// only say how often each one was seen
+class access_trace {
+public:
+
+  struct entry {
+    uint32_t txn_type_;
+    uint32_t acc_id_;
+    const void *btr_;
+    uint32_t key_class_;
+    uint8_t op_;
+    uint8_t kind_; // commutative_kind, CommutativeNone unless OpCommute
+
+    inline bool
+    operator<(const entry &that) const
+    {
+      if (txn_type_ != that.txn_type_)
+        return txn_type_ < that.txn_type_;
+      if (acc_id_ != that.acc_id_)
+        return acc_id_ < that.acc_id_;
+      if (btr_ != that.btr_)
+        return btr_ < that.btr_;
+      if (key_class_ != that.key_class_)
+        return key_class_ < that.key_class_;
+      if (op_ != that.op_)
+        return op_ < that.op_;
+      return kind_ < that.kind_;
+    }
+  };
+
+  static bool g_enabled;
+
+  // names the tree btr, the tuples are dumped by table name. trees sharing
+  // a name (e.g. partitions of one table) are one table
+  static void RegisterTable(const void *btr, const std::string &name);
+
+  // the name btr was registered with, "<unknown>" if none
+  static std::string TableName(const void *btr);
+
+  static inline ALWAYS_INLINE void
+  Record(uint32_t txn_type, uint32_t acc_id, const void *btr,
+         size_t klen, uint8_t op, commutative_kind kind = CommutativeNone)
+  {
+    const entry e = {txn_type, acc_id, btr, uint32_t(klen), op, kind};
+    g_entries.my()[e]++;
+  }
+
+  // writes one line per distinct tuple:
+  //   <txn type> <access id> <table> <key class> <op> <count>
+  // where a commutative update is op commute_<kind>, e.g. commute_add
+  // must be called once the workers are done
+  static void Dump(const std::string &file);
+
+private:
+  static percore_lazy<std::map<entry, uint64_t>> g_entries;
+  static std::map<const void *, std::string> g_tables;
+  static spinlock g_tables_lock;
+};
+
+#endif /* _ACCESS_TRACE_H_ */
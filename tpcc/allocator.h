@@ -22,6 +22,13 @@ public:
 
   static void DumpStats();
 
+  // true once Initialize() has run (ie with --numa-memory)
+  static inline bool
+  IsInitialized()
+  {
+    return g_ncpus;
+  }
+
   // returns an arena linked-list
   static void *
   AllocateArenas(size_t cpu, size_t sz);
@@ -38,6 +38,7 @@ public:
       been_destructed(false)
   {
     base_txn_btree_handler<Transaction>::on_construct();
+    access_trace::RegisterTable(&underlying_btree, name);
   }
 
   ~base_txn_btree()
@@ -80,6 +81,38 @@ public:
     return table_order;
   }
 
+  inline void
+  set_log_id(uint32_t id)
+  {
+    underlying_btree.set_log_id(id);
+  }
+
+  /**
+   * only call when there are no concurrent operations on the tree, see
+   * mbtree::build_hash_index()
+   */
+  inline void
+  build_hash_index()
+  {
+    underlying_btree.build_hash_index();
+  }
+
+  /**
+   * only call before the tree is used, see mbtree::set_sequential_splits()
+   */
+  inline void
+  set_sequential_splits(bool x)
+  {
+    underlying_btree.set_sequential_splits(x);
+  }
+
+  // see mbtree::leaf_stats()
+  inline void
+  leaf_stats(size_t &nleaves, size_t &nslots, size_t &nbytes) const
+  {
+    underlying_btree.leaf_stats(nleaves, nslots, nbytes);
+  }
+
   /**
    * only call when you are sure there are no concurrent modifications on the
    * tree. is neither threadsafe nor transactional
@@ -197,6 +230,18 @@ protected:
             ValueReader &value_reader,
             uint32_t acc_id = MAX_ACC_ID);
 
+  // do_search() of a key which need only live for the call
+  template <typename Traits, typename ValueReader>
+  inline bool
+  do_search_key(Transaction<Traits> &t,
+                const varkey &k,
+                ValueReader &value_reader,
+                uint32_t acc_id = MAX_ACC_ID)
+  {
+    t.ensure_active();
+    return t.do_get(this->underlying_btree, k, value_reader, acc_id);
+  }
+
   template <typename Traits, typename ValueReader>
   inline bool
   profile_do_search(Transaction<Traits> &t,
@@ -239,6 +284,26 @@ protected:
                    bool expect_new,
                    uint32_t acc_id = MAX_ACC_ID);
 
+  // get/put of a key set known up front, in batches of MULTI_OP_BATCH keys
+  // each taking one policy decision. reader_at(i) returns the ValueReader for
+  // keys[i]. returns the number of keys found
+  template <typename Traits, typename ReaderAt>
+  inline size_t
+  do_multi_search(Transaction<Traits> &t,
+                  const typename P::Key *keys,
+                  size_t n,
+                  ReaderAt &reader_at,
+                  bool *found,
+                  uint32_t acc_id = MAX_ACC_ID);
+
+  template <typename Traits>
+  void do_multi_tree_put(Transaction<Traits> &t,
+                         const std::string *const *keys,
+                         const typename P::Value *const *values,
+                         size_t n,
+                         dbtuple::tuple_writer_t writer,
+                         uint32_t acc_id = MAX_ACC_ID);
+
   template <typename Traits, typename ValueReader>
   void do_tree_update(Transaction<Traits> &t,
                       const std::string *k,
@@ -253,7 +318,9 @@ protected:
                           const std::string *key,
                           dbtuple::tuple_commutative_act act,
                           uint64_t param,
-                          dbtuple::tuple_writer_t writer);
+                          commutative_kind kind,
+                          dbtuple::tuple_writer_t writer,
+                          uint32_t acc_id = MAX_ACC_ID);
 
   concurrent_btree underlying_btree;
   size_type value_size_hint;
@@ -285,6 +352,34 @@ base_txn_btree<Transaction, P>::do_search(
 }
 
 
+template <template <typename> class Transaction, typename P>
+template <typename Traits, typename ReaderAt>
+size_t
+base_txn_btree<Transaction, P>::do_multi_search(
+    Transaction<Traits> &t,
+    const typename P::Key *keys,
+    size_t n,
+    ReaderAt &reader_at,
+    bool *found,
+    uint32_t acc_id)
+{
+  t.ensure_active();
+
+  size_t nfound = 0;
+  const std::string *key_strs[MULTI_OP_BATCH];
+  for (size_t off = 0; off < n; off += MULTI_OP_BATCH) {
+    const size_t m = std::min(n - off, size_t(MULTI_OP_BATCH));
+    for (size_t i = 0; i < m; i++) {
+      typename P::KeyWriter key_writer(&keys[off + i]);
+      key_strs[i] = key_writer.fully_materialize(true, t.string_allocator());
+    }
+    auto batch_reader_at = [&reader_at, off](size_t i) { return reader_at(off + i); };
+    nfound += t.do_multi_get(this->underlying_btree, key_strs, m,
+                             batch_reader_at, found + off, acc_id);
+  }
+  return nfound;
+}
+
 template <template <typename> class Transaction, typename P>
 template <typename Traits, typename ValueReader>
 bool
@@ -412,6 +507,8 @@ void base_txn_btree<Transaction, P>::do_tree_put(
 
 
   if(!res) {
+    if (t.status_aborted())
+      return;
     const transaction_base::abort_reason r = transaction_base::ABORT_REASON_INSERT_NODE_INTERFERENCE;
     t.abort_impl(r);
     throw transaction_abort_exception(r);
@@ -419,6 +516,41 @@ void base_txn_btree<Transaction, P>::do_tree_put(
 
 }
 
+template <template <typename> class Transaction, typename P>
+template <typename Traits>
+void base_txn_btree<Transaction, P>::do_multi_tree_put(
+    Transaction<Traits> &t,
+    const std::string *const *keys,
+    const typename P::Value *const *values,
+    size_t n,
+    dbtuple::tuple_writer_t writer,
+    uint32_t acc_id)
+{
+  t.ensure_active();
+
+  if (unlikely(t.is_snapshot())) {
+    const transaction_base::abort_reason r = transaction_base::ABORT_REASON_USER;
+    t.abort_impl(r);
+    throw transaction_abort_exception(r);
+  }
+
+  void *vals[MULTI_OP_BATCH];
+  for (size_t off = 0; off < n; off += MULTI_OP_BATCH) {
+    const size_t m = std::min(n - off, size_t(MULTI_OP_BATCH));
+    for (size_t i = 0; i < m; i++) {
+      INVARIANT(keys[off + i] && values[off + i]);
+      vals[i] = (void *)(values[off + i]);
+    }
+    if (!t.do_multi_put(this->underlying_btree, keys + off, vals, m, writer, acc_id)) {
+      if (t.status_aborted())
+        return;
+      const transaction_base::abort_reason r = transaction_base::ABORT_REASON_INSERT_NODE_INTERFERENCE;
+      t.abort_impl(r);
+      throw transaction_abort_exception(r);
+    }
+  }
+}
+
 template <template <typename> class Transaction, typename P>
 template <typename Traits, typename ValueReader>
 void base_txn_btree<Transaction, P>::do_tree_update(
@@ -436,6 +568,8 @@ void base_txn_btree<Transaction, P>::do_tree_update(
   bool res = t.do_update(this->underlying_btree, k, value_reader, callback, writer, acc_id);
 
   if(!res) {
+    if (t.status_aborted())
+      return;
     const transaction_base::abort_reason r = transaction_base::ABORT_REASON_INSERT_NODE_INTERFERENCE;
     t.abort_impl(r);
     throw transaction_abort_exception(r);
@@ -449,9 +583,14 @@ void base_txn_btree<Transaction, P>::do_commutative_act(Transaction<Traits> &t,
                                       const std::string *k,
                                       dbtuple::tuple_commutative_act act,
                                       uint64_t param,
-                                      dbtuple::tuple_writer_t w)
+                                      commutative_kind kind,
+                                      dbtuple::tuple_writer_t w,
+                                      uint32_t acc_id)
 {
   t.ensure_active();
+  // never blocks nor exposes, only keeps the step count for the policy
+  t.update_txn_step(acc_id);
+  t.trace_access(this->underlying_btree, k->size(), acc_id, OpCommute, kind);
 
   typename concurrent_btree::value_type bv = 0;
   ALWAYS_ASSERT(this->underlying_btree.search(varkey(*k), bv));
@@ -460,7 +599,7 @@ void base_txn_btree<Transaction, P>::do_commutative_act(Transaction<Traits> &t,
 
   ALWAYS_ASSERT(tuple);
 
-  // t.commutative_set.emplace_back(tuple, k, act, param, &this->underlying_btree, w);
+  t.commutative_set.emplace_back(tuple, k, act, param, &this->underlying_btree, w);
 
 }
 
@@ -517,7 +656,8 @@ base_txn_btree<Transaction, P>::do_search_range_call(
   t.ensure_active();
   t.update_txn_step(acc_id);
   auto pa = t.refresh_policy(acc_id, OpScan);
-  t.before_access_operation(pa);
+  if (!t.before_access_operation(pa))
+    return;
   bool occ = t.inference_scan_access(pa);
 
   if (upper)
@@ -539,6 +679,7 @@ base_txn_btree<Transaction, P>::do_search_range_call(
 
   if (unlikely(upper_str && *upper_str <= *lower_str))
     return;
+  t.trace_access(this->underlying_btree, lower_str->size(), acc_id, OpScan);
 
   txn_search_range_callback<Traits, Callback, KeyReader, ValueReader> c(
 			&t, &callback, &key_reader, &value_reader);
@@ -578,7 +719,8 @@ base_txn_btree<Transaction, P>::do_rsearch_range_call(
   t.ensure_active();
   t.update_txn_step(acc_id);
   auto pa = t.refresh_policy(acc_id, OpScan);
-  t.before_access_operation(pa);
+  if (!t.before_access_operation(pa))
+    return;
   bool occ = t.inference_scan_access(pa);
 
   typename P::KeyWriter lower_key_writer(lower);
@@ -591,6 +733,7 @@ base_txn_btree<Transaction, P>::do_rsearch_range_call(
 
   if (unlikely(lower_str && *upper_str <= *lower_str))
     return;
+  t.trace_access(this->underlying_btree, upper_str->size(), acc_id, OpScan);
 
   txn_search_range_callback<Traits, Callback, KeyReader, ValueReader> c(
 			&t, &callback, &key_reader, &value_reader);
@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# cost per abort, exception vs. status aborts: TPC-C new-order/payment under
+# the sample ic3 policy with its wait timeouts cut to TIMEOUT ns, so most
+# txns abort in a policy wait, with and without --status-aborts. compare
+# avg_abort_unwind_cycles (fail_access() to the procedure's abort)
+#
+#   ./benchmarks/abort_runner.sh <prefix>
+
+set -x
+
+BENCH=./dbtest
+NTHREADS=${NTHREADS:-4}
+RUNTIME=${RUNTIME:-10}
+TIMEOUT=${TIMEOUT:-1000}
+PREFIX=$1
+
+mkdir -p results
+POLICY=results/$PREFIX-timeout-$TIMEOUT.txt
+sed "/^timeout:/{n;s/[0-9]\+/$TIMEOUT/g}" training/samples/ic3.txt > $POLICY
+
+run() {
+  $BENCH \
+    --verbose \
+    --bench tpcc \
+    --retry-aborted-transactions \
+    --parallel-loading \
+    --scale-factor 1 \
+    --num-threads $NTHREADS \
+    --runtime $RUNTIME \
+    --policy $POLICY \
+    --bench-opts "--workload-mix 50,50,0,0,0 $*" 2>&1 | \
+    grep -E "agg_throughput|agg_abort_rate|avg_abort_unwind_cycles|status_aborts"
+}
+
+run > results/$PREFIX-aborts-throw.txt
+run --status-aborts > results/$PREFIX-aborts-status.txt
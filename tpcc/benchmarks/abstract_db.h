@@ -72,6 +72,17 @@ public:
 
   virtual void reset_ntxn_persisted() { }
 
+  /**
+   * With logging a commit is only durable, and so acknowledged, once the
+   * whole epoch it committed in is. take_commit_epoch() returns that epoch
+   * for the last txn this thread committed, once (0 if there is nothing to
+   * wait for), is_epoch_persisted() whether it is durable yet. See
+   * bench_worker::run()
+   */
+  virtual uint64_t take_commit_epoch() { return 0; }
+
+  virtual bool is_epoch_persisted(uint64_t e) const { return true; }
+
   enum TxnProfileHint {
     HINT_DEFAULT,
 
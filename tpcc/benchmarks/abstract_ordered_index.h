@@ -6,11 +6,13 @@
 #include <utility>
 #include <map>
 
+#include "../conflict_graph.h"
 #include "../macros.h"
 #include "../policy.h"
 #include "../str_arena.h"
 #include "../tuple.h"
 #include "../update_callback.h"
+#include "../varkey.h"
 
 /**
  * The underlying index manages memory for keys/values, but
@@ -32,6 +34,67 @@ public:
       size_t max_bytes_read = std::string::npos,
       uint32_t acc_id = MAX_ACC_ID) = 0;
 
+  /**
+   * get() of a fixed-width key encoded with EncodeKey(), which spares the
+   * caller the std::string of the key. The default implementation goes
+   * through one
+   */
+  virtual bool get(
+      void *txn,
+      const packed_key &key,
+      std::string &value,
+      size_t max_bytes_read = std::string::npos,
+      uint32_t acc_id = MAX_ACC_ID)
+  {
+    std::string k;
+    return get(txn, key.str(k), value, max_bytes_read, acc_id);
+  }
+
+  /**
+   * Receives the bytes of the record get_decoded() reads. They are only
+   * valid during the call and not necessarily stable yet: if they changed
+   * meanwhile the read is retried and the decoder called again, so it may
+   * only write state the next call overwrites. Returns false if the bytes
+   * are not a valid record: torn bytes are retried as well, while bytes
+   * which did not change meanwhile abort the txn (an unstable read)
+   */
+  class value_decoder {
+  public:
+    virtual ~value_decoder() {}
+    virtual bool operator()(const uint8_t *data, size_t sz) = 0;
+  };
+
+  /**
+   * Like get(), but decodes the record straight out of storage instead of
+   * copying it into a string first. What was read is validated at commit
+   * like for get(). The default implementation decodes a copy
+   */
+  virtual bool get_decoded(
+      void *txn,
+      const std::string &key,
+      value_decoder &decoder,
+      uint32_t acc_id = MAX_ACC_ID)
+  {
+    std::string value;
+    if (!get(txn, key, value, std::string::npos, acc_id))
+      return false;
+    ALWAYS_ASSERT(decoder((const uint8_t *) value.data(), value.size()));
+    return true;
+  }
+
+  /**
+   * get_decoded() of a key encoded with EncodeKey(), see get()
+   */
+  virtual bool get_decoded(
+      void *txn,
+      const packed_key &key,
+      value_decoder &decoder,
+      uint32_t acc_id = MAX_ACC_ID)
+  {
+    std::string k;
+    return get_decoded(txn, key.str(k), decoder, acc_id);
+  }
+
   virtual bool get_profile(
     void *txn,
       const std::string &key,
@@ -39,6 +102,28 @@ public:
       size_t max_bytes_read = std::string::npos,
       ic3_profile* prof = nullptr) { return false;}
 
+  /**
+   * Get n keys at once, for a txn which knows the keys it reads up front.
+   * Returns the number of keys found, values[i] is left empty if keys[i] is
+   * not. The default implementation calls get() for each key
+   */
+  virtual size_t multi_get(
+      void *txn,
+      const std::string *keys,
+      std::string *values,
+      size_t n,
+      uint32_t acc_id = MAX_ACC_ID)
+  {
+    size_t nfound = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (get(txn, keys[i], values[i], std::string::npos, acc_id))
+        nfound++;
+      else
+        values[i].clear();
+    }
+    return nfound;
+  }
+
   class scan_callback {
   public:
     virtual ~scan_callback() {}
@@ -109,6 +194,34 @@ public:
                     acc_id);
   }
 
+  /**
+   * put() of a key encoded with EncodeKey(), see get()
+   */
+  virtual const char *
+  put(void *txn,
+      const packed_key &key,
+      const std::string &value,
+      uint32_t acc_id = MAX_ACC_ID)
+  {
+    std::string k;
+    return put(txn, key.str(k), value, acc_id);
+  }
+
+  /**
+   * Put n keys at once, see multi_get(). The default implementation calls
+   * put() for each key
+   */
+  virtual void multi_put(
+      void *txn,
+      const std::string *keys,
+      const std::string *values,
+      size_t n,
+      uint32_t acc_id = MAX_ACC_ID)
+  {
+    for (size_t i = 0; i < n; i++)
+      put(txn, keys[i], values[i], acc_id);
+  }
+
   virtual const char *
   update(void *txn,
       const std::string &key,
@@ -116,11 +229,19 @@ public:
       update_callback *callback,
       uint32_t acc_id = MAX_ACC_ID) {};
 
+  /**
+   * Record act(value, param) against key, applied to the latest committed
+   * value at commit. Commutative acts of the same kind on one key never
+   * conflict with each other, kind names the operator act applies (see
+   * conflict_graph.h); acc_id only advances the txn step for the policy.
+   */
   virtual void commutative_act(
     void *txn,
     const std::string &key,
     dbtuple::tuple_commutative_act act,
-    uint64_t param) {}
+    uint64_t param,
+    commutative_kind kind,
+    uint32_t acc_id = MAX_ACC_ID) {}
 
   /**
    * Insert a key of length keylen.
@@ -178,6 +299,30 @@ public:
    * Not thread safe for now
    */
   virtual std::map<std::string, uint64_t> clear() = 0;
+
+  /**
+   * Adds a hash index for exact-key lookups next to the ordered one, if the
+   * implementation has one. Not thread safe, call once the table is loaded
+   */
+  virtual void build_hash_index() {}
+
+  /**
+   * Makes the tree of a table opened mostly_append split in favor of
+   * appends, if the implementation can. Not thread safe, call before the
+   * table is loaded
+   */
+  virtual void enable_sequential_splits() {}
+
+  /**
+   * The leaves of the underlying tree, their average fill factor and the
+   * memory they take, if the implementation has such a thing. Only an
+   * estimate, like size()
+   */
+  virtual bool
+  leaf_stats(size_t &nleaves, double &fill, size_t &nbytes) const
+  {
+    return false;
+  }
 };
 
 #endif /* _ABSTRACT_ORDERED_INDEX_H_ */
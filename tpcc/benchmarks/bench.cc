@@ -13,6 +13,7 @@
 #include "bench.h"
 
 #include "../counter.h"
+#include "../policy_library.h"
 #include "../scopedperf.hh"
 #include "../allocator.h"
 
@@ -44,6 +45,8 @@ int retry_aborted_transaction = 0;
 int no_reset_counters = 0;
 int backoff_aborted_transaction = 0;
 int consistency_check = 0;
+int use_hash_index = 0;
+int use_sequential_splits = 0;
 int dynamic_workload = 0;
 int kid_start = 0;
 int kid_end = 0;
@@ -121,63 +124,139 @@ bench_worker::run()
     scoped_rcu_region r; // register this thread in rcu region
   }
   on_run_setup();
-  scoped_db_thread_ctx ctx(db, false);
-  const workload_desc_vec workload = get_workload();
-  txn_counts.resize(workload.size());
-  abort_counts.resize(workload.size());
-  barrier_a->count_down();
-  barrier_b->wait_for();
-
-  int which_retry = 0;
-  while (running && (run_mode != RUNMODE_OPS || ntxn_commits < ops_per_worker)) {
-    double d = r.next_uniform();
-    for (size_t i = 0; i < workload.size(); i++) {
-      if ((i + 1) == workload.size() || d < workload[i].frequency) {
-      retry:
-        timer t;
-        const unsigned long old_seed = r.get_seed();
-        const auto ret = workload[i].fn(this);
-        // ret.second == 0 means this txn is a read-only transaction
-        // since read-only transactions use snapshot, they must have been committed
-        if (likely(ret.first)) {
-          ++ntxn_commits;
-          latency_numer_us += t.lap();
-          backoff_action action = pg->inference_backoff_action(true /*success*/, which_retry, ret.second);
-          modify_backoff(action.first, action.second);
-          which_retry = 0;
-        } else {
-          ++ntxn_aborts;
-          if (retry_aborted_transaction && running && !is_user_initiate_abort) {
-            if (backoff_aborted_transaction) {
-              backoff_action action = pg->inference_backoff_action(false /*fail*/, which_retry, ret.second);
-              modify_backoff(action.first, action.second);
-              uint64_t spins = backoff;
-              evt_avg_abort_spins.offer(spins);
-              while (spins) {
-                nop_pause();
-                spins--;
+  {
+    scoped_db_thread_ctx ctx(db, false);
+    const workload_desc_vec workload = get_workload();
+    txn_counts.resize(workload.size());
+    abort_counts.resize(workload.size());
+    barrier_a->count_down();
+    barrier_b->wait_for();
+
+    int which_retry = 0;
+    while (running && (run_mode != RUNMODE_OPS ||
+                       ntxn_commits + nheld_acks < ops_per_worker)) {
+      release_acks();
+      // switch policies between txns only, a retry keeps the one it started with
+      if (unlikely(policy_library::g_enabled) && policy_library::Current() != pg)
+        set_pg(policy_library::Current());
+      double d = r.next_uniform();
+      for (size_t i = 0; i < workload.size(); i++) {
+        if ((i + 1) == workload.size() || d < workload[i].frequency) {
+        retry:
+          timer t;
+          const unsigned long old_seed = r.get_seed();
+          const auto ret = workload[i].fn(this);
+          if (unlikely(policy_library::g_enabled))
+            policy_library::NoteTxn(workload[i].kind, ret.first);
+          // ret.second == 0 means this txn is a read-only transaction
+          // since read-only transactions use snapshot, they must have been committed
+          if (likely(ret.first)) {
+            // a logged commit only counts once its epoch is durable, see
+            // release_acks()
+            const uint64_t e = db->take_commit_epoch();
+            if (e) {
+              hold_ack(e, timer::cur_usec() - t.lap());
+            } else {
+              ++ntxn_commits;
+              latency_numer_us += t.lap();
+            }
+            backoff_action action = pg->inference_backoff_action(true /*success*/, which_retry, ret.second);
+            modify_backoff(action.first, action.second);
+            which_retry = 0;
+          } else {
+            ++ntxn_aborts;
+            if (retry_aborted_transaction && running && !is_user_initiate_abort) {
+              if (backoff_aborted_transaction) {
+                backoff_action action = pg->inference_backoff_action(false /*fail*/, which_retry, ret.second);
+                modify_backoff(action.first, action.second);
+                uint64_t spins = backoff;
+                evt_avg_abort_spins.offer(spins);
+                while (spins) {
+                  nop_pause();
+                  spins--;
+                }
               }
+              ++which_retry;
+              r.set_seed(old_seed);
+              goto retry;
             }
-            ++which_retry;
-            r.set_seed(old_seed);
-            goto retry;
           }
+          is_user_initiate_abort = false;
+          size_delta += ret.second; // should be zero on abort
+          // txn_counts[i]++; // txn_counts aren't used to compute throughput (is
+                           // just an informative number to print to the console
+                           // in verbose mode)
+          break;
         }
-        is_user_initiate_abort = false;
-        size_delta += ret.second; // should be zero on abort
-        // txn_counts[i]++; // txn_counts aren't used to compute throughput (is
-                         // just an informative number to print to the console
-                         // in verbose mode)
-        break;
+        d -= workload[i].frequency;
       }
-      d -= workload[i].frequency;
     }
   }
+  // drained only after thread_end() pushed our last log buffer
+  while (!pending_acks.empty()) {
+    nop_pause();
+    release_acks();
+  }
+}
+
+void
+bench_worker::hold_ack(uint64_t epoch, uint64_t start_us)
+{
+  // the epochs of a worker's commits never go back, so the commits of one
+  // epoch wait as one group
+  if (pending_acks.empty() || pending_acks.back().epoch_ != epoch)
+    pending_acks.push_back({epoch, 0, 0});
+  pending_acks.back().n_++;
+  pending_acks.back().start_us_sum_ += start_us;
+  nheld_acks++;
+}
+
+void
+bench_worker::release_acks()
+{
+  if (pending_acks.empty() ||
+      !db->is_epoch_persisted(pending_acks.front().epoch_))
+    return;
+  const uint64_t now = timer::cur_usec();
+  do {
+    const pending_ack &a = pending_acks.front();
+    nheld_acks -= a.n_;
+    // what the drain acknowledges once the run stopped is not throughput
+    if (likely(running)) {
+      ntxn_commits += a.n_;
+      latency_numer_us += a.n_ * now - a.start_us_sum_;
+    } else {
+      ntxn_late_acks += a.n_;
+    }
+    pending_acks.pop_front();
+  } while (!pending_acks.empty() &&
+           db->is_epoch_persisted(pending_acks.front().epoch_));
+}
+
+void
+bench_runner::build_hash_indexes()
+{
+  if (!use_hash_index)
+    return;
+  scoped_timer t("hash index build", verbose);
+  for (auto &p : open_tables)
+    p.second->build_hash_index();
+}
+
+void
+bench_runner::enable_sequential_splits()
+{
+  if (!use_sequential_splits)
+    return;
+  for (auto &p : open_tables)
+    p.second->enable_sequential_splits();
 }
 
 void
 bench_runner::run()
 {
+  enable_sequential_splits();
+
   // load data
   const vector<bench_loader *> loaders = make_loaders();
   {
@@ -200,6 +279,7 @@ bench_runner::run()
     if (verbose)
       cerr << "DB size: " << delta_mb << " MB" << endl;
   }
+  build_hash_indexes();
 
   db->do_txn_epoch_sync(); // also waits for worker threads to be persisted
   {
@@ -260,10 +340,12 @@ bench_runner::run()
   db->do_txn_finish(); // waits for all worker txns to persist
   size_t n_commits = 0;
   size_t n_aborts = 0;
+  size_t n_late_acks = 0;
   uint64_t latency_numer_us = 0;
   for (size_t i = 0; i < nthreads; i++) {
     n_commits += workers[i]->get_ntxn_commits();
     n_aborts += workers[i]->get_ntxn_aborts();
+    n_late_acks += workers[i]->get_ntxn_late_acks();
     latency_numer_us += workers[i]->get_latency_numer_us();
   }
   const auto persisted_info = db->get_ntxn_persisted();
@@ -293,7 +375,7 @@ bench_runner::run()
   // various sanity checks
   ALWAYS_ASSERT(get<0>(persisted_info) == get<1>(persisted_info));
   // not == b/c persisted_info does not count read-only txns
-  ALWAYS_ASSERT(n_commits >= get<1>(persisted_info));
+  ALWAYS_ASSERT(n_commits + n_late_acks >= get<1>(persisted_info));
 
   const double elapsed_nosync_sec = double(elapsed_nosync) / 1000000.0;
   const double agg_nosync_throughput = double(n_commits) / elapsed_nosync_sec;
@@ -353,6 +435,11 @@ bench_runner::run()
         cerr << " (" << delta << " records)" << endl;
       else
         cerr << " (+" << delta << " records)" << endl;
+      size_t nleaves, nbytes;
+      double fill;
+      if (it->second->leaf_stats(nleaves, fill, nbytes))
+        cerr << "  leaves " << nleaves << " fill " << fill
+             << " leaf memory " << (double(nbytes) / 1048576.0) << " MB" << endl;
     }
 #ifdef ENABLE_BENCH_TXN_COUNTERS
     cerr << "--- txn counter statistics ---" << endl;
@@ -380,6 +467,7 @@ bench_runner::run()
     cerr << "avg_per_core_persist_throughput: " << avg_per_core_persist_throughput << " ops/sec/core" << endl;
     cerr << "avg_latency: " << avg_latency_ms << " ms" << endl;
     cerr << "avg_persist_latency: " << avg_persist_latency_ms << " ms" << endl;
+    cerr << "late_acks: " << n_late_acks << " (acked after the run stopped, not counted)" << endl;
     cerr << "agg_abort_rate: " << agg_abort_rate << endl;
     cerr << "avg_per_core_abort_rate: " << avg_per_core_abort_rate << " aborts/sec/core" << endl;
     cerr << "txn_breakdown: " << format_list(agg_txn_counts.begin(), agg_txn_counts.end()) << endl;
@@ -457,6 +545,8 @@ bench_runner::run()
 void
 bench_runner::dynamic_run()
 {
+  enable_sequential_splits();
+
   // load data
   const vector<bench_loader *> loaders = make_loaders();
   {
@@ -479,6 +569,7 @@ bench_runner::dynamic_run()
     if (verbose)
       cerr << "DB size: " << delta_mb << " MB" << endl;
   }
+  build_hash_indexes();
 
   
   // workers initlaization
@@ -576,10 +667,12 @@ bench_runner::dynamic_run()
     db->do_txn_finish(); // waits for all worker txns to persist
     size_t n_commits = 0;
     size_t n_aborts = 0;
+    size_t n_late_acks = 0;
     uint64_t latency_numer_us = 0;
     for (size_t i = 0; i < nthreads; i++) {
       n_commits += workers[i]->get_ntxn_commits();
       n_aborts += workers[i]->get_ntxn_aborts();
+      n_late_acks += workers[i]->get_ntxn_late_acks();
       latency_numer_us += workers[i]->get_latency_numer_us();
     }
     const auto persisted_info = db->get_ntxn_persisted();
@@ -591,7 +684,7 @@ bench_runner::dynamic_run()
     // various sanity checks
     ALWAYS_ASSERT(get<0>(persisted_info) == get<1>(persisted_info));
     // not == b/c persisted_info does not count read-only txns
-    ALWAYS_ASSERT(n_commits >= get<1>(persisted_info));
+    ALWAYS_ASSERT(n_commits + n_late_acks >= get<1>(persisted_info));
 
     const double elapsed_nosync_sec = double(elapsed_nosync) / 1000000.0;
     const double agg_nosync_throughput = double(n_commits) / elapsed_nosync_sec;
@@ -669,6 +762,7 @@ bench_runner::dynamic_run()
       cerr << "avg_per_core_persist_throughput: " << avg_per_core_persist_throughput << " ops/sec/core" << endl;
       cerr << "avg_latency: " << avg_latency_ms << " ms" << endl;
       cerr << "avg_persist_latency: " << avg_persist_latency_ms << " ms" << endl;
+      cerr << "late_acks: " << n_late_acks << " (acked after the run stopped, not counted)" << endl;
       cerr << "agg_abort_rate: " << agg_abort_rate << " (aborts/commits + aborts)" << endl;
       cerr << "avg_per_core_abort_rate: " << avg_per_core_abort_rate << " aborts/sec/core" << endl;
       cerr << "txn breakdown: " << format_list(agg_txn_counts.begin(), agg_txn_counts.end()) << endl;
@@ -732,6 +826,8 @@ bench_runner::dynamic_run()
 void
 bench_runner::training_run(std::vector<std::string>& policies)
 {
+  enable_sequential_splits();
+
   // load data
   const vector<bench_loader *> loaders = make_loaders();
   {
@@ -754,6 +850,7 @@ bench_runner::training_run(std::vector<std::string>& policies)
     if (verbose)
       cerr << "DB size: " << delta_mb << " MB" << endl;
   }
+  build_hash_indexes();
 
   
   // workers initlaization
@@ -833,10 +930,12 @@ bench_runner::training_run(std::vector<std::string>& policies)
     db->do_txn_finish(); // waits for all worker txns to persist
     size_t n_commits = 0;
     size_t n_aborts = 0;
+    size_t n_late_acks = 0;
     uint64_t latency_numer_us = 0;
     for (size_t i = 0; i < nthreads; i++) {
       n_commits += workers[i]->get_ntxn_commits();
       n_aborts += workers[i]->get_ntxn_aborts();
+      n_late_acks += workers[i]->get_ntxn_late_acks();
       latency_numer_us += workers[i]->get_latency_numer_us();
     }
     const auto persisted_info = db->get_ntxn_persisted();
@@ -848,7 +947,7 @@ bench_runner::training_run(std::vector<std::string>& policies)
     // various sanity checks
     ALWAYS_ASSERT(get<0>(persisted_info) == get<1>(persisted_info));
     // not == b/c persisted_info does not count read-only txns
-    ALWAYS_ASSERT(n_commits >= get<1>(persisted_info));
+    ALWAYS_ASSERT(n_commits + n_late_acks >= get<1>(persisted_info));
 
     const double elapsed_nosync_sec = double(elapsed_nosync) / 1000000.0;
     const double agg_nosync_throughput = double(n_commits) / elapsed_nosync_sec;
@@ -926,6 +1025,7 @@ bench_runner::training_run(std::vector<std::string>& policies)
       cerr << "avg_per_core_persist_throughput: " << avg_per_core_persist_throughput << " ops/sec/core" << endl;
       cerr << "avg_latency: " << avg_latency_ms << " ms" << endl;
       cerr << "avg_persist_latency: " << avg_persist_latency_ms << " ms" << endl;
+      cerr << "late_acks: " << n_late_acks << " (acked after the run stopped, not counted)" << endl;
       cerr << "agg_abort_rate: " << agg_abort_rate << " (aborts/commits + aborts)" << endl;
       cerr << "avg_per_core_abort_rate: " << avg_per_core_abort_rate << " aborts/sec/core" << endl;
       cerr << "txn breakdown: " << format_list(agg_txn_counts.begin(), agg_txn_counts.end()) << endl;
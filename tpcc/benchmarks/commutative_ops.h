@@ -0,0 +1,95 @@
+#ifndef _NDB_BENCH_COMMUTATIVE_OPS_H_
+#define _NDB_BENCH_COMMUTATIVE_OPS_H_
+
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+#include "../record/encoder.h"
+
+// Ready made dbtuple::tuple_commutative_act's over one numeric member of an
+// encoded record, for abstract_ordered_index::commutative_act(). The act runs
+// at commit against the latest committed value, so concurrent adds to a hot
+// column (w_ytd, d_ytd, balances) never conflict with each other.
+//
+// The uint64_t parameter carries a double (see commutative_param()), so the
+// same act serves integer and float members.
+
+static inline uint64_t
+commutative_param(double d)
+{
+  uint64_t p;
+  memcpy(&p, &d, sizeof(p));
+  return p;
+}
+
+static inline double
+commutative_operand(uint64_t p)
+{
+  double d;
+  memcpy(&d, &p, sizeof(d));
+  return d;
+}
+
+template <typename Value, typename Field, Field Value::*Member>
+bool
+commutative_add(std::string *val, uint64_t param)
+{
+  Value v_temp;
+  const Value *v = Decode(*val, v_temp);
+  Value v_new(*v);
+  v_new.*Member += commutative_operand(param);
+  Encode(*val, v_new);
+  return true;
+}
+
+template <typename Value, typename Field, Field Value::*Member>
+bool
+commutative_min(std::string *val, uint64_t param)
+{
+  Value v_temp;
+  const Value *v = Decode(*val, v_temp);
+  const Field x = commutative_operand(param);
+  if (!(x < v->*Member))
+    return true;
+  Value v_new(*v);
+  v_new.*Member = x;
+  Encode(*val, v_new);
+  return true;
+}
+
+template <typename Value, typename Field, Field Value::*Member>
+bool
+commutative_max(std::string *val, uint64_t param)
+{
+  Value v_temp;
+  const Value *v = Decode(*val, v_temp);
+  const Field x = commutative_operand(param);
+  if (!(v->*Member < x))
+    return true;
+  Value v_new(*v);
+  v_new.*Member = x;
+  Encode(*val, v_new);
+  return true;
+}
+
+// escrow style add: refuses (aborting the txn) if the member would leave
+// [Lo, Hi]. The bound is checked against the committed value under the
+// write lock, so it holds no matter how the adds interleave
+template <typename Value, typename Field, Field Value::*Member,
+          int64_t Lo, int64_t Hi>
+bool
+commutative_bounded_add(std::string *val, uint64_t param)
+{
+  Value v_temp;
+  const Value *v = Decode(*val, v_temp);
+  const double x = v->*Member + commutative_operand(param);
+  if (x < Lo || x > Hi)
+    return false;
+  Value v_new(*v);
+  v_new.*Member = x;
+  Encode(*val, v_new);
+  return true;
+}
+
+#endif /* _NDB_BENCH_COMMUTATIVE_OPS_H_ */
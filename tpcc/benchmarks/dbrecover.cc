@@ -0,0 +1,435 @@
+/**
+ * dbrecover: rebuilds a database from the logs written by txn_logger and
+ * reports how fast that goes.
+ *
+ *   dbrecover --logfile f0 [--logfile f1 ...] [--num-threads n]
+ *             [--bench tpcc --scale-factor w]
+ *
+ * The log files are decoded in parallel (one decoder per file), every write
+ * is routed by (table, key) to one of the replay threads, and each replay
+ * thread keeps the write with the highest (tid, position in txn) per key
+ * before inserting the survivors into fresh tables. Txns in epochs later
+ * than the persisted epoch (see txn_logger::PersistentEpochFileName()) never
+ * became durable and are dropped.
+ *
+ * With --bench tpcc the result is checked with tpcc_check_tables().
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <lz4.h>
+
+#include "bench.h"
+#include "ndb_wrapper.h"
+#include "ndb_wrapper_impl.h"
+#include "../txn_ic3_impl.h"
+#include "../record/serializer.h"
+#include "../policy.h"
+
+using namespace std;
+using namespace util;
+
+struct replay_record {
+  uint64_t tid_;
+  uint32_t seq_; // position in the txn's write set
+  uint32_t table_id_;
+  string key_;
+  string value_; // empty for a delete
+
+  inline bool
+  newer_than(const replay_record &o) const
+  {
+    return tid_ > o.tid_ || (tid_ == o.tid_ && seq_ > o.seq_);
+  }
+};
+
+struct decode_stats {
+  uint64_t nbytes_ = 0;
+  uint64_t ntxns_ = 0;
+  uint64_t ntxns_dropped_ = 0; // past the persisted epoch
+  uint64_t nwrites_ = 0;
+};
+
+class log_decoder {
+public:
+  log_decoder(uint64_t pepoch, bool compressed, size_t npartitions)
+    : pepoch(pepoch), compressed(compressed), parts(npartitions),
+      scratch(size_t(txn_logger::g_horizon_buffer_size)) {}
+
+  // decodes every buffer of fname, stopping at the zeroed (preallocated)
+  // tail or at a torn buffer
+  void
+  decode_file(const string &fname)
+  {
+    const int fd = open(fname.c_str(), O_RDONLY);
+    if (fd == -1) {
+      perror("open");
+      ALWAYS_ASSERT(false);
+    }
+    struct stat st;
+    ALWAYS_ASSERT(!fstat(fd, &st));
+    if (!st.st_size) {
+      close(fd);
+      return;
+    }
+    void *px = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ALWAYS_ASSERT(px != MAP_FAILED);
+    madvise(px, st.st_size, MADV_SEQUENTIAL);
+
+    const uint8_t *p = (const uint8_t *) px;
+    const uint8_t * const end = p + st.st_size;
+    while (size_t(end - p) >= sizeof(txn_logger::logbuf_header)) {
+      const txn_logger::logbuf_header *hdr =
+        (const txn_logger::logbuf_header *) p;
+      if (!hdr->nentries_)
+        break;
+      const uint8_t *q = p + sizeof(*hdr);
+      q = compressed ?
+        decode_compressed(q, end, hdr->nentries_) :
+        decode_entries(q, end, hdr->nentries_);
+      if (!q) {
+        cerr << "[WARNING] " << fname << ": torn buffer at offset "
+             << (p - (const uint8_t *) px) << ", ignoring the rest" << endl;
+        break;
+      }
+      p = q;
+    }
+    stats.nbytes_ += p - (const uint8_t *) px;
+    munmap(px, st.st_size);
+    close(fd);
+  }
+
+  const uint64_t pepoch;
+  const bool compressed;
+  vector<vector<replay_record>> parts; // by replay thread
+  decode_stats stats;
+
+private:
+  const uint8_t *
+  decode_compressed(const uint8_t *p, const uint8_t *end, uint64_t nentries)
+  {
+    serializer<uint32_t, false> s_uint32_t;
+    while (nentries) {
+      uint32_t clen;
+      if (!(p = s_uint32_t.failsafe_read(p, end - p, &clen)) ||
+          size_t(end - p) < clen)
+        return nullptr;
+      const int n = LZ4_decompress_safe(
+          (const char *) p, (char *) scratch.data(), clen, scratch.size());
+      if (n < 0)
+        return nullptr;
+      p += clen;
+      const uint8_t *q = scratch.data();
+      const uint8_t * const qend = q + n;
+      while (q < qend) {
+        if (!nentries || !(q = decode_entries(q, qend, 1)))
+          return nullptr;
+        nentries--;
+      }
+    }
+    return p;
+  }
+
+  // see transaction_ic3::write_current_txn_into_buffer()
+  const uint8_t *
+  decode_entries(const uint8_t *p, const uint8_t *end, uint64_t nentries)
+  {
+    serializer<uint32_t, true> vs_uint32_t;
+    serializer<uint64_t, false> s_uint64_t;
+    for (uint64_t i = 0; i < nentries; i++) {
+      uint64_t tid;
+      uint32_t nwrites;
+      if (!(p = s_uint64_t.failsafe_read(p, end - p, &tid)) ||
+          !(p = vs_uint32_t.failsafe_read(p, end - p, &nwrites)))
+        return nullptr;
+      const bool durable = transaction_ic3_static::EpochId(tid) <= pepoch;
+      for (uint32_t w = 0; w < nwrites; w++) {
+        uint32_t table_id, k_nbytes, v_nbytes;
+        if (!(p = vs_uint32_t.failsafe_read(p, end - p, &table_id)) ||
+            !(p = vs_uint32_t.failsafe_read(p, end - p, &k_nbytes)) ||
+            size_t(end - p) < k_nbytes)
+          return nullptr;
+        const uint8_t *k = p;
+        p += k_nbytes;
+        if (!(p = vs_uint32_t.failsafe_read(p, end - p, &v_nbytes)) ||
+            size_t(end - p) < v_nbytes)
+          return nullptr;
+        const uint8_t *v = p;
+        p += v_nbytes;
+        if (!durable)
+          continue;
+        replay_record r;
+        r.tid_ = tid;
+        r.seq_ = w;
+        r.table_id_ = table_id;
+        r.key_.assign((const char *) k, k_nbytes);
+        r.value_.assign((const char *) v, v_nbytes);
+        const size_t h =
+          hash<string>()(r.key_) * 31 + table_id;
+        parts[h % parts.size()].emplace_back(move(r));
+      }
+      if (durable) {
+        stats.ntxns_++;
+        stats.nwrites_ += nwrites;
+      } else {
+        stats.ntxns_dropped_++;
+      }
+    }
+    return p;
+  }
+
+  vector<uint8_t> scratch;
+};
+
+// applies the newest write per key of partition part, returns the # of
+// records inserted
+static uint64_t
+replay_partition(abstract_db *db,
+                 const vector<log_decoder *> &decoders,
+                 size_t part,
+                 const vector<abstract_ordered_index *> &tables)
+{
+  {
+    scoped_rcu_region r; // register this thread in rcu region
+  }
+  scoped_db_thread_ctx ctx(db, true);
+
+  // TID-ordered conflict resolution: the newest write to a key wins
+  unordered_map<string, const replay_record *> latest;
+  for (auto d : decoders)
+    for (auto &r : d->parts[part]) {
+      string k;
+      k.reserve(sizeof(uint32_t) + r.key_.size());
+      k.append((const char *) &r.table_id_, sizeof(uint32_t));
+      k.append(r.key_);
+      auto it = latest.find(k);
+      if (it == latest.end())
+        latest.emplace(move(k), &r);
+      else if (r.newer_than(*it->second))
+        it->second = &r;
+    }
+
+  static const size_t batch_size = 64;
+  str_arena arena;
+  string txn_obj_buf(db->sizeof_txn_object(txn_flags), 0);
+  void *txn = nullptr;
+  size_t nbatch = 0;
+  uint64_t ninserted = 0;
+  for (auto &e : latest) {
+    const replay_record &r = *e.second;
+    if (r.value_.empty())
+      continue; // deleted, never existed in the fresh tables
+    if (r.table_id_ >= tables.size() || !tables[r.table_id_]) {
+      cerr << "[WARNING] record of unknown table id " << r.table_id_ << endl;
+      continue;
+    }
+    if (!txn)
+      txn = db->new_txn(txn_flags, arena, (void *) txn_obj_buf.data());
+    tables[r.table_id_]->insert(txn, r.key_, r.value_);
+    ninserted++;
+    if (++nbatch == batch_size) {
+      // keys are disjoint across replay threads, nothing can conflict
+      ALWAYS_ASSERT(db->commit_txn(txn));
+      arena.reset();
+      txn = nullptr;
+      nbatch = 0;
+    }
+  }
+  if (txn)
+    ALWAYS_ASSERT(db->commit_txn(txn));
+  return ninserted;
+}
+
+int
+main(int argc, char **argv)
+{
+  vector<string> logfiles;
+  string bench_type;
+  string encoder = "./encoder/default_tpcc_encoder.txt";
+  nthreads = 1;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"verbose"      , no_argument       , &verbose , 1}   ,
+      {"logfile"      , required_argument , 0        , 'l'} ,
+      {"num-threads"  , required_argument , 0        , 't'} ,
+      {"bench"        , required_argument , 0        , 'b'} ,
+      {"scale-factor" , required_argument , 0        , 's'} ,
+      {"encoder"      , required_argument , 0        , 'e'} ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "l:t:b:s:e:", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+      abort();
+      break;
+
+    case 'l':
+      logfiles.emplace_back(optarg);
+      break;
+
+    case 't':
+      nthreads = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(nthreads > 0);
+      break;
+
+    case 'b':
+      bench_type = optarg;
+      break;
+
+    case 's':
+      scale_factor = strtod(optarg, NULL);
+      ALWAYS_ASSERT(scale_factor > 0.0);
+      break;
+
+    case 'e':
+      encoder = optarg;
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+
+  if (logfiles.empty()) {
+    cerr << "[ERROR] no --logfile given" << endl;
+    return 1;
+  }
+  if (!bench_type.empty() && bench_type != "tpcc") {
+    cerr << "[ERROR] only tpcc has consistency checks" << endl;
+    return 1;
+  }
+
+  // catalog: "compress <0|1>" followed by one "<id> <name>" line per table
+  ifstream catalog(txn_logger::CatalogFileName(logfiles[0]));
+  if (!catalog) {
+    cerr << "[ERROR] cannot open "
+         << txn_logger::CatalogFileName(logfiles[0]) << endl;
+    return 1;
+  }
+  string tok;
+  int compressed = 0;
+  catalog >> tok >> compressed;
+  ALWAYS_ASSERT(tok == "compress");
+  map<uint32_t, string> table_names;
+  uint32_t id;
+  string name;
+  while (catalog >> id >> name)
+    table_names[id] = name;
+
+  uint64_t pepoch = 0;
+  {
+    ifstream f(txn_logger::PersistentEpochFileName(logfiles[0]), ios::binary);
+    if (!f.read((char *) &pepoch, sizeof(pepoch))) {
+      cerr << "[ERROR] cannot read "
+           << txn_logger::PersistentEpochFileName(logfiles[0]) << endl;
+      return 1;
+    }
+  }
+
+  if (verbose) {
+    cerr << "recovery settings:" << endl;
+    cerr << "  logfiles       : " << logfiles << endl;
+    cerr << "  num-threads    : " << nthreads << endl;
+    cerr << "  compressed     : " << compressed << endl;
+    cerr << "  ntables        : " << table_names.size() << endl;
+    cerr << "  persisted epoch: " << pepoch << endl;
+  }
+
+  global_encoder.load(encoder);
+  abstract_db *db = new ndb_wrapper<transaction_ic3>(
+      vector<string>(), vector<vector<unsigned>>(), false, false, false);
+  db->pg = new Policy();
+
+  map<string, abstract_ordered_index *> open_tables;
+  vector<abstract_ordered_index *> tables;
+  for (auto &t : table_names) {
+    if (tables.size() <= t.first)
+      tables.resize(t.first + 1, nullptr);
+    tables[t.first] = open_tables[t.second] = db->open_index(t.second, 128);
+  }
+
+  timer t_total, t_phase;
+
+  // phase 1: decode, one thread per log file
+  vector<log_decoder *> decoders;
+  vector<thread> threads;
+  for (size_t i = 0; i < logfiles.size(); i++)
+    decoders.push_back(new log_decoder(pepoch, compressed, nthreads));
+  for (size_t i = 0; i < logfiles.size(); i++)
+    threads.emplace_back(
+        &log_decoder::decode_file, decoders[i], logfiles[i]);
+  for (auto &th : threads)
+    th.join();
+  threads.clear();
+  const double decode_sec = t_phase.lap() / 1000000.0;
+
+  // phase 2: replay, one thread per partition of the (table, key) space
+  vector<uint64_t> ninserted(nthreads);
+  for (size_t p = 0; p < nthreads; p++)
+    threads.emplace_back([&, p]() {
+      ninserted[p] = replay_partition(db, decoders, p, tables);
+    });
+  for (auto &th : threads)
+    th.join();
+  const double replay_sec = t_phase.lap() / 1000000.0;
+  const double total_sec = t_total.lap() / 1000000.0;
+
+  decode_stats agg;
+  for (auto d : decoders) {
+    agg.nbytes_ += d->stats.nbytes_;
+    agg.ntxns_ += d->stats.ntxns_;
+    agg.ntxns_dropped_ += d->stats.ntxns_dropped_;
+    agg.nwrites_ += d->stats.nwrites_;
+  }
+  uint64_t agg_inserted = 0;
+  for (auto n : ninserted)
+    agg_inserted += n;
+  const double mb = double(agg.nbytes_) / double(1 << 20);
+
+  cerr << "log_bytes: " << agg.nbytes_ << endl;
+  cerr << "txns_replayed: " << agg.ntxns_ << endl;
+  cerr << "txns_dropped: " << agg.ntxns_dropped_ << " (past epoch " << pepoch << ")" << endl;
+  cerr << "writes_replayed: " << agg.nwrites_ << endl;
+  cerr << "records_recovered: " << agg_inserted << endl;
+  cerr << "decode_time: " << decode_sec << " sec" << endl;
+  cerr << "replay_time: " << replay_sec << " sec" << endl;
+  cerr << "decode_throughput: " << (mb / decode_sec) << " MB/sec" << endl;
+  cerr << "recovery_throughput: " << (mb / total_sec) << " MB/sec" << endl;
+  cerr << "recovery_txn_throughput: " << (double(agg.ntxns_) / total_sec)
+       << " txns/sec" << endl;
+  // machine readable, same spirit as dbtest
+  cout << (mb / total_sec) << " " << (double(agg.ntxns_) / total_sec) << endl;
+
+  int ret = 0;
+  if (bench_type == "tpcc") {
+    const size_t nviolations = tpcc_check_tables(db, open_tables);
+    cerr << "tpcc_consistency_violations: " << nviolations << endl;
+    ret = nviolations ? 1 : 0;
+  }
+
+  for (auto d : decoders)
+    delete d;
+  return ret;
+}
@@ -11,6 +11,8 @@
 #include <unistd.h>
 #include <sys/sysinfo.h>
 
+#include "../access_trace.h"
+#include "../hot_records.h"
 #include "../allocator.h"
 #include "../stats_server.h"
 #include "bench.h"
@@ -21,6 +23,7 @@
 #include "kvdb_wrapper.h"
 #include "kvdb_wrapper_impl.h"
 #include "../policy.h"
+#include "../policy_library.h"
 
 using namespace std;
 using namespace util;
@@ -62,7 +65,13 @@ main(int argc, char **argv)
   string bench_type = "ycsb";
   string db_type = "ndb-ic3";
   string policy = "";
+  string save_policy;
+  string policy_library_file;
   string encoder = "./encoder/default_tpcc_encoder.txt";
+  string access_trace_file;
+  string hot_records_file;
+  unsigned hot_records_threshold = hot_records::g_threshold;
+  string access_profile;
   char *curdir = get_current_dir_name();
   string basedir = curdir;
   string bench_opts;
@@ -74,6 +83,10 @@ main(int argc, char **argv)
   int fake_writes = 0;
   int disable_gc = 0;
   int disable_snapshots = 0;
+  uint64_t ro_epoch_ms = 0;
+  uint64_t ro_epoch_min_ms = 0;
+  uint64_t ro_epoch_max_versions = 0;
+  unsigned chain_compact_threshold = 0;
   vector<string> logfiles;
   vector<vector<unsigned>> assignments;
   string stats_server_sockfile;
@@ -91,6 +104,12 @@ main(int argc, char **argv)
       {"backoff-alpha"              , required_argument , 0                          , 'A'}   ,
       {"policy"                     , required_argument , 0                          , 'p'}   ,
       {"encoder"                    , required_argument , 0                          , 'e'}   ,
+      {"save-policy"                , required_argument , 0                          , 'S'}   , // in the binary format
+      {"policy-library"             , required_argument , 0                          , 'L'}   , // see policy_library.h
+      {"access-trace"               , required_argument , 0                          , 'T'}   ,
+      {"access-profile"             , required_argument , 0                          , 'P'}   ,
+      {"hot-records"                , required_argument , 0                          , 'H'}   ,
+      {"hot-records-threshold"      , required_argument , 0                          , 'K'}   ,
       {"bench"                      , required_argument , 0                          , 'b'} ,
       {"scale-factor"               , required_argument , 0                          , 's'} ,
       {"kid-start"                  , required_argument , 0                          , 'y'} ,
@@ -110,8 +129,14 @@ main(int argc, char **argv)
       {"log-fake-writes"            , no_argument       , &fake_writes               , 1}   ,
       {"disable-gc"                 , no_argument       , &disable_gc                , 1}   ,
       {"disable-snapshots"          , no_argument       , &disable_snapshots         , 1}   ,
+      {"ro-epoch-ms"                , required_argument , 0                          , 'R'} ,
+      {"ro-epoch-min-ms"            , required_argument , 0                          , 'M'} , // adapts within [min, ro-epoch-ms]
+      {"ro-epoch-max-versions"      , required_argument , 0                          , 'V'} ,
+      {"chain-compact-threshold"    , required_argument , 0                          , 'C'} ,
       {"stats-server-sockfile"      , required_argument , 0                          , 'x'} ,
       {"no-reset-counters"          , no_argument       , &no_reset_counters         , 1}   ,
+      {"hash-index"                 , no_argument       , &use_hash_index            , 1}   ,
+      {"sequential-splits"          , no_argument       , &use_sequential_splits     , 1}   ,
       {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -134,6 +159,31 @@ main(int argc, char **argv)
       encoder = optarg;
       break;
 
+    case 'S':
+      save_policy = optarg;
+      break;
+
+    case 'L':
+      policy_library_file = optarg;
+      break;
+
+    case 'T':
+      access_trace_file = optarg;
+      break;
+
+    case 'P':
+      access_profile = optarg;
+      break;
+
+    case 'H':
+      hot_records_file = optarg;
+      break;
+
+    case 'K':
+      hot_records_threshold = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(hot_records_threshold > 0);
+      break;
+
     case 'A':
       backoff_alpha = strtod(optarg, NULL);
       ALWAYS_ASSERT(backoff_alpha >= 0.0);
@@ -214,6 +264,24 @@ main(int argc, char **argv)
       stats_server_sockfile = optarg;
       break;
 
+    case 'R':
+      ro_epoch_ms = strtoul(optarg, nullptr, 10);
+      ALWAYS_ASSERT(ro_epoch_ms > 0);
+      break;
+
+    case 'M':
+      ro_epoch_min_ms = strtoul(optarg, nullptr, 10);
+      ALWAYS_ASSERT(ro_epoch_min_ms > 0);
+      break;
+
+    case 'V':
+      ro_epoch_max_versions = strtoul(optarg, nullptr, 10);
+      break;
+
+    case 'C':
+      chain_compact_threshold = strtoul(optarg, nullptr, 10);
+      break;
+
     case '?':
       /* getopt_long already printed an error message. */
       exit(1);
@@ -340,6 +408,25 @@ main(int argc, char **argv)
   if (disable_snapshots)
     transaction_ic3_static::DisableSnapshots();
 #endif
+  if (ro_epoch_min_ms) {
+    if (!ro_epoch_ms)
+      ro_epoch_ms = transaction_ic3_static::CurrentReadOnlyEpochUsec() / 1000;
+    if (ro_epoch_min_ms > ro_epoch_ms) {
+      cerr << "[ERROR] --ro-epoch-min-ms is larger than --ro-epoch-ms" << endl;
+      return 1;
+    }
+    transaction_ic3_static::SetAdaptiveReadOnlyEpoch(
+        ro_epoch_min_ms, ro_epoch_ms, ro_epoch_max_versions);
+  } else if (ro_epoch_ms) {
+    transaction_ic3_static::SetReadOnlyEpoch(ro_epoch_ms);
+  }
+  if (chain_compact_threshold) {
+    if (disable_gc) {
+      cerr << "[ERROR] --chain-compact-threshold needs the gc" << endl;
+      return 1;
+    }
+    transaction_ic3_static::SetChainCompactThreshold(chain_compact_threshold);
+  }
 
 #ifdef DEBUG
   cerr << "WARNING: benchmark built in DEBUG mode!!!" << endl;
@@ -397,7 +484,18 @@ main(int argc, char **argv)
     cerr << "  assignments : " << assignments               << endl;
     cerr << "  disable-gc : " << disable_gc                 << endl;
     cerr << "  disable-snapshots : " << disable_snapshots   << endl;
+    cerr << "  ro-epoch-ms : " << ro_epoch_ms               << endl;
+    cerr << "  ro-epoch-min-ms : " << ro_epoch_min_ms       << endl;
+    cerr << "  ro-epoch-max-versions : " << ro_epoch_max_versions << endl;
+    cerr << "  chain-compact-threshold : " << chain_compact_threshold << endl;
     cerr << "  stats-server-sockfile: " << stats_server_sockfile << endl;
+    cerr << "  access-trace : " << access_trace_file        << endl;
+    cerr << "  access-profile : " << access_profile         << endl;
+    cerr << "  hot-records : " << hot_records_file          << endl;
+    cerr << "  hot-records-threshold : " << hot_records_threshold << endl;
+    cerr << "  policy-library : " << policy_library_file    << endl;
+    cerr << "  hash-index : " << use_hash_index             << endl;
+    cerr << "  sequential-splits : " << use_sequential_splits << endl;
 
     cerr << "system properties:" << endl;
     cerr << "  btree_internal_node_size: " << concurrent_btree::InternalNodeSize() << endl;
@@ -422,10 +520,26 @@ main(int argc, char **argv)
     thread(&stats_server::serve_forever, srvr).detach();
   }
 
+  if (!access_profile.empty())
+    load_access_profile(access_profile);
+  access_trace::g_enabled = !access_trace_file.empty();
+
   global_encoder.load(encoder);
-  Policy *pg = new Policy();  // the same as PolyJuice training script setting.
-                                                                // policy initialization
-  if (!policy.empty()) pg->policy_gradient(policy);
+  // the encoder may tell hot records apart, see ENCODER_REC_HOT, and the
+  // policy library how hot the conflicts are
+  if (!hot_records_file.empty() || global_encoder.uses_rec_hot() ||
+      !policy_library_file.empty())
+    hot_records::Enable(hot_records_threshold);
+  Policy *pg;
+  if (!policy_library_file.empty()) {
+    // starts with the first policy of the library, --policy is ignored
+    pg = policy_library::Load(policy_library_file);
+  } else {
+    pg = new Policy();  // the same as PolyJuice training script setting.
+                                                                  // policy initialization
+    if (!policy.empty()) pg->policy_gradient(policy);
+  }
+  if (!save_policy.empty()) pg->save(save_policy);
 
   db->pg = pg;
   vector<string> bench_toks = split_ws(bench_opts);
@@ -435,6 +549,10 @@ main(int argc, char **argv)
   for (size_t i = 1; i <= bench_toks.size(); i++)
     argv[i] = (char *) bench_toks[i - 1].c_str();
   test_fn(db, argc, argv);
+  if (!access_trace_file.empty())
+    access_trace::Dump(access_trace_file);
+  if (!hot_records_file.empty())
+    hot_records::Dump(hot_records_file);
   if (verbose)
     pg->print_policy(bench_type);
   if (verbose)
@@ -0,0 +1,366 @@
+/**
+ * derive_chopping: derives the static chopping of a workload (the arrays
+ * load_access_profile() replaces in policy.h) from access traces, instead of
+ * analysing every stored procedure by hand.
+ *
+ *   dbtest --bench tpcc --access-trace tpcc.trace ...
+ *   derive_chopping --trace tpcc.trace [--trace ...] [--key-classes]
+ *                   [--output tpcc.profile]
+ *   dbtest --bench tpcc --access-profile tpcc.profile ...
+ *
+ * The accesses of a txn type are the access ids it was traced with, in
+ * order. Two accesses conflict if they touch one table and at least one of
+ * them writes it (with --key-classes only if they also share a key class, see
+ * below), except for two commutative updates applying the same operator, and
+ * two inserts into a table no access of the trace range reads: inserts write
+ * fresh keys, but a scan sees them as phantoms, so with a scan in the picture
+ * their order matters. An access which only does commutative updates of one
+ * operator is written out as commutative with that operator, so the engine
+ * also drops the edge between two instances of it. Every conflict is a
+ * C-edge of the SC-graph of two txn instances, whose S-edges chain the
+ * accesses of each instance, so two instances can form an SC-cycle as soon
+ * as there are two distinct C-edges between them. Only then is a guard
+ * needed: before its i-th access, t1 waits until the t2 it depends on passed
+ * the last step conflicting with that access. Cycles through more than two instances are
+ * left to the runtime dependency tracking.
+ *
+ * An access can be exposed right after it unless it reads what the next
+ * access of the txn writes (a read-modify-write).
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <algorithm>
+
+#include <getopt.h>
+#include <stdlib.h>
+
+using namespace std;
+
+struct traced_access {
+  uint32_t txn_type_ = 0;
+  set<pair<string, uint32_t>> reads_; // (table, key class)
+  set<pair<string, uint32_t>> writes_;
+  set<pair<string, uint32_t>> commutes_; // commutative updates
+  // the operators (commute_<kind> in the trace) applied to each of commutes_
+  map<pair<string, uint32_t>, set<string>> commute_kinds_;
+  bool only_inserts_ = true;
+  uint64_t count_ = 0;
+
+  inline bool
+  inserts_only() const
+  {
+    return reads_.empty() && !writes_.empty() && only_inserts_;
+  }
+
+  // the one operator of all the commutative updates, empty if none or more
+  inline string
+  commute_kind() const
+  {
+    set<string> kinds;
+    for (auto &p : commute_kinds_)
+      kinds.insert(p.second.begin(), p.second.end());
+    return kinds.size() == 1 ? *kinds.begin() : string();
+  }
+
+  inline bool
+  commutes_only() const
+  {
+    return reads_.empty() && writes_.empty() && !commutes_.empty() &&
+           !commute_kind().empty();
+  }
+};
+
+static bool g_key_classes = false;
+static set<string> g_scanned_tables; // range read by some traced access
+
+static inline bool
+same_obj(const pair<string, uint32_t> &x, const pair<string, uint32_t> &y)
+{
+  return x.first == y.first && (!g_key_classes || x.second == y.second);
+}
+
+static bool
+intersects(const set<pair<string, uint32_t>> &a,
+           const set<pair<string, uint32_t>> &b)
+{
+  for (auto &x : a)
+    for (auto &y : b)
+      if (same_obj(x, y))
+        return true;
+  return false;
+}
+
+// two inserts write fresh keys, which cannot be the same, they only conflict
+// over a table some scan may see them in
+static bool
+inserts_conflict(const traced_access &a, const traced_access &b)
+{
+  for (auto &x : a.writes_)
+    for (auto &y : b.writes_)
+      if (same_obj(x, y) && g_scanned_tables.count(x.first))
+        return true;
+  return false;
+}
+
+// two commutative updates of an object give the same result in either order
+// only if both apply one and the same operator to it
+static bool
+commutes_conflict(const traced_access &a, const traced_access &b)
+{
+  for (auto &x : a.commute_kinds_)
+    for (auto &y : b.commute_kinds_)
+      if (same_obj(x.first, y.first) &&
+          !(x.second.size() == 1 && x.second == y.second))
+        return true;
+  return false;
+}
+
+static bool
+conflicts(const traced_access &a, const traced_access &b)
+{
+  return (a.inserts_only() && b.inserts_only() ?
+          inserts_conflict(a, b) : intersects(a.writes_, b.writes_)) ||
+         commutes_conflict(a, b) ||
+         intersects(a.writes_, b.reads_) ||
+         intersects(a.reads_, b.writes_) ||
+         intersects(a.commutes_, b.reads_) ||
+         intersects(a.commutes_, b.writes_) ||
+         intersects(a.reads_, b.commutes_) ||
+         intersects(a.writes_, b.commutes_);
+}
+
+static void
+read_trace(const string &file, map<uint32_t, traced_access> &accs)
+{
+  ifstream in(file);
+  if (!in.is_open()) {
+    cerr << "[ERROR] could not open trace " << file << endl;
+    exit(1);
+  }
+  string line;
+  while (getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    istringstream ss(line);
+    uint32_t type, acc_id, key_class;
+    string table, op;
+    uint64_t count;
+    if (!(ss >> type >> acc_id >> table >> key_class >> op >> count)) {
+      cerr << "[ERROR] " << file << ": bad line: " << line << endl;
+      exit(1);
+    }
+    traced_access &a = accs[acc_id];
+    if (a.count_ && a.txn_type_ != type) {
+      cerr << "[ERROR] access " << acc_id << " traced for txn types "
+           << a.txn_type_ << " and " << type << endl;
+      exit(1);
+    }
+    a.txn_type_ = type;
+    a.count_ += count;
+    const auto obj = make_pair(table, key_class);
+    if (op == "read" || op == "scan") {
+      a.reads_.insert(obj);
+      if (op == "scan")
+        g_scanned_tables.insert(table);
+    } else if (op.compare(0, 8, "commute_") == 0) {
+      a.commutes_.insert(obj);
+      a.commute_kinds_[obj].insert(op.substr(8));
+    } else {
+      a.writes_.insert(obj);
+      a.only_inserts_ &= op == "insert";
+    }
+  }
+}
+
+static void
+print_objs(ostream &out, const char *what,
+           const set<pair<string, uint32_t>> &objs)
+{
+  for (auto &o : objs)
+    out << " " << what << ":" << o.first << "/" << o.second;
+}
+
+int
+main(int argc, char **argv)
+{
+  vector<string> traces;
+  string output;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"trace"       , required_argument , 0              , 't'} ,
+      {"output"      , required_argument , 0              , 'o'} ,
+      {"key-classes" , no_argument       , 0              , 'k'} ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "t:o:k", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 't':
+      traces.emplace_back(optarg);
+      break;
+
+    case 'o':
+      output = optarg;
+      break;
+
+    case 'k':
+      // the key class is only the key length (see access_trace.h), which
+      // tells apart the differently shaped keys one tree may hold and
+      // nothing else: accesses to distinct rows with same length keys still
+      // conflict, and it is only sound if keys of different lengths never
+      // name the same row. the tpcc tables have one key shape each, so it
+      // removes no edges there
+      g_key_classes = true;
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+  if (traces.empty()) {
+    cerr << "[ERROR] no --trace given" << endl;
+    return 1;
+  }
+
+  map<uint32_t, traced_access> accs;
+  for (auto &t : traces)
+    read_trace(t, accs);
+  if (accs.empty()) {
+    cerr << "[ERROR] the traces are empty" << endl;
+    return 1;
+  }
+
+  // the access ids of each txn type, ids in between which were never traced
+  // (branches the run did not take) touch nothing
+  uint32_t ntypes = 0;
+  for (auto &p : accs)
+    ntypes = max(ntypes, p.second.txn_type_);
+  const uint32_t naccesses = accs.rbegin()->first + 1;
+  vector<uint32_t> base(ntypes + 1, 0), num(ntypes + 1, 0);
+  for (uint32_t t = 1; t <= ntypes; t++) {
+    uint32_t lo = naccesses, hi = 0;
+    for (auto &p : accs)
+      if (p.second.txn_type_ == t) {
+        lo = min(lo, p.first);
+        hi = max(hi, p.first);
+      }
+    if (lo == naccesses) {
+      cerr << "[WARNING] txn type " << t << " was never traced" << endl;
+      continue;
+    }
+    base[t] = lo;
+    num[t] = hi - lo + 1;
+    for (uint32_t a = lo; a <= hi; a++) {
+      auto it = accs.find(a);
+      if (it == accs.end()) {
+        cerr << "[WARNING] access " << a << " was never traced" << endl;
+        accs[a].txn_type_ = t;
+      } else if (it->second.txn_type_ != t) {
+        cerr << "[ERROR] the accesses of txn types " << t << " and "
+             << it->second.txn_type_ << " interleave" << endl;
+        return 1;
+      }
+    }
+  }
+
+  // C-edges, and the SC-cycles between two instances of t1, t2
+  vector<pair<uint32_t, uint32_t>> edges;
+  for (auto &a : accs)
+    for (auto &b : accs)
+      if (a.first <= b.first && conflicts(a.second, b.second))
+        edges.emplace_back(a.first, b.first);
+  vector<vector<bool>> cycle(ntypes + 1, vector<bool>(ntypes + 1, false));
+  for (uint32_t t1 = 1; t1 <= ntypes; t1++)
+    for (uint32_t t2 = 1; t2 <= ntypes; t2++) {
+      size_t n = 0;
+      for (uint32_t i = 0; i < num[t1]; i++)
+        for (uint32_t j = 0; j < num[t2]; j++)
+          n += conflicts(accs[base[t1] + i], accs[base[t2] + j]);
+      cycle[t1][t2] = n >= 2;
+    }
+
+  ostream *outp = &cout;
+  ofstream fout;
+  if (!output.empty()) {
+    fout.open(output);
+    if (!fout.is_open()) {
+      cerr << "[ERROR] could not open " << output << endl;
+      return 1;
+    }
+    outp = &fout;
+  }
+  ostream &out = *outp;
+
+  out << "# access profile derived from";
+  for (auto &t : traces)
+    out << " " << t;
+  out << (g_key_classes ? " (table and key class conflicts)" : " (table conflicts)") << endl;
+  for (auto &p : accs) {
+    out << "# access " << p.first << ": txn type " << p.second.txn_type_;
+    print_objs(out, "r", p.second.reads_);
+    print_objs(out, "w", p.second.writes_);
+    print_objs(out, "c", p.second.commutes_);
+    out << endl;
+  }
+  out << "txn_types " << ntypes << endl;
+  out << "accesses " << naccesses << endl;
+  out << "txn_access_num";
+  for (uint32_t t = 1; t <= ntypes; t++)
+    out << " " << num[t];
+  out << endl << "base_access_num";
+  for (uint32_t t = 1; t <= ntypes; t++)
+    out << " " << base[t];
+  out << endl << "can_expose";
+  for (uint32_t a = 0; a < naccesses; a++) {
+    const traced_access &x = accs[a];
+    const auto next = accs.find(a + 1);
+    const bool rmw = next != accs.end() &&
+      next->second.txn_type_ == x.txn_type_ &&
+      intersects(x.reads_, next->second.writes_);
+    out << " " << !rmw;
+  }
+  out << endl;
+  for (auto &p : accs)
+    if (p.second.commutes_only())
+      out << "commutative " << p.first << " " << p.second.commute_kind() << endl;
+  for (auto &e : edges)
+    out << "conflict " << e.first << " " << e.second << endl;
+  size_t nguards = 0;
+  for (uint32_t t1 = 1; t1 <= ntypes; t1++)
+    for (uint32_t t2 = 1; t2 <= ntypes; t2++) {
+      if (!cycle[t1][t2])
+        continue;
+      for (uint32_t i = 0; i < num[t1]; i++) {
+        uint32_t g = 0;
+        for (uint32_t j = 0; j < num[t2]; j++)
+          if (conflicts(accs[base[t1] + i], accs[base[t2] + j]))
+            g = j + 1;
+        if (g) {
+          out << "guard " << t1 << " " << t2 << " " << i << " " << g << endl;
+          nguards++;
+        }
+      }
+    }
+
+  cerr << "derive_chopping: " << ntypes << " txn types, " << naccesses
+       << " accesses, " << edges.size() << " c-edges, " << nguards
+       << " guards" << endl;
+  for (uint32_t t1 = 1; t1 <= ntypes; t1++)
+    for (uint32_t t2 = t1; t2 <= ntypes; t2++)
+      if (cycle[t1][t2])
+        cerr << "  sc-cycle between txn types " << t1 << " and " << t2 << endl;
+  return 0;
+}
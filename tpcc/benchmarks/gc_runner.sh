@@ -29,3 +29,17 @@ $BENCH \
   --parallel-loading \
   --runtime 60 \
   --slow-exit 2>&1 | grep chain_ > results/$PREFIX-tpcc-chains.txt
+
+# hot warehouse/district chains with the chain compactor: compare the
+# chain_walk_* histogram and dbtuple bytes with the run above
+$BENCH \
+  --verbose \
+  --bench tpcc \
+  --db-type ndb-ic3 \
+  --scale-factor $NTHREADS \
+  --num-threads $NTHREADS \
+  --numa-memory $((4 * $NTHREADS))G \
+  --parallel-loading \
+  --runtime 60 \
+  --chain-compact-threshold 4 \
+  --slow-exit 2>&1 | grep -E "chain_|dbtuple_bytes_" > results/$PREFIX-tpcc-chains-compact.txt
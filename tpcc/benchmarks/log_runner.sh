@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# throughput and persist latency of the logger: no logging, logging with
+# fake writes, --log-nofsync and full fdatasync. LOGDIR can be any local
+# directory (tmpfs, ext4, ...), one log file is created per logger
+#
+#   ./benchmarks/log_runner.sh <prefix> [logdir]
+
+set -x
+
+BENCH=./dbtest
+NTHREADS=${NTHREADS:-8}
+NLOGGERS=${NLOGGERS:-2}
+RUNTIME=${RUNTIME:-30}
+PREFIX=$1
+LOGDIR=${2:-/tmp/ndb-logs}
+
+mkdir -p $LOGDIR results
+
+LOGFILES=""
+for ((i = 0; i < $NLOGGERS; i++)); do
+  LOGFILES="$LOGFILES --logfile $LOGDIR/log$i.txt"
+done
+
+run() {
+  $BENCH \
+    --verbose \
+    --bench tpcc \
+    --db-type ndb-ic3 \
+    --scale-factor $NTHREADS \
+    --num-threads $NTHREADS \
+    --runtime $RUNTIME \
+    "$@" 2>&1 | grep -E "agg_|avg_persist_latency|logger_"
+}
+
+run                               > results/$PREFIX-log-none.txt
+run $LOGFILES --log-fake-writes   > results/$PREFIX-log-fake.txt
+run $LOGFILES --log-nofsync       > results/$PREFIX-log-nofsync.txt
+run $LOGFILES                     > results/$PREFIX-log-fsync.txt
+
+rm -f $LOGDIR/log*.txt
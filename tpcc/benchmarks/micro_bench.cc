@@ -47,6 +47,7 @@ static const int64_t records_per_table = 1024*1024;
 
 
 static bool profile = false;
+static bool packed_keys = false;
 static size_t txn_length = 10;
 static int user_abort_rate = 0;
 static uint64_t access_range = 10;
@@ -284,12 +285,12 @@ public:
               if(profile)
                 get_beg = rdtsc();
 
-              if(profile) {
-                tbl->get_profile(txn, Encode(obj_key0, k), obj_v, std::string::npos, &internal_pdata[pidx]);
-                internal_pdata[pidx].count++;
-              } else {
+              // the GET time is that of the plain get() of either key
+              // path: the ic3 engine has no profiled read path
+              if(packed_keys)
+                tbl->get(txn, EncodeKey(pkey, k), obj_v);
+              else
                 tbl->get(txn, Encode(obj_key0, k), obj_v);
-              }  
 
               if(profile)
                 pdata[pidx].gettime += rdtsc() - get_beg ;
@@ -316,7 +317,10 @@ public:
               test::value v_new(*v);
               v_new.t_v_count++;   
               ALWAYS_ASSERT(v_new.t_v_count > 0);
-              tbl->put(txn, Encode(str(), k), Encode(obj_v, v_new));
+              if(packed_keys)
+                tbl->put(txn, EncodeKey(pkey, k), Encode(obj_v, v_new));
+              else
+                tbl->put(txn, Encode(str(), k), Encode(obj_v, v_new));
 
               if(profile) 
                 pdata[pidx].puttime += rdtsc() - put_beg ;
@@ -451,12 +455,12 @@ public:
                   const test::key k(keys[j]);
 
                   uint64_t get_beg = 0; 
-                  if(profile) {
+                  if(profile)
                     get_beg = rdtsc();
-                    tbl->get_profile(txn, Encode(obj_key0, k), obj_v, std::string::npos, &internal_pdata[pidx]);
-                  } else {
+                  if(packed_keys)
+                    ALWAYS_ASSERT(tbl->get(txn, EncodeKey(pkey, k), obj_v));
+                  else
                     ALWAYS_ASSERT(tbl->get(txn, Encode(obj_key0, k), obj_v));
-                  }
                   if(profile)
                     pdata[pidx].gettime += rdtsc() - get_beg;
                 
@@ -472,7 +476,10 @@ public:
                   if(profile) 
                     put_beg = rdtsc();
                 
-                  tbl->put(txn, Encode(str(), k), Encode(obj_v, v_new));
+                  if(packed_keys)
+                    tbl->put(txn, EncodeKey(pkey, k), Encode(obj_v, v_new));
+                  else
+                    tbl->put(txn, Encode(str(), k), Encode(obj_v, v_new));
 
                   if(profile) 
                     pdata[pidx].puttime += rdtsc() - put_beg ;
@@ -585,6 +592,7 @@ private:
   string obj_key0;
   string obj_key1;
   string obj_v;
+  packed_key pkey;
 
   std::default_random_engine generator;
   std::exponential_distribution<float> distribution;
@@ -748,9 +756,12 @@ microbench_do_test(abstract_db *db, int argc, char **argv)
       {"txn-length"    , required_argument , 0, 't'},
       {"user-initial-abort"    , required_argument , 0, 'u'},
       {"piece-access-recs"    , required_argument , 0, 'p'},
+      {"packed-keys"    , no_argument , 0, 'k'},
+      {"profile"    , no_argument , 0, 'f'},
+      {0, 0, 0, 0}
     };
     int option_index = 0;
-    int c = getopt_long(argc, argv, "a:t:p:u", long_options, &option_index);
+    int c = getopt_long(argc, argv, "a:t:p:u:kf", long_options, &option_index);
     if (c == -1)
       break;
 
@@ -788,6 +799,16 @@ microbench_do_test(abstract_db *db, int argc, char **argv)
         ALWAYS_ASSERT(user_abort_rate >= 0);
         break;
 
+        case 'k':
+        packed_keys = true;
+        cout<<"packed keys"<<endl;
+        break;
+
+        case 'f':
+        profile = true;
+        cout<<"per-op profiling"<<endl;
+        break;
+
 
         default:
           fprintf(stderr, "Wrong Arg %d\n", c);
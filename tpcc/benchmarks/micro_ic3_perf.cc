@@ -393,12 +393,79 @@ protected:
 
 };
 
+static int g_cgraph_lookups = 0;
+
+// cycles per conflict region + first conflict lookup on a random graph,
+// scanning the steps and from the frozen tables. both runs must produce
+// the same checksum
+static void
+cgraph_lookup_bench()
+{
+  static const uint8_t ntypes = 8;
+  static const uint32_t nsteps = 32;
+  static const size_t niters = 1 << 22;
+  conflict_graph g(ntypes);
+  for (uint8_t t = 1; t <= ntypes; t++)
+    g.init_txn(t, nsteps);
+  fast_random r(23984543);
+  for (uint8_t t1 = 1; t1 <= ntypes; t1++)
+    for (uint8_t t2 = t1 + 1; t2 <= ntypes; t2++)
+      for (uint32_t s = 1; s <= nsteps; s++)
+        if (r.next() % 8 == 0)
+          g.set_conflict(t1, s, t2, 1 + r.next() % nsteps);
+
+  for (int frozen = 0; frozen < 2; frozen++) {
+    if (frozen)
+      g.freeze();
+    uint64_t sum = 0;
+    const uint64_t start = rdtsc();
+    for (size_t i = 0; i < niters; i++) {
+      const uint8_t t1 = 1 + i % ntypes;
+      const uint8_t t2 = 1 + (i / ntypes) % ntypes;
+      const uint32_t op = 1 + (i * 7) % nsteps;
+      const auto region = g.get_conflict_region(t1, op, t2);
+      sum += region.first + region.second + g.first_conflict_step(t1, t2, op);
+    }
+    const uint64_t cycles = rdtsc() - start;
+    printf("%s lookups: %.2f cycles/lookup (checksum %lu)\n",
+      frozen ? "frozen" : "scan", double(cycles) / niters, sum);
+  }
+}
+
 void
 micro_ic3_perf_test(abstract_db *db, int argc, char **argv)
 {
+  optind = 1;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"cgraph-lookups", no_argument, &g_cgraph_lookups, 1},
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 0:
+      break;
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+    default:
+      abort();
+    }
+  }
+
+  if (g_cgraph_lookups) {
+    cgraph_lookup_bench();
+    return;
+  }
+
   printf("Hello World \n");
   cgraph = new conflict_graph(TXTTPES);
   cgraph->init_txn(IC3PERF, TESTSTEP);
+  cgraph->freeze();
   micro_ic3_perf_runner r(db);
   r.run();
 
@@ -85,6 +85,18 @@ public:
     txn_epoch_sync<Transaction>::reset_ntxn_persisted();
   }
 
+  virtual uint64_t
+  take_commit_epoch()
+  {
+    return txn_epoch_sync<Transaction>::take_commit_epoch();
+  }
+
+  virtual bool
+  is_epoch_persisted(uint64_t e) const
+  {
+    return txn_epoch_sync<Transaction>::is_epoch_persisted(e);
+  }
+
   virtual size_t
   sizeof_txn_object(uint64_t txn_flags) const;
 
@@ -154,6 +166,13 @@ public:
       size_t max_bytes_read,
       uint32_t acc_id);
 
+  virtual bool get(
+      void *txn,
+      const packed_key &key,
+      std::string &value,
+      size_t max_bytes_read,
+      uint32_t acc_id);
+
   virtual bool get_profile(
     void *txn,
       const std::string &key,
@@ -161,6 +180,13 @@ public:
       size_t max_bytes_read = std::string::npos,
       ic3_profile* prof = nullptr);
 
+  virtual size_t multi_get(
+      void *txn,
+      const std::string *keys,
+      std::string *values,
+      size_t n,
+      uint32_t acc_id);
+
   virtual const char * put(
       void *txn,
       const std::string &key,
@@ -171,6 +197,17 @@ public:
       std::string &&key,
       std::string &&value,
       uint32_t acc_id);
+  virtual const char * put(
+      void *txn,
+      const packed_key &key,
+      const std::string &value,
+      uint32_t acc_id);
+  virtual void multi_put(
+      void *txn,
+      const std::string *keys,
+      const std::string *values,
+      size_t n,
+      uint32_t acc_id);
   virtual const char * update(
       void *txn,
       const std::string &key,
@@ -182,7 +219,9 @@ public:
     void *txn,
     const std::string &key,
     dbtuple::tuple_commutative_act act,
-    uint64_t param);
+    uint64_t param,
+    commutative_kind kind,
+    uint32_t acc_id);
 
   virtual const char *
   insert(void *txn,
@@ -219,8 +258,23 @@ public:
       uint32_t acc_id);
   virtual size_t size() const;
   virtual std::map<std::string, uint64_t> clear();
+  virtual void build_hash_index() OVERRIDE;
+  virtual void enable_sequential_splits() OVERRIDE;
+  virtual bool leaf_stats(size_t &nleaves, double &fill,
+                          size_t &nbytes) const OVERRIDE;
+  virtual bool get_decoded(
+      void *txn,
+      const std::string &key,
+      value_decoder &decoder,
+      uint32_t acc_id = MAX_ACC_ID) OVERRIDE;
+  virtual bool get_decoded(
+      void *txn,
+      const packed_key &key,
+      value_decoder &decoder,
+      uint32_t acc_id = MAX_ACC_ID) OVERRIDE;
 private:
   std::string name;
+  const bool mostly_append;
   txn_btree<Transaction> btr;
 };
 
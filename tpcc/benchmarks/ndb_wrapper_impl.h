@@ -783,8 +783,10 @@ ndb_wrapper<Transaction>::close_index(abstract_ordered_index *idx)
 template <template <typename> class Transaction>
 ndb_ordered_index<Transaction>::ndb_ordered_index(
     const std::string &name, size_t value_size_hint, bool mostly_append)
-  : name(name), btr(value_size_hint, mostly_append, name)
+  : name(name), mostly_append(mostly_append),
+    btr(value_size_hint, mostly_append, name)
 {
+  btr.set_log_id(txn_logger::RegisterTable(name));
   // for debugging
   //std::cerr << name << " : btree= "
   //          << btr.get_underlying_btree()
@@ -826,7 +828,80 @@ ndb_ordered_index<Transaction>::get(
   }
 }
 
+template <template <typename> class Transaction>
+bool
+ndb_ordered_index<Transaction>::get(
+    void *txn,
+    const packed_key &key,
+    std::string &value,
+    size_t max_bytes_read,
+    uint32_t acc_id)
+{
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+#define MY_OP_X(a, b) \
+  case a: \
+    { \
+      auto t = cast< b >()(p); \
+      return btr.search(*t, varkey(key), value, max_bytes_read, acc_id); \
+    }
+  switch (p->hint) {
+    TXN_PROFILE_HINT_OP(MY_OP_X)
+  default:
+    ALWAYS_ASSERT(false);
+  }
+#undef MY_OP_X
+  return false;
+}
 
+template <template <typename> class Transaction>
+bool
+ndb_ordered_index<Transaction>::get_decoded(
+    void *txn,
+    const std::string &key,
+    value_decoder &decoder,
+    uint32_t acc_id)
+{
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+#define MY_OP_X(a, b) \
+  case a: \
+    { \
+      auto t = cast< b >()(p); \
+      return btr.search_decoded(*t, key, decoder, acc_id); \
+    }
+  switch (p->hint) {
+    TXN_PROFILE_HINT_OP(MY_OP_X)
+  default:
+    ALWAYS_ASSERT(false);
+  }
+#undef MY_OP_X
+  return false;
+}
+
+// neither get_decoded() nor get() of a packed_key copy the key: it only
+// goes into the txn arena if the absent set needs it
+template <template <typename> class Transaction>
+bool
+ndb_ordered_index<Transaction>::get_decoded(
+    void *txn,
+    const packed_key &key,
+    value_decoder &decoder,
+    uint32_t acc_id)
+{
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+#define MY_OP_X(a, b) \
+  case a: \
+    { \
+      auto t = cast< b >()(p); \
+      return btr.search_decoded(*t, varkey(key), decoder, acc_id); \
+    }
+  switch (p->hint) {
+    TXN_PROFILE_HINT_OP(MY_OP_X)
+  default:
+    ALWAYS_ASSERT(false);
+  }
+#undef MY_OP_X
+  return false;
+}
 
 template <template <typename> class Transaction>
 bool
@@ -863,6 +938,73 @@ ndb_ordered_index<Transaction>::get_profile(
   }
 }
 
+template <template <typename> class Transaction>
+size_t
+ndb_ordered_index<Transaction>::multi_get(
+    void *txn,
+    const std::string *keys,
+    std::string *values,
+    size_t n,
+    uint32_t acc_id)
+{
+  PERF_DECL(static std::string probe1_name(std::string(__PRETTY_FUNCTION__) + std::string(":total:")));
+  ANON_REGION(probe1_name.c_str(), &private_::ndb_get_probe0_cg);
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+  bool found[MULTI_OP_BATCH];
+  size_t nfound = 0;
+  for (size_t off = 0; off < n; off += MULTI_OP_BATCH) {
+    const size_t m = std::min(n - off, size_t(MULTI_OP_BATCH));
+#define MY_OP_X(a, b) \
+  case a: \
+    { \
+      auto t = cast< b >()(p); \
+      nfound += btr.multi_search(*t, keys + off, values + off, m, found, acc_id); \
+      break; \
+    }
+    switch (p->hint) {
+      TXN_PROFILE_HINT_OP(MY_OP_X)
+    default:
+      ALWAYS_ASSERT(false);
+    }
+#undef MY_OP_X
+    for (size_t i = 0; i < m; i++)
+      if (!found[i])
+        values[off + i].clear();
+  }
+  return nfound;
+}
+
+template <template <typename> class Transaction>
+void
+ndb_ordered_index<Transaction>::multi_put(
+    void *txn,
+    const std::string *keys,
+    const std::string *values,
+    size_t n,
+    uint32_t acc_id)
+{
+  PERF_DECL(static std::string probe1_name(std::string(__PRETTY_FUNCTION__) + std::string(":total:")));
+  ANON_REGION(probe1_name.c_str(), &private_::ndb_put_probe0_cg);
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+  try {
+#define MY_OP_X(a, b) \
+  case a: \
+    { \
+      auto t = cast< b >()(p); \
+      btr.multi_put(*t, keys, values, n, acc_id); \
+      return; \
+    }
+    switch (p->hint) {
+      TXN_PROFILE_HINT_OP(MY_OP_X)
+    default:
+      ALWAYS_ASSERT(false);
+    }
+#undef MY_OP_X
+  } catch (transaction_abort_exception &ex) {
+    throw abstract_db::abstract_abort_exception();
+  }
+}
+
 // XXX: find way to remove code duplication below using C++ templates!
 
 template <template <typename> class Transaction>
@@ -925,6 +1067,37 @@ ndb_ordered_index<Transaction>::put(
   return 0;
 }
 
+// the key goes straight from the packed bytes into the txn arena, see
+// txn_btree::put(const varkey &)
+template <template <typename> class Transaction>
+const char *
+ndb_ordered_index<Transaction>::put(
+    void *txn,
+    const packed_key &key,
+    const std::string &value,
+    uint32_t acc_id)
+{
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+  try {
+#define MY_OP_X(a, b) \
+  case a: \
+    { \
+      auto t = cast< b >()(p); \
+      btr.put(*t, varkey(key), value, acc_id); \
+      return 0; \
+    }
+    switch (p->hint) {
+      TXN_PROFILE_HINT_OP(MY_OP_X)
+    default:
+      ALWAYS_ASSERT(false);
+    }
+#undef MY_OP_X
+  } catch (transaction_abort_exception &ex) {
+    throw abstract_db::abstract_abort_exception();
+  }
+  return 0;
+}
+
 template <template <typename> class Transaction>
 const char *
 ndb_ordered_index<Transaction>::update(
@@ -963,7 +1136,9 @@ ndb_ordered_index<Transaction>::commutative_act(
     void *txn,
     const std::string &key,
     dbtuple::tuple_commutative_act act,
-    uint64_t param)
+    uint64_t param,
+    commutative_kind kind,
+    uint32_t acc_id)
 {
   ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
   try {
@@ -971,7 +1146,7 @@ ndb_ordered_index<Transaction>::commutative_act(
   case a: \
     { \
       auto t = cast< b >()(p); \
-      btr.commutative_act(*t, key, act, param); \
+      btr.commutative_act(*t, key, act, param, kind, acc_id); \
       return; \
     }
     switch (p->hint) {
@@ -1197,4 +1372,31 @@ ndb_ordered_index<Transaction>::clear()
   return btr.unsafe_purge(true);
 }
 
+template <template <typename> class Transaction>
+void
+ndb_ordered_index<Transaction>::build_hash_index()
+{
+  btr.build_hash_index();
+}
+
+template <template <typename> class Transaction>
+void
+ndb_ordered_index<Transaction>::enable_sequential_splits()
+{
+  btr.set_sequential_splits(mostly_append);
+}
+
+template <template <typename> class Transaction>
+bool
+ndb_ordered_index<Transaction>::leaf_stats(
+    size_t &nleaves, double &fill, size_t &nbytes) const
+{
+  size_t nslots;
+  btr.leaf_stats(nleaves, nslots, nbytes);
+  if (!nleaves)
+    return false;
+  fill = double(nslots) / double(nleaves * concurrent_btree::NKeysPerNode);
+  return true;
+}
+
 #endif /* _NDB_WRAPPER_IMPL_H_ */
@@ -171,7 +171,7 @@ public:
       //w.push_back(workload_desc("ConsumeScanHint", 1.0, TxnConsumeScanHint));
       //w.push_back(workload_desc("ConsumeNoScan", 1.0, TxnConsumeNoScan));
     else
-      w.push_back(workload_desc("Produce", 1.0, TxnProduce));
+      w.push_back(workload_desc("Produce", 1.0, TxnProduce, 1));
     return w;
   }
 
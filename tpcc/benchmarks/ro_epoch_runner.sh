@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# memory use vs. read only freshness: TPC-C (whose order-status and
+# stock-level txns read snapshots) with fixed read only epochs of decreasing
+# length, and with the adaptive read only epoch. compare
+# dbtuple_bytes_allocated - dbtuple_bytes_freed and the chain_walk_*
+# histogram against avg_ro_snapshot_staleness_ms
+#
+#   ./benchmarks/ro_epoch_runner.sh <prefix>
+
+set -x
+
+BENCH=./dbtest
+NTHREADS=${NTHREADS:-8}
+RUNTIME=${RUNTIME:-30}
+PREFIX=$1
+
+mkdir -p results
+
+run() {
+  $BENCH \
+    --verbose \
+    --bench tpcc \
+    --db-type ndb-ic3 \
+    --scale-factor $NTHREADS \
+    --num-threads $NTHREADS \
+    --runtime $RUNTIME \
+    "$@" 2>&1 | grep -E "agg_throughput|dbtuple_bytes_|dbtuple_spills|chain_walk_|ro_epoch|ro_snapshot"
+}
+
+for MS in 1000 400 120 40; do
+  run --ro-epoch-ms $MS > results/$PREFIX-ro-epoch-$MS.txt
+done
+run --ro-epoch-ms 1000 --ro-epoch-min-ms 40 --ro-epoch-max-versions 1000000 \
+  > results/$PREFIX-ro-epoch-adaptive.txt
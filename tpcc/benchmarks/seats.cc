@@ -76,6 +76,7 @@ init_seats_cgraph()
 
 
 
+  g->freeze();
   return g;
 }
 
@@ -25,6 +25,7 @@
 
 
 #include "bench.h"
+#include "commutative_ops.h"
 #include "../txn_btree.h"
 #include "../conflict_graph.h"
 //#include "../txn_proto2_impl.h"
@@ -54,6 +55,15 @@ enum bank_tx_types
 
 const size_t type_num = (end_type - amalgate_type);
 
+static int g_enable_commutative_ops = 0;
+
+// the balance updates of deposit_checking, send_payment and
+// transact_savings are pure adds, see --enable-commutative-ops
+static const dbtuple::tuple_commutative_act checking_add_act =
+  commutative_add<checking::value, float, &checking::value::balance>;
+static const dbtuple::tuple_commutative_act saving_add_act =
+  commutative_add<saving::value, float, &saving::value::balance>;
+
 static inline conflict_graph*
 init_bank_cgraph()
 {
@@ -67,6 +77,13 @@ init_bank_cgraph()
   g->init_txn(send_payment_type,1);
   g->init_txn(transact_savings_type,1);
   g->init_txn(write_check_type,1);
+  if (g_enable_commutative_ops) {
+    // the adds commute with each other, amalgamate and write_check still
+    // read the balances they write
+    g->set_commutative(deposit_checking_type, 1, CommutativeAdd);
+    g->set_commutative(send_payment_type, 1, CommutativeAdd);
+    g->set_commutative(transact_savings_type, 1, CommutativeAdd);
+  }
 
 
   g->set_conflict(amalgate_type, 1, deposit_checking_type, 1);
@@ -82,6 +99,7 @@ init_bank_cgraph()
 
 
 
+  g->freeze();
   return g;
 }
 
@@ -345,17 +363,17 @@ public:
 		  m += g_txn_workload_mix[i];
 		ALWAYS_ASSERT(m == 100);
 		if (g_txn_workload_mix[0])
-			w.push_back(workload_desc("Balance", double(g_txn_workload_mix[0])/100.0, TxnBalance));
+			w.push_back(workload_desc("Balance", double(g_txn_workload_mix[0])/100.0, TxnBalance, 0));
 		if (g_txn_workload_mix[1])
-			w.push_back(workload_desc("Amalgate:", double(g_txn_workload_mix[1])/100.0, TxnAmalgate));
+			w.push_back(workload_desc("Amalgate:", double(g_txn_workload_mix[1])/100.0, TxnAmalgate, 1));
 		if (g_txn_workload_mix[2])
-			w.push_back(workload_desc("DepositChecking:", double(g_txn_workload_mix[2])/100.0, TxnDepositChecking));
+			w.push_back(workload_desc("DepositChecking:", double(g_txn_workload_mix[2])/100.0, TxnDepositChecking, 2));
 		if (g_txn_workload_mix[3])
-			w.push_back(workload_desc("SendPayment:", double(g_txn_workload_mix[3])/100.0, TxnSendPayment));
+			w.push_back(workload_desc("SendPayment:", double(g_txn_workload_mix[3])/100.0, TxnSendPayment, 3));
 		if (g_txn_workload_mix[4])
-			w.push_back(workload_desc("TransactSavings", double(g_txn_workload_mix[4])/100.0, TxnTransactSavings));
+			w.push_back(workload_desc("TransactSavings", double(g_txn_workload_mix[4])/100.0, TxnTransactSavings, 4));
 		if (g_txn_workload_mix[5])
-			w.push_back(workload_desc("WriteCheck", double(g_txn_workload_mix[5])/100.0, TxnWriteCheck));
+			w.push_back(workload_desc("WriteCheck", double(g_txn_workload_mix[5])/100.0, TxnWriteCheck, 5));
 		return w;
 
 	}
@@ -827,12 +845,17 @@ deposit_checking_piece_1:
             checking::key k_c;
             k_c.cust_partition = pa_id;
             k_c.cust_id = cust_id;
-            ALWAYS_ASSERT(tbl_checking(partition_id)->get(txn, Encode(obj_key0, k_c), obj_v));
-            checking::value v_c_temp;
-            const checking::value* v_c_c = Decode(obj_v,v_c_temp);
-            float c_balance = v_c_c->balance;
-            v_c_temp.balance = c_balance+1;
-            tbl_checking(partition_id)->put(txn, Encode(str(), k_c), Encode(obj_v, v_c_temp));
+            if (g_enable_commutative_ops) {
+              tbl_checking(partition_id)->commutative_act(
+                  txn, Encode(str(), k_c), checking_add_act, commutative_param(1), CommutativeAdd);
+            } else {
+              ALWAYS_ASSERT(tbl_checking(partition_id)->get(txn, Encode(obj_key0, k_c), obj_v));
+              checking::value v_c_temp;
+              const checking::value* v_c_c = Decode(obj_v,v_c_temp);
+              float c_balance = v_c_c->balance;
+              v_c_temp.balance = c_balance+1;
+              tbl_checking(partition_id)->put(txn, Encode(str(), k_c), Encode(obj_v, v_c_temp));
+            }
             if(!db->mul_ops_end(txn))
             goto deposit_checking_piece_1;
         }
@@ -895,25 +918,36 @@ send_payment_piece_1:
     try{
           db->mul_ops_begin(txn);
           checking::key k_c;
-          k_c.cust_partition = pa_id_0;
-          k_c.cust_id = cust_id_0;
-          ALWAYS_ASSERT(tbl_checking(partition_id)->get(txn, Encode(obj_key0, k_c), obj_v));
-          checking::value v_c_temp;
-          const checking::value* v_c_0 = Decode(obj_v,v_c_temp);
-          float balance_0 = v_c_0->balance;
+          if (g_enable_commutative_ops) {
+            k_c.cust_partition = pa_id_1;
+            k_c.cust_id = cust_id_1;
+            tbl_checking(partition_id)->commutative_act(
+                txn, Encode(str(), k_c), checking_add_act, commutative_param(amount), CommutativeAdd);
+            k_c.cust_partition = pa_id_0;
+            k_c.cust_id = cust_id_0;
+            tbl_checking(partition_id)->commutative_act(
+                txn, Encode(str(), k_c), checking_add_act, commutative_param(-amount), CommutativeAdd);
+          } else {
+            k_c.cust_partition = pa_id_0;
+            k_c.cust_id = cust_id_0;
+            ALWAYS_ASSERT(tbl_checking(partition_id)->get(txn, Encode(obj_key0, k_c), obj_v));
+            checking::value v_c_temp;
+            const checking::value* v_c_0 = Decode(obj_v,v_c_temp);
+            float balance_0 = v_c_0->balance;
 
-          k_c.cust_partition = pa_id_1;
-          k_c.cust_id = cust_id_1;
-          ALWAYS_ASSERT(tbl_checking(partition_id)->get(txn, Encode(obj_key0, k_c), obj_v));
+            k_c.cust_partition = pa_id_1;
+            k_c.cust_id = cust_id_1;
+            ALWAYS_ASSERT(tbl_checking(partition_id)->get(txn, Encode(obj_key0, k_c), obj_v));
 
-          const checking::value* v_check_1 = Decode(obj_v,v_c_temp);
-          float balance_1 = v_check_1->balance;
-          v_c_temp.balance = balance_1+amount;
-          tbl_checking(partition_id)->put(txn, Encode(str(), k_c), Encode(obj_v, v_c_temp));
-          k_c.cust_partition = pa_id_0;
-          k_c.cust_id = cust_id_0;
-          v_c_temp.balance = balance_0-amount;
-          tbl_checking(partition_id)->put(txn, Encode(str(), k_c), Encode(obj_v, v_c_temp));
+            const checking::value* v_check_1 = Decode(obj_v,v_c_temp);
+            float balance_1 = v_check_1->balance;
+            v_c_temp.balance = balance_1+amount;
+            tbl_checking(partition_id)->put(txn, Encode(str(), k_c), Encode(obj_v, v_c_temp));
+            k_c.cust_partition = pa_id_0;
+            k_c.cust_id = cust_id_0;
+            v_c_temp.balance = balance_0-amount;
+            tbl_checking(partition_id)->put(txn, Encode(str(), k_c), Encode(obj_v, v_c_temp));
+          }
           if(!db->mul_ops_end(txn))
             goto send_payment_piece_1;
       } catch(piece_abort_exception &ex){
@@ -966,12 +1000,17 @@ transact_savings_piece_1:
              saving::key k_s;
              k_s.cust_partition = pa_id;
              k_s.cust_id = cust_id;
-             ALWAYS_ASSERT(tbl_saving(partition_id)->get(txn, Encode(obj_key0, k_s), obj_v));
-             saving::value v_s_temp;
-             const saving::value* v_c_s = Decode(obj_v,v_s_temp);
-             float c_balance = v_c_s->balance;
-             v_s_temp.balance = c_balance-amount;
-             tbl_saving(partition_id)->put(txn, Encode(str(), k_s), Encode(obj_v, v_s_temp));
+             if (g_enable_commutative_ops) {
+               tbl_saving(partition_id)->commutative_act(
+                   txn, Encode(str(), k_s), saving_add_act, commutative_param(-amount), CommutativeAdd);
+             } else {
+               ALWAYS_ASSERT(tbl_saving(partition_id)->get(txn, Encode(obj_key0, k_s), obj_v));
+               saving::value v_s_temp;
+               const saving::value* v_c_s = Decode(obj_v,v_s_temp);
+               float c_balance = v_c_s->balance;
+               v_s_temp.balance = c_balance-amount;
+               tbl_saving(partition_id)->put(txn, Encode(str(), k_s), Encode(obj_v, v_s_temp));
+             }
              if(!db->mul_ops_end(txn))
                goto transact_savings_piece_1;
        } catch(piece_abort_exception &ex){
@@ -1272,6 +1311,29 @@ void
 small_do_test(abstract_db *db, int argc, char **argv)
 {
 	optind = 1;
+	while (1) {
+		static struct option long_options[] =
+		{
+			{"enable-commutative-ops", no_argument, &g_enable_commutative_ops, 1},
+			{0, 0, 0, 0}
+		};
+		int option_index = 0;
+		int c = getopt_long(argc, argv, "", long_options, &option_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 0:
+			break;
+		case '?':
+			/* getopt_long already printed an error message. */
+			exit(1);
+		default:
+			abort();
+		}
+	}
+	if (verbose)
+		cerr << "smallbank settings:" << endl
+		     << "  commutative_ops : " << g_enable_commutative_ops << endl;
 
 	cgraph = init_bank_cgraph();
 	small_bench_runner r(db);
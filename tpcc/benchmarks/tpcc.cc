@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <numa.h>
 
 #include <set>
 #include <vector>
@@ -24,6 +25,7 @@
 #include "../conflict_graph.h"
 #include "bench.h"
 #include "tpcc.h"
+#include "commutative_ops.h"
 #include "../policy.h"
 using namespace std;
 using namespace util;
@@ -99,28 +101,6 @@ enum tpcc_tx_types
 
 const size_t type_num = (end_type - neworder_type);
 
-static inline conflict_graph* 
-init_tpcc_cgraph()
-{
-  conflict_graph* g = new conflict_graph(type_num);
-
-  //No need to specify the constraint, 
-  //if only one c-edge
-
-  g->init_txn(neworder_type, 3);
-
-#ifdef SUPPORT_COMMUTATIVE_OP  
-  g->init_txn(payment_type, 1);
-#else
-  g->init_txn(payment_type, 3);
-#endif  
-
-  g->init_txn(delivery_type, 2);  
-
-  return g;
-}
-
-
 // T must implement lock()/unlock(). Both must *not* throw exceptions
 template <typename T>
 class scoped_multilock {
@@ -201,14 +181,49 @@ static int g_enable_partition_locks = 0;
 static int g_enable_separate_tree_per_partition = 0;
 static int g_new_order_remote_item_pct = 1;
 static int g_new_order_fast_id_gen = 0;
+static int g_new_order_batch = 0;
+static int g_status_aborts = 0;
+static int g_decode_in_place = 0;
+static int g_column_groups = 0;
 static int g_uniform_item_dist = 0;
 static int g_order_status_scan_hack = 0;
 static unsigned g_txn_workload_mix[] = { 45, 43, 4, 4, 4 }; // default TPC-C workload mix
 static int g_user_initial_abort_rate = 0;
+static int g_enable_commutative_ops = 0;
+static int g_numa_placement = 0;
 
 static aligned_padded_elem<spinlock> *g_partition_locks = nullptr;
 static aligned_padded_elem<atomic<uint64_t>> *g_district_ids = nullptr;
 
+static inline conflict_graph* 
+init_tpcc_cgraph()
+{
+  // a derived access profile replaces the hand chopping below, its
+  // commutative steps are the traced commutative updates
+  conflict_graph* g = profile_conflict_graph();
+  if (g)
+    return g;
+
+  g = new conflict_graph(type_num);
+
+  //No need to specify the constraint, 
+  //if only one c-edge
+
+  g->init_txn(neworder_type, 3);
+
+  g->init_txn(payment_type, 3);
+  if (g_enable_commutative_ops) {
+    // the warehouse and district ytd adds commute with each other
+    g->set_commutative(payment_type, 1, CommutativeAdd);
+    g->set_commutative(payment_type, 2, CommutativeAdd);
+  }
+
+  g->init_txn(delivery_type, 2);  
+
+  g->freeze();
+  return g;
+}
+
 // maps a wid => partition id
 static inline ALWAYS_INLINE unsigned int
 PartitionId(unsigned int wid)
@@ -232,6 +247,76 @@ LockForPartition(unsigned int wid)
   return g_partition_locks[PartitionId(wid)].elem;
 }
 
+// --numa-placement: worker i runs on g_worker_cpu[i], and every warehouse is
+// loaded on (so allocated from) the cpu of the worker which owns it
+static vector<unsigned> g_worker_cpu;
+static vector<unsigned> g_warehouse_cpu; // indexed by wid
+static vector<int> g_warehouse_node; // indexed by wid
+
+static void
+InitNumaPlacement()
+{
+  // the allocator regions only cover cpus [0, nthreads), so only those are
+  // handed out, visited node by node so consecutive workers (and with them
+  // consecutive warehouse ranges) share a node
+  const unsigned ncpus = min<unsigned>(nthreads, coreid::num_cpus_online());
+  vector<pair<int, unsigned>> cpus;
+  for (unsigned c = 0; c < ncpus; c++) {
+    const int node = numa_node_of_cpu(c);
+    ALWAYS_ASSERT(node >= 0);
+    cpus.emplace_back(node, c);
+  }
+  sort(cpus.begin(), cpus.end());
+  g_worker_cpu.resize(nthreads);
+  for (size_t i = 0; i < nthreads; i++)
+    g_worker_cpu[i] = cpus[i % ncpus].second;
+  g_warehouse_cpu.assign(NumWarehouses() + 1, 0);
+  g_warehouse_node.assign(NumWarehouses() + 1, -1);
+  for (unsigned w = 1; w <= NumWarehouses(); w++) {
+    // PartitionId() is the first worker owning w, see make_workers()
+    g_warehouse_cpu[w] = g_worker_cpu[PartitionId(w)];
+    g_warehouse_node[w] = numa_node_of_cpu(g_warehouse_cpu[w]);
+  }
+}
+
+static inline ALWAYS_INLINE bool
+IsCrossNode(unsigned w0, unsigned w1)
+{
+  return g_numa_placement && g_warehouse_node[w0] != g_warehouse_node[w1];
+}
+
+// --column-groups: the accesses by which new-order shares warehouse and
+// customer rows with payment and delivery name the column groups (see
+// tpcc.h) they touch, so they no longer depend on each other. reads the
+// txn overwrites later keep the whole row, it writes all of it back
+static void
+DeclareAccessColumnGroups()
+{
+#ifndef USE_UPDATE_FUNC
+  // access_id 0 - new-order reads w_tax
+  access_cgroups[0] = column_groups<warehouse::value>::of_fields(
+      COLUMN_GROUP_FIELD(warehouse, w_tax));
+  // access_id 10 - new-order reads the discount, credit and name
+  access_cgroups[10] = column_groups<customer::value>::of_fields(
+      COLUMN_GROUP_FIELD(customer, c_discount) |
+      COLUMN_GROUP_FIELD(customer, c_credit) |
+      COLUMN_GROUP_FIELD(customer, c_last) |
+      COLUMN_GROUP_FIELD(customer, c_middle));
+  // access_id 12 - payment adds to w_ytd
+  access_cgroups[12] = column_groups<warehouse::value>::of_fields(
+      COLUMN_GROUP_FIELD(warehouse, w_ytd));
+  // access_id 16 - payment updates the balance and c_data
+  access_cgroups[16] = column_groups<customer::value>::of_fields(
+      COLUMN_GROUP_FIELD(customer, c_balance) |
+      COLUMN_GROUP_FIELD(customer, c_ytd_payment) |
+      COLUMN_GROUP_FIELD(customer, c_payment_cnt) |
+      COLUMN_GROUP_FIELD(customer, c_data));
+  // access_id 25 - delivery adds to c_balance
+  access_cgroups[25] = column_groups<customer::value>::of_fields(
+      COLUMN_GROUP_FIELD(customer, c_balance));
+#endif
+}
+
 static inline atomic<uint64_t> &
 NewOrderIdHolder(unsigned warehouse, unsigned district)
 {
@@ -369,7 +454,7 @@ protected: \
   {
     const unsigned int partid = PartitionId(wid);
     ALWAYS_ASSERT(partid < nthreads);
-    const unsigned int pinid  = partid;
+    const unsigned int pinid  = g_numa_placement ? g_warehouse_cpu[wid] : partid;
     if (verbose)
       cerr << "PinToWarehouseId(): coreid=" << coreid::core_id()
            << " pinned to whse=" << wid << " (partid=" << partid << ")"
@@ -598,8 +683,21 @@ public:
   // XXX(stephentu): tune this
   static const size_t NMaxCustomerIdxScanElems = 512;
 
+  // the flags each procedure starts its txn with: with --status-aborts an
+  // access the policy fails returns false instead of throwing, see
+  // TXN_STATUS_ABORT_CHECK
+  inline uint64_t
+  procedure_txn_flags() const
+  {
+    return txn_flags | (g_status_aborts ? transaction_base::TXN_FLAG_STATUS_ABORTS : 0);
+  }
+
   txn_result txn_new_order();
 
+  bool new_order_update_stock_batched(
+      void *txn, uint warehouse_id, uint numItems, const uint *itemIDs,
+      const uint *supplierWarehouseIDs, const uint *orderQuantities);
+
   static txn_result
   TxnNewOrder(bench_worker *w)
   {
@@ -658,15 +756,15 @@ public:
       m += g_txn_workload_mix[i];
     ALWAYS_ASSERT(m == 100);
     if (g_txn_workload_mix[0])
-      w.push_back(workload_desc("NewOrder", double(g_txn_workload_mix[0])/100.0, TxnNewOrder));
+      w.push_back(workload_desc("NewOrder", double(g_txn_workload_mix[0])/100.0, TxnNewOrder, 0));
     if (g_txn_workload_mix[1])
-      w.push_back(workload_desc("Payment", double(g_txn_workload_mix[1])/100.0, TxnPayment));
+      w.push_back(workload_desc("Payment", double(g_txn_workload_mix[1])/100.0, TxnPayment, 1));
     if (g_txn_workload_mix[2])
-      w.push_back(workload_desc("Delivery", double(g_txn_workload_mix[2])/100.0, TxnDelivery));
+      w.push_back(workload_desc("Delivery", double(g_txn_workload_mix[2])/100.0, TxnDelivery, 2));
     if (g_txn_workload_mix[3])
-      w.push_back(workload_desc("OrderStatus", double(g_txn_workload_mix[3])/100.0, TxnOrderStatus));
+      w.push_back(workload_desc("OrderStatus", double(g_txn_workload_mix[3])/100.0, TxnOrderStatus, 3));
     if (g_txn_workload_mix[4])
-      w.push_back(workload_desc("StockLevel", double(g_txn_workload_mix[4])/100.0, TxnStockLevel));
+      w.push_back(workload_desc("StockLevel", double(g_txn_workload_mix[4])/100.0, TxnStockLevel, 4));
     return w;
   }
 
@@ -688,12 +786,26 @@ public:
     INVARIANT(warehouse_id_end <= (NumWarehouses() + 1));
   }
 
+  // cpu picked by InitNumaPlacement(), only used with --numa-placement
+  void
+  set_home_cpu(unsigned cpu)
+  {
+    home_cpu = cpu;
+  }
+
 protected:
 
   virtual void
   on_run_setup() OVERRIDE
   {
-    
+    if (g_numa_placement) {
+      // same cpu (so node and allocator region) our warehouses were loaded on
+      bind_thread(home_cpu);
+      rcu::s_instance.pin_current_thread(home_cpu);
+      rcu::s_instance.fault_region();
+      return;
+    }
+
     bind_thread(worker_id);
 
     if (!pin_cpus)
@@ -713,6 +825,7 @@ protected:
 private:
   uint warehouse_id_start;
   uint warehouse_id_end;
+  unsigned home_cpu = 0;
   // static int32_t last_no_o_ids[10]; // XXX(stephentu): hack
   int32_t local_last_no_o_ids[64][10]; // XXX(stephentu): hack
   bool retry = false;
@@ -722,6 +835,9 @@ private:
   string obj_key0;
   string obj_key1;
   string obj_v;
+  packed_key pkey;
+  string stock_keys[15];
+  string stock_values[15];
 };
 
 // int32_t tpcc_worker::last_no_o_ids[10];
@@ -1343,6 +1459,9 @@ private:
 
 static event_counter evt_tpcc_cross_partition_new_order_txns("tpcc_cross_partition_new_order_txns");
 static event_counter evt_tpcc_cross_partition_payment_txns("tpcc_cross_partition_payment_txns");
+// only counted with --numa-placement, when warehouses have a home node
+static event_counter evt_tpcc_cross_node_new_order_items("tpcc_cross_node_new_order_items");
+static event_counter evt_tpcc_cross_node_payment_txns("tpcc_cross_node_payment_txns");
 
 
 #ifdef STOCK_PROF
@@ -1426,6 +1545,24 @@ private:
   x(9) \
   x(10)
 
+// with --status-aborts every procedure runs with TXN_FLAG_STATUS_ABORTS: an
+// access whose policy wait aborts the txn fails instead of throwing (a get
+// returns false, an expose (false, -1), writes and scans do nothing), and the
+// procedure returns through these
+#define TXN_STATUS_ABORT_CHECK(type) \
+  if (unlikely(db->should_abort(txn))) { \
+    db->abort_txn(txn); \
+    return txn_result(false, type); \
+  }
+
+#define TXN_GET_OR_STATUS_ABORT(get, type) \
+  do { \
+    if (unlikely(!(get))) { \
+      TXN_STATUS_ABORT_CHECK(type); \
+      ALWAYS_ASSERT(false); \
+    } \
+  } while (0)
+
 #define TXN_NEW_ORDER_PIECE_RETRY(a) \
   case a: \
     { \
@@ -1435,6 +1572,81 @@ private:
 
 // std::cerr << "goto " << #a <<std::endl;
 
+// the stock rows of a new order are known up front, so they can be read and
+// then written with one policy decision per stock tree (a single tree unless
+// partitioned) instead of one per row. returns false, having touched
+// nothing, if an item repeats: the row at a time loop has the second access
+// see the first one's write. under status aborts the caller checks
+// should_abort() after it
+bool
+tpcc_worker::new_order_update_stock_batched(
+    void *txn, uint warehouse_id, uint numItems, const uint *itemIDs,
+    const uint *supplierWarehouseIDs, const uint *orderQuantities)
+{
+  uint order[15];
+  for (uint i = 0; i < numItems; i++)
+    order[i] = i;
+  std::sort(order, order + numItems, [&](uint a, uint b) {
+    if (tbl_stock(supplierWarehouseIDs[a]) != tbl_stock(supplierWarehouseIDs[b]))
+      return tbl_stock(supplierWarehouseIDs[a]) < tbl_stock(supplierWarehouseIDs[b]);
+    return std::make_pair(supplierWarehouseIDs[a], itemIDs[a]) <
+           std::make_pair(supplierWarehouseIDs[b], itemIDs[b]);
+  });
+  for (uint j = 1; j < numItems; j++)
+    if (supplierWarehouseIDs[order[j]] == supplierWarehouseIDs[order[j - 1]] &&
+        itemIDs[order[j]] == itemIDs[order[j - 1]])
+      return false;
+
+  for (uint j = 0; j < numItems; j++) {
+    const uint i = order[j];
+    const stock::key k_s(supplierWarehouseIDs[i], itemIDs[i]);
+    Encode(stock_keys[j], k_s);
+  }
+
+  // access_id 4 - read stock
+  for (uint lo = 0, hi; lo < numItems; lo = hi) {
+    abstract_ordered_index * const tbl = tbl_stock(supplierWarehouseIDs[order[lo]]);
+    for (hi = lo + 1; hi < numItems && tbl_stock(supplierWarehouseIDs[order[hi]]) == tbl; hi++)
+      ;
+    if (tbl->multi_get(txn, &stock_keys[lo], &stock_values[lo],
+                       hi - lo, 4 /*access_id*/) != hi - lo) {
+      if (db->should_abort(txn))
+        return true;
+      ALWAYS_ASSERT(false);
+    }
+  }
+
+  for (uint j = 0; j < numItems; j++) {
+    const uint i = order[j];
+    const uint ol_supply_w_id = supplierWarehouseIDs[i];
+    const uint ol_quantity = orderQuantities[i];
+    const stock::key k_s(ol_supply_w_id, itemIDs[i]);
+    stock::value v_s_temp;
+    const stock::value *v_s = Decode(stock_values[j], v_s_temp);
+    checker::SanityCheckStock(&k_s, v_s);
+
+    stock::value v_s_new(*v_s);
+    if (v_s_new.s_quantity - ol_quantity >= 10)
+      v_s_new.s_quantity -= ol_quantity;
+    else
+      v_s_new.s_quantity += -int32_t(ol_quantity) + 91;
+    v_s_new.s_ytd += ol_quantity;
+    v_s_new.s_remote_cnt += (ol_supply_w_id == warehouse_id) ? 0 : 1;
+    Encode(stock_values[j], v_s_new);
+  }
+
+  // access_id 5 - write stock
+  for (uint lo = 0, hi; lo < numItems; lo = hi) {
+    abstract_ordered_index * const tbl = tbl_stock(supplierWarehouseIDs[order[lo]]);
+    for (hi = lo + 1; hi < numItems && tbl_stock(supplierWarehouseIDs[order[hi]]) == tbl; hi++)
+      ;
+    tbl->multi_put(txn, &stock_keys[lo], &stock_values[lo], hi - lo, 5 /*access_id*/);
+    if (db->should_abort(txn))
+      return true;
+  }
+  return true;
+}
+
 tpcc_worker::txn_result
 tpcc_worker::txn_new_order()
 {
@@ -1456,6 +1668,8 @@ tpcc_worker::txn_new_order()
        supplierWarehouseIDs[i] = RandomNumber(r, 1, NumWarehouses());
       } while (supplierWarehouseIDs[i] == warehouse_id);
       allLocal = false;
+      if (IsCrossNode(warehouse_id, supplierWarehouseIDs[i]))
+        ++evt_tpcc_cross_node_new_order_items;
     }
     orderQuantities[i] = RandomNumber(r, 1, 10);
   }
@@ -1490,7 +1704,8 @@ tpcc_worker::txn_new_order()
   //   max_write_set_size : 15
   //   num_txn_contexts : 9
 
-  void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_TPCC_NEW_ORDER, neworder_type);
+  void *txn = db->new_txn(procedure_txn_flags(),
+                          arena, txn_buf(), abstract_db::HINT_TPCC_NEW_ORDER, neworder_type);
 
   db->init_txn(txn, cgraph, neworder_type, pg);
 
@@ -1525,14 +1740,16 @@ piece_retry_0:
     //[WH]
     const warehouse::key k_w(warehouse_id);
     // access_id 0 - read warehouse
-    ALWAYS_ASSERT(tbl_warehouse(warehouse_id)
-                      ->get(txn, Encode(obj_key0, k_w), obj_v, std::string::npos, 0 /*access_id*/));
+    TXN_GET_OR_STATUS_ABORT(tbl_warehouse(warehouse_id)
+                                ->get(txn, EncodeKey(pkey, k_w), obj_v, std::string::npos, 0 /*access_id*/),
+                            neworder_type);
     warehouse::value v_w_temp;
     const warehouse::value *v_w = Decode(obj_v, v_w_temp);
     checker::SanityCheckWarehouse(&k_w, v_w);
 
     expose_ret = db->expose_uncommitted(txn, 0 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1547,10 +1764,12 @@ piece_retry_1:
     new_order_district_update_callback d_c(obj_v, str(), &k_d);
     tbl_district(warehouse_id)->update(
         txn, Encode(str(), k_d), obj_v, &d_c, 1 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(neworder_type);
     my_next_o_id = d_c.get_my_next_o_id();
 
     expose_ret = db->expose_uncommitted(txn, 1 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1562,11 +1781,12 @@ piece_retry_1:
     //[DIST]
     const district::key k_d(warehouse_id, districtID);
     // access_id 1 - read district
-    ALWAYS_ASSERT(tbl_district(warehouse_id)->get(
-        txn, Encode(obj_key0, k_d), obj_v, std::string::npos, 1 /*access_id*/));
+    TXN_GET_OR_STATUS_ABORT(tbl_district(warehouse_id)->get(
+        txn, EncodeKey(pkey, k_d), obj_v, std::string::npos, 1 /*access_id*/), neworder_type);
 
     expose_ret = db->expose_uncommitted(txn, 1 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1587,10 +1807,12 @@ piece_retry_2:
       // access_id 2 - write district
       tbl_district(warehouse_id)->put(
           txn, Encode(str(), k_d), Encode(str(), v_d_new), 2 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(neworder_type);
     }
 
     expose_ret = db->expose_uncommitted(txn, 2 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1605,10 +1827,18 @@ piece_retry_3:
 
       const item::key k_i(ol_i_id);
       // access_id 3 - read item
-      ALWAYS_ASSERT(tbl_item(1)->get(
-              txn, Encode(obj_key0, k_i), obj_v, std::string::npos, 3 /*access_id*/));
       item::value v_i_temp;
-      const item::value *v_i = Decode(obj_v, v_i_temp);
+      if (g_decode_in_place) {
+        typed_value_decoder<item::value> d_i(
+            v_i_temp, 1UL << item::value::i_price_field);
+        TXN_GET_OR_STATUS_ABORT(tbl_item(1)->get_decoded(
+                txn, EncodeKey(pkey, k_i), d_i, 3 /*access_id*/), neworder_type);
+      } else {
+        TXN_GET_OR_STATUS_ABORT(tbl_item(1)->get(
+                txn, EncodeKey(pkey, k_i), obj_v, std::string::npos, 3 /*access_id*/), neworder_type);
+        Decode(obj_v, v_i_temp);
+      }
+      const item::value *v_i = &v_i_temp;
       itemPrices[ol_number - 1] = v_i->i_price;
 
       checker::SanityCheckItem(&k_i, v_i);
@@ -1616,6 +1846,7 @@ piece_retry_3:
 
     expose_ret = db->expose_uncommitted(txn, 3 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1624,6 +1855,11 @@ piece_retry_3:
 
 piece_retry_4:
     //[STOCK]
+#ifndef USE_UPDATE_FUNC
+    if (!g_new_order_batch ||
+        !new_order_update_stock_batched(txn, warehouse_id, numItems, itemIDs,
+                                        supplierWarehouseIDs, orderQuantities))
+#endif
     for (uint ol_number = 1; ol_number <= numItems; ol_number++) {
       const uint ol_supply_w_id = supplierWarehouseIDs[ol_number - 1];
       const uint ol_i_id = itemIDs[ol_number - 1];
@@ -1636,12 +1872,20 @@ piece_retry_4:
       new_order_stock_update_callback s_c(obj_v, str(), &k_s, ol_supply_w_id, ol_i_id, ol_quantity, warehouse_id);
       tbl_stock(ol_supply_w_id)->update(
           txn, Encode(str(), k_s), obj_v, &s_c, 3 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(neworder_type);
 #else
       // access_id 4 - read stock
-      ALWAYS_ASSERT(tbl_stock(ol_supply_w_id)->get(
-          txn, Encode(obj_key0, k_s), obj_v, std::string::npos, 4 /*access_id*/));
       stock::value v_s_temp;
-      const stock::value *v_s = Decode(obj_v, v_s_temp);
+      if (g_decode_in_place) {
+        typed_value_decoder<stock::value> d_s(v_s_temp);
+        TXN_GET_OR_STATUS_ABORT(tbl_stock(ol_supply_w_id)->get_decoded(
+            txn, EncodeKey(pkey, k_s), d_s, 4 /*access_id*/), neworder_type);
+      } else {
+        TXN_GET_OR_STATUS_ABORT(tbl_stock(ol_supply_w_id)->get(
+            txn, EncodeKey(pkey, k_s), obj_v, std::string::npos, 4 /*access_id*/), neworder_type);
+        Decode(obj_v, v_s_temp);
+      }
+      const stock::value *v_s = &v_s_temp;
       checker::SanityCheckStock(&k_s, v_s);
 
       stock::value v_s_new(*v_s);
@@ -1655,11 +1899,14 @@ piece_retry_4:
       // access_id 5 - write stock
       tbl_stock(ol_supply_w_id)->put(
           txn, Encode(str(), k_s), Encode(str(), v_s_new), 5 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(neworder_type);
 #endif
     }
 
+    TXN_STATUS_ABORT_CHECK(neworder_type);
     expose_ret = db->expose_uncommitted(txn, 5 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1675,10 +1922,12 @@ piece_retry_6:
     // access_id 6 - write new order / insert new order
     tbl_new_order(warehouse_id)->insert(
         txn, Encode(str(), k_no), Encode(str(), v_no), 6 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(neworder_type);
     ret += new_order_sz;
 
     expose_ret = db->expose_uncommitted(txn, 6 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1699,10 +1948,12 @@ piece_retry_7:
     // access_id 7 - write order / insert order
     tbl_oorder(warehouse_id)->insert(
         txn, Encode(str(), k_oo), Encode(str(), v_oo), 7 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(neworder_type);
     ret += oorder_sz;
 
     expose_ret = db->expose_uncommitted(txn, 7 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1716,10 +1967,12 @@ piece_retry_8:
     // access_id 8 - write order index / insert order index
     tbl_oorder_c_id_idx(warehouse_id)->insert(
         txn, Encode(str(), k_oo_idx), Encode(str(), v_oo_idx), 8 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(neworder_type);
 
 
     expose_ret = db->expose_uncommitted(txn, 8 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1746,11 +1999,13 @@ piece_retry_9:
       // access_id 9 write order line / insert order line
       tbl_order_line(warehouse_id)->insert(
           txn, Encode(str(), k_ol), Encode(str(), v_ol), 9 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       ret += order_line_sz;
     }
 
     expose_ret = db->expose_uncommitted(txn, 9 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1761,14 +2016,27 @@ piece_retry_10:
     //[CUST]
     const customer::key k_c(warehouse_id, districtID, customerID);
     // access_id 10 - read customer
-    ALWAYS_ASSERT(tbl_customer(warehouse_id)->get(
-            txn, Encode(obj_key0, k_c), obj_v, std::string::npos, 10 /*access_id*/));
     customer::value v_c_temp;
-    const customer::value *v_c = Decode(obj_v, v_c_temp);
+    if (g_decode_in_place) {
+      // skips c_data, the bulk of the row
+      typed_value_decoder<customer::value> d_c(v_c_temp,
+          (1UL << customer::value::c_discount_field) |
+          (1UL << customer::value::c_credit_field) |
+          (1UL << customer::value::c_last_field) |
+          (1UL << customer::value::c_middle_field));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get_decoded(
+              txn, EncodeKey(pkey, k_c), d_c, 10 /*access_id*/), neworder_type);
+    } else {
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get(
+              txn, EncodeKey(pkey, k_c), obj_v, std::string::npos, 10 /*access_id*/), neworder_type);
+      Decode(obj_v, v_c_temp);
+    }
+    const customer::value *v_c = &v_c_temp;
     checker::SanityCheckCustomer(&k_c, v_c);
 
     expose_ret = db->expose_uncommitted(txn, 10 + ACCESSES/*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(neworder_type);
       switch (expose_ret.second) {
         TXN_NEW_ORDER_LIST(TXN_NEW_ORDER_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -1919,7 +2187,7 @@ neworder_piece:
       const oorder::key k_oo(warehouse_id, d, last_no_o_id);
       // XXX(Conrad): access_id 19 - read order
       ALWAYS_ASSERT(tbl_oorder(warehouse_id)->get(
-              txn, Encode(obj_key0, k_oo), obj_v,
+              txn, EncodeKey(pkey, k_oo), obj_v,
               std::string::npos,
               policy->is_occ(true, 14, false)));
 
@@ -1982,7 +2250,7 @@ customer_piece:
         const customer::key k_c(warehouse_id, d, c_id);
         // XXX(Conrad): access_id 23 - read customer
         ALWAYS_ASSERT(tbl_customer(warehouse_id)->get(
-                txn, Encode(obj_key0, k_c), obj_v,
+                txn, EncodeKey(pkey, k_c), obj_v,
                 std::string::npos,
                 policy->is_occ(true, 23, false)));
 
@@ -2114,7 +2382,7 @@ tpcc_worker::txn_delivery()
   //   max_read_set_size : 133
   //   max_write_set_size : 133
   //   num_txn_contexts : 4
-  void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_TPCC_DELIVERY, delivery_type);
+  void *txn = db->new_txn(procedure_txn_flags(), arena, txn_buf(), abstract_db::HINT_TPCC_DELIVERY, delivery_type);
 
   db->init_txn(txn, cgraph, delivery_type, pg);
 
@@ -2157,6 +2425,7 @@ piece_retry_18:
         // access_id 18 scan new_order table
         tbl_new_order(warehouse_id)->scan(txn, Encode(str(), k_no_0), &Encode(str(), k_no_1), 
                                           new_order_c, s_arena.get(), 18 /*access_id*/);
+        TXN_STATUS_ABORT_CHECK(delivery_type);
       }
 
       const new_order::key *k_no = new_order_c.get_key();
@@ -2172,6 +2441,7 @@ piece_retry_18:
 
     expose_ret = db->expose_uncommitted(txn, 18 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(delivery_type);
       switch (expose_ret.second) {
         TXN_DELIVERY_LIST(TXN_DELIVERY_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2188,10 +2458,12 @@ piece_retry_19:
       // access_id 19 delete new_order
       tbl_new_order(warehouse_id)->remove(
           txn, Encode(str(), new_order_keys[d - 1]), 19 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(delivery_type);
     }
 
     expose_ret = db->expose_uncommitted(txn, 19 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(delivery_type);
       switch (expose_ret.second) {
         TXN_DELIVERY_LIST(TXN_DELIVERY_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2222,11 +2494,14 @@ piece_retry_20:
       delivery_order_update_callback o_c(obj_v, str(), &k_oo, o_carrier_id, &c_id, d);
       tbl_oorder(warehouse_id)->update(
           txn, Encode(str(), k_oo), obj_v, &o_c, 15 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(delivery_type);
 #else
       // access_id 20 read order
-      if(!tbl_oorder(warehouse_id)->get(
-              txn, Encode(obj_key0, k_oo), obj_v, std::string::npos, 20 /*access_id*/))
+      if (!tbl_oorder(warehouse_id)->get(
+              txn, EncodeKey(pkey, k_oo), obj_v, std::string::npos, 20 /*access_id*/)) {
+        TXN_STATUS_ABORT_CHECK(delivery_type);
         continue;
+      }
         
       oorder::value v_oo_temp;
       const oorder::value *v_oo = Decode(obj_v, v_oo_temp);
@@ -2237,6 +2512,7 @@ piece_retry_20:
       // access_id 21 write order
       tbl_oorder(warehouse_id)->put(
           txn, Encode(str(), k_oo), Encode(str(), v_oo_new), 21 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(delivery_type);
       c_id[d - 1] = v_oo->o_c_id;
 #endif
     }
@@ -2244,6 +2520,7 @@ piece_retry_20:
 
     expose_ret = db->expose_uncommitted(txn, 21 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(delivery_type);
       switch (expose_ret.second) {
         TXN_DELIVERY_LIST(TXN_DELIVERY_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2264,6 +2541,7 @@ piece_retry_22:
       // access_id 22 scan order_line
       tbl_order_line(warehouse_id)->scan(txn, Encode(str(), k_oo_0), &Encode(str(), k_oo_1), 
                                           c, s_arena.get(), 22 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(delivery_type);
       float sum = 0.0;
       ALWAYS_ASSERT(c.size() <= 15);
       for (size_t i = 0; i < c.size(); i++) {
@@ -2284,6 +2562,7 @@ piece_retry_22:
         // access_id 23 write order_line
         tbl_order_line(warehouse_id)->put(
             txn, *c.values[i].first, Encode(str(), v_ol_new), 23 /*access_id*/);
+        TXN_STATUS_ABORT_CHECK(delivery_type);
       }
 
       ol_total[d - 1] = sum;
@@ -2292,6 +2571,7 @@ piece_retry_22:
 
     expose_ret = db->expose_uncommitted(txn, 23 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(delivery_type);
       switch (expose_ret.second) {
         TXN_DELIVERY_LIST(TXN_DELIVERY_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2311,11 +2591,14 @@ piece_retry_24:
       delivery_customer_update_callback c_c(obj_v, str(), &k_c, ol_total[d - 1]);
       tbl_customer(warehouse_id)->update(
           txn, Encode(str(), k_c), obj_v, &c_c, 17 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(delivery_type);
 #else
       // access_id 24 read customer
-      if(!tbl_customer(warehouse_id)->get(
-              txn, Encode(obj_key0, k_c), obj_v, std::string::npos, 24 /*access_id*/))
+      if (!tbl_customer(warehouse_id)->get(
+              txn, EncodeKey(pkey, k_c), obj_v, std::string::npos, 24 /*access_id*/)) {
+        TXN_STATUS_ABORT_CHECK(delivery_type);
         continue;
+      }
 
       customer::value v_c_temp;
       const customer::value *v_c = Decode(obj_v, v_c_temp);
@@ -2324,11 +2607,13 @@ piece_retry_24:
       // access_id 25 write customer
       tbl_customer(warehouse_id)->put(
           txn, Encode(str(), k_c), Encode(str(), v_c_new), 25 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(delivery_type);
 #endif
     }
 
     expose_ret = db->expose_uncommitted(txn, 25 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(delivery_type);
       switch (expose_ret.second) {
         TXN_DELIVERY_LIST(TXN_DELIVERY_PIECE_RETRY)
         default: 
@@ -2366,247 +2651,11 @@ piece_retry_24:
 static event_avg_counter evt_avg_cust_name_idx_scan_size("avg_cust_name_idx_scan_size");
 
 
-void payment_wh_act(std::string* val, uint64_t paymentAmount){
-  warehouse::value v_d_temp;
-  const warehouse::value *v_d = Decode(*val, v_d_temp);
-  warehouse::value  v_d_new(*v_d);
-  v_d_new.w_ytd += paymentAmount;
-  v_d_new.w_tax += 1.0;
-  Encode(*val, v_d_new);
-  // fprintf(stderr, "[before] ytd %f tax %f ytd_delta %ld\n", v_d->w_ytd, v_d->w_tax, paymentAmount);
-  //const warehouse::value *v_dd = Decode(*val, v_d_temp);
-  // fprintf(stderr, "[after] ytd %f tax %f ytd_delta %ld\n", v_dd->w_ytd, v_dd->w_tax, paymentAmount);
-}
-
-
-void payment_dist_act(std::string* val, uint64_t paymentAmount){
-  district::value v_d_temp;
-  const district::value *v_d = Decode(*val, v_d_temp);
-  district::value v_d_new(*v_d);
-  v_d_new.d_ytd += paymentAmount;
-  Encode(*val, v_d_new);
-}
-
-#ifdef SUPPORT_COMMUTATIVE_OP
-
-tpcc_worker::txn_result
-tpcc_worker::txn_payment()
-{
-  const uint warehouse_id = PickWarehouseId(r, warehouse_id_start, warehouse_id_end);
-  const uint districtID = RandomNumber(r, 1, NumDistrictsPerWarehouse());
-  uint customerDistrictID, customerWarehouseID;
-  if (likely(g_disable_xpartition_txn ||
-             NumWarehouses() == 1 ||
-             RandomNumber(r, 1, 100) <= 85)) {
-    customerDistrictID = districtID;
-    customerWarehouseID = warehouse_id;
-  } else {
-    customerDistrictID = RandomNumber(r, 1, NumDistrictsPerWarehouse());
-    do {
-      customerWarehouseID = RandomNumber(r, 1, NumWarehouses());
-    } while (customerWarehouseID == warehouse_id);
-  }
-  const float paymentAmount = (float) (RandomNumber(r, 100, 500000) / 100.0);
-  const uint32_t ts = GetCurrentTimeMillis();
-  INVARIANT(!g_disable_xpartition_txn || customerWarehouseID == warehouse_id);
-
-  // output from txn counters:
-  //   max_absent_range_set_size : 0
-  //   max_absent_set_size : 0
-  //   max_node_scan_size : 10
-  //   max_read_set_size : 71
-  //   max_write_set_size : 1
-  //   num_txn_contexts : 5
-  void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_TPCC_PAYMENT, payment_type);
-  
-  db->init_txn(txn, cgraph, payment_type);
-
-  scoped_str_arena s_arena(arena);
-  scoped_multilock<spinlock> mlock;
-  if (g_enable_partition_locks) {
-    mlock.enq(LockForPartition(warehouse_id));
-    if (PartitionId(customerWarehouseID) != PartitionId(warehouse_id))
-      mlock.enq(LockForPartition(customerWarehouseID));
-    mlock.multilock();
-  }
-  if (customerWarehouseID != warehouse_id)
-    ++evt_tpcc_cross_partition_payment_txns;
-  try {
-    ssize_t ret = 0;
-
-    //[CUSTOMER]
-    // XXX(Conrad): dep_piece_id 9
-customer_piece:
-    customer::key k_c;
-    customer::value v_c;
-
-    try {
-
-      db->mul_ops_begin(txn);
-
-      if (RandomNumber(r, 1, 100) <= 60) {
-        // cust by name
-        uint8_t lastname_buf[CustomerLastNameMaxSize + 1];
-        static_assert(sizeof(lastname_buf) == 16, "xx");
-        NDB_MEMSET(lastname_buf, 0, sizeof(lastname_buf));
-        GetNonUniformCustomerLastNameRun(lastname_buf, r);
-
-        static const string zeros(16, 0);
-        static const string ones(16, 255);
-
-        customer_name_idx::key k_c_idx_0;
-        k_c_idx_0.c_w_id = customerWarehouseID;
-        k_c_idx_0.c_d_id = customerDistrictID;
-        k_c_idx_0.c_last.assign((const char *) lastname_buf, 16);
-        k_c_idx_0.c_first.assign(zeros);
-
-        customer_name_idx::key k_c_idx_1;
-        k_c_idx_1.c_w_id = customerWarehouseID;
-        k_c_idx_1.c_d_id = customerDistrictID;
-        k_c_idx_1.c_last.assign((const char *) lastname_buf, 16);
-        k_c_idx_1.c_first.assign(ones);
-
-        static_limit_callback<NMaxCustomerIdxScanElems> c(s_arena.get(), true); // probably a safe bet for now
-        // XXX(Conrad): Scan operator, need to decide?
-        tbl_customer_name_idx(customerWarehouseID)->scan(txn, Encode(obj_key0, k_c_idx_0), &Encode(obj_key1, k_c_idx_1), c, s_arena.get());
-        ALWAYS_ASSERT(c.size() > 0);
-        INVARIANT(c.size() < NMaxCustomerIdxScanElems); // we should detect this
-        int index = c.size() / 2;
-        if (c.size() % 2 == 0)
-          index--;
-        evt_avg_cust_name_idx_scan_size.offer(c.size());
-
-        customer_name_idx::value v_c_idx_temp;
-        const customer_name_idx::value *v_c_idx = Decode(*c.values[index].second, v_c_idx_temp);
-
-        k_c.c_w_id = customerWarehouseID;
-        k_c.c_d_id = customerDistrictID;
-        k_c.c_id = v_c_idx->c_id;
-        // XXX(Conrad): access_id 11 - read customer
-        ALWAYS_ASSERT(tbl_customer(customerWarehouseID)->get(
-                txn, Encode(obj_key0, k_c), obj_v,
-                std::string::npos,
-                policy->is_occ(true, 11, false)));
-        Decode(obj_v, v_c);
-
-      } else {
-        // cust by ID
-        const uint customerID = GetCustomerId(r);
-        k_c.c_w_id = customerWarehouseID;
-        k_c.c_d_id = customerDistrictID;
-        k_c.c_id = customerID;
-        // XXX(Conrad): access_id 11 - read customer
-        ALWAYS_ASSERT(tbl_customer(customerWarehouseID)->get(
-                txn, Encode(obj_key0, k_c), obj_v,
-                std::string::npos,
-                policy->is_occ(true, 11, false)));
-        Decode(obj_v, v_c);
-      }
-      checker::SanityCheckCustomer(&k_c, &v_c);
-      customer::value v_c_new(v_c);
-
-      v_c_new.c_balance -= paymentAmount;
-      v_c_new.c_ytd_payment += paymentAmount;
-      v_c_new.c_payment_cnt++;
-      if (strncmp(v_c.c_credit.data(), "BC", 2) == 0) {
-        char buf[501];
-        int n = snprintf(buf, sizeof(buf), "%d %d %d %d %d %f | %s",
-                         k_c.c_id,
-                         k_c.c_d_id,
-                         k_c.c_w_id,
-                         districtID,
-                         warehouse_id,
-                         paymentAmount,
-                         v_c.c_data.c_str());
-        v_c_new.c_data.resize_junk(
-            min(static_cast<size_t>(n), v_c_new.c_data.max_size()));
-        NDB_MEMCPY((void *) v_c_new.c_data.data(), &buf[0], v_c_new.c_data.size());
-      }
-
-      // XXX(Conrad): access_id 12 - write customer
-      tbl_customer(customerWarehouseID)->put(
-          txn, Encode(str(), k_c), Encode(obj_v, v_c_new),
-          policy->is_occ(false, 12, false));
-
-      if(!db->mul_ops_end(txn))
-          goto customer_piece;
-
-    } catch(piece_abort_exception &ex) {
-      db->atomic_ops_abort(txn);
-      goto customer_piece;
-    }
-
-    //[WH]
-    // XXX(Conrad): dep_piece_id 10
-    const warehouse::key k_w(warehouse_id);
-    // XXX(Conrad): access_id 13 - read warehouse
-    ALWAYS_ASSERT(tbl_warehouse(warehouse_id)->get(
-            txn, Encode(obj_key0, k_w), obj_v,
-            std::string::npos,
-            policy->is_occ(true, 13, false)));
-    warehouse::value v_w_temp;
-    const warehouse::value *v_w = Decode(obj_v, v_w_temp);
-    checker::SanityCheckWarehouse(&k_w, v_w);
-
-    // warehouse::value v_w_new(*v_w);
-    // v_w_new.w_ytd += paymentAmount;
-    // XXX(Conrad): access_id 14 - write warehouse
-    // tbl_warehouse(warehouse_id)->put(
-        //txn, Encode(str(), k_w), Encode(obj_v, v_w_new),
-        //policy->is_occ(false, 14, false));
-
-    tbl_warehouse(warehouse_id)->commutative_act(txn, Encode(str(), k_w), payment_wh_act, paymentAmount);    
-
-    // fprintf(stderr, "wh id %d ytd %f tax %f ytd_delta %f\n", k_w.w_id, v_w->w_ytd, v_w->w_tax, paymentAmount);
-
-    //[DISTRICT]
-    // XXX(Conrad): dep_piece_id 11
-    const district::key k_d(warehouse_id, districtID);
-    // XXX(Conrad): access_id 15 - read district
-    ALWAYS_ASSERT(tbl_district(warehouse_id)->get(
-            txn, Encode(obj_key0, k_d), obj_v,
-            std::string::npos,
-            policy->is_occ(true, 15, false)));
-    district::value v_d_temp;
-    const district::value *v_d = Decode(obj_v, v_d_temp);
-    checker::SanityCheckDistrict(&k_d, v_d);
-    // district::value v_d_new(*v_d);
-    // v_d_new.d_ytd += paymentAmount;
-    // XXX(Conrad): access_id 16 - write district
-    // tbl_district(warehouse_id)->put(
-    //txn, Encode(str(), k_d), Encode(obj_v, v_d_new),
-        //policy->is_occ(false, 16, false));
-     //tbl_district(warehouse_id)->commutative_act(txn, Encode(str(), k_d), payment_dist_act, paymentAmount);    
-
-    //[HISTORY]
-    // XXX(Conrad): dep_piece_id 12
-    uint32_t ts_total_order = (ts << 6) | coreid::core_id();
-    const history::key k_h(k_c.c_d_id, k_c.c_w_id, k_c.c_id, districtID, warehouse_id, ts_total_order);
-    history::value v_h;
-    v_h.h_amount = paymentAmount;
-    v_h.h_data.resize_junk(v_h.h_data.max_size());
-    int n = snprintf((char *) v_h.h_data.data(), v_h.h_data.max_size() + 1,
-                     "%.10s    %.10s",
-                     v_w->w_name.c_str(),
-                     v_d->d_name.c_str());
-    v_h.h_data.resize_junk(min(static_cast<size_t>(n), v_h.h_data.max_size()));
-
-    const size_t history_sz = Size(v_h);
-    // XXX(Conrad): access_id 17 - write history
-    tbl_history(warehouse_id)->insert(
-        txn, Encode(str(), k_h), Encode(obj_v, v_h), false,
-        policy->is_occ(false, 17, false));
-    ret += history_sz;
-
-    measure_txn_counters(txn, "txn_payment");
-    if (likely(db->commit_txn(txn)))
-      return txn_result(true, ret);
-  } catch (abstract_db::abstract_abort_exception &ex) {
-    db->abort_txn(txn);
-  }
-  return txn_result(false, 0);
-}
-#else
+// payment's ytd columns are pure adds, see --enable-commutative-ops
+static const dbtuple::tuple_commutative_act payment_wh_act =
+  commutative_add<warehouse::value, float, &warehouse::value::w_ytd>;
+static const dbtuple::tuple_commutative_act payment_dist_act =
+  commutative_add<district::value, float, &district::value::d_ytd>;
 
 class payment_warehouse_update_callback : public update_callback {
 public:
@@ -2730,7 +2779,7 @@ tpcc_worker::txn_payment()
   //   max_read_set_size : 71
   //   max_write_set_size : 1
   //   num_txn_contexts : 5
-  void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_TPCC_PAYMENT, payment_type);
+  void *txn = db->new_txn(procedure_txn_flags(), arena, txn_buf(), abstract_db::HINT_TPCC_PAYMENT, payment_type);
   
   db->init_txn(txn, cgraph, payment_type, pg);
 
@@ -2747,6 +2796,8 @@ tpcc_worker::txn_payment()
   }
   if (customerWarehouseID != warehouse_id)
     ++evt_tpcc_cross_partition_payment_txns;
+  if (IsCrossNode(warehouse_id, customerWarehouseID))
+    ++evt_tpcc_cross_node_payment_txns;
   try {
     ssize_t ret = 0;
     std::pair<bool, uint32_t> expose_ret;
@@ -2759,9 +2810,11 @@ piece_retry_11:
     payment_warehouse_update_callback w_c(obj_v, str(), &k_w, paymentAmount);
     tbl_warehouse(warehouse_id)->update(
         txn, Encode(str(), k_w), obj_v, &w_c, 9 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(payment_type);
 
     expose_ret = db->expose_uncommitted(txn, 9 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(payment_type);
       switch (expose_ret.second) {
         TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2771,34 +2824,54 @@ piece_retry_11:
 piece_retry_11:
     //[WH]
     const warehouse::key k_w(warehouse_id);
-    // access_id 11 - read warehouse
-    ALWAYS_ASSERT(tbl_warehouse(warehouse_id)->get(
-            txn, Encode(obj_key0, k_w), obj_v, std::string::npos, 11 /*access_id*/));
-
-    expose_ret = db->expose_uncommitted(txn, 11 + ACCESSES /*access_id*/);
-    if (!expose_ret.first) {
-      switch (expose_ret.second) {
-        TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
-        default: ALWAYS_ASSERT(false);
+    if (g_enable_commutative_ops) {
+      // access_id 11 - add to w_ytd at commit, no read and no write conflict
+      tbl_warehouse(warehouse_id)->commutative_act(
+          txn, Encode(str(), k_w), payment_wh_act,
+          commutative_param(paymentAmount), CommutativeAdd, 11 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(payment_type);
+
+      expose_ret = db->expose_uncommitted(txn, 11 + ACCESSES /*access_id*/);
+      if (!expose_ret.first) {
+        TXN_STATUS_ABORT_CHECK(payment_type);
+        switch (expose_ret.second) {
+          TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
+          default: ALWAYS_ASSERT(false);
+        }
+      }
+    } else {
+      // access_id 11 - read warehouse
+      TXN_GET_OR_STATUS_ABORT(tbl_warehouse(warehouse_id)->get(
+              txn, EncodeKey(pkey, k_w), obj_v, std::string::npos, 11 /*access_id*/), payment_type);
+
+      expose_ret = db->expose_uncommitted(txn, 11 + ACCESSES /*access_id*/);
+      if (!expose_ret.first) {
+        TXN_STATUS_ABORT_CHECK(payment_type);
+        switch (expose_ret.second) {
+          TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
+          default: ALWAYS_ASSERT(false);
+        }
       }
-    }
 
 piece_retry_12:
-    warehouse::value v_w_temp;
-    const warehouse::value *v_w = Decode(obj_v, v_w_temp);
-    checker::SanityCheckWarehouse(&k_w, v_w);
-
-    warehouse::value v_w_new(*v_w);
-    v_w_new.w_ytd += paymentAmount;
-    // access_id 12 - write warehouse
-    tbl_warehouse(warehouse_id)->put(
-        txn, Encode(str(), k_w), Encode(str(), v_w_new), 12 /*access_id*/);
+      warehouse::value v_w_temp;
+      const warehouse::value *v_w = Decode(obj_v, v_w_temp);
+      checker::SanityCheckWarehouse(&k_w, v_w);
 
-    expose_ret = db->expose_uncommitted(txn, 12 + ACCESSES /*access_id*/);
-    if (!expose_ret.first) {
-      switch (expose_ret.second) {
-        TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
-        default: ALWAYS_ASSERT(false);
+      warehouse::value v_w_new(*v_w);
+      v_w_new.w_ytd += paymentAmount;
+      // access_id 12 - write warehouse
+      tbl_warehouse(warehouse_id)->put(
+          txn, Encode(str(), k_w), Encode(str(), v_w_new), 12 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(payment_type);
+
+      expose_ret = db->expose_uncommitted(txn, 12 + ACCESSES /*access_id*/);
+      if (!expose_ret.first) {
+        TXN_STATUS_ABORT_CHECK(payment_type);
+        switch (expose_ret.second) {
+          TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
+          default: ALWAYS_ASSERT(false);
+        }
       }
     }
 #endif
@@ -2817,37 +2890,58 @@ piece_retry_12:
     payment_district_update_callback d_c(obj_v, str(), &k_d, paymentAmount);
     tbl_district(warehouse_id)->update(
         txn, Encode(str(), k_d), obj_v, &d_c, 10 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(payment_type);
 #else
 piece_retry_13:
     //[DISTRICT]
     const district::key k_d(warehouse_id, districtID);
-    // access_id 13 - read district
-    ALWAYS_ASSERT(tbl_district(warehouse_id)->get(
-            txn, Encode(obj_key0, k_d), obj_v, std::string::npos, 13 /*access_id*/));
-
-    expose_ret = db->expose_uncommitted(txn, 13 + ACCESSES /*access_id*/);
-    if (!expose_ret.first) {
-      switch (expose_ret.second) {
-        TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
-        default: ALWAYS_ASSERT(false);
+    if (g_enable_commutative_ops) {
+      // access_id 13 - add to d_ytd at commit
+      tbl_district(warehouse_id)->commutative_act(
+          txn, Encode(str(), k_d), payment_dist_act,
+          commutative_param(paymentAmount), CommutativeAdd, 13 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(payment_type);
+
+      expose_ret = db->expose_uncommitted(txn, 13 + ACCESSES /*access_id*/);
+      if (!expose_ret.first) {
+        TXN_STATUS_ABORT_CHECK(payment_type);
+        switch (expose_ret.second) {
+          TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
+          default: ALWAYS_ASSERT(false);
+        }
+      }
+    } else {
+      // access_id 13 - read district
+      TXN_GET_OR_STATUS_ABORT(tbl_district(warehouse_id)->get(
+              txn, EncodeKey(pkey, k_d), obj_v, std::string::npos, 13 /*access_id*/), payment_type);
+
+      expose_ret = db->expose_uncommitted(txn, 13 + ACCESSES /*access_id*/);
+      if (!expose_ret.first) {
+        TXN_STATUS_ABORT_CHECK(payment_type);
+        switch (expose_ret.second) {
+          TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
+          default: ALWAYS_ASSERT(false);
+        }
       }
-    }
 
 piece_retry_14:
-    district::value v_d_temp;
-    const district::value *v_d = Decode(obj_v, v_d_temp);
-    checker::SanityCheckDistrict(&k_d, v_d);
-    district::value v_d_new(*v_d);
-    v_d_new.d_ytd += paymentAmount;
-    // access_id 14 - write district
-    tbl_district(warehouse_id)->put(
-        txn, Encode(str(), k_d), Encode(str(), v_d_new), 14 /*access_id*/);
-
-    expose_ret = db->expose_uncommitted(txn, 14 + ACCESSES /*access_id*/);
-    if (!expose_ret.first) {
-      switch (expose_ret.second) {
-        TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
-        default: ALWAYS_ASSERT(false);
+      district::value v_d_temp;
+      const district::value *v_d = Decode(obj_v, v_d_temp);
+      checker::SanityCheckDistrict(&k_d, v_d);
+      district::value v_d_new(*v_d);
+      v_d_new.d_ytd += paymentAmount;
+      // access_id 14 - write district
+      tbl_district(warehouse_id)->put(
+          txn, Encode(str(), k_d), Encode(str(), v_d_new), 14 /*access_id*/);
+      TXN_STATUS_ABORT_CHECK(payment_type);
+
+      expose_ret = db->expose_uncommitted(txn, 14 + ACCESSES /*access_id*/);
+      if (!expose_ret.first) {
+        TXN_STATUS_ABORT_CHECK(payment_type);
+        switch (expose_ret.second) {
+          TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
+          default: ALWAYS_ASSERT(false);
+        }
       }
     }
 #endif
@@ -2881,6 +2975,7 @@ piece_retry_15:
       // scan
       // TODO - scan default using ic3's implementation, should seprate into two actions
       tbl_customer_name_idx(customerWarehouseID)->scan(txn, Encode(obj_key0, k_c_idx_0), &Encode(obj_key1, k_c_idx_1), c, s_arena.get());
+      TXN_STATUS_ABORT_CHECK(payment_type);
       ALWAYS_ASSERT(c.size() > 0);
       INVARIANT(c.size() < NMaxCustomerIdxScanElems); // we should detect this
       int index = c.size() / 2;
@@ -2903,12 +2998,13 @@ piece_retry_15:
     }
     customer::value v_c;
     // access_id 15 - read customer
-    ALWAYS_ASSERT(tbl_customer(customerWarehouseID)->get(
-            txn, Encode(obj_key0, k_c), obj_v, std::string::npos, 15 /*access_id*/));
+    TXN_GET_OR_STATUS_ABORT(tbl_customer(customerWarehouseID)->get(
+            txn, EncodeKey(pkey, k_c), obj_v, std::string::npos, 15 /*access_id*/), payment_type);
     Decode(obj_v, v_c);
 
     expose_ret = db->expose_uncommitted(txn, 15 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(payment_type);
       switch (expose_ret.second) {
         TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2938,9 +3034,11 @@ piece_retry_16:
     // access_id 16 - write customer
     tbl_customer(customerWarehouseID)->put(
         txn, Encode(str(), k_c), Encode(str(), v_c_new), 16 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(payment_type);
 
     expose_ret = db->expose_uncommitted(txn, 16 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(payment_type);
       switch (expose_ret.second) {
         TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2964,10 +3062,12 @@ piece_retry_17:
     // access_id 17 - write history / insert history
     tbl_history(warehouse_id)->insert(
         txn, Encode(str(), k_h), Encode(str(), v_h), 17 /*access_id*/);
+    TXN_STATUS_ABORT_CHECK(payment_type);
     ret += history_sz;
 
     expose_ret = db->expose_uncommitted(txn, 17 + ACCESSES /*access_id*/);
     if (!expose_ret.first) {
+      TXN_STATUS_ABORT_CHECK(payment_type);
       switch (expose_ret.second) {
         TXN_PAYMENT_LIST(TXN_PAYMENT_PIECE_RETRY)
         default: ALWAYS_ASSERT(false);
@@ -2989,8 +3089,6 @@ piece_retry_17:
   return txn_result(false, payment_type);
 }
 
-#endif
-
 #undef TXN_PAYMENT_PIECE_RETRY
 
 class order_line_nop_callback : public abstract_ordered_index::scan_callback {
@@ -3035,7 +3133,7 @@ tpcc_worker::txn_order_status()
     g_disable_read_only_scans ?
       abstract_db::HINT_TPCC_ORDER_STATUS :
       abstract_db::HINT_TPCC_ORDER_STATUS_READ_ONLY;
-  void *txn = db->new_txn(txn_flags | read_only_mask, arena, txn_buf(), hint);
+  void *txn = db->new_txn(procedure_txn_flags() | read_only_mask, arena, txn_buf(), hint);
   scoped_str_arena s_arena(arena);
   // NB: since txn_order_status() is a RO txn, we assume that
   // locking is un-necessary (since we can just read from some old snapshot)
@@ -3067,6 +3165,7 @@ tpcc_worker::txn_order_status()
 
       static_limit_callback<NMaxCustomerIdxScanElems> c(s_arena.get(), true); // probably a safe bet for now
       tbl_customer_name_idx(warehouse_id)->scan(txn, Encode(obj_key0, k_c_idx_0), &Encode(obj_key1, k_c_idx_1), c, s_arena.get());
+      TXN_STATUS_ABORT_CHECK(0);
       ALWAYS_ASSERT(c.size() > 0);
       INVARIANT(c.size() < NMaxCustomerIdxScanElems); // we should detect this
       int index = c.size() / 2;
@@ -3080,7 +3179,7 @@ tpcc_worker::txn_order_status()
       k_c.c_w_id = warehouse_id;
       k_c.c_d_id = districtID;
       k_c.c_id = v_c_idx->c_id;
-      ALWAYS_ASSERT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get(txn, EncodeKey(pkey, k_c), obj_v), 0);
       Decode(obj_v, v_c);
 
     } else {
@@ -3089,7 +3188,7 @@ tpcc_worker::txn_order_status()
       k_c.c_w_id = warehouse_id;
       k_c.c_d_id = districtID;
       k_c.c_id = customerID;
-      ALWAYS_ASSERT(tbl_customer(warehouse_id)->get(txn, Encode(obj_key0, k_c), obj_v));
+      TXN_GET_OR_STATUS_ABORT(tbl_customer(warehouse_id)->get(txn, EncodeKey(pkey, k_c), obj_v), 0);
       Decode(obj_v, v_c);
     }
     checker::SanityCheckCustomer(&k_c, &v_c);
@@ -3111,12 +3210,14 @@ tpcc_worker::txn_order_status()
       {
         ANON_REGION("OrderStatusOOrderScan:", &order_status_probe0_cg);
         tbl_oorder_c_id_idx(warehouse_id)->scan(txn, Encode(obj_key0, k_oo_idx_0), &Encode(obj_key1, k_oo_idx_1), c_oorder, s_arena.get());
+        TXN_STATUS_ABORT_CHECK(0);
       }
       ALWAYS_ASSERT(c_oorder.size());
     } else {
       latest_key_callback c_oorder(*newest_o_c_id, 1);
       const oorder_c_id_idx::key k_oo_idx_hi(warehouse_id, districtID, k_c.c_id, numeric_limits<int32_t>::max());
       tbl_oorder_c_id_idx(warehouse_id)->rscan(txn, Encode(obj_key0, k_oo_idx_hi), nullptr, c_oorder, s_arena.get());
+      TXN_STATUS_ABORT_CHECK(0);
       ALWAYS_ASSERT(c_oorder.size() == 1);
     }
 
@@ -3128,6 +3229,7 @@ tpcc_worker::txn_order_status()
     const order_line::key k_ol_0(warehouse_id, districtID, o_id, 0);
     const order_line::key k_ol_1(warehouse_id, districtID, o_id, numeric_limits<int32_t>::max());
     tbl_order_line(warehouse_id)->scan(txn, Encode(obj_key0, k_ol_0), &Encode(obj_key1, k_ol_1), c_order_line, s_arena.get());
+    TXN_STATUS_ABORT_CHECK(0);
     ALWAYS_ASSERT(c_order_line.n >= 5 && c_order_line.n <= 15);
 
     measure_txn_counters(txn, "txn_order_status");
@@ -3192,13 +3294,13 @@ tpcc_worker::txn_stock_level()
     g_disable_read_only_scans ?
       abstract_db::HINT_TPCC_STOCK_LEVEL :
       abstract_db::HINT_TPCC_STOCK_LEVEL_READ_ONLY;
-  void *txn = db->new_txn(txn_flags | read_only_mask, arena, txn_buf(), hint);
+  void *txn = db->new_txn(procedure_txn_flags() | read_only_mask, arena, txn_buf(), hint);
   scoped_str_arena s_arena(arena);
   // NB: since txn_stock_level() is a RO txn, we assume that
   // locking is un-necessary (since we can just read from some old snapshot)
   try {
     const district::key k_d(warehouse_id, districtID);
-    ALWAYS_ASSERT(tbl_district(warehouse_id)->get(txn, Encode(obj_key0, k_d), obj_v));
+    TXN_GET_OR_STATUS_ABORT(tbl_district(warehouse_id)->get(txn, EncodeKey(pkey, k_d), obj_v), 0);
     district::value v_d_temp;
     const district::value *v_d = Decode(obj_v, v_d_temp);
     checker::SanityCheckDistrict(&k_d, v_d);
@@ -3215,6 +3317,7 @@ tpcc_worker::txn_stock_level()
     {
       ANON_REGION("StockLevelOrderLineScan:", &stock_level_probe0_cg);
       tbl_order_line(warehouse_id)->scan(txn, Encode(obj_key0, k_ol_0), &Encode(obj_key1, k_ol_1), c, s_arena.get());
+      TXN_STATUS_ABORT_CHECK(0);
     }
     {
       small_unordered_map<uint, bool, 512> s_i_ids_distinct;
@@ -3227,7 +3330,7 @@ tpcc_worker::txn_stock_level()
         INVARIANT(p.first >= 1 && p.first <= NumItems());
         {
           ANON_REGION("StockLevelLoopJoinGet:", &stock_level_probe2_cg);
-          ALWAYS_ASSERT(tbl_stock(warehouse_id)->get(txn, Encode(obj_key0, k_s), obj_v, nbytesread));
+          TXN_GET_OR_STATUS_ABORT(tbl_stock(warehouse_id)->get(txn, EncodeKey(pkey, k_s), obj_v, nbytesread), 0);
         }
         INVARIANT(obj_v.size() <= nbytesread);
         const uint8_t *ptr = (const uint8_t *) obj_v.data();
@@ -4383,11 +4486,17 @@ private:
     return strcmp("item", name) == 0;
   }
 
+  // with --sequential-splits, the tables whose keys grow per district count
+  // as well, so their trees split in favor of appends
   static bool
   IsTableAppendOnly(const char *name)
   {
     return strcmp("history", name) == 0 ||
-           strcmp("oorder_c_id_idx", name) == 0;
+           strcmp("oorder_c_id_idx", name) == 0 ||
+           (use_sequential_splits &&
+            (strcmp("new_order", name) == 0 ||
+             strcmp("oorder", name) == 0 ||
+             strcmp("order_line", name) == 0));
   }
 
   static vector<abstract_ordered_index *>
@@ -4526,6 +4635,9 @@ protected:
             &barrier_a, &barrier_b, wstart+1, wend+1));
       }
     }
+    if (g_numa_placement)
+      for (size_t i = 0; i < nthreads; i++)
+        static_cast<tpcc_worker *>(ret[i])->set_home_cpu(g_worker_cpu[i]);
     return ret;
   }
 
@@ -4541,6 +4653,109 @@ private:
   map<string, vector<abstract_ordered_index *>> partitions;
 };
 
+template <typename Key, typename Value,
+          void (*Check)(const Key *, const Value *)>
+class sanity_check_scan_callback : public abstract_ordered_index::scan_callback {
+public:
+  sanity_check_scan_callback() : n(0) {}
+  virtual bool invoke(
+      const char *keyp, size_t keylen,
+      const string &value)
+  {
+    Key k_temp;
+    Value v_temp;
+    Check(Decode(keyp, k_temp), Decode(value, v_temp));
+    ++n;
+    return true;
+  }
+  size_t n;
+};
+
+class ytd_scan_callback : public abstract_ordered_index::scan_callback {
+public:
+  ytd_scan_callback(bool district) : district(district) {}
+  virtual bool invoke(
+      const char *keyp, size_t keylen,
+      const string &value)
+  {
+    if (district) {
+      district::key k_temp;
+      district::value v_temp;
+      ytd[Decode(keyp, k_temp)->d_w_id] += Decode(value, v_temp)->d_ytd;
+    } else {
+      warehouse::key k_temp;
+      warehouse::value v_temp;
+      ytd[Decode(keyp, k_temp)->w_id] += Decode(value, v_temp)->w_ytd;
+    }
+    return true;
+  }
+  const bool district;
+  map<int32_t, double> ytd;
+};
+
+// used by dbrecover on replayed tables: runs the checker:: sanity checks
+// over every record of the tpcc tables in open_tables (keyed by the name
+// given to open_index(), possibly with a _<partition> suffix) and checks
+// consistency condition 1 (w_ytd = sum(d_ytd)). returns the # of warehouses
+// violating it
+size_t
+tpcc_check_tables(abstract_db *db,
+                  const map<string, abstract_ordered_index *> &open_tables)
+{
+  scoped_db_thread_ctx ctx(db, true);
+  str_arena arena;
+  string txn_obj_buf(db->sizeof_txn_object(txn_flags), 0);
+  const string lowkey;
+  ytd_scan_callback w_ytd(false), d_ytd(true);
+  for (auto &p : open_tables) {
+    // strip the partition suffix, if any
+    string tbl = p.first;
+    const size_t pos = tbl.find_last_of('_');
+    if (pos != string::npos && pos + 1 < tbl.size() &&
+        tbl.find_first_not_of("0123456789", pos + 1) == string::npos)
+      tbl.resize(pos);
+
+    size_t n = 0;
+    void *txn = db->new_txn(txn_flags, arena, (void *) txn_obj_buf.data(),
+                            abstract_db::HINT_CONSISTENCY_CHECK);
+#define SCAN_CHECK_X(name, check) \
+    if (tbl == #name) { \
+      sanity_check_scan_callback<name::key, name::value, check> c; \
+      p.second->scan(txn, lowkey, nullptr, c, &arena); \
+      n = c.n; \
+    }
+    SCAN_CHECK_X(customer, checker::SanityCheckCustomer)
+    SCAN_CHECK_X(district, checker::SanityCheckDistrict)
+    SCAN_CHECK_X(item, checker::SanityCheckItem)
+    SCAN_CHECK_X(new_order, checker::SanityCheckNewOrder)
+    SCAN_CHECK_X(oorder, checker::SanityCheckOOrder)
+    SCAN_CHECK_X(order_line, checker::SanityCheckOrderLine)
+    SCAN_CHECK_X(stock, checker::SanityCheckStock)
+    SCAN_CHECK_X(warehouse, checker::SanityCheckWarehouse)
+#undef SCAN_CHECK_X
+    if (tbl == "warehouse")
+      p.second->scan(txn, lowkey, nullptr, w_ytd, &arena);
+    else if (tbl == "district")
+      p.second->scan(txn, lowkey, nullptr, d_ytd, &arena);
+    ALWAYS_ASSERT(db->commit_txn(txn));
+    arena.reset();
+    if (verbose && n)
+      cerr << "[INFO] checked " << n << " records of " << p.first << endl;
+  }
+
+  size_t nviolations = 0;
+  for (auto &w : w_ytd.ytd) {
+    const double d = d_ytd.ytd[w.first];
+    // both sides are sums of floats, so only compare up to their precision
+    if (fabs(w.second - d) > max(1.0, 1e-4 * w.second)) {
+      cerr << "[ERROR] warehouse " << w.first << ": w_ytd=" << w.second
+           << " but sum(d_ytd)=" << d << endl;
+      nviolations++;
+    }
+  }
+  return nviolations;
+}
+
 void
 tpcc_do_test(abstract_db *db, int argc, char **argv)
 {
@@ -4557,9 +4772,15 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
       {"enable-separate-tree-per-partition"   , no_argument       , &g_enable_separate_tree_per_partition , 1}   ,
       {"new-order-remote-item-pct"            , required_argument , 0                                     , 'r'} ,
       {"new-order-fast-id-gen"                , no_argument       , &g_new_order_fast_id_gen              , 1}   ,
+      {"new-order-batch"                      , no_argument       , &g_new_order_batch                    , 1}   ,
+      {"status-aborts"                        , no_argument       , &g_status_aborts                      , 1}   ,
+      {"decode-in-place"                      , no_argument       , &g_decode_in_place                    , 1}   ,
+      {"column-groups"                        , no_argument       , &g_column_groups                      , 1}   ,
       {"uniform-item-dist"                    , no_argument       , &g_uniform_item_dist                  , 1}   ,
       {"order-status-scan-hack"               , no_argument       , &g_order_status_scan_hack             , 1}   ,
       {"workload-mix"                         , required_argument , 0                                     , 'w'} ,
+      {"enable-commutative-ops"               , no_argument       , &g_enable_commutative_ops             , 1}   ,
+      {"numa-placement"                       , no_argument       , &g_numa_placement                     , 1}   ,
       {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -4612,6 +4833,23 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
     }
   }
 
+  if (g_numa_placement) {
+    // a pinned thread allocates from (and faults) the region of its cpu,
+    // which only exists with --numa-memory
+    if (!::allocator::IsInitialized()) {
+      cerr << "[ERROR] --numa-placement needs --numa-memory" << endl;
+      exit(1);
+    }
+    // placement is meaningless unless loaders and workers are pinned
+    pin_cpus = 1;
+    InitNumaPlacement();
+  }
+
+  if (g_column_groups) {
+    DeclareAccessColumnGroups();
+    dbtuple::EnableColumnGroups();
+  }
+
   if (did_spec_remote_pct && g_disable_xpartition_txn) {
     cerr << "WARNING: --new-order-remote-item-pct given with --disable-cross-partition-transactions" << endl;
     cerr << "  --new-order-remote-item-pct will have no effect" << endl;
@@ -4625,8 +4863,17 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
     cerr << "  separate_tree_per_partition  : " << g_enable_separate_tree_per_partition << endl;
     cerr << "  new_order_remote_item_pct    : " << g_new_order_remote_item_pct << endl;
     cerr << "  new_order_fast_id_gen        : " << g_new_order_fast_id_gen << endl;
+    cerr << "  new_order_batch              : " << g_new_order_batch << endl;
+    cerr << "  status_aborts                : " << g_status_aborts << endl;
+    cerr << "  decode_in_place              : " << g_decode_in_place << endl;
+    cerr << "  column_groups                : " << g_column_groups << endl;
     cerr << "  uniform_item_dist            : " << g_uniform_item_dist << endl;
     cerr << "  order_status_scan_hack       : " << g_order_status_scan_hack << endl;
+    cerr << "  commutative_ops              : " << g_enable_commutative_ops << endl;
+    cerr << "  numa_placement               : " << g_numa_placement << endl;
+    if (g_numa_placement)
+      cerr << "  worker_cpus                  : "
+           << format_list(g_worker_cpu.begin(), g_worker_cpu.end()) << endl;
     cerr << "  workload_mix                 : " <<
       format_list(g_txn_workload_mix,
                   g_txn_workload_mix + ARRAY_NELEMS(g_txn_workload_mix)) << endl;
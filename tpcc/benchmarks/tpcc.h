@@ -32,6 +32,13 @@
   y(inline_str_fixed<2>,c_middle) \
   y(inline_str_16<500>,c_data)
 DO_STRUCT(customer, CUSTOMER_KEY_FIELDS, CUSTOMER_VALUE_FIELDS)
+// payment and delivery update the balance columns, new-order reads the rest
+DO_COLUMN_GROUPS(customer,
+    COLUMN_GROUP_FIELD(customer, c_balance) |
+    COLUMN_GROUP_FIELD(customer, c_ytd_payment) |
+    COLUMN_GROUP_FIELD(customer, c_payment_cnt) |
+    COLUMN_GROUP_FIELD(customer, c_delivery_cnt) |
+    COLUMN_GROUP_FIELD(customer, c_data))
 
 #define CUSTOMER_NAME_IDX_KEY_FIELDS(x, y) \
   x(int32_t,c_w_id) \
@@ -161,5 +168,7 @@ DO_STRUCT(stock_data, STOCK_DATA_KEY_FIELDS, STOCK_DATA_VALUE_FIELDS)
   y(inline_str_fixed<2>,w_state) \
   y(inline_str_fixed<9>,w_zip)
 DO_STRUCT(warehouse, WAREHOUSE_KEY_FIELDS, WAREHOUSE_VALUE_FIELDS)
+// payment updates w_ytd, new-order reads w_tax
+DO_COLUMN_GROUPS(warehouse, COLUMN_GROUP_FIELD(warehouse, w_ytd))
 
 #endif
@@ -665,7 +665,7 @@ public:
 	// if(g_txn_workload_mix[TPCE_TXN_ID_ENUM(t)] > 0) 
         // w.push_back(workload_desc( #t, double(g_txn_workload_mix[TPCE_TXN_ID_ENUM(t)])/100.0, TXN_name(t)));
 #define PUSH_WORKLOAD(t) \
-    w.push_back(workload_desc( #t, double(g_txn_workload_mix[TPCE_TXN_ID_ENUM(t)])/100.0, TXN_name(t)));
+    w.push_back(workload_desc( #t, double(g_txn_workload_mix[TPCE_TXN_ID_ENUM(t)])/100.0, TXN_name(t), TPCE_TXN_ID_ENUM(t)));
     TPCE_TXN_LIST(PUSH_WORKLOAD)
 #undef PUSH_WORKLOAD
 
@@ -130,7 +130,6 @@ public:
       tbl(open_tables.at("USERTABLE")),
       computation_n(0)
   {
-    obj_key0.reserve(str_arena::MinStrReserveLength);
     obj_key1.reserve(str_arena::MinStrReserveLength);
     obj_v.reserve(str_arena::MinStrReserveLength);
   }
@@ -170,24 +169,25 @@ public:
         for (int i=0;i<g_txn_length;) {
           auto row_id = keys[i];
           auto op = g_txn_op_distribution[i];
-          obj_key0 = u64_varkey(row_id).str(obj_key0);
+          // the keys go to the index packed, see EncodeKey()
+          const packed_key k0((u64_varkey(row_id)));
           if (op == ReadOpt) {
             // read operation,
-            ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v, acc_id));
+            ALWAYS_ASSERT(tbl->get(txn, k0, obj_v, acc_id));
           } else if (op == WriteOpt) {
             // read modify write.
-            ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v, acc_id));
-            tbl->put(txn, obj_key0, str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
+            ALWAYS_ASSERT(tbl->get(txn, k0, obj_v, acc_id));
+            tbl->put(txn, k0, str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
           } else if (op == ScanReadOpt) {
             for (int j = 0; j < 10; j++) {
-              ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id + j).str(obj_key0),
+              ALWAYS_ASSERT(tbl->get(txn, packed_key(u64_varkey(row_id + j)),
                                      obj_v, acc_id));
             }
           } else if (op == ScanWriteOpt) {
             for (int j = 0; j < 10; j++) {
-              ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id + j).str(obj_key0),
-                                     obj_v, acc_id));
-              tbl->put(txn, obj_key0, str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
+              const packed_key k((u64_varkey(row_id + j)));
+              ALWAYS_ASSERT(tbl->get(txn, k, obj_v, acc_id));
+              tbl->put(txn, k, str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
             }
           } else {
             // unsupported yet.
@@ -263,7 +263,6 @@ protected:
 private:
   abstract_ordered_index *tbl;
 
-  string obj_key0;
   string obj_key1;
   string obj_v;
 
@@ -1181,6 +1181,7 @@ private:
   static void recursive_delete(node *n);
 
   node *volatile root_;
+  uint32_t log_id_ = 0;
 
 public:
 
@@ -1255,6 +1256,16 @@ public:
     return search_impl(k, v, ns, search_info);
   }
 
+  // search() always fills in search_info here, see mbtree::search_node()
+  inline void
+  search_node(const key_type &k, versioned_node_t &search_info) const
+  {
+    rcu_region guard;
+    typename util::vec<leaf_node *>::type ns;
+    value_type v;
+    search_impl(k, v, ns, &search_info);
+  }
+
   /**
    * The low level callback interface is as follows:
    *
@@ -1569,6 +1580,49 @@ public:
     return sizeof(leaf_node);
   }
 
+  // table id written next to every record of this tree in the persistence
+  // log, 0 if the tree is not logged (see txn_logger::RegisterTable())
+  inline uint32_t
+  log_id() const
+  {
+    return log_id_;
+  }
+
+  inline void
+  set_log_id(uint32_t id)
+  {
+    log_id_ = id;
+  }
+
+  // see mbtree::multi_search(), which overlaps the descents
+  inline void
+  multi_search(const key_type *keys, size_t n, value_type *vs,
+               versioned_node_t *search_info, bool *found) const
+  {
+    for (size_t i = 0; i < n; i++)
+      found[i] = search(keys[i], vs[i], &search_info[i]);
+  }
+
+  // hash indexes are only implemented for masstree, see
+  // mbtree::build_hash_index()
+  inline void
+  build_hash_index()
+  {
+  }
+
+  // so are sequential splits and leaf stats, see
+  // mbtree::set_sequential_splits()
+  inline void
+  set_sequential_splits(bool x)
+  {
+  }
+
+  inline void
+  leaf_stats(size_t &nleaves, size_t &nslots, size_t &nbytes) const
+  {
+    nleaves = nslots = nbytes = 0;
+  }
+
 private:
 
   /**
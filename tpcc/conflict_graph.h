@@ -1,7 +1,46 @@
 #ifndef CONFLICT_GRAPH_H
 #define CONFLICT_GRAPH_H
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <limits>
+#include <algorithm>
+
+#include "macros.h"
+
+// the operator of a commutative update. two steps commute only if they
+// apply the same one: an add and a min on one column do not, and an escrow
+// (bounded) add, whose bound check depends on the order, commutes only with
+// other escrow adds
+enum commutative_kind : uint8_t {
+  CommutativeNone = 0,
+  CommutativeAdd,
+  CommutativeMin,
+  CommutativeMax,
+  CommutativeBoundedAdd,
+};
+
+static inline const char *
+commutative_kind_name(commutative_kind k)
+{
+  switch (k) {
+  case CommutativeAdd:        return "add";
+  case CommutativeMin:        return "min";
+  case CommutativeMax:        return "max";
+  case CommutativeBoundedAdd: return "bounded_add";
+  default:                    return "none";
+  }
+}
+
+// CommutativeNone if name names none of them
+static inline commutative_kind
+commutative_kind_from_name(const char *name)
+{
+  for (uint8_t k = CommutativeAdd; k <= CommutativeBoundedAdd; k++)
+    if (!strcmp(name, commutative_kind_name(commutative_kind(k))))
+      return commutative_kind(k);
+  return CommutativeNone;
+}
 
 class conflict_graph
 {
@@ -18,32 +57,51 @@ public:
     chopped_tx()
     {
       conflicts =  nullptr;
+      prev = nullptr;
+      next = nullptr;
+      first = nullptr;
+      commutative = nullptr;
       type = 0;
       total_ops = 0;
       total_types = 0;
+      frozen = false;
     }
 
     ~chopped_tx()
     {
-      //TODO free memory
+      // conflicts is the start of the single block holding every table
+      free(conflicts);
+      delete[] commutative;
     }
 
+    chopped_tx(const chopped_tx &) = delete;
+    chopped_tx &operator=(const chopped_tx &) = delete;
+
     void init(uint8_t tp, uint32_t cps, uint32_t total_tps)
     {
+      ALWAYS_ASSERT(!conflicts);
 
       type = tp;
       total_ops = cps;
       total_types = total_tps;
 
-      conflicts = new uint32_t*[total_ops + 1];
+      // one flat, cache aligned block of 4 [rows][total_types + 1] tables.
+      // rows 0 and total_ops + 1 are sentinels so lookups need no bounds
+      // checks for 0 <= op <= total_ops + 1
+      const size_t n = table_size();
+      void *px = nullptr;
+      ALWAYS_ASSERT(!posix_memalign(&px, CACHELINE_SIZE, 4 * n * sizeof(uint32_t)));
+      memset(px, 0, 4 * n * sizeof(uint32_t));
+      conflicts = reinterpret_cast<uint32_t *>(px);
+      prev = conflicts + n;
+      next = prev + n;
+      first = next + n;
 
-      for(uint32_t i = 1; i <= total_ops; i++){ 
-        conflicts[i] = new uint32_t[total_types + 1]();
-      }
+      commutative = new uint8_t[total_ops + 1]();
 
       //Each transaction conflict with it self
       for(uint32_t i = 1; i <= total_ops; i++) {
-        conflicts[i][type] = i;
+        at(conflicts, i, type) = i;
         //fprintf(stderr, "op<%ld, %ld>: %d\n", i, type, i);
       }
     }
@@ -54,22 +112,75 @@ public:
 
       //ALWAYS_ASSERT(op1 <= total_ops && op1 > 0);
       //ALWAYS_ASSERT(op2 <= total_types && type > 0);
-      conflicts[op1][type] = op2;
+      at(conflicts, op1, type) = op2;
+      frozen = false;
+    }
+
+    //Mark op as a commutative update of kind k (add/min/max/escrow add
+    //on the committed value)
+    void set_commutative(uint32_t op, commutative_kind k)
+    {
+      commutative[op] = k;
+    }
+
+    bool is_commutative(uint32_t op)
+    {
+      return commutative[op] != CommutativeNone;
+    }
+
+    commutative_kind get_commutative_kind(uint32_t op)
+    {
+      return commutative_kind(commutative[op]);
+    }
+
+    //Precompute the answers of get_first/prev/next_conflict() for every
+    //(step, type), so each becomes a single load. Must be called again if
+    //the graph is changed afterwards, until then the lookups scan
+    void freeze()
+    {
+      //a commutative op does not conflict with itself in another instance
+      //of this txn either, init() only put the self-edge in
+      for(uint32_t i = 1; i <= total_ops; i++)
+        if(commutative[i] && at(conflicts, i, type) == i)
+          at(conflicts, i, type) = 0;
+      for(uint32_t t = 0; t <= total_types; t++) {
+        uint32_t p = 0;
+        for(uint32_t i = 1; i <= total_ops + 1; i++) {
+          at(prev, i, t) = p;
+          if(i <= total_ops && at(conflicts, i, t) > 0)
+            p = at(conflicts, i, t);
+        }
+        uint32_t f = 0, nx = 0;
+        for(uint32_t i = total_ops; i > 0; i--) {
+          if(at(conflicts, i, t) > 0) {
+            f = i;
+            nx = at(conflicts, i, t);
+          }
+          at(first, i, t) = f;
+          at(next, i, t) = nx;
+        }
+        // the scans start at step 1 for op 0
+        at(first, 0, t) = f;
+        at(next, 0, t) = nx;
+      }
+      frozen = true;
     }
 
     //Get the step of type which conflict my_step
     int32_t get_conflict(uint32_t my_step, uint8_t type)
     {
-      return conflicts[my_step][type];
+      return at(conflicts, my_step, type);
     }
 
     //Get the first step which is not less than min_step
     //and conflict with type
     int32_t get_first_conflict(uint32_t min_step, uint8_t type)
     {
-      for(uint32_t i = min_step; i <= total_ops; i++)
+      if(likely(frozen))
+        return min_step <= total_ops ? at(first, min_step, type) : 0;
+      for(uint32_t i = (min_step ? min_step : 1); i <= total_ops; i++)
       {
-        if(conflicts[i][type] > 0)
+        if(at(conflicts, i, type) > 0)
             return i;
       }
       return 0;
@@ -80,10 +191,12 @@ public:
     int32_t get_prev_conflict(uint32_t op, uint8_t t2)
     {
 
-      for(int i = op - 1 ; i > 0; i--)
+      if(likely(frozen))
+        return at(prev, (op <= total_ops ? op : total_ops + 1), t2);
+      for(int i = std::min(op, total_ops + 1) - 1 ; i > 0; i--)
       {
-        if(conflicts[i][t2] > 0) {
-          return conflicts[i][t2];
+        if(at(conflicts, i, t2) > 0) {
+          return at(conflicts, i, t2);
         }
         
       }
@@ -95,10 +208,12 @@ public:
     int32_t get_next_conflict(uint32_t op, uint8_t t2)
     {
     
-      for(uint32_t i = op; i <= total_ops; i++)
+      if(likely(frozen))
+        return op <= total_ops ? at(next, op, t2) : 0;
+      for(uint32_t i = (op ? op : 1); i <= total_ops; i++)
       {
-        if(conflicts[i][t2] > 0) {
-          return conflicts[i][t2];
+        if(at(conflicts, i, t2) > 0) {
+          return at(conflicts, i, t2);
         }
       }
       return 0;
@@ -109,13 +224,36 @@ public:
         return total_ops;
     }
 
+    bool is_frozen() const
+    {
+      return frozen;
+    }
+
     private:
-      //2D dimensional array: 
-      //1st dimension - step number, 2nd dimension - type, value - conflict step
-      uint32_t** conflicts;
+      inline size_t table_size() const
+      {
+        return size_t(total_ops + 2) * (total_types + 1);
+      }
+
+      inline uint32_t &at(uint32_t *table, uint32_t op, uint32_t t) const
+      {
+        return table[size_t(op) * (total_types + 1) + t];
+      }
+
+      //Flat [step][type] tables, value - conflict step (or step for first):
+      //conflicts is the graph itself, prev/next/first the precomputed
+      //answers of get_prev/next/first_conflict()
+      uint32_t* conflicts;
+      uint32_t* prev;
+      uint32_t* next;
+      uint32_t* first;
+      //commutative_kind of each op, commutative ops only conflict with ops
+      //which are not commutative or apply another operator
+      uint8_t* commutative;
       uint8_t type;
       uint32_t total_ops;
       uint32_t total_types;
+      bool frozen;
   };
 
 
@@ -127,18 +265,49 @@ public:
     txns = new chopped_tx[types + 1];
   }
 
+  ~conflict_graph()
+  {
+    delete[] txns;
+  }
+
+  conflict_graph(const conflict_graph &) = delete;
+  conflict_graph &operator=(const conflict_graph &) = delete;
+
   void init_txn(uint8_t type, uint32_t ops)
   {
     txns[type].init(type, ops, types);
   }
 
+  void set_commutative(uint8_t type, uint32_t op, commutative_kind k)
+  {
+    txns[type].set_commutative(op, k);
+  }
+
+  bool is_commutative(uint8_t type, uint32_t op)
+  {
+    return txns[type].is_commutative(op);
+  }
+
+  //two ops applying the same commutative operator never conflict, so such
+  //an edge is dropped
   void set_conflict(uint8_t t1, uint32_t op1, uint8_t t2, uint32_t op2)
   {
     ALWAYS_ASSERT(t1 != t2);
+    const commutative_kind k = txns[t1].get_commutative_kind(op1);
+    if (k != CommutativeNone && k == txns[t2].get_commutative_kind(op2))
+      return;
     txns[t1].set_conflict(op1, t2, op2);
     txns[t2].set_conflict(op2, t1, op1);
   }
 
+  //call once the graph is built, see chopped_tx::freeze()
+  void freeze()
+  {
+    for(uint32_t t = 0; t <= types; t++)
+      if(txns[t].get_ops())
+        txns[t].freeze();
+  }
+
   //get the t1's step which is conflict with t2
   uint32_t conflict_step(uint8_t t1, uint8_t t2, uint32_t step)
   {
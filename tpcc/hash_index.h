@@ -0,0 +1,168 @@
+// -*- c-basic-offset: 2 -*-
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "macros.h"
+#include "rcu.h"
+#include "spinlock.h"
+#include "lockguard.h"
+
+/**
+ * Point lookup index kept next to an mbtree (see mbtree::build_hash_index()).
+ *
+ * Maps the full key of every record to the value masstree holds for it, so
+ * an exact-key search is one hash probe instead of a descent through the
+ * layers of masstree. Masstree stays the authority: scans, phantom
+ * protection (node versions) and every miss here go to it.
+ *
+ * Buckets chain immutable entries. Writers serialize per lock stripe and
+ * publish a fully built entry with a single pointer store, readers walk the
+ * chains without locking from inside the RCU region every tree operation
+ * runs in, and unlinked entries are freed through RCU. The table is never
+ * resized, so it is sized with headroom when built.
+ */
+template <typename V>
+class hash_index {
+public:
+  static const size_t NLocks = 1024;
+
+  // nbuckets must be a power of two
+  hash_index(size_t nbuckets)
+    : mask_(nbuckets - 1),
+      buckets_(new std::atomic<entry *>[nbuckets])
+  {
+    ALWAYS_ASSERT(nbuckets >= NLocks && !(nbuckets & mask_));
+    for (size_t i = 0; i < nbuckets; i++)
+      buckets_[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  /**
+   * NOT THREAD SAFE
+   */
+  ~hash_index()
+  {
+    for (size_t i = 0; i <= mask_; i++) {
+      entry *e = buckets_[i].load(std::memory_order_relaxed);
+      while (e) {
+        entry *next = e->next_.load(std::memory_order_relaxed);
+        rcu::s_instance.dealloc(e, entry::alloc_size(e->len_));
+        e = next;
+      }
+    }
+    delete [] buckets_;
+  }
+
+  hash_index(const hash_index &) = delete;
+  hash_index &operator=(const hash_index &) = delete;
+
+  inline size_t nbuckets() const { return mask_ + 1; }
+
+  inline bool
+  search(const char *k, size_t len, V &v) const
+  {
+    const uint64_t h = Hash(k, len);
+    for (const entry *e = buckets_[h & mask_].load(std::memory_order_acquire);
+         e; e = e->next_.load(std::memory_order_acquire)) {
+      if (e->hash_ == h && e->len_ == len && !memcmp(e->key_, k, len)) {
+        v = e->value_;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // maps k to v, replacing the entry of k if there is one
+  void
+  put(const char *k, size_t len, V v)
+  {
+    const uint64_t h = Hash(k, len);
+    entry *n = entry::make(h, k, len, v);
+    ::lock_guard<spinlock> l(locks_[h & (NLocks - 1)]);
+    std::atomic<entry *> *link = &buckets_[h & mask_];
+    for (entry *e = link->load(std::memory_order_relaxed); e;
+         link = &e->next_, e = link->load(std::memory_order_relaxed)) {
+      if (e->hash_ == h && e->len_ == len && !memcmp(e->key_, k, len)) {
+        n->next_.store(e->next_.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+        link->store(n, std::memory_order_release);
+        rcu::s_instance.dealloc_rcu(e, entry::alloc_size(e->len_));
+        return;
+      }
+    }
+    n->next_.store(buckets_[h & mask_].load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+    buckets_[h & mask_].store(n, std::memory_order_release);
+  }
+
+  void
+  erase(const char *k, size_t len)
+  {
+    const uint64_t h = Hash(k, len);
+    ::lock_guard<spinlock> l(locks_[h & (NLocks - 1)]);
+    std::atomic<entry *> *link = &buckets_[h & mask_];
+    for (entry *e = link->load(std::memory_order_relaxed); e;
+         link = &e->next_, e = link->load(std::memory_order_relaxed)) {
+      if (e->hash_ == h && e->len_ == len && !memcmp(e->key_, k, len)) {
+        // readers on e still see the rest of the chain through it
+        link->store(e->next_.load(std::memory_order_relaxed),
+                    std::memory_order_release);
+        rcu::s_instance.dealloc_rcu(e, entry::alloc_size(e->len_));
+        return;
+      }
+    }
+  }
+
+  static inline uint64_t
+  Hash(const char *k, size_t len)
+  {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (len * 0xff51afd7ed558ccdULL);
+    for (; len >= 8; k += 8, len -= 8) {
+      uint64_t w;
+      memcpy(&w, k, 8);
+      h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 29;
+    }
+    if (len) {
+      uint64_t w = 0;
+      memcpy(&w, k, len);
+      h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+    }
+    h ^= h >> 32;
+    return h;
+  }
+
+private:
+  struct entry {
+    std::atomic<entry *> next_;
+    V value_;
+    uint64_t hash_;
+    uint32_t len_;
+    char key_[0];
+
+    static inline size_t
+    alloc_size(size_t len)
+    {
+      return sizeof(entry) + len;
+    }
+
+    static entry *
+    make(uint64_t h, const char *k, size_t len, V v)
+    {
+      entry *e = reinterpret_cast<entry *>(rcu::s_instance.alloc(alloc_size(len)));
+      e->next_.store(nullptr, std::memory_order_relaxed);
+      e->value_ = v;
+      e->hash_ = h;
+      e->len_ = len;
+      memcpy(e->key_, k, len);
+      return e;
+    }
+  };
+
+  const size_t mask_;
+  std::atomic<entry *> *const buckets_;
+  spinlock locks_[NLocks];
+};
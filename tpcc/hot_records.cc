@@ -0,0 +1,136 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "hot_records.h"
+#include "access_trace.h"
+#include "ticker.h"
+#include "util.h"
+
+using namespace std;
+
+static_assert(hot_records::Width <= (1 << 16) &&
+              !(hot_records::Width & (hot_records::Width - 1)),
+              "Cell() takes a power of two of at most 16 bits of the hash per row");
+static_assert(hot_records::Depth * 16 <= 64,
+              "Cell() takes the rows from one 64-bit hash");
+
+bool hot_records::g_enabled = false;
+uint32_t hot_records::g_threshold = 32;
+atomic<hot_records::core_sketch *> hot_records::g_sketches[NMAXCORES];
+atomic<uint32_t> hot_records::g_folded[Depth * Width];
+
+hot_records::core_sketch::core_sketch()
+  : cells_(new atomic<uint32_t>[Depth * Width]),
+    last_(new uint32_t[Depth * Width]),
+    nrecorded_(0), nhot_(0)
+{
+  for (size_t i = 0; i < Depth * Width; i++) {
+    cells_[i].store(0, memory_order_relaxed);
+    last_[i] = 0;
+  }
+  for (size_t i = 0; i < TopK; i++)
+    top_[i] = {nullptr, nullptr, string(), 0, 0};
+}
+
+hot_records::core_sketch *
+hot_records::new_core_sketch()
+{
+  core_sketch *s = new core_sketch;
+  // only this core creates its sketch, the ticker picks it up at the next
+  // fold
+  g_sketches[coreid::core_id()].store(s, memory_order_release);
+  return s;
+}
+
+void
+hot_records::Enable(uint32_t threshold)
+{
+  g_threshold = threshold;
+  g_enabled = true;
+  ticker::s_instance.add_tick_callback(&hot_records::Fold);
+}
+
+void
+hot_records::Fold(uint64_t tick)
+{
+  // only runs on the ticker thread, so it is the only writer of g_folded
+  if (!(tick % DecayTicks))
+    for (size_t i = 0; i < Depth * Width; i++)
+      g_folded[i].store(g_folded[i].load(memory_order_relaxed) / 2,
+                        memory_order_relaxed);
+  for (size_t c = 0; c < NMAXCORES; c++) {
+    core_sketch *s = g_sketches[c].load(memory_order_acquire);
+    if (!s)
+      continue;
+    for (size_t i = 0; i < Depth * Width; i++) {
+      const uint32_t v = s->cells_[i].load(memory_order_relaxed);
+      if (v == s->last_[i])
+        continue;
+      // the cells only grow, this is right across a wrap around as well
+      g_folded[i].store(g_folded[i].load(memory_order_relaxed) + (v - s->last_[i]),
+                        memory_order_relaxed);
+      s->last_[i] = v;
+    }
+  }
+}
+
+void
+hot_records::Totals(uint64_t &nrecorded, uint64_t &nhot)
+{
+  nrecorded = nhot = 0;
+  for (size_t c = 0; c < NMAXCORES; c++) {
+    const core_sketch *s = g_sketches[c].load(memory_order_acquire);
+    if (!s)
+      continue;
+    nrecorded += s->nrecorded_.load(memory_order_relaxed);
+    nhot += s->nhot_.load(memory_order_relaxed);
+  }
+}
+
+void
+hot_records::Dump(const string &file)
+{
+  // merge the cores
+  map<const void *, top_entry> merged;
+  for (size_t c = 0; c < NMAXCORES; c++) {
+    const core_sketch *s = g_sketches[c].load(memory_order_acquire);
+    if (!s)
+      continue;
+    for (size_t i = 0; i < TopK; i++) {
+      if (!s->top_[i].rec_)
+        continue;
+      top_entry &e = merged[s->top_[i].rec_];
+      e.rec_ = s->top_[i].rec_;
+      e.acc_id_ = s->top_[i].acc_id_;
+      e.count_ += s->top_[i].count_;
+      if (!s->top_[i].key_.empty())
+        e.name(s->top_[i].table_, &s->top_[i].key_);
+    }
+  }
+  vector<top_entry> top;
+  for (auto &p : merged)
+    top.push_back(p.second);
+  sort(top.begin(), top.end(),
+       [](const top_entry &a, const top_entry &b) { return a.count_ > b.count_; });
+  if (top.size() > TopK)
+    top.resize(TopK);
+
+  ofstream out(file);
+  if (!out.is_open()) {
+    cerr << "Could not open hot records file: " << file << endl;
+    ALWAYS_ASSERT(false);
+  }
+  out << "# table key acc_id count estimate" << endl;
+  for (auto &e : top) {
+    if (e.key_.empty())
+      out << "<unknown> -";
+    else
+      out << access_trace::TableName(e.table_) << " " << util::hexify(e.key_);
+    out << " " << e.acc_id_ << " " << e.count_ << " "
+        << Estimate(e.rec_) << endl;
+  }
+  cerr << "hot records: " << top.size() << " records written to "
+       << file << endl;
+}
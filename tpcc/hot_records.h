@@ -0,0 +1,164 @@
+#ifndef _HOT_RECORDS_H_
+#define _HOT_RECORDS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+#include "macros.h"
+#include "core.h"
+
+// which records the conflicts of a workload pile up on, as a feature for
+// the learned policy (see ENCODER_REC_HOT in policy.h) and for a look at
+// the hot keys of a run.
+//
+// every abort and every wait blamed on a record counts against it in a
+// count-min sketch of the core which saw it. the cores only ever bump their
+// own cells, the ticker thread folds what they added since the last tick
+// into one shared sketch and halves that one every DecayTicks ticks, so the
+// estimates count the recent conflicts only and lag by at most a tick.
+// each core also keeps the TopK records it blamed most often over the whole
+// run (space-saving), with the table and key they were blamed under, which
+// is what Dump() writes
+class hot_records {
+public:
+  static const size_t Depth = 4;
+  static const size_t Width = 4096; // power of two, at most 1 << 16
+  static const size_t TopK = 32;
+  static const uint64_t DecayTicks = 25; // ~1s with the 40ms ticks
+
+  static bool g_enabled;
+  // records with a decayed estimate of at least this many are hot
+  static uint32_t g_threshold;
+
+  // starts folding the sketches on the ticker, sets g_enabled
+  static void Enable(uint32_t threshold);
+
+  // table and key name rec for Dump(), if the blamer knows them
+  static inline ALWAYS_INLINE void
+  Record(const void *rec, uint32_t acc_id,
+         const void *table = nullptr, const std::string *key = nullptr)
+  {
+    core_sketch *s = g_sketches[coreid::core_id()].load(std::memory_order_relaxed);
+    if (unlikely(!s))
+      s = new_core_sketch();
+    const uint64_t h = Hash(rec);
+    for (size_t d = 0; d < Depth; d++) {
+      std::atomic<uint32_t> &c = s->cells_[Cell(h, d)];
+      // only this core writes its cells
+      c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    s->nrecorded_.store(s->nrecorded_.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    if (IsHot(rec))
+      s->nhot_.store(s->nhot_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    s->offer(rec, acc_id, table, key);
+  }
+
+  static inline uint32_t
+  Estimate(const void *rec)
+  {
+    const uint64_t h = Hash(rec);
+    uint32_t e = g_folded[Cell(h, 0)].load(std::memory_order_relaxed);
+    for (size_t d = 1; d < Depth; d++)
+      e = std::min(e, g_folded[Cell(h, d)].load(std::memory_order_relaxed));
+    return e;
+  }
+
+  static inline bool
+  IsHot(const void *rec)
+  {
+    return g_enabled && Estimate(rec) >= g_threshold;
+  }
+
+  // how many conflicts were recorded so far, and how many of them were on
+  // records which were hot already
+  static void Totals(uint64_t &nrecorded, uint64_t &nhot);
+
+  // writes the TopK records of all cores, hottest first, one per line:
+  //   <table> <key> <access id> <count> <decayed estimate>
+  // where key is the encoded key in hex and access id is the access which
+  // last blamed the record. a record never blamed with its key is written
+  // as "<unknown> -". must be called once the workers are done
+  static void Dump(const std::string &file);
+
+private:
+  struct top_entry {
+    const void *rec_;
+    const void *table_; // tree, see access_trace::TableName()
+    std::string key_;   // encoded, empty if not known yet
+    uint32_t acc_id_;
+    uint64_t count_;
+
+    inline void
+    name(const void *table, const std::string *key)
+    {
+      if (!key || !key_.empty())
+        return;
+      table_ = table;
+      key_ = *key;
+    }
+  };
+
+  struct core_sketch {
+    std::atomic<uint32_t> *cells_; // Depth x Width, bumped by the owner
+    uint32_t *last_;               // cells_ at the last fold, ticker only
+    top_entry top_[TopK];          // owner only
+    std::atomic<uint64_t> nrecorded_;
+    std::atomic<uint64_t> nhot_;
+
+    core_sketch();
+
+    inline void
+    offer(const void *rec, uint32_t acc_id, const void *table,
+          const std::string *key)
+    {
+      size_t min = 0;
+      for (size_t i = 0; i < TopK; i++) {
+        if (top_[i].rec_ == rec) {
+          top_[i].acc_id_ = acc_id;
+          top_[i].count_++;
+          top_[i].name(table, key);
+          return;
+        }
+        if (top_[i].count_ < top_[min].count_)
+          min = i;
+      }
+      // evict the least counted record, the newcomer inherits its count
+      top_[min].rec_ = rec;
+      top_[min].acc_id_ = acc_id;
+      top_[min].count_++;
+      top_[min].key_.clear();
+      top_[min].name(table, key);
+    }
+  };
+
+  static inline uint64_t
+  Hash(const void *rec)
+  {
+    uint64_t h = uintptr_t(rec);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // a different 16 bits of the hash for every row
+  static inline size_t
+  Cell(uint64_t h, size_t d)
+  {
+    return d * Width + ((h >> (16 * d)) & (Width - 1));
+  }
+
+  static core_sketch *new_core_sketch();
+  static void Fold(uint64_t tick);
+
+  static std::atomic<core_sketch *> g_sketches[NMAXCORES];
+  static std::atomic<uint32_t> g_folded[Depth * Width];
+};
+
+#endif /* _HOT_RECORDS_H_ */
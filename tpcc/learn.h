@@ -10,6 +10,7 @@
 #include <pthread.h>
 #include <set>
 #include "fstream"
+#include "sstream"
 #include "iostream"
 #include "macros.h"
 
@@ -26,6 +27,7 @@ enum OpType {
   OpCommit,
   OpInsert,
   OpScan,
+  OpCommute, // a commutative update, only traced (see access_trace)
   OpNone
 };
 
@@ -142,9 +144,16 @@ struct contention_encoder {
   }
 
   void load(const std::string &encoder_f) {
+    load<default_workload>(encoder_f);
+  }
+
+  // the feature caps (and the step encoder) depend on the workload
+  template <typename Workload>
+  void load(const std::string &encoder_f) {
+    const int32_t *encoder_feature_cap = Workload::encoder_feature_cap();
     access_only = true;
     if (encoder_f == "step") {
-      max_state = TXN_TYPE * encoder_feature_cap[ENCODER_TX_N_OP];
+      max_state = Workload::txn_types * encoder_feature_cap[ENCODER_TX_N_OP];
       for (int i = 0; i < ENCODER_N_FEATURES; i++) {
         encode_type[i] = EncodeIgnore;
         encoding_cap[i] = 1;
@@ -162,16 +171,22 @@ struct contention_encoder {
                   << std::endl;
         ALWAYS_ASSERT(false);
       }
+      // a line of encoding types, then a line of caps. files written before
+      // a feature was added end early, the features missing are ignored
+      std::string types_line, caps_line;
+      std::getline(pol_file, types_line);
+      std::getline(pol_file, caps_line);
+      std::istringstream types(types_line), caps(caps_line);
       for (int i = 0; i < ENCODER_N_FEATURES; i++) {
         int tmp;
-        pol_file >> tmp;
-        encode_type[i] = EncodingType(tmp);
+        encode_type[i] = types >> tmp ? EncodingType(tmp) : EncodeIgnore;
         if (i != ENCODER_TX_TYPE && i != ENCODER_TX_N_OP && encode_type[i] != EncodeIgnore) {
           access_only = false;
         }
       }
       for (int i = 0; i < ENCODER_N_FEATURES; i++) {
-        pol_file >> encoding_cap[i];
+        if (!(caps >> encoding_cap[i]))
+          encoding_cap[i] = 1;
         assert(encoding_cap[i] > 0);
         if (encoding_cap[i] > encoder_feature_cap[i]) {
           encoding_cap[i] = encoder_feature_cap[i];
@@ -201,22 +216,49 @@ struct contention_encoder {
     return capped_steps + rev_prod[tx_type-1];
   }
 
+  // what feature i with value x adds to the state
+  ALWAYS_INLINE int inference_feature(int i, int x) const {
+    auto tmp = x >= encoding_cap[i]? encoding_cap[i]-1 :x;
+    if (encode_type[i] == EncodeIgnore)
+      return 0;
+    else if (encode_type[i] == EncodeIfNot)
+      return tmp > 0?  rev_prod[i]: 0;
+    else if (encode_type[i] == EncodeLog)
+      return log2_values[tmp] * rev_prod[i];
+    else if (encode_type[i] == EncodeLinear)
+      return tmp * rev_prod[i];
+    return 0;
+  }
+
   ALWAYS_INLINE int inference(const int x[ENCODER_N_FEATURES]) {
     assert(!access_only);
     int res = 0;
-    for (int i=ENCODER_N_FEATURES-1;i>=0;i--) {
-      auto tmp = x[i] >= encoding_cap[i]? encoding_cap[i]-1 :x[i];
-      if (encode_type[i] == EncodeIgnore)
-        continue ;
-      else if (encode_type[i] == EncodeIfNot)
-        res += tmp > 0?  rev_prod[i]: 0;
-      else if (encode_type[i] == EncodeLog)
-        res += log2_values[tmp] * rev_prod[i];
-      else if (encode_type[i] == EncodeLinear)
-        res += tmp * rev_prod[i];
-    }
+    for (int i=ENCODER_N_FEATURES-1;i>=0;i--)
+      res += inference_feature(i, x[i]);
     return res;
   }
+
+  // identifies the numbering of the states, a policy is only valid for
+  // encoders of the same hash (see basic_policy::save())
+  uint64_t hash() const {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](int64_t v) {
+      for (int i = 0; i < 8; i++, v >>= 8)
+        h = (h ^ uint8_t(v)) * 0x100000001b3ULL;
+    };
+    for (int i = 0; i < ENCODER_N_FEATURES; i++) {
+      mix(encode_type[i]);
+      mix(encoding_cap[i]);
+    }
+    mix(max_state);
+    mix(access_only);
+    return h;
+  }
+
+  // the states depend on the record accessed, so hot_records has to run
+  inline bool uses_rec_hot() const {
+    return encode_type[ENCODER_REC_HOT] != EncodeIgnore;
+  }
 };
 
 extern contention_encoder global_encoder;
@@ -228,6 +270,7 @@ struct xact {
   uint32_t tx_n_op;      // number of executed transaction operations.
   uint32_t cur_acc_id = 0;
   OpType tx_cur_op;          // the type of currently executed operation.
+  uint32_t rec_hot;          // whether the record of the operation is hot.
 
   // Graphical information.
 #if TRACK_FULL_DEPENDENCY
@@ -242,11 +285,17 @@ struct xact {
   // Some bugs only happen regarding high concurrency and are not reproducible in GDB.
   // In this case, we use the debug bits for static debugging purpose.
   uint32_t state;
+  PolicyAction lazy_action; // see get_cur_policy()
   CACHE_PADOUT;
 
   ALWAYS_INLINE uint32_t encode() const {
 #ifdef WL_TPCC
-    return cur_acc_id;
+    if (likely(!global_encoder.uses_rec_hot()))
+      return cur_acc_id;
+    // the access id stands in for the step, the other features are not
+    // tracked for tpcc
+    return cur_acc_id * global_encoder.rev_prod[ENCODER_TX_N_OP] +
+           global_encoder.inference_feature(ENCODER_REC_HOT, rec_hot);
 #endif
     if (likely(global_encoder.access_only)) {
       // aggressive optimization for this branch (fast path).
@@ -258,7 +307,8 @@ struct xact {
         tx_n_op,
         tx_n_dep_on,
         tx_n_dep_by,
-        global_listener.tx_n_blocked};
+        global_listener.tx_n_blocked,
+        int(rec_hot)};
     return global_encoder.inference(feature);
   }
 
@@ -270,6 +320,7 @@ struct xact {
     tx_n_dep_by = 0;
     tx_n_dep_on = 0;
     tx_cur_op = OpNone;
+    rec_hot = 0;
     debug_bits = 0;
 #if TRACK_FULL_DEPENDENCY
     blocking.clear();
@@ -291,6 +342,12 @@ struct xact {
     if (likely(tx_cur_op != OpCommit || tmp->lazy_mark)) {
       return tmp;
     } else if (tx_n_op != txn_access_num[tx_type]) {
+      // the states the policy does not set share one action, which must
+      // not take the expose of this one
+      if (unlikely(pg->is_default(tmp))) {
+        lazy_action = *tmp;
+        tmp = &lazy_action;
+      }
       // if not the final operation, we use the wait policy for next operation as expose wait policy.
       tx_n_op ++;
       cur_acc_id ++;
@@ -36,8 +36,6 @@
 #define ENABLE_RENDEZVOUS
 #define USE_ONE_OP_PIECE
 
-// XXX(Conrad): Turn off cummatative_set
-//#define SUPPORT_COMMUTATIVE_OP
 // #define TRACK_LAST_ENTRY
  #define CASCADING_ABORT_BY_EXCEPTION
 
@@ -156,6 +154,16 @@
 // indicating how much independent txn can a bench worker can hold at most
 #define MAX_TXN_BUF_SIZE 32
 
+// most keys a multi_get()/multi_put() handles at once, larger key sets are
+// split into batches of this size
+#define MULTI_OP_BATCH 16
+
+// most column groups the value of a table can be split into (see
+// DO_COLUMN_GROUPS in record/encoder.h), bit g of a column group mask
+// stands for group g
+#define MAX_COLUMN_GROUPS 4
+#define ALL_COLUMN_GROUPS ((uint8_t) ((1 << MAX_COLUMN_GROUPS) - 1))
+
 #define ALIGN_MEM alignas(CACHELINE_SIZE)
 #define ALIGN_PTR(arr, n_entry, type) posix_memalign(reinterpret_cast<void**>(&arr), CACHELINE_SIZE, n_entry * sizeof(type));
 
@@ -82,8 +82,17 @@ class basic_table {
 
     inline void print(FILE* f = 0, int indent = 0) const;
 
+    // see leaf::split_into()
+    inline bool sequential_splits() const {
+	return sequential_splits_;
+    }
+    inline void set_sequential_splits(bool x) {
+	sequential_splits_ = x;
+    }
+
   private:
     node_type* root_;
+    bool sequential_splits_;
 
     template <typename H, typename F>
     int scan(H helper, Str firstkey, bool matchfirst,
@@ -39,16 +39,18 @@ leaf<P>::ikey_after_insert(const permuter_type& perm, int i,
     @post split_ikey is the first key in *@a nr
     @return split type
 
-    If @a p == this->size() and *this is the rightmost node in the layer,
-    then this code assumes we're inserting nodes in sequential order, and
-    the split does not move any keys.
+    If @a sequential, @a p == this->size() and *this is the rightmost node
+    in the layer, then this code assumes we're inserting nodes in sequential
+    order, and the split does not move any keys: *this stays full instead of
+    both halves staying half empty as the keys keep coming in order.
 
     The split type is 0 if @a ka went into *this, 1 if the @a ka went into
     *@a nr, and 2 for the sequential-order optimization (@a ka went into *@a
     nr and no other keys were moved). */
 template <typename P>
 int leaf<P>::split_into(leaf<P>* nr, int p, const key_type& ka,
-                        ikey_type& split_ikey, threadinfo& ti)
+                        ikey_type& split_ikey, threadinfo& ti,
+                        bool sequential)
 {
     // B+tree leaf insertion.
     // Split *this, with items [0,T::width), into *this + nr, simultaneously
@@ -66,12 +68,8 @@ int leaf<P>::split_into(leaf<P>* nr, int p, const key_type& ka,
     int width = this->size();	// == this->width or this->width - 1
     int mid = this->width / 2 + 1;
 
-#if 0   
-    if (p == 0 && !this->prev_)
-	mid = 1;
-    else if (p == width && !this->next_.ptr)
+    if (sequential && p == width && !this->next_.ptr)
 	mid = width;
-#endif
 
     // Never separate keys with the same ikey0.
     permuter_type perml(this->permutation_);
@@ -174,7 +172,8 @@ node_base<P>* tcursor<P>::finish_split(threadinfo& ti)
     child->assign_version(*n_);
     ikey_type xikey[2];
     int split_type = n_->split_into(static_cast<leaf_type *>(child),
-                                    ki_, ka_, xikey[0], ti);
+                                    ki_, ka_, xikey[0], ti,
+                                    sequential_splits_);
     bool sense = false;
 
     while (1) {
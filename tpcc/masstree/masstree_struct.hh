@@ -516,7 +516,7 @@ class leaf : public node_base<P> {
     inline ikey_type ikey_after_insert(const permuter_type& perm, int i,
                                        const key_type& ka, int ka_i) const;
     int split_into(leaf<P>* nr, int p, const key_type& ka, ikey_type& split_ikey,
-                   threadinfo& ti);
+                   threadinfo& ti, bool sequential = false);
 
     template <typename PP> friend class tcursor;
 };
@@ -737,7 +737,7 @@ void leaf<P>::hard_assign_ksuf(int p, Str s, bool initializing,
 
 template <typename P>
 inline basic_table<P>::basic_table()
-    : root_(0) {
+    : root_(0), sequential_splits_(false) {
 }
 
 template <typename P>
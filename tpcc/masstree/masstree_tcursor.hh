@@ -99,19 +99,23 @@ class tcursor {
     typedef typename P::threadinfo_type threadinfo;
 
     tcursor(basic_table<P>& table, Str str)
-	: ka_(str), root_(table.fix_root()) {
+	: ka_(str), root_(table.fix_root()),
+	  sequential_splits_(table.sequential_splits()) {
     }
     tcursor(basic_table<P>& table, const char* s, int len)
-	: ka_(s, len), root_(table.fix_root()) {
+	: ka_(s, len), root_(table.fix_root()),
+	  sequential_splits_(table.sequential_splits()) {
     }
     tcursor(basic_table<P>& table, const unsigned char* s, int len)
-	: ka_(reinterpret_cast<const char*>(s), len), root_(table.fix_root()) {
+	: ka_(reinterpret_cast<const char*>(s), len), root_(table.fix_root()),
+	  sequential_splits_(table.sequential_splits()) {
     }
     tcursor(node_base<P>* root, const char* s, int len)
-	: ka_(s, len), root_(root) {
+	: ka_(s, len), root_(root), sequential_splits_(false) {
     }
     tcursor(node_base<P>* root, const unsigned char* s, int len)
-	: ka_(reinterpret_cast<const char*>(s), len), root_(root) {
+	: ka_(reinterpret_cast<const char*>(s), len), root_(root),
+	  sequential_splits_(false) {
     }
 
     inline bool has_value() const {
@@ -150,6 +154,7 @@ class tcursor {
     int kp_;
     node_base<P>* root_;
     int state_;
+    bool sequential_splits_;
 
     inline node_type* reset_retry() {
 	ka_.unshift_all();
@@ -25,6 +25,7 @@
 #include "util.h"
 #include "small_vector.h"
 #include "ownership_checker.h"
+#include "hash_index.h"
 
 #include "masstree/masstree_scan.hh"
 #include "masstree/masstree_insert.hh"
@@ -237,6 +238,7 @@ public:
     rcu_region guard;
     threadinfo ti;
     table_.destroy(ti);
+    delete hash_;
   }
 
   /**
@@ -247,8 +249,45 @@ public:
     threadinfo ti;
     table_.destroy(ti);
     table_.initialize(ti);
+    delete hash_;
+    hash_ = nullptr;
   }
 
+  /**
+   * Adds a hash index over the keys currently in the tree, which from then
+   * on answers the exact-key hits of search() and is kept up to date by
+   * insert(), insert_if_absent() and remove(). Sized for twice the current
+   * number of keys, so call it once the tree is loaded. No-op if there
+   * already is one.
+   *
+   * NOT THREAD SAFE
+   */
+  void build_hash_index();
+
+  inline bool has_hash_index() const {
+    return hash_;
+  }
+
+  /**
+   * Splits the rightmost leaf of each layer in favor of the keys appended to
+   * it (see Masstree::leaf::split_into()), for trees whose keys mostly come
+   * in increasing order and which would otherwise fill up with half-empty
+   * leaves.
+   *
+   * NOT THREAD SAFE, call before the tree is used
+   */
+  inline void set_sequential_splits(bool x) {
+    table_.set_sequential_splits(x);
+  }
+
+  /**
+   * The leaves of every layer and how many of their slots are in use (links
+   * to lower layers included), nbytes does not count key suffixes kept
+   * outside the leaves. Like size(), not consistent given concurrent
+   * modifications
+   */
+  inline void leaf_stats(size_t &nleaves, size_t &nslots, size_t &nbytes) const;
+
   /** Note: invariant checking is not thread safe */
   inline void invariant_checker() const {
   }
@@ -256,9 +295,31 @@ public:
   /** NOTE: the public interface assumes that the caller has taken care
   * of setting up RCU */
 
+  /**
+   * search_info is set to no node if k is found through the hash index,
+   * see search_node() for when a caller still needs the leaf of k
+   */
   inline bool search(const key_type &k, value_type &v,
                      versioned_node_t *search_info = nullptr) const;
 
+  /**
+   * The leaf k is in, or would be in, and its version, always from the tree.
+   * For the absent set of a read which found k through the hash index but
+   * then an empty or deleted tuple
+   */
+  inline void search_node(const key_type &k, versioned_node_t &search_info) const;
+
+  /**
+   * search() of n keys, whose descents through the internodes of the top
+   * layer go level by level for all of them at once: each round moves every
+   * key one node down and prefetches that node, so the cache misses of the
+   * n descents overlap instead of adding up. That walk is unvalidated and
+   * only warms the cache, the lookups themselves are regular search()es
+   * over the nodes it brought in
+   */
+  inline void multi_search(const key_type *keys, size_t n, value_type *vs,
+                           versioned_node_t *search_info, bool *found) const;
+
   /**
    * The low level callback interface is as follows:
    *
@@ -471,11 +532,26 @@ public:
     return sizeof(leaf_type);
   }
 
+  // table id written next to every record of this tree in the persistence
+  // log, 0 if the tree is not logged (see txn_logger::RegisterTable())
+  inline uint32_t log_id() const {
+    return log_id_;
+  }
+
+  inline void set_log_id(uint32_t id) {
+    log_id_ = id;
+  }
+
  private:
   Masstree::basic_table<P> table_;
+  uint32_t log_id_ = 0;
+  // see build_hash_index(), updated under the leaf lock of the key so it
+  // always agrees with table_ once a writer is done
+  hash_index<value_type> *hash_ = nullptr;
 
   static leaf_type* leftmost_descend_layer(node_base_type* n);
   class size_walk_callback;
+  class leaf_stats_walk_callback;
   template <bool Reverse> class search_range_scanner_base;
   template <bool Reverse> class low_level_search_range_scanner;
   template <typename F> class low_level_search_range_callback_wrapper;
@@ -580,11 +656,47 @@ inline size_t mbtree<P>::size() const
   return c.size_;
 }
 
+template <typename P>
+class mbtree<P>::leaf_stats_walk_callback : public tree_walk_callback {
+ public:
+  leaf_stats_walk_callback()
+    : nleaves_(0), nslots_(0) {
+  }
+  virtual void on_node_begin(const node_opaque_t *n) {
+    node_size_ = n->size();
+  }
+  virtual void on_node_success() {
+    ++nleaves_;
+    nslots_ += node_size_;
+  }
+  virtual void on_node_failure() {
+  }
+  size_t nleaves_;
+  size_t nslots_;
+  int node_size_;
+};
+
+template <typename P>
+inline void mbtree<P>::leaf_stats(size_t &nleaves, size_t &nslots,
+                                  size_t &nbytes) const
+{
+  leaf_stats_walk_callback c;
+  tree_walk(c);
+  nleaves = c.nleaves_;
+  nslots = c.nslots_;
+  nbytes = c.nleaves_ * sizeof(leaf_type);
+}
+
 template <typename P>
 inline bool mbtree<P>::search(const key_type &k, value_type &v,
                               versioned_node_t *search_info) const
 {
   rcu_region guard;
+  if (hash_ && hash_->search(reinterpret_cast<const char *>(k.data()), k.length(), v)) {
+    if (search_info)
+      *search_info = versioned_node_t(nullptr, 0);
+    return true;
+  }
   threadinfo ti;
   Masstree::unlocked_tcursor<P> lp(table_, k.data(), k.length());
   bool found = lp.find_unlocked(ti);
@@ -595,6 +707,74 @@ inline bool mbtree<P>::search(const key_type &k, value_type &v,
   return found;
 }
 
+template <typename P>
+inline void mbtree<P>::search_node(const key_type &k,
+                                   versioned_node_t &search_info) const
+{
+  rcu_region guard;
+  threadinfo ti;
+  Masstree::unlocked_tcursor<P> lp(table_, k.data(), k.length());
+  lp.find_unlocked(ti);
+  search_info = versioned_node_t(lp.node(), lp.full_version_value());
+}
+
+template <typename P>
+inline void mbtree<P>::multi_search(const key_type *keys, size_t n,
+                                    value_type *vs,
+                                    versioned_node_t *search_info,
+                                    bool *found) const
+{
+  static const size_t Width = 16;
+  rcu_region guard;
+  // the hash index has no descents to overlap
+  for (size_t off = 0; !hash_ && off < n; off += Width) {
+    const size_t m = std::min(n - off, Width);
+    const node_base_type *root = table_.root();
+    const node_base_type *cur[Width];
+    root->prefetch_full();
+    for (size_t i = 0; i < m; i++)
+      cur[i] = root;
+    for (bool more = true; more; ) {
+      more = false;
+      for (size_t i = 0; i < m; i++) {
+        if (!cur[i] || cur[i]->isleaf())
+          continue;
+        const internode_type *in = static_cast<const internode_type *>(cur[i]);
+        const Masstree::key<typename P::ikey_type> ka(
+            reinterpret_cast<const char *>(keys[off + i].data()),
+            keys[off + i].length());
+        cur[i] = in->child_[internode_type::bound_type::upper(ka, *in)];
+        if (cur[i]) {
+          cur[i]->prefetch_full();
+          more = true;
+        }
+      }
+    }
+  }
+  for (size_t i = 0; i < n; i++)
+    found[i] = search(keys[i], vs[i], &search_info[i]);
+}
+
+template <typename P>
+void mbtree<P>::build_hash_index()
+{
+  if (hash_)
+    return;
+  size_t nbuckets = hash_index<value_type>::NLocks;
+  for (const size_t want = 2 * size(); nbuckets < want; nbuckets <<= 1)
+    ;
+  hash_index<value_type> *h = new hash_index<value_type>(nbuckets);
+  auto fill = [h](const string_type &k, value_type v) {
+    h->put(k.data(), k.length(), v);
+    return true;
+  };
+  {
+    scoped_rcu_region guard;
+    search_range(key_type(), nullptr, fill);
+  }
+  hash_ = h;
+}
+
 template <typename P>
 inline bool mbtree<P>::insert(const key_type &k, value_type v,
                               value_type *old_v,
@@ -614,6 +794,8 @@ inline bool mbtree<P>::insert(const key_type &k, value_type v,
     insert_info->old_version = lp.previous_full_version_value();
     insert_info->new_version = lp.next_full_version_value(1);
   }
+  if (hash_)
+    hash_->put(reinterpret_cast<const char *>(k.data()), k.length(), v);
   lp.finish(1, ti);
   return !found;
 }
@@ -634,6 +816,8 @@ inline bool mbtree<P>::insert_if_absent(const key_type &k, value_type v,
       insert_info->old_version = lp.previous_full_version_value();
       insert_info->new_version = lp.next_full_version_value(1);
     }
+    if (hash_)
+      hash_->put(reinterpret_cast<const char *>(k.data()), k.length(), v);
   }
   lp.finish(!found, ti);
   return !found;
@@ -654,6 +838,8 @@ inline bool mbtree<P>::remove(const key_type &k, value_type *old_v)
   bool found = lp.find_locked(ti);
   if (found && old_v)
     *old_v = lp.value();
+  if (found && hash_)
+    hash_->erase(reinterpret_cast<const char *>(k.data()), k.length());
   lp.finish(found ? -1 : 0, ti);
   return found;
 }
@@ -1,6 +1,7 @@
 #ifndef _PIECE_H_
 #define _PIECE_H_
 
+#include <algorithm>
 #include <exception>
 #include "policy.h"
 #include "tuple.h"
@@ -202,6 +203,10 @@ public:
 
   template <typename ValueReader>
   bool do_get(concurrent_btree &btr, const std::string* key_str, ValueReader& value_reader, uint32_t acc_id);
+  // do_get() of a key the caller keeps only for the call (e.g. a packed_key
+  // on its stack). it goes into the arena only if the absent set needs it
+  template <typename ValueReader>
+  bool do_get(concurrent_btree &btr, const varkey &k, ValueReader& value_reader, uint32_t acc_id);
   template <typename ValueWriter>
   bool do_put(concurrent_btree &btr, const std::string* key_str,
               void* val_str, ValueWriter& value_writer, bool expect_new, uint32_t acc_id);
@@ -211,6 +216,17 @@ public:
                  ValueReader &value_reader, update_callback *callback,
                  ValueWriter &value_writer, uint32_t acc_id);
 
+  // batched do_get()/do_put() of n <= MULTI_OP_BATCH keys sharing acc_id,
+  // with one policy decision for the whole batch. reader_at(i) returns the
+  // ValueReader for key_strs[i]
+  template <typename ReaderAt>
+  size_t do_multi_get(concurrent_btree &btr, const std::string *const *key_strs,
+                      size_t n, ReaderAt &reader_at, bool *found, uint32_t acc_id);
+  template <typename ValueWriter>
+  bool do_multi_put(concurrent_btree &btr, const std::string *const *key_strs,
+                    void *const *val_strs, size_t n, ValueWriter &value_writer,
+                    uint32_t acc_id);
+
   bool do_expose_ic3_action(int pos, bool is_write, bool lock_mode = true);
 
   void check_rmw(int pos);
@@ -226,6 +242,21 @@ protected:
   access_entry* read_set_find(dbtuple* tuple);
 
 private:
+  // key_str is k if stable, else nullptr
+  template <typename ValueReader>
+  bool do_get_key(concurrent_btree &btr, const varkey &k, const std::string *key_str,
+                  ValueReader& value_reader, uint32_t acc_id);
+
+  // the record the one policy decision of a batch is made for: a hot one if
+  // any, so that rec_hot is that of the hottest access in the batch. names
+  // it for hot_records
+  const dbtuple *batch_rec(const concurrent_btree &btr, dbtuple *const *tuples,
+                           const std::string *const *key_strs, size_t n);
+
+  // the absent set entry of a missed key, which must outlive the txn
+  bool do_miss_read(const concurrent_btree::versioned_node_t &search_info,
+                    const varkey &k, const std::string *key_str);
+
   Transaction* txn;
   Policy *pg;
 };
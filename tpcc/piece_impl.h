@@ -57,13 +57,50 @@ bool mix_op<Transaction>::do_get(
   const std::string* key_str,
   ValueReader& value_reader,
   uint32_t acc_id)
+{
+  return do_get_key(btr, varkey(*key_str), key_str, value_reader, acc_id);
+}
+
+template <typename Transaction>
+template <typename ValueReader>
+bool mix_op<Transaction>::do_get(
+  concurrent_btree &btr,
+  const varkey &k,
+  ValueReader& value_reader,
+  uint32_t acc_id)
+{
+  return do_get_key(btr, k, nullptr, value_reader, acc_id);
+}
+
+template <typename Transaction>
+bool mix_op<Transaction>::do_miss_read(
+  const concurrent_btree::versioned_node_t &search_info,
+  const varkey &k,
+  const std::string *key_str)
+{
+  if (!key_str) {
+    std::string * const px = txn->string_allocator()();
+    px->assign((const char *) k.data(), k.size());
+    key_str = px;
+  }
+  // both occ and ic3 action should add not found case to absent set
+  return do_node_read(search_info.first, search_info.second, key_str, key_str, true /* occ for not found case */);
+}
+
+template <typename Transaction>
+template <typename ValueReader>
+bool mix_op<Transaction>::do_get_key(
+  concurrent_btree &btr,
+  const varkey &k,
+  const std::string *key_str,
+  ValueReader& value_reader,
+  uint32_t acc_id)
 {
   concurrent_btree::versioned_node_t search_info;
   typename concurrent_btree::value_type underlying_v{};
 
-  if (!btr.search(varkey(*key_str), underlying_v, &search_info)){
-    // both occ and ic3 action should add not found case to absent set
-    do_node_read(search_info.first, search_info.second, key_str, key_str, true /* occ for not found case */);
+  if (!btr.search(k, underlying_v, &search_info)){
+    do_miss_read(search_info, k, key_str);
     return false;
   }
 
@@ -73,7 +110,9 @@ bool mix_op<Transaction>::do_get(
   bool occ, lock_mode = true;
 
   txn->update_txn_step(acc_id);
-  auto pa = txn->refresh_policy(acc_id, OpRead);
+  auto pa = txn->refresh_policy(acc_id, OpRead, tuple);
+  txn->trace_access(btr, k.size(), acc_id, OpRead);
+  txn->name_rec(tuple, btr, k);
   if (unlikely(acc_id == MAX_ACC_ID || pg == nullptr || pa == nullptr)) {
     occ = true;
     lock_mode = true;
@@ -81,12 +120,18 @@ bool mix_op<Transaction>::do_get(
     occ = pa->access == no_detect;
   }
   // before access 
-  txn->before_access_operation(pa);
+  if (!txn->before_access_operation(pa))
+    return false;
 
   if (occ) {
     bool ret = do_tuple_read(tuple, value_reader);
     // check whether read success (the tuple can be empty)
-    if (!ret) do_node_read(search_info.first, search_info.second, key_str, key_str, true /* occ for not found case */);
+    if (!ret) {
+      // found through the hash index, the absent set needs the real leaf
+      if (!search_info.first)
+        btr.search_node(k, search_info);
+      do_miss_read(search_info, k, key_str);
+    }
 
     // if (ret) txn->insert_unexposed_read(txn->read_set.size() - 1);
 
@@ -98,15 +143,28 @@ bool mix_op<Transaction>::do_get(
   access_entry *e = txn->insert_read_set(tuple, dbtuple::MIN_TID, dbtuple::MIN_TID, txn->get_tid(), txn, occ, record_contention,
                                           tuple->version);
   tuple->chamcc_lock(lock_mode, nullptr);
-  bool result = tuple->ic3_read(value_reader, txn->string_allocator(), nullptr);
+  const uint8_t cgroups = cgroups_of_access(acc_id);
+  access_entry *de = tuple->get_dependent_entry(false /*indicate read action*/, cgroups);
+  bool result;
+  if (likely(cgroups == ALL_COLUMN_GROUPS)) {
+    result = tuple->ic3_read(value_reader, txn->string_allocator(), nullptr);
+  } else {
+    // the writers of other groups are passed over, their values are read
+    // from the last writer of ours (or the committed row)
+    access_entry *row_de = tuple->get_dependent_entry(false);
+    if (row_de && de != row_de && row_de->get_txn() != txn &&
+        !((Transaction *) row_de->get_txn())->is_commit(row_de->get_tid()))
+      ++transaction_base::g_evt_cgroup_skipped_deps;
+    result = tuple->ic3_read_from(value_reader, txn->string_allocator(), de);
+  }
 
   // update the clean tid of the tuple after mcs_lock on
   int index = txn->read_set.size() - 1;
   INVARIANT(index >= 0);
   txn->read_set[index].set_clean_tid(tuple->version);
+  txn->read_set[index].set_cgroups(cgroups, tuple->cgroups_stamp(cgroups));
 
   // set_dep_txn for dirty read
-  access_entry *de = tuple->get_dependent_entry(false /*indicate read action*/);
   if (likely(de && !txn->read_set[index].is_occ())) {
     Transaction *d_txn = (Transaction *) de->get_txn();
     uint64_t d_tid = de->get_tid();
@@ -142,6 +200,12 @@ bool mix_op<Transaction>::do_get(
      txn->insert_read_set(tuple, dbtuple::MIN_TID, dbtuple::MIN_TID, txn->get_tid(), txn, occ /*occ*/, record_contention, start_t);
      return true;
    }
+   // the reader rejected a record which did not change under it, that is
+   // no miss (see record_at())
+   if (unlikely(stat == dbtuple::ReadStatus::READ_FAILED)) {
+     const transaction_base::abort_reason r = transaction_base::ABORT_REASON_UNSTABLE_READ;
+     throw transaction_abort_exception(r);
+   }
    return false;
  }
 
@@ -149,6 +213,7 @@ bool mix_op<Transaction>::do_get(
  bool mix_op<Transaction>::do_node_read(const typename concurrent_btree::node_opaque_t *n,
                                                 uint64_t v, const std::string* lkey, const std::string* ukey, bool occ)
  {
+   INVARIANT(n);
    auto it = txn->absent_set.find(n);
 
    if(it == txn->absent_set.end()) {
@@ -185,6 +250,7 @@ bool mix_op<Transaction>::do_put(
   bool occ, lock_mode = true, is_insert = false;
   txn->update_txn_step(acc_id);
   auto pa = txn->refresh_policy(acc_id, OpUpdate);
+  txn->trace_access(btr, k->size(), acc_id, expect_new ? OpInsert : OpUpdate);
   if (unlikely(acc_id == MAX_ACC_ID || pg == nullptr || pa == nullptr)) {
      occ = true;
      lock_mode = true;
@@ -197,7 +263,8 @@ retry:
     // action inference w/ record contention knowledge (contention 0 for insert)
     record_contention = 0;
     // before access
-    txn->before_access_operation(pa);
+    if (!txn->before_access_operation(pa))
+      return false;
     concurrent_btree::node_opaque_t *node;
     auto ret = try_insert_new_tuple(btr, k, v, writer, occ, &node);
     px = ret.first;
@@ -224,14 +291,217 @@ retry:
     }
 
     px = reinterpret_cast<dbtuple *>(bv);
+    // the record is known only now, decide again if it could be hot
+    if (unlikely(hot_records::g_enabled) && pa)
+      pa = txn->refresh_policy(acc_id, OpUpdate, px);
+    txn->name_rec(px, btr, varkey(*k));
     // before access - record already exist
-    txn->before_access_operation(pa);
+    if (!txn->before_access_operation(pa))
+      return false;
     txn->insert_write_set(px, k, v, writer, &btr, false, nullptr, txn, occ, record_contention, txn->get_tid());
+    if (v)
+      txn->write_set.back().set_cgroups(cgroups_of_access(acc_id));
   }
   return true;
 }
 
 
+template <typename Transaction>
+const dbtuple *mix_op<Transaction>::batch_rec(
+  const concurrent_btree &btr,
+  dbtuple *const *tuples,
+  const std::string *const *key_strs,
+  size_t n)
+{
+  size_t rec = n;
+  for (size_t i = 0; i < n; i++) {
+    if (!tuples[i])
+      continue;
+    if (hot_records::IsHot(tuples[i])) {
+      rec = i;
+      break;
+    }
+    if (rec == n)
+      rec = i;
+  }
+  if (rec == n)
+    return nullptr;
+  txn->name_rec(tuples[rec], btr, varkey(*key_strs[rec]));
+  return tuples[rec];
+}
+
+template <typename Transaction>
+template <typename ReaderAt>
+size_t mix_op<Transaction>::do_multi_get(
+  concurrent_btree &btr,
+  const std::string *const *key_strs,
+  size_t n,
+  ReaderAt &reader_at,
+  bool *found,
+  uint32_t acc_id)
+{
+  INVARIANT(n <= MULTI_OP_BATCH);
+  dbtuple *tuples[MULTI_OP_BATCH];
+  concurrent_btree::versioned_node_t search_info[MULTI_OP_BATCH];
+
+  // all the descents at once (see concurrent_btree::multi_search()), then
+  // prefetch the tuples found so their misses overlap too
+  varkey keys[MULTI_OP_BATCH];
+  typename concurrent_btree::value_type vs[MULTI_OP_BATCH];
+  bool hit[MULTI_OP_BATCH];
+  for (size_t i = 0; i < n; i++)
+    keys[i] = varkey(*key_strs[i]);
+  btr.multi_search(keys, n, vs, search_info, hit);
+  for (size_t i = 0; i < n; i++) {
+    if (hit[i]) {
+      tuples[i] = reinterpret_cast<dbtuple *>(vs[i]);
+      tuples[i]->prefetch();
+    } else {
+      tuples[i] = nullptr;
+      do_node_read(search_info[i].first, search_info[i].second, key_strs[i], key_strs[i], true /* occ for not found case */);
+    }
+  }
+
+  // one policy decision and one wait for the whole batch
+  bool occ, lock_mode = true;
+  txn->update_txn_step(acc_id);
+  auto pa = txn->refresh_policy(acc_id, OpRead, batch_rec(btr, tuples, key_strs, n));
+  for (size_t i = 0; i < n; i++)
+    txn->trace_access(btr, key_strs[i]->size(), acc_id, OpRead);
+  if (unlikely(acc_id == MAX_ACC_ID || pg == nullptr || pa == nullptr))
+    occ = true;
+  else
+    occ = pa->access == no_detect;
+  if (!txn->before_access_operation(pa)) {
+    for (size_t i = 0; i < n; i++)
+      found[i] = false;
+    return 0;
+  }
+  ++transaction_base::g_evt_multi_op_batches;
+  transaction_base::g_evt_multi_op_keys += n;
+
+  size_t nfound = 0;
+  if (occ) {
+    for (size_t i = 0; i < n; i++) {
+      found[i] = false;
+      if (!tuples[i])
+        continue;
+      auto reader = reader_at(i);
+      found[i] = do_tuple_read(tuples[i], reader);
+      if (!found[i]) {
+        // see do_get()
+        if (!search_info[i].first)
+          btr.search_node(varkey(*key_strs[i]), search_info[i]);
+        do_node_read(search_info[i].first, search_info[i].second, key_strs[i], key_strs[i], true /* occ for not found case */);
+      }
+      nfound += found[i];
+    }
+    return nfound;
+  }
+
+  // dirty reads: lock the tuples in one pass in address order, like
+  // expose_uncommitted() does, so holding several at once cannot deadlock
+  uint16_t order[MULTI_OP_BATCH];
+  int index[MULTI_OP_BATCH];
+  size_t nlocked = 0;
+  for (size_t i = 0; i < n; i++) {
+    found[i] = false;
+    if (!tuples[i])
+      continue;
+    txn->insert_read_set(tuples[i], dbtuple::MIN_TID, dbtuple::MIN_TID, txn->get_tid(), txn, occ, 0,
+                         tuples[i]->version);
+    index[i] = txn->read_set.size() - 1;
+    order[nlocked++] = i;
+  }
+  std::sort(order, order + nlocked, [&tuples](uint16_t a, uint16_t b) {
+    return tuples[a] < tuples[b];
+  });
+  for (size_t j = 0; j < nlocked; j++)
+    if (!j || tuples[order[j]] != tuples[order[j - 1]])
+      tuples[order[j]]->chamcc_lock(lock_mode, nullptr);
+
+  for (size_t j = 0; j < nlocked; j++) {
+    const size_t i = order[j];
+    dbtuple *tuple = tuples[i];
+    auto reader = reader_at(i);
+    found[i] = tuple->ic3_read(reader, txn->string_allocator(), nullptr);
+    nfound += found[i];
+
+    // update the clean tid of the tuple after mcs_lock on
+    txn->read_set[index[i]].set_clean_tid(tuple->version);
+
+    // set_dep_txn for dirty read
+    access_entry *de = tuple->get_dependent_entry(false /*indicate read action*/);
+    if (likely(de && !txn->read_set[index[i]].is_occ())) {
+      Transaction *d_txn = (Transaction *) de->get_txn();
+      uint64_t d_tid = de->get_tid();
+
+      if (d_tid != txn->get_tid() && d_txn != txn) {
+        txn->read_set[index[i]].set_dependent(de->get_txn(), d_tid, de->get_write_seq());
+      }
+    }
+  }
+
+  for (size_t j = 0; j < nlocked; j++)
+    if (!j || tuples[order[j]] != tuples[order[j - 1]])
+      tuples[order[j]]->chamcc_unlock(lock_mode, nullptr);
+
+  return nfound;
+}
+
+template <typename Transaction>
+template <typename ValueWriter>
+bool mix_op<Transaction>::do_multi_put(
+  concurrent_btree &btr,
+  const std::string *const *key_strs,
+  void *const *val_strs,
+  size_t n,
+  ValueWriter &writer,
+  uint32_t acc_id)
+{
+  INVARIANT(n <= MULTI_OP_BATCH);
+  dbtuple *tuples[MULTI_OP_BATCH];
+
+  // see do_multi_get()
+  varkey keys[MULTI_OP_BATCH];
+  typename concurrent_btree::value_type vs[MULTI_OP_BATCH];
+  concurrent_btree::versioned_node_t search_info[MULTI_OP_BATCH];
+  bool hit[MULTI_OP_BATCH];
+  for (size_t i = 0; i < n; i++)
+    keys[i] = varkey(*key_strs[i]);
+  btr.multi_search(keys, n, vs, search_info, hit);
+  for (size_t i = 0; i < n; i++) {
+    tuples[i] = hit[i] ? reinterpret_cast<dbtuple *>(vs[i]) : nullptr;
+    if (tuples[i])
+      tuples[i]->prefetch();
+  }
+
+  bool occ;
+  txn->update_txn_step(acc_id);
+  auto pa = txn->refresh_policy(acc_id, OpUpdate, batch_rec(btr, tuples, key_strs, n));
+  if (unlikely(acc_id == MAX_ACC_ID || pg == nullptr || pa == nullptr))
+    occ = true;
+  else
+    occ = pa->access == no_detect;
+  // before access - for the records which already exist
+  if (!txn->before_access_operation(pa))
+    return false;
+  ++transaction_base::g_evt_multi_op_batches;
+  transaction_base::g_evt_multi_op_keys += n;
+
+  for (size_t i = 0; i < n; i++) {
+    if (unlikely(!tuples[i])) {
+      // absent keys take the regular insert path
+      if (!do_put(btr, key_strs[i], val_strs[i], writer, true, acc_id))
+        return false;
+      continue;
+    }
+    txn->trace_access(btr, key_strs[i]->size(), acc_id, OpUpdate);
+    txn->insert_write_set(tuples[i], key_strs[i], val_strs[i], writer, &btr, false, nullptr, txn, occ, 0, txn->get_tid());
+  }
+  return true;
+}
+
  template <typename Transaction>
  template <typename ValueWriter>
  std::pair< dbtuple *, bool >
@@ -324,7 +594,9 @@ bool mix_op<Transaction>::do_update(
   // action inference w/ record contention knowledge
   // record_contention = tuple->get_counter();
   txn->update_txn_step(acc_id);
-  auto pa = txn->refresh_policy(acc_id, OpUpdate);
+  auto pa = txn->refresh_policy(acc_id, OpUpdate, tuple);
+  txn->trace_access(btr, k->size(), acc_id, OpUpdate);
+  txn->name_rec(tuple, btr, varkey(*k));
   if (unlikely(acc_id == MAX_ACC_ID || pg == nullptr || pa == nullptr)) {
     occ = true;
     lock_mode = true;
@@ -332,7 +604,8 @@ bool mix_op<Transaction>::do_update(
     occ = pa->access == no_detect;
   }
   // before access 
-  txn->before_access_operation(pa);
+  if (!txn->before_access_operation(pa))
+    return false;
 
   if (occ) {
     // action: cleanRead & privateWrite
@@ -443,7 +716,11 @@ bool mix_op<Transaction>::do_expose_ic3_action(int pos, bool is_write, bool lock
       if (!d_txn->is_commit(d_tid)
           && d_tid != txn->get_tid()
           && d_txn != txn) {
-        txn->add_dep_txn(de->get_tid(), de->get_txn());
+        // a reader of other column groups than ours need not go first
+        if (de->is_write() || (de->cgroups & entry->cgroups))
+          txn->add_dep_txn(de->get_tid(), de->get_txn(), tuple);
+        else
+          ++transaction_base::g_evt_cgroup_skipped_deps;
       }
       de = de->next;
     }
@@ -455,14 +732,17 @@ bool mix_op<Transaction>::do_expose_ic3_action(int pos, bool is_write, bool lock
         return true;
     }
     
-    access_entry *de = tuple->get_dependent_entry(entry->is_write());
+    access_entry *de = tuple->get_dependent_entry(entry->is_write(), entry->cgroups);
 
     // begin: early valiation for read
     if (txn->read_set[pos].get_dep_txn() == nullptr) {
       // check things:
-      // a.version unchanged
-      // b.no write access entry exposed on access list
-      if (!tuple->is_latest_version(txn->read_set[pos].clean_tid()) || !tuple->check_no_write_entry(txn->get_tid()))
+      // a.version unchanged, or none of the column groups read written
+      // b.no write access entry of them exposed on access list
+      const bool latest = tuple->is_latest_version(txn->read_set[pos].clean_tid()) ||
+        (entry->cgroups != ALL_COLUMN_GROUPS && !entry->is_overwrite() &&
+         tuple->is_latest_cgroups(entry->cgroups, txn->read_set[pos].get_cg_stamp()));
+      if (!latest || !tuple->check_no_write_entry(txn->get_tid(), entry->cgroups))
         return false;
     } else {
       Transaction *read_dep_txn = (Transaction *) txn->read_set[pos].get_dep_txn();
@@ -504,7 +784,7 @@ bool mix_op<Transaction>::do_expose_ic3_action(int pos, bool is_write, bool lock
       if (!d_txn->is_commit(d_tid)
           && d_tid != txn->get_tid()
           && d_txn != txn) {
-        txn->add_dep_txn(de->get_tid(), de->get_txn(), true/*dirty_read_dep*/);
+        txn->add_dep_txn(de->get_tid(), de->get_txn(), tuple, true/*dirty_read_dep*/);
       }
     }
   }
@@ -527,7 +807,7 @@ bool mix_op<Transaction>::do_expose_ic3_action(int pos, bool is_write, bool lock
         && is_conflict
         && d_tid != txn->get_tid()
         && d_txn != txn) {
-          txn->add_dep_txn(d_tid, (void *)d_txn); 
+          txn->add_dep_txn(d_tid, (void *)d_txn, nullptr); 
       }
     }
   }
@@ -863,7 +1143,7 @@ bool atomic_one_op<Transaction>::commit_piece()
       if(!d_txn->is_commit(d_tid) 
         && d_tid != txn->get_tid()
         && d_txn != txn) {
-        txn->add_dep_txn(de->get_tid(), de->get_txn()); 
+        txn->add_dep_txn(de->get_tid(), de->get_txn(), tuple); 
       }
     }
 
@@ -1382,7 +1662,7 @@ bool atomic_mul_ops<Transaction>::commit_piece()
       if(!d_txn->is_commit(d_tid) 
         && d_tid != txn->get_tid()
         && d_txn != txn) {
-        txn->add_dep_txn(de->get_tid(), de->get_txn()); 
+        txn->add_dep_txn(de->get_tid(), de->get_txn(), tuple); 
       }
     }
 
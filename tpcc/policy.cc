@@ -2,7 +2,9 @@
 #include <fstream>
 #include <iostream>
 #include <regex>
+#include <sstream>
 
+#include "conflict_graph.h"
 #include "macros.h"
 #include "policy.h"
 #include "learn.h"
@@ -11,31 +13,169 @@
 
 PolicyAction before_commit_policy = PolicyAction(detect_all, highest_priority, 0, blocked_wait);
 
-void Policy::print_policy(const std::string &bench) const {
+template <> uint32_t workload_chopping<tpcc_workload>::txn_access_num[] = { 0 /*just a placeholder*/, 11, 7, 8};
+template <> uint32_t workload_chopping<tpcc_workload>::base_access_num[] = {0, 0, 11, 18};
+template <> bool workload_chopping<tpcc_workload>::can_guard[]  = {0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0};
+template <> bool workload_chopping<tpcc_workload>::can_expose[] = {1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 1, 1, 0, 1};
+template <> uint32_t workload_chopping<ycsb_workload>::txn_access_num[] = { 0 /*just a placeholder*/, 16};
+template <> uint32_t workload_chopping<ycsb_workload>::base_access_num[] = {0, 0};
+template <> bool workload_chopping<ycsb_workload>::can_expose[] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+
+static bool profile_loaded = false;
+static std::vector<std::pair<uint32_t, uint32_t>> profile_conflicts; // access ids
+static std::vector<std::pair<uint32_t, commutative_kind>> profile_commutative; // access ids
+
+template <typename T>
+static void
+read_profile_array(std::istringstream &in, T *arr, size_t n, const std::string &what)
+{
+  for (size_t i = 0; i < n; i++) {
+    uint64_t v;
+    if (!(in >> v)) {
+      std::cerr << "access profile: " << what << " needs " << n << " values" << std::endl;
+      ALWAYS_ASSERT(false);
+    }
+    arr[i] = T(v);
+  }
+}
+
+void load_access_profile(const std::string &file) {
+  std::ifstream prof(file);
+  if (!prof.is_open()) {
+    std::cerr << "Could not open access profile: " << file << std::endl;
+    ALWAYS_ASSERT(false);
+  }
+  memset(txn_guard, 0, sizeof txn_guard);
+  profile_conflicts.clear();
+  profile_commutative.clear();
+  std::string line;
+  while (std::getline(prof, line)) {
+    std::istringstream in(line);
+    std::string key;
+    if (!(in >> key) || key[0] == '#')
+      continue;
+    if (key == "txn_types" || key == "accesses") {
+      uint32_t v = 0;
+      in >> v;
+      if (v != (key == "txn_types" ? TXN_TYPE : ACCESSES)) {
+        std::cerr << "access profile: " << key << " " << v
+                  << " does not match the compiled workload" << std::endl;
+        ALWAYS_ASSERT(false);
+      }
+    } else if (key == "txn_access_num") {
+      read_profile_array(in, txn_access_num + 1, TXN_TYPE, key);
+      REP(t, 1, TXN_TYPE + 1) ALWAYS_ASSERT(txn_access_num[t] <= MAX_TXN_ACCESSES);
+    } else if (key == "base_access_num") {
+      read_profile_array(in, base_access_num + 1, TXN_TYPE, key);
+    } else if (key == "can_expose") {
+      read_profile_array(in, can_expose, ACCESSES, key);
+    } else if (key == "guard") {
+      uint32_t g[4];
+      read_profile_array(in, g, 4, key);
+      ALWAYS_ASSERT(g[0] >= 1 && g[0] <= TXN_TYPE && g[1] >= 1 && g[1] <= TXN_TYPE);
+      ALWAYS_ASSERT(g[2] < MAX_TXN_ACCESSES);
+      txn_guard[g[0] - 1][g[2]][g[1] - 1] = g[3];
+    } else if (key == "conflict") {
+      uint32_t c[2];
+      read_profile_array(in, c, 2, key);
+      ALWAYS_ASSERT(c[0] < ACCESSES && c[1] < ACCESSES);
+      profile_conflicts.emplace_back(c[0], c[1]);
+    } else if (key == "commutative") {
+      uint32_t c;
+      read_profile_array(in, &c, 1, key);
+      ALWAYS_ASSERT(c < ACCESSES);
+      std::string name;
+      const commutative_kind k =
+        in >> name ? commutative_kind_from_name(name.c_str()) : CommutativeNone;
+      if (k == CommutativeNone) {
+        std::cerr << "access profile: commutative " << c
+                  << " needs the operator kind" << std::endl;
+        ALWAYS_ASSERT(false);
+      }
+      profile_commutative.emplace_back(c, k);
+    } else {
+      std::cerr << "access profile: unknown entry " << key << std::endl;
+      ALWAYS_ASSERT(false);
+    }
+  }
+  REP(t, 1, TXN_TYPE + 1)
+    ALWAYS_ASSERT(base_access_num[t] + txn_access_num[t] <= ACCESSES);
+  profile_loaded = true;
+}
+
+// the txn type owning access acc_id, and its step in there
+static std::pair<uint8_t, uint32_t>
+profile_step(uint32_t acc_id)
+{
+  REP(t, 1, TXN_TYPE + 1)
+    if (acc_id >= base_access_num[t] && acc_id < base_access_num[t] + txn_access_num[t])
+      return std::make_pair(uint8_t(t), acc_id - base_access_num[t] + 1);
+  std::cerr << "access profile: conflict on access " << acc_id
+            << " of no txn type" << std::endl;
+  ALWAYS_ASSERT(false);
+  return std::make_pair(uint8_t(0), 0u);
+}
+
+conflict_graph *profile_conflict_graph() {
+  if (!profile_loaded)
+    return nullptr;
+  conflict_graph *g = new conflict_graph(TXN_TYPE);
+  REP(t, 1, TXN_TYPE + 1)
+    g->init_txn(t, txn_access_num[t]);
+  // before the edges, set_conflict() drops those between commutative steps
+  for (auto &c : profile_commutative) {
+    auto s = profile_step(c.first);
+    g->set_commutative(s.first, s.second, c.second);
+  }
+  // a step keeps one conflicting step per other type, so add the edges in
+  // order and each keeps the last one (what a txn has to wait for)
+  std::vector<std::pair<std::pair<uint8_t, uint32_t>, std::pair<uint8_t, uint32_t>>> edges;
+  for (auto &c : profile_conflicts) {
+    auto a = profile_step(c.first), b = profile_step(c.second);
+    // every step already conflicts with itself in another instance, and
+    // a chopped_tx has no edges between two of its own steps
+    if (a.first == b.first)
+      continue;
+    if (b < a)
+      std::swap(a, b);
+    edges.emplace_back(a, b);
+  }
+  std::sort(edges.begin(), edges.end());
+  for (auto &e : edges)
+    g->set_conflict(e.first.first, e.first.second, e.second.first, e.second.second);
+  g->freeze();
+  return g;
+}
+
+template <typename Workload>
+void basic_policy<Workload>::print_policy(const std::string &bench) const {
   printf("Profile: the policy\n"
          "<--------------------------------------->\n");
+  printf("%d states, %d pages of %d set\n", int(policy.capacity()),
+         int(policy.npages()), int(policy_table<action_type>::PageSize));
   if (bench == "tpcc") {
     printf("\naccess\n");
-    REP(j, 0, global_encoder.max_state) printf("%d,", policy[j].access);
+    REP(j, 0, encoder->max_state) printf("%d,", policy.lookup(j)->access);
     printf("\npriority\n");
-    REP(j, 0, global_encoder.max_state) printf("%.2f,", policy[j].rank);
+    REP(j, 0, encoder->max_state) printf("%.2f,", policy.lookup(j)->rank);
     printf("\ntimeout\n");
-    REP(j, 0, global_encoder.max_state) printf("%d,", policy[j].timeout);
+    REP(j, 0, encoder->max_state) printf("%d,", policy.lookup(j)->timeout);
     printf("\nexpose\n");
-    REP(j, 0, global_encoder.max_state) printf("%d,", policy[j].expose);
+    REP(j, 0, encoder->max_state) printf("%d,", policy.lookup(j)->expose);
     printf("\nexpose\n");
-    REP(j, 0, global_encoder.max_state) printf("%d,", policy[j].expose);
+    REP(j, 0, encoder->max_state) printf("%d,", policy.lookup(j)->expose);
     printf("access type\n");
-    REP(i, 0, global_encoder.max_state) {
-      if (policy[i].access == no_detect || policy[i].access == detect_track_dirty) {
-        printf("%s\t%s\t\t%d (ns)\n", policy[i].access == no_detect? "NO DE":"DIRTY",
-               policy[i].expose? "EXPO":"HIDE", policy[i].timeout);
-      } else if (policy[i].access == detect_all)
-        printf("ALL\t%s\t\t%d (ns)\n", policy[i].expose? "EXPO":"HIDE", policy[i].timeout);
+    REP(i, 0, encoder->max_state) {
+      const action_type &a = *policy.lookup(i);
+      if (a.access == no_detect || a.access == detect_track_dirty) {
+        printf("%s\t%s\t\t%d (ns)\n", a.access == no_detect? "NO DE":"DIRTY",
+               a.expose? "EXPO":"HIDE", a.timeout);
+      } else if (a.access == detect_all)
+        printf("ALL\t%s\t\t%d (ns)\n", a.expose? "EXPO":"HIDE", a.timeout);
       else {
-        printf("GUARD\t%s\t(%d %d %d)\t%d (ns)\n", policy[i].expose? "EXPO":"HIDE",
-               policy[i].safeguard[0], policy[i].safeguard[1], policy[i].safeguard[2],
-               policy[i].timeout);
+        printf("GUARD\t%s\t(", a.expose? "EXPO":"HIDE");
+        REP(t, 0, Workload::txn_types) printf(t ? " %d" : "%d", a.safeguard[t]);
+        printf(")\t%d (ns)\n", a.timeout);
       }
     }
   } else if (bench == "ycsb") {
@@ -44,24 +184,26 @@ void Policy::print_policy(const std::string &bench) const {
   printf("<--------------------------------------->\n");
 }
 
-void Policy::init_occ() {
-  REP(state, 0, MAX_STATE)
-  policy[state] = PolicyAction(no_detect, lowest_priority, false, blocked_wait);
+template <typename Workload>
+void basic_policy<Workload>::init_occ() {
+  policy.reset(action_type(no_detect, lowest_priority, false, blocked_wait));
 }
 
-void Policy::init_2pl() {
-  REP(state, 0, MAX_STATE)
-  policy[state] = PolicyAction(detect_all, lowest_priority, false, blocked_wait);
+template <typename Workload>
+void basic_policy<Workload>::init_2pl() {
+  policy.reset(action_type(detect_all, lowest_priority, false, blocked_wait));
 }
 
-void Policy::init_pipeline_execution() {
-  REP(state, 0, MAX_STATE)
-  policy[state] = PolicyAction(detect_track_dirty, lowest_priority, true, blocked_wait);
+template <typename Workload>
+void basic_policy<Workload>::init_pipeline_execution() {
+  policy.reset(action_type(detect_track_dirty, lowest_priority, true, blocked_wait));
 }
 
 
-Policy::Policy() {
-  policy = new PolicyAction [MAX_STATE];
+template <typename Workload>
+basic_policy<Workload>::basic_policy(const contention_encoder *enc)
+  : encoder(enc) {
+  policy.reserve(std::max(MAX_STATE, encoder->max_state));
   init_occ();
 }
 
@@ -73,7 +215,139 @@ std::vector<float> parseFloatString(const std::string& str) {
   return result;
 }
 
-void Policy::init(std::ifstream *pol_file) {
+// The binary policy format (see basic_policy::save()), in host byte order:
+//   policy_file_header
+//   double backoff[2][RETRY_TIMES][txn_types + 1]
+//   the default action, then the nactions actions of the states set, each
+//   a policy_file_action followed by uint32_t safeguard[txn_types]
+// Bump policy_file_version with any change to it.
+static const char policy_file_magic[8] = {'C', 'C', 'P', 'O', 'L', 'I', 'C', 'Y'};
+static const uint32_t policy_file_version = 1;
+
+struct policy_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t txn_types;
+  char workload[16];
+  uint64_t encoder_hash; // contention_encoder::hash()
+  uint32_t max_state;
+  uint32_t nactions;
+  uint32_t txn_buf_size;
+  uint32_t reserved;
+};
+
+struct policy_file_action {
+  uint32_t state;
+  uint8_t access;
+  uint8_t expose;
+  uint16_t reserved;
+  float rank;
+  uint32_t timeout;
+};
+
+static_assert(sizeof(policy_file_header) == 56, "policy file layout changed");
+static_assert(sizeof(policy_file_action) == 16, "policy file layout changed");
+
+template <typename Workload>
+void basic_policy<Workload>::save(const std::string &policy_f) const {
+  std::vector<uint32_t> states;
+  REP(state, 0, encoder->max_state)
+    if (policy.is_set(state) && !policy.lookup(state)->same_as(policy.default_action()))
+      states.push_back(state);
+
+  policy_file_header h;
+  memset(&h, 0, sizeof h);
+  memcpy(h.magic, policy_file_magic, sizeof h.magic);
+  h.version = policy_file_version;
+  h.txn_types = Workload::txn_types;
+  strncpy(h.workload, Workload::name(), sizeof h.workload - 1);
+  h.encoder_hash = encoder->hash();
+  h.max_state = encoder->max_state;
+  h.nactions = states.size();
+  h.txn_buf_size = txn_buf_size;
+
+  std::string buf((const char *) &h, sizeof h);
+  buf.append((const char *) backoff, sizeof backoff);
+  auto append_action = [&buf](uint32_t state, const action_type &a) {
+    policy_file_action fa;
+    memset(&fa, 0, sizeof fa);
+    fa.state = state;
+    fa.access = a.access;
+    fa.expose = a.expose;
+    fa.rank = a.rank;
+    fa.timeout = a.timeout;
+    buf.append((const char *) &fa, sizeof fa);
+    buf.append((const char *) a.safeguard, sizeof a.safeguard);
+  };
+  append_action(0, policy.default_action());
+  for (uint32_t state : states)
+    append_action(state, *policy.lookup(state));
+
+  std::ofstream out(policy_f, std::ios::binary | std::ios::trunc);
+  if (!out.write(buf.data(), buf.size())) {
+    std::cerr << "Could not write policy file: " << policy_f << std::endl;
+    ALWAYS_ASSERT(false);
+  }
+}
+
+template <typename Workload>
+void basic_policy<Workload>::load_binary(const std::string &policy_f) {
+  auto fail = [&policy_f](const std::string &why) {
+    std::cerr << "policy file " << policy_f << ": " << why << std::endl;
+    ALWAYS_ASSERT(false);
+  };
+
+  // all of it in one read
+  std::ifstream in(policy_f, std::ios::binary | std::ios::ate);
+  const std::streamoff size = in.tellg();
+  if (!in.is_open() || size < std::streamoff(sizeof(policy_file_header)))
+    fail("too short");
+  std::string buf(size, '\0');
+  in.seekg(0);
+  if (!in.read(&buf[0], size))
+    fail("could not be read");
+
+  policy_file_header h;
+  memcpy(&h, buf.data(), sizeof h);
+  if (memcmp(h.magic, policy_file_magic, sizeof h.magic))
+    fail("not a binary policy");
+  if (h.version != policy_file_version)
+    fail("layout version " + std::to_string(h.version) + ", expected " +
+         std::to_string(policy_file_version));
+  h.workload[sizeof h.workload - 1] = '\0';
+  if (strcmp(h.workload, Workload::name()) || h.txn_types != Workload::txn_types)
+    fail(std::string("policy of workload ") + h.workload + ", expected " + Workload::name());
+  if (h.encoder_hash != encoder->hash() || h.max_state != uint32_t(encoder->max_state))
+    fail("policy of another encoder (" + std::to_string(h.max_state) +
+         " states), the encoder loaded has " + std::to_string(encoder->max_state));
+  if (h.txn_buf_size < 1 || h.txn_buf_size > MAX_TXN_BUF_SIZE)
+    fail("txn_buf_size " + std::to_string(h.txn_buf_size) + " out of 1.." +
+         std::to_string(MAX_TXN_BUF_SIZE));
+  const size_t action_size = sizeof(policy_file_action) + sizeof(uint32_t) * Workload::txn_types;
+  if (size_t(size) != sizeof h + sizeof backoff + (h.nactions + 1) * action_size)
+    fail("truncated or corrupt");
+
+  const char *p = buf.data() + sizeof h;
+  memcpy(backoff, p, sizeof backoff);
+  p += sizeof backoff;
+  txn_buf_size = h.txn_buf_size;
+  REP(i, 0, int(h.nactions) + 1) {
+    policy_file_action fa;
+    memcpy(&fa, p, sizeof fa);
+    if (fa.access > predict || (i && fa.state >= h.max_state))
+      fail("corrupt action " + std::to_string(i));
+    action_type a(AccessPolicy(fa.access), fa.rank, fa.expose, fa.timeout);
+    memcpy(a.safeguard, p + sizeof fa, sizeof a.safeguard);
+    p += action_size;
+    if (!i)
+      policy.reset(a);
+    else
+      policy.at(fa.state) = a;
+  }
+}
+
+template <typename Workload>
+void basic_policy<Workload>::init(std::ifstream *pol_file) {
   std::string not_using;
   std::string access_policy_str;
   std::string rank_str;
@@ -95,57 +369,80 @@ void Policy::init(std::ifstream *pol_file) {
   std::getline(*pol_file, extra_str);
   int s;
 
-  std::vector<AccessPolicy> access_vec;
-  access_vec.resize(MAX_STATE);
-  std::transform(access_policy_str.begin(), access_policy_str.end(), access_vec.begin(),
-                 [](char ac) -> AccessPolicy {
-                   if (ac == '0') return no_detect;
-                   else if (ac == '1') return detect_guarded;
-                   else if (ac == '2') return detect_guarded;
-                   else if (ac == '3') return detect_all;
-                   else ALWAYS_ASSERT(false);
-                 });
-  s = 0;
-  for (auto it:access_vec) policy[s++].access = it;
   std::vector<WaitPriority> rank_vec = parseFloatString(rank_str);
-  s = 0;
-  for (auto it:rank_vec) policy[s++].rank = it;
   std::vector<float> timeout_vec = parseFloatString(timeout_str);
+  std::vector<float> wait_chop = parseFloatString(wait_chop_str);
+  int n = encoder->max_state;
+  // a policy for another encoder would index past its states
+  auto check_states = [n](const char *what, size_t nstates) {
+    if (nstates > size_t(n)) {
+      std::cerr << "policy file: " << what << " has " << nstates
+                << " states, the encoder loaded " << n << std::endl;
+      ALWAYS_ASSERT(false);
+    }
+  };
+  check_states("conflict detection", access_policy_str.size());
+  check_states("wait priorities", rank_vec.size());
+  check_states("timeout", timeout_vec.size());
+  check_states("expose", expose_str.size());
+  if (wait_chop.size() != size_t(n) * Workload::txn_types) {
+    std::cerr << "policy file: chop wait has " << wait_chop.size()
+              << " values, expected " << n * Workload::txn_types << std::endl;
+    ALWAYS_ASSERT(false);
+  }
+
+  // the file sets the states it lists, the others keep the default action
+  // and take no memory (see compact() below)
+  init_occ();
   s = 0;
-  for (auto it:timeout_vec) policy[s++].timeout = static_cast<uint32_t>(it);
-
-  std::vector<bool> expose_vec;
-  expose_vec.resize(MAX_STATE);
-  std::transform(expose_str.begin(), expose_str.end(), expose_vec.begin(),
-                 [](char ac) -> bool {
-                   if (ac == '0') return false;
-                   else if (ac == '1') return true;
-                   else ALWAYS_ASSERT(false);
-                 });
+  for (char ac : access_policy_str) {
+    AccessPolicy a;
+    if (ac == '0') a = no_detect;
+    else if (ac == '1') a = detect_guarded;
+    else if (ac == '2') a = detect_guarded;
+    else if (ac == '3') a = detect_all;
+    else ALWAYS_ASSERT(false);
+    policy.at(s++).access = a;
+  }
   s = 0;
-  for (auto it:expose_vec) policy[s++].expose = it;
-  std::vector<float> wait_chop = parseFloatString(wait_chop_str);
-  int n = global_encoder.max_state;
-  for (int i=0;i<TXN_TYPE;i ++) {
+  for (auto it:rank_vec) policy.at(s++).rank = it;
+  s = 0;
+  for (auto it:timeout_vec) policy.at(s++).timeout = static_cast<uint32_t>(it);
+
+  s = 0;
+  for (char ac : expose_str) {
+    if (ac == '0') policy.at(s++).expose = false;
+    else if (ac == '1') policy.at(s++).expose = true;
+    else ALWAYS_ASSERT(false);
+  }
+  for (int i=0;i<Workload::txn_types;i ++) {
     for (int j=0;j<n;j++) {
-      policy[j].safeguard[i] = uint32_t(wait_chop[j + n*i]);
+      policy.at(j).safeguard[i] = uint32_t(wait_chop[j + n*i]);
     }
   }
+  policy.compact();
 
   std::vector<float> extra_learn = parseFloatString(extra_str);
   auto it = extra_learn.begin();
+  if (extra_learn.empty() || *it < 1 || *it > MAX_TXN_BUF_SIZE) {
+    std::cerr << "policy file: txn_buf_size out of 1.." << MAX_TXN_BUF_SIZE << std::endl;
+    ALWAYS_ASSERT(false);
+  }
   txn_buf_size = uint32_t (*it);
   for (int op = 0; op < 2; op ++) {
     for (int i = 0; i < RETRY_TIMES; ++i) {
       backoff[op][i][0] = 0.0;
       it ++;
-      for (int j = 0; j < TXN_TYPE; j ++) backoff[op][i][j] = *it;
+      for (int j = 0; j < Workload::txn_types; j ++) backoff[op][i][j] = *it;
     }
   }
   assert(it == extra_learn.end());
 }
 
-void Policy::policy_gradient(const std::string &policy_f) {
+template <typename Workload>
+void basic_policy<Workload>::policy_gradient(const std::string &policy_f) {
+  // the encoder may have been loaded after the policy was made
+  policy.reserve(encoder->max_state);
   if (policy_f == "2pl") {
     init_2pl();
   } else if (policy_f == "pipe") {
@@ -159,10 +456,25 @@ void Policy::policy_gradient(const std::string &policy_f) {
                 << std::endl;
       ALWAYS_ASSERT(false);
     }
+    char magic[sizeof policy_file_magic];
+    if (pol_file.read(magic, sizeof magic) &&
+        !memcmp(magic, policy_file_magic, sizeof magic)) {
+      pol_file.close();
+      load_binary(policy_f);
+      return;
+    }
+    pol_file.clear();
+    pol_file.seekg(0);
     init(&pol_file);
   }
 }
 
-Policy::~Policy() {
-  delete[] policy;
-}
\ No newline at end of file
+template <typename Workload>
+basic_policy<Workload>::~basic_policy() {
+}
+
+template class basic_policy<tpcc_workload>;
+template class basic_policy<ycsb_workload>;
+template class basic_policy<tpce_workload>;
+template class basic_policy<smallbank_workload>;
+
@@ -2,6 +2,9 @@
 #define POLICY_H_
 
 #include <cmath>
+#include <limits>
+#include <new>
+#include <stdlib.h>
 #include <map>
 #include <string>
 #include <vector>
@@ -24,37 +27,156 @@
 #define ENCODER_TX_BLOCKING   4
 #define ENCODER_TX_N_BLOCKED  5
 
-#define ENCODER_N_FEATURES    6
+// Record features: whether the record accessed is hot (see hot_records.h).
+#define ENCODER_REC_HOT       6
+
+#define ENCODER_N_FEATURES    7
 
 /************************************************/
 // Workload helper
 /************************************************/
 #define MAX_ACC_ID std::numeric_limits<uint32_t>::max()
-// type1: neworder, type2: payment, type3: delivery
+
+// Workload descriptors: the compile-time shape of a workload's policy table.
+// Policy tables (basic_policy), encoders and the static chopping
+// (workload_chopping) are sized by one, so a process can hold the tables of
+// several workloads side by side, each with the exact sizes of its own. The
+// engine itself runs the one it is built for, default_workload.
+struct tpcc_workload {
+  // type1: neworder, type2: payment, type3: delivery
+  enum { txn_types = 3, accesses = 26, max_txn_accesses = 11 };
+  static inline const char *name() { return "tpcc"; }
+  static inline const int32_t *encoder_feature_cap() {
+    static const int32_t cap[ENCODER_N_FEATURES] = {1, 3, 26, 16, 16, 16, 2};
+    return cap;
+  }
+};
+
+struct ycsb_workload {
+  enum { txn_types = 1, accesses = 20, max_txn_accesses = 16 };
+  static inline const char *name() { return "ycsb"; }
+  static inline const int32_t *encoder_feature_cap() {
+    static const int32_t cap[ENCODER_N_FEATURES] = {1, 5, 16, 16, 16, 16, 2};
+    return cap;
+  }
+};
+
+struct tpce_workload {
+  enum { txn_types = 4, accesses = 105, max_txn_accesses = 48 };
+  static inline const char *name() { return "tpce"; }
+  static inline const int32_t *encoder_feature_cap() {
+    static const int32_t cap[ENCODER_N_FEATURES] = {1, 5, 105, 16, 16, 16, 2};
+    return cap;
+  }
+};
+
+struct smallbank_workload {
+  // every txn is a single piece (see init_bank_cgraph())
+  enum { txn_types = 5, accesses = 5, max_txn_accesses = 1 };
+  static inline const char *name() { return "smallbank"; }
+  static inline const int32_t *encoder_feature_cap() {
+    static const int32_t cap[ENCODER_N_FEATURES] = {1, 3, 5, 16, 16, 16, 2};
+    return cap;
+  }
+};
+
+// the workload the engine (txn, learn) is built for
 #if WORKLOAD_TYPE == WL_TPCC
-#define TXN_TYPE 3
-#define ACCESSES 26
-const uint32_t txn_access_num[] = { 0 /*just a placeholder*/, 11, 7, 8};
-const uint32_t base_access_num[] = {0, 0, 11, 18};
-const bool can_guard[]  = {0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0};
-const bool can_expose[] = {1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 1, 1, 0, 1};
-const int32_t encoder_feature_cap[ENCODER_N_FEATURES] = {1, 3, 26, 16, 16, 16};
-// the guard needed to avoid triggering cycle.
-extern uint32_t txn_guard[TXN_TYPE][TXN_TYPE][11];
+typedef tpcc_workload default_workload;
 #elif WORKLOAD_TYPE == WL_YCSB
-#define TXN_TYPE 1
-#define ACCESSES 20
-const uint32_t txn_access_num[] = { 0 /*just a placeholder*/, 16};
-const uint32_t base_access_num[] = {0, 0};
-const bool can_expose[] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
-const int32_t encoder_feature_cap[ENCODER_N_FEATURES] = {1, 5, 16, 16, 16, 16};
+typedef ycsb_workload default_workload;
 #endif
+#define TXN_TYPE default_workload::txn_types
+#define ACCESSES default_workload::accesses
+#define MAX_TXN_ACCESSES default_workload::max_txn_accesses
+
+// The static chopping of a workload, sized by its descriptor. Defaults to
+// the hand analysis in policy.cc (all zero for workloads without one), or is
+// replaced at startup by load_access_profile() with the one derived from an
+// access trace (see access_trace.h and benchmarks/derive_chopping.cc).
+template <typename Workload>
+struct workload_chopping {
+  enum { txn_types = Workload::txn_types, accesses = Workload::accesses,
+         max_txn_accesses = Workload::max_txn_accesses };
+
+  static uint32_t txn_access_num[txn_types + 1]; // [0] is just a placeholder
+  static uint32_t base_access_num[txn_types + 1];
+  static bool can_guard[accesses];
+  static bool can_expose[accesses];
+  // the guard needed to avoid triggering cycle: before its i-th access, a
+  // txn of type t1 waits until a txn of type t2 it depends on has passed
+  // step txn_guard[t1 - 1][i][t2 - 1] (0: no wait needed). all 0 unless a
+  // profile gave guards, transaction::before_access_operation() makes a
+  // detect_guarded wait at least that long
+  static uint32_t txn_guard[txn_types][max_txn_accesses][txn_types];
+
+  // The column groups each access touches (bit g: column group g of the row
+  // it accesses), 0 for the whole row. Accesses only conflict if they share
+  // a group, see dbtuple::get_dependent_entry(). A read of a row the txn
+  // then overwrites should keep the whole row, its write carries every
+  // group. Zero unless the workload declares them, load_access_profile()
+  // leaves them alone.
+  static uint8_t access_cgroups[accesses];
+};
+
+template <typename Workload>
+uint32_t workload_chopping<Workload>::txn_access_num[txn_types + 1] = {};
+template <typename Workload>
+uint32_t workload_chopping<Workload>::base_access_num[txn_types + 1] = {};
+template <typename Workload>
+bool workload_chopping<Workload>::can_guard[accesses] = {};
+template <typename Workload>
+bool workload_chopping<Workload>::can_expose[accesses] = {};
+template <typename Workload>
+uint32_t workload_chopping<Workload>::txn_guard[txn_types][max_txn_accesses][txn_types] = {};
+template <typename Workload>
+uint8_t workload_chopping<Workload>::access_cgroups[accesses] = {};
+
+// the hand analysis, see policy.cc
+template <> uint32_t workload_chopping<tpcc_workload>::txn_access_num[];
+template <> uint32_t workload_chopping<tpcc_workload>::base_access_num[];
+template <> bool workload_chopping<tpcc_workload>::can_guard[];
+template <> bool workload_chopping<tpcc_workload>::can_expose[];
+template <> uint32_t workload_chopping<ycsb_workload>::txn_access_num[];
+template <> uint32_t workload_chopping<ycsb_workload>::base_access_num[];
+template <> bool workload_chopping<ycsb_workload>::can_expose[];
+
+// the chopping the engine runs with, that of default_workload
+typedef workload_chopping<default_workload> default_chopping;
+static uint32_t (&txn_access_num)[TXN_TYPE + 1] = default_chopping::txn_access_num;
+static uint32_t (&base_access_num)[TXN_TYPE + 1] = default_chopping::base_access_num;
+static bool (&can_guard)[ACCESSES] = default_chopping::can_guard;
+static bool (&can_expose)[ACCESSES] = default_chopping::can_expose;
+static uint32_t (&txn_guard)[TXN_TYPE][MAX_TXN_ACCESSES][TXN_TYPE] = default_chopping::txn_guard;
+static uint8_t (&access_cgroups)[ACCESSES] = default_chopping::access_cgroups;
+
+inline uint8_t
+cgroups_of_access(uint32_t acc_id)
+{
+  if (acc_id == MAX_ACC_ID || acc_id >= ACCESSES || !access_cgroups[acc_id])
+    return ALL_COLUMN_GROUPS;
+  return access_cgroups[acc_id];
+}
+
+// Loads a profile written by derive_chopping, it must match the compiled
+// TXN_TYPE and ACCESSES.
+void load_access_profile(const std::string &file);
+
+class conflict_graph;
+
+// The conflict graph of the loaded profile (its conflict and commutative
+// lines) over the accesses of each txn type, step i being the i-th access of
+// the type as in transaction::update_txn_step(). nullptr if no profile was loaded, the
+// benchmark then builds its own. The caller owns the (frozen) graph.
+conflict_graph *profile_conflict_graph();
 
 /************************************************/
 // Learning helper
 /************************************************/
 // We encode the dependency graph by embedding its key features into a 0/1 vector.
 // The lower EVENT_BITS bits capture the feature of each transaction itself, the rest GRAPH_BITS capture graphic features.
+// A policy covers at least MAX_STATE states, more if its encoder has more
+// (see policy_table).
 #define MAX_STATE 3000
 
 // Optimization 1: if there is no dependency related to the current transaction, there is no reason for us to trigger abort.
@@ -108,11 +230,12 @@ typedef std::pair<AgentDecision, double> backoff_action;
 #define TX_OTHERS 5                 // aborted due to other reasons.
 
 // PolicyAction contains the basic unit of policy.
-struct PolicyAction {
+template <typename Workload>
+struct basic_policy_action {
   AccessPolicy access;    // control conflict detection.
   bool expose;            // shall we expose current data version.
-  uint32_t safeguard[TXN_TYPE];
-  uint32_t expose_safeguard[TXN_TYPE];
+  uint32_t safeguard[Workload::txn_types];
+  uint32_t expose_safeguard[Workload::txn_types];
   WaitPriority rank;
 
   // we shall make the expose of current write as close as possible with the next op to avoid depend cycle.
@@ -125,10 +248,11 @@ struct PolicyAction {
 #endif
   CACHE_PADOUT;
 
-  PolicyAction() {
+  basic_policy_action() {
     access = detect_all;
     expose = false;
     memset(safeguard, 0, sizeof safeguard);
+    memset(expose_safeguard, 0, sizeof expose_safeguard);
     rank = lowest_priority;
     expose_rank = lowest_priority;
     expose_access = detect_all;
@@ -138,10 +262,10 @@ struct PolicyAction {
 #endif
   }
 
-  void copy(PolicyAction *act) {
+  void copy(basic_policy_action *act) {
     access = act->access;
     expose = act->expose;
-    for (int i=0;i<TXN_TYPE;i++) safeguard[i] = act->safeguard[i];
+    for (int i=0;i<Workload::txn_types;i++) safeguard[i] = act->safeguard[i];
     rank = act->rank;
     expose_rank = act->expose_rank;
     expose_access = act->expose_access;
@@ -151,10 +275,12 @@ struct PolicyAction {
 #endif
   }
 
-  PolicyAction(AccessPolicy c_detect, double c_rank, bool c_expose, uint32_t c_resolve_tl) {
+  basic_policy_action(AccessPolicy c_detect, double c_rank, bool c_expose, uint32_t c_resolve_tl) {
     access = c_detect;
     rank = c_rank;
     expose = c_expose;
+    memset(safeguard, 0, sizeof safeguard);
+    memset(expose_safeguard, 0, sizeof expose_safeguard);
     // By default, we assume the operation will commit and
     // thus take the highest priority to minimize potential conflicts.
     expose_rank = highest_priority;
@@ -164,40 +290,207 @@ struct PolicyAction {
     expose_timeout = c_resolve_tl;
 #endif
   }
+
+  // whether both decide the same, whatever was worked out lazily
+  bool same_as(const basic_policy_action &that) const {
+    if (access != that.access || expose != that.expose || rank != that.rank)
+      return false;
+    for (int i=0;i<Workload::txn_types;i++)
+      if (safeguard[i] != that.safeguard[i]) return false;
+#if ADD_TIMEOUT
+    if (timeout != that.timeout) return false;
+#endif
+    return true;
+  }
+};
+
+typedef basic_policy_action<default_workload> PolicyAction;
+
+// The actions of a policy by state, for state spaces too big, or too
+// sparsely visited, for one dense array. States are looked up through a
+// directory of pages of PageSize actions: a page is only allocated once an
+// action in it differs from the default one, the directory entries of all
+// the other pages point to one shared page of default actions. A lookup is
+// two loads without a branch, and the pages of the states a policy sets are
+// all there is to keep in cache.
+//
+// Loading (reserve(), reset(), at(), compact()) is not thread safe, and
+// must be done before the policy is used.
+template <typename Action>
+class policy_table {
+public:
+  static const uint32_t PageBits = 5;
+  static const uint32_t PageSize = 1 << PageBits;
+  static const uint32_t PageMask = PageSize - 1;
+
+  policy_table(const Action &def = Action()) : dir_(nullptr), ndir_(0), npages_(0) {
+    default_page_ = new_page(def);
+  }
+
+  ~policy_table() {
+    for (uint32_t i = 0; i < ndir_; i++)
+      if (dir_[i] != default_page_)
+        free_page(dir_[i]);
+    free_page(default_page_);
+    delete[] dir_;
+  }
+
+  policy_table(const policy_table &) = delete;
+  policy_table &operator=(const policy_table &) = delete;
+
+  // the number of states covered
+  inline uint32_t capacity() const { return ndir_ << PageBits; }
+  // the number of pages of non default actions
+  inline uint32_t npages() const { return npages_; }
+  inline const Action &default_action() const { return default_page_[0]; }
+
+  ALWAYS_INLINE Action *lookup(uint32_t state) const {
+    INVARIANT(state < capacity());
+    return dir_[state >> PageBits] + (state & PageMask);
+  }
+
+  // whether the page of state was set, see at()
+  inline bool is_set(uint32_t state) const {
+    return state < capacity() && dir_[state >> PageBits] != default_page_;
+  }
+
+  // whether a is the shared action of the states which are not set. it must
+  // not be written, as that would change all of them
+  inline bool is_default(const Action *a) const {
+    return a >= default_page_ && a < default_page_ + PageSize;
+  }
+
+  // covers at least nstates states from now on
+  void reserve(uint32_t nstates) {
+    const uint32_t n = (nstates + PageMask) >> PageBits;
+    if (n <= ndir_)
+      return;
+    Action **dir = new Action *[n];
+    for (uint32_t i = 0; i < n; i++)
+      dir[i] = i < ndir_ ? dir_[i] : default_page_;
+    delete[] dir_;
+    dir_ = dir;
+    ndir_ = n;
+  }
+
+  // every state takes def
+  void reset(const Action &def) {
+    for (uint32_t i = 0; i < ndir_; i++) {
+      if (dir_[i] != default_page_)
+        free_page(dir_[i]);
+      dir_[i] = default_page_;
+    }
+    npages_ = 0;
+    for (uint32_t i = 0; i < PageSize; i++)
+      default_page_[i] = def;
+  }
+
+  // the action of state, for it to be set
+  Action &at(uint32_t state) {
+    reserve(state + 1);
+    Action *&page = dir_[state >> PageBits];
+    if (page == default_page_) {
+      page = new_page(default_action());
+      npages_++;
+    }
+    return page[state & PageMask];
+  }
+
+  // gives up the pages at() allocated whose actions turned out to be
+  // default ones
+  void compact() {
+    for (uint32_t i = 0; i < ndir_; i++) {
+      if (dir_[i] == default_page_)
+        continue;
+      bool all_default = true;
+      for (uint32_t j = 0; j < PageSize && all_default; j++)
+        all_default = dir_[i][j].same_as(default_action());
+      if (all_default) {
+        free_page(dir_[i]);
+        dir_[i] = default_page_;
+        npages_--;
+      }
+    }
+  }
+
+private:
+  static Action *new_page(const Action &def) {
+    Action *page;
+    ALWAYS_ASSERT(!posix_memalign(reinterpret_cast<void **>(&page), CACHELINE_SIZE,
+                                  PageSize * sizeof(Action)));
+    for (uint32_t i = 0; i < PageSize; i++)
+      new (&page[i]) Action(def);
+    return page;
+  }
+
+  static void free_page(Action *page) {
+    for (uint32_t i = 0; i < PageSize; i++)
+      page[i].~Action();
+    free(page);
+  }
+
+  Action **dir_;
+  uint32_t ndir_;
+  uint32_t npages_;
+  Action *default_page_;
 };
 
 extern PolicyAction before_commit_policy;
 
+struct contention_encoder;
+extern contention_encoder global_encoder;
 
-using backoff_info = double[2][RETRY_TIMES][TXN_TYPE + 1];
 // Policy contains a cached policy inside memory.
-class Policy {
+template <typename Workload>
+class basic_policy {
+public:
+  typedef Workload workload_type;
+  typedef basic_policy_action<Workload> action_type;
+  typedef double backoff_info[2][RETRY_TIMES][Workload::txn_types + 1];
+
 private:
   const std::string identifier;
-  // frequently accessed, we perform memory alignment for it.
-  PolicyAction *policy;
+  // frequently accessed, its pages are cache aligned.
+  policy_table<action_type> policy;
   backoff_info backoff;
   uint32_t txn_buf_size = 32;
+  // states are numbered by this encoder, which must be loaded for Workload
+  const contention_encoder *encoder;
   CACHE_PADOUT;
 
+  // see save()
+  void load_binary(const std::string &policy_f);
+
 public:
-  Policy();
-  Policy(const std::string &s) {
-    ALIGN_PTR(policy, MAX_STATE, PolicyAction);
+  basic_policy(const contention_encoder *enc = &global_encoder);
+  basic_policy(const std::string &s, const contention_encoder *enc = &global_encoder)
+    : basic_policy(enc) {
     policy_gradient(s);
   }
-  ~Policy();
+  ~basic_policy();
 
+  const char *workload_name() const { return Workload::name(); }
   void print_policy(const std::string &bench) const;
   void init_2pl();
   void init_pipeline_execution();
   void init_occ();
   // Load policy from target stream
   void init(std::ifstream *pol_file);
+  // Loads policy_f, "2pl", "pipe", or a file in either the text format
+  // init() reads or the binary one save() writes
   void policy_gradient(const std::string &policy_f);
+  // Writes the policy in the binary format, which loads with one read and
+  // is checked against the workload and the encoder when it does. The text
+  // format is converted by loading and saving it
+  void save(const std::string &policy_f) const;
 
-  ALWAYS_INLINE PolicyAction* inference(const uint32_t &state) const {
-    return &policy[state];
+  ALWAYS_INLINE action_type* inference(const uint32_t &state) const {
+    return policy.lookup(state);
+  }
+
+  // see policy_table::is_default()
+  inline bool is_default(const action_type *a) const {
+    return policy.is_default(a);
   }
 
 
@@ -218,4 +511,7 @@ public:
       return backoff_action(agent_inc_backoff, backoff[0][retry_times][txn_type]);
   }
 };
+
+typedef basic_policy<default_workload> Policy;
+
 #endif /* POLICY_H_ */
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include "policy_library.h"
+#include "hot_records.h"
+#include "ticker.h"
+
+using namespace std;
+
+const double policy_library::Margin = 0.02;
+bool policy_library::g_enabled = false;
+percore<policy_library::core_counts> policy_library::g_counts;
+vector<policy_library::entry> policy_library::g_entries;
+atomic<Policy *> policy_library::g_current(nullptr);
+
+static chrono::steady_clock::time_point g_start;
+
+policy_library::fingerprint::fingerprint()
+{
+  for (size_t i = 0; i < FpDims; i++) {
+    v_[i] = 0.0;
+    set_[i] = false;
+  }
+}
+
+double
+policy_library::fingerprint::distance(const fingerprint &that) const
+{
+  double d = 0.0;
+  size_t n = 0;
+  for (size_t i = 0; i < FpDims; i++) {
+    if (!set_[i] || !that.set_[i])
+      continue;
+    d += fabs(v_[i] - that.v_[i]);
+    n++;
+  }
+  return n ? d / n : 0.0;
+}
+
+string
+policy_library::fingerprint::str() const
+{
+  static const char *const names[] = {"mix", "abort_rate", "aborts", "blocked", "hot"};
+  static const size_t starts[] = {FpMix, FpAbortRate, FpAborts, FpBlocked, FpHot, FpDims};
+  ostringstream o;
+  for (size_t k = 0; k < 5; k++) {
+    bool named = false;
+    for (size_t i = starts[k]; i < starts[k + 1]; i++) {
+      if (!set_[i])
+        continue;
+      o << (named ? "," : (o.tellp() ? " " : "")) << (named ? "" : names[k])
+        << (named ? "" : " ") << v_[i];
+      named = true;
+    }
+  }
+  return o.str();
+}
+
+policy_library::core_counts::core_counts()
+  : commits_(0), aborts_(0), waits_(0), blocked_(0)
+{
+  for (size_t i = 0; i < MaxTxnKinds; i++)
+    txns_[i].store(0, memory_order_relaxed);
+  for (size_t i = 0; i < NAbortClasses; i++)
+    abort_classes_[i].store(0, memory_order_relaxed);
+}
+
+void
+policy_library::totals::sub(const totals &that)
+{
+  for (size_t i = 0; i < MaxTxnKinds; i++)
+    txns_[i] -= that.txns_[i];
+  commits_ -= that.commits_;
+  aborts_ -= that.aborts_;
+  for (size_t i = 0; i < NAbortClasses; i++)
+    abort_classes_[i] -= that.abort_classes_[i];
+  waits_ -= that.waits_;
+  blocked_ -= that.blocked_;
+  conflicts_ -= that.conflicts_;
+  hot_conflicts_ -= that.hot_conflicts_;
+}
+
+void
+policy_library::totals::add(const totals &that)
+{
+  for (size_t i = 0; i < MaxTxnKinds; i++)
+    txns_[i] += that.txns_[i];
+  commits_ += that.commits_;
+  aborts_ += that.aborts_;
+  for (size_t i = 0; i < NAbortClasses; i++)
+    abort_classes_[i] += that.abort_classes_[i];
+  waits_ += that.waits_;
+  blocked_ += that.blocked_;
+  conflicts_ += that.conflicts_;
+  hot_conflicts_ += that.hot_conflicts_;
+}
+
+Policy *
+policy_library::Load(const string &file)
+{
+  ifstream in(file);
+  if (!in.is_open()) {
+    cerr << "Could not open policy library: " << file << endl;
+    ALWAYS_ASSERT(false);
+  }
+  string line;
+  while (getline(in, line)) {
+    istringstream toks(line);
+    entry e;
+    if (!(toks >> e.file_) || e.file_[0] == '#')
+      continue;
+    auto fail = [&line](const string &why) {
+      cerr << "policy library: " << why << " in: " << line << endl;
+      ALWAYS_ASSERT(false);
+    };
+    auto read = [&](size_t dim) {
+      if (!(toks >> e.fp_.v_[dim]))
+        fail("missing value");
+      e.fp_.set_[dim] = true;
+    };
+    string key;
+    while (toks >> key) {
+      if (key == "mix") {
+        // as many shares as the benchmark has txn kinds
+        size_t i = 0;
+        for (; i < MaxTxnKinds && toks.peek() != EOF; i++) {
+          const streampos p = toks.tellg();
+          string v;
+          char *end;
+          if (!(toks >> v) || (strtod(v.c_str(), &end), *end)) {
+            toks.clear();
+            toks.seekg(p);
+            break;
+          }
+          e.fp_.v_[FpMix + i] = strtod(v.c_str(), nullptr);
+          e.fp_.set_[FpMix + i] = true;
+        }
+        if (!i)
+          fail("mix without shares");
+      } else if (key == "abort_rate") {
+        read(FpAbortRate);
+      } else if (key == "aborts") {
+        for (size_t i = 0; i < NAbortClasses; i++)
+          read(FpAborts + i);
+      } else if (key == "blocked") {
+        read(FpBlocked);
+      } else if (key == "hot") {
+        read(FpHot);
+      } else {
+        fail("unknown entry " + key);
+      }
+    }
+    e.pg_ = new Policy(e.file_);
+    g_entries.push_back(e);
+  }
+  if (g_entries.empty()) {
+    cerr << "policy library " << file << " has no policies" << endl;
+    ALWAYS_ASSERT(false);
+  }
+  for (auto &e : g_entries)
+    cerr << "policy library: " << e.file_ << " for " << e.fp_.str() << endl;
+
+  g_start = chrono::steady_clock::now();
+  g_current.store(g_entries[0].pg_, memory_order_release);
+  g_enabled = true;
+  ticker::s_instance.add_tick_callback(&policy_library::Sample);
+  return g_entries[0].pg_;
+}
+
+void
+policy_library::Collect(totals &t)
+{
+  memset(&t, 0, sizeof t);
+  for (size_t c = 0; c < g_counts.size(); c++) {
+    const core_counts &cc = g_counts[c];
+    for (size_t i = 0; i < MaxTxnKinds; i++)
+      t.txns_[i] += cc.txns_[i].load(memory_order_relaxed);
+    t.commits_ += cc.commits_.load(memory_order_relaxed);
+    t.aborts_ += cc.aborts_.load(memory_order_relaxed);
+    for (size_t i = 0; i < NAbortClasses; i++)
+      t.abort_classes_[i] += cc.abort_classes_[i].load(memory_order_relaxed);
+    t.waits_ += cc.waits_.load(memory_order_relaxed);
+    t.blocked_ += cc.blocked_.load(memory_order_relaxed);
+  }
+  hot_records::Totals(t.conflicts_, t.hot_conflicts_);
+}
+
+policy_library::fingerprint
+policy_library::FingerprintOf(const totals &t)
+{
+  auto share = [](uint64_t n, uint64_t of) { return of ? double(n) / of : 0.0; };
+  fingerprint fp;
+  for (size_t i = 0; i < FpDims; i++)
+    fp.set_[i] = true;
+  uint64_t ntxns = 0;
+  for (size_t i = 0; i < MaxTxnKinds; i++)
+    ntxns += t.txns_[i];
+  for (size_t i = 0; i < MaxTxnKinds; i++)
+    fp.v_[FpMix + i] = share(t.txns_[i], ntxns);
+  fp.v_[FpAbortRate] = share(t.aborts_, t.commits_ + t.aborts_);
+  uint64_t naborts = 0;
+  for (size_t i = 0; i < NAbortClasses; i++)
+    naborts += t.abort_classes_[i];
+  for (size_t i = 0; i < NAbortClasses; i++)
+    fp.v_[FpAborts + i] = share(t.abort_classes_[i], naborts);
+  fp.v_[FpBlocked] = share(t.blocked_, t.waits_);
+  fp.v_[FpHot] = share(t.hot_conflicts_, t.conflicts_);
+  return fp;
+}
+
+void
+policy_library::Sample(uint64_t tick)
+{
+  // only runs on the ticker thread
+  if (tick % WindowTicks)
+    return;
+  static totals last, windows[NWindows];
+  static size_t nwindows = 0;
+  static const entry *candidate = nullptr;
+  static size_t streak = 0;
+  static bool report = false;
+  static double tput_before = 0.0;
+
+  totals now;
+  Collect(now);
+  totals w = now;
+  w.sub(last);
+  last = now;
+  windows[nwindows++ % NWindows] = w;
+  totals recent;
+  memset(&recent, 0, sizeof recent);
+  for (size_t i = 0; i < min(nwindows, NWindows); i++)
+    recent.add(windows[i]);
+
+  const double window_sec = double(WindowTicks * ticker::tick_us) / 1000000.0;
+  const double tput = w.commits_ / window_sec;
+  const Policy *current = g_current.load(memory_order_relaxed);
+  const entry *cur = nullptr;
+  for (auto &e : g_entries)
+    if (e.pg_ == current)
+      cur = &e;
+  INVARIANT(cur);
+  if (report) {
+    cerr << "policy library: " << cur->file_ << " runs at " << tput
+         << " txns/s after the switch (" << tput_before << " before)" << endl;
+    report = false;
+  }
+  if (!w.commits_ && !w.aborts_)
+    return; // not running (yet)
+
+  const fingerprint fp = FingerprintOf(recent);
+  const entry *best = cur;
+  double best_d = cur->fp_.distance(fp);
+  const double cur_d = best_d;
+  for (auto &e : g_entries) {
+    const double d = e.fp_.distance(fp);
+    if (d < best_d) {
+      best = &e;
+      best_d = d;
+    }
+  }
+  if (best == cur || best_d + Margin > cur_d) {
+    candidate = nullptr;
+    streak = 0;
+    return;
+  }
+  if (best != candidate) {
+    candidate = best;
+    streak = 0;
+  }
+  if (++streak < SwitchWindows)
+    return;
+
+  const double t = chrono::duration<double>(chrono::steady_clock::now() - g_start).count();
+  cerr << "policy library: switch from " << cur->file_ << " to " << best->file_
+       << " at " << t << "s, distance " << cur_d << " -> " << best_d
+       << ", workload " << fp.str() << ", " << tput << " txns/s" << endl;
+  g_current.store(best->pg_, memory_order_release);
+  candidate = nullptr;
+  streak = 0;
+  report = true;
+  tput_before = tput;
+}
@@ -0,0 +1,159 @@
+#ifndef _POLICY_LIBRARY_H_
+#define _POLICY_LIBRARY_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "macros.h"
+#include "core.h"
+#include "policy.h"
+
+namespace policylibrarytest { void Test(); }
+
+// a policy library: several trained policies, each with the fingerprint of
+// the workload it was trained for, and the engine running the one whose
+// fingerprint is closest to that of the workload it currently sees.
+//
+// the workers count what a fingerprint is made of per core. every
+// WindowTicks the ticker thread takes the counts of the window which just
+// ended, and matches the fingerprint of the last NWindows windows against
+// the library. a policy only takes over once it has been closer than the
+// current one by Margin for SwitchWindows windows in a row (hysteresis).
+// the workers pick the new policy up at their next transaction boundary.
+//
+// the library file has one policy per line, then the parts of the
+// fingerprint it was trained for, any left out match anything:
+//   <policy file> [mix <share of txn kind 0> <1> ...] [abort_rate <f>]
+//                 [aborts <cascading> <timeout> <validation> <other>]
+//                 [blocked <f>] [hot <f>]
+// where the txn kinds are those of the benchmark, in its order (e.g.
+// new_order payment delivery order_status stock_level for tpcc, see
+// bench_worker::workload_desc::kind), the mix is that of the txns which
+// commit, and the aborts are the shares of the abort reasons, see
+// transaction_base::AbortClass()
+class policy_library {
+public:
+  static const size_t MaxTxnKinds = 8;
+  enum { AbortCascading, AbortTimeout, AbortValidation, AbortOther, NAbortClasses };
+
+  // the dimensions of a fingerprint
+  enum {
+    FpMix = 0,
+    FpAbortRate = FpMix + MaxTxnKinds,
+    FpAborts,
+    FpBlocked = FpAborts + NAbortClasses,
+    FpHot,
+    FpDims
+  };
+
+  struct fingerprint {
+    double v_[FpDims];
+    bool set_[FpDims]; // dimensions a library entry leaves out are not
+
+    fingerprint();
+    // mean distance over the dimensions both set
+    double distance(const fingerprint &that) const;
+    std::string str() const;
+  };
+
+  static const uint64_t WindowTicks = 25; // ~1s with the 40ms ticks
+  static const size_t NWindows = 4;
+  static const size_t SwitchWindows = 2;
+  static const double Margin;
+
+  static bool g_enabled;
+
+  // loads the policies of the library file, all of them over the global
+  // encoder, and starts matching. returns the first policy
+  static Policy *Load(const std::string &file);
+
+  // the policy the workers should run, see bench_worker::run()
+  static inline Policy *
+  Current()
+  {
+    return g_current.load(std::memory_order_acquire);
+  }
+
+  static inline void
+  NoteTxn(size_t kind, bool committed)
+  {
+    core_counts &c = g_counts.my();
+    if (!committed) {
+      // the retries of a txn would count its kind again
+      bump(c.aborts_);
+      return;
+    }
+    if (kind < MaxTxnKinds)
+      bump(c.txns_[kind]);
+    bump(c.commits_);
+  }
+
+  static inline void
+  NoteAbort(unsigned reason_class)
+  {
+    bump(g_counts.my().abort_classes_[reason_class]);
+  }
+
+  static inline void
+  NoteWait(bool blocked)
+  {
+    core_counts &c = g_counts.my();
+    bump(c.waits_);
+    if (blocked)
+      bump(c.blocked_);
+  }
+
+private:
+  friend void policylibrarytest::Test(); // drives Sample()
+
+  struct core_counts {
+    std::atomic<uint64_t> txns_[MaxTxnKinds];
+    std::atomic<uint64_t> commits_;
+    std::atomic<uint64_t> aborts_;
+    std::atomic<uint64_t> abort_classes_[NAbortClasses];
+    std::atomic<uint64_t> waits_;
+    std::atomic<uint64_t> blocked_;
+
+    core_counts();
+  };
+
+  // the counts summed over the cores
+  struct totals {
+    uint64_t txns_[MaxTxnKinds];
+    uint64_t commits_;
+    uint64_t aborts_;
+    uint64_t abort_classes_[NAbortClasses];
+    uint64_t waits_;
+    uint64_t blocked_;
+    uint64_t conflicts_;     // see hot_records::Totals()
+    uint64_t hot_conflicts_;
+
+    void sub(const totals &that);
+    void add(const totals &that);
+  };
+
+  struct entry {
+    std::string file_;
+    Policy *pg_;
+    fingerprint fp_;
+  };
+
+  // only this core writes its counts
+  static inline void
+  bump(std::atomic<uint64_t> &c)
+  {
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static void Collect(totals &t);
+  static fingerprint FingerprintOf(const totals &t);
+  static void Sample(uint64_t tick);
+
+  static percore<core_counts> g_counts;
+  static std::vector<entry> g_entries;
+  static std::atomic<Policy *> g_current;
+};
+
+#endif /* _POLICY_LIBRARY_H_ */
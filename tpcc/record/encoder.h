@@ -71,6 +71,26 @@ PrefixDecode(const char *buf, T &obj, size_t prefix)
   return enc.read(buf, &obj, prefix);
 }
 
+// decodes straight out of bytes which may be torn (e.g. the value of a
+// tuple read without a lock), returns nullptr if they are not a valid
+// encoding. with fields_mask only the fields whose bit is set are written
+// into obj, the rest are skipped over
+template <typename T>
+static inline const T *
+FailsafeDecode(const uint8_t *buf, size_t nbytes, T &obj)
+{
+  const encoder<T> enc;
+  return enc.failsafe_read(buf, nbytes, &obj);
+}
+
+template <typename T>
+static inline const T *
+ProjectedDecode(const uint8_t *buf, size_t nbytes, T &obj, uint64_t fields_mask)
+{
+  const encoder<T> enc;
+  return enc.projected_read(buf, nbytes, &obj, fields_mask);
+}
+
 template <typename T>
 static inline size_t
 Size(const T &t)
@@ -141,6 +161,30 @@ Size(const T &t)
     obj->name = trfm(tpe, obj->name); \
   } while (0);
 
+#define SERIALIZE_PROJECTED_READ_FIELD(tpe, name, compress, trfm) \
+  do { \
+    if (!(fields_mask >> i)) \
+      return true; \
+    if (fields_mask & (1UL << i)) { \
+      tpe v; \
+      const uint8_t * const p = \
+        serializer< tpe, compress >::failsafe_read(buf, nbytes, &v); \
+      if (unlikely(!p)) \
+        return false; \
+      nbytes -= (p - buf); \
+      buf = p; \
+      obj->name = trfm(tpe, v); \
+    } else { \
+      const size_t sz = \
+        serializer< tpe, compress >::failsafe_skip(buf, nbytes, nullptr); \
+      if (unlikely(!sz)) \
+        return false; \
+      nbytes -= sz; \
+      buf += sz; \
+    } \
+    i++; \
+  } while (0);
+
 #define SERIALIZE_NBYTES_FIELD(tpe, name, compress) \
   do { \
     size += serializer< tpe, compress >::nbytes(&obj->name); \
@@ -190,6 +234,9 @@ Size(const T &t)
 #define SERIALIZE_FAILSAFE_READ_VALUE_FIELD_X(tpe, name) \
   SERIALIZE_FAILSAFE_READ_FIELD(tpe, name, true, IDENT_TRANSFORM)
 
+#define SERIALIZE_PROJECTED_READ_VALUE_FIELD_X(tpe, name) \
+  SERIALIZE_PROJECTED_READ_FIELD(tpe, name, true, IDENT_TRANSFORM)
+
 #define SERIALIZE_NBYTES_KEY_FIELD_X(tpe, name) \
   SERIALIZE_NBYTES_FIELD(tpe, name, false)
 #define SERIALIZE_NBYTES_VALUE_FIELD_X(tpe, name) \
@@ -234,6 +281,13 @@ Size(const T &t)
 // const T *
 // read(const uint8_t *buf, T *obj)
 
+// Like read(), but checks buf against the nbytes it may read and only reads
+// the fields in fields_mask (bit i is field i), returning nullptr if buf is
+// not a valid encoding. Only implemented for values
+//
+// const T *
+// projected_read(const uint8_t *buf, size_t nbytes, T *obj, uint64_t fields_mask)
+
 // Returns the number of bytes required to encode this specific instance
 // of obj.
 //
@@ -356,10 +410,33 @@ Size(const T &t)
     return prefix_read((const uint8_t *) buf, obj, prefix); \
   }
 
+#define DO_STRUCT_ENCODE_PROJECTED(name) \
+  inline ALWAYS_INLINE const struct name * \
+  projected_read(const uint8_t *buf, size_t nbytes, struct name *obj, \
+                 uint64_t fields_mask) const \
+  { \
+    if (unlikely(!encode_projected_read(buf, nbytes, obj, fields_mask))) \
+      return nullptr; \
+    return obj; \
+  }
+
+// the fields are not worth picking out of an unencoded struct
+#define DO_STRUCT_PASS_THROUGH_PROJECTED(name) \
+  inline ALWAYS_INLINE const struct name * \
+  projected_read(const uint8_t *buf, size_t nbytes, struct name *obj, \
+                 uint64_t fields_mask) const \
+  { \
+    return failsafe_read(buf, nbytes, obj); \
+  }
+
 #ifdef USE_VARINT_ENCODING
-#define DO_STRUCT_REST_VALUE(name) DO_STRUCT_ENCODE_REST(name)
+#define DO_STRUCT_REST_VALUE(name) \
+  DO_STRUCT_ENCODE_REST(name) \
+  DO_STRUCT_ENCODE_PROJECTED(name)
 #else
-#define DO_STRUCT_REST_VALUE(name) DO_STRUCT_PASS_THROUGH_REST(name)
+#define DO_STRUCT_REST_VALUE(name) \
+  DO_STRUCT_PASS_THROUGH_REST(name) \
+  DO_STRUCT_PASS_THROUGH_PROJECTED(name)
 #endif
 
 #define APPLY_X_AND_Y(x, y) x(y, y)
@@ -585,6 +662,14 @@ Size(const T &t)
     APPLY_X_AND_Y(valuefields, SERIALIZE_FAILSAFE_READ_VALUE_FIELD_X) \
     return true; \
   } \
+  inline bool \
+  encode_projected_read(const uint8_t *buf, size_t nbytes, struct name::value *obj, \
+                        uint64_t fields_mask) const \
+  { \
+    size_t i = 0; \
+    APPLY_X_AND_Y(valuefields, SERIALIZE_PROJECTED_READ_VALUE_FIELD_X) \
+    return true; \
+  } \
   inline size_t \
   encode_nbytes(const struct name::value *obj) const \
   { \
@@ -622,4 +707,49 @@ struct schema {
   typedef encoder<value_type> value_encoder_type;
 };
 
+// column groups split the value fields of a table into groups which are
+// read and written apart, e.g. a counter updated on every access next to
+// attributes which are only read. accesses which declare the groups they
+// touch (access_cgroups in policy.h) only conflict if they share one.
+//
+// a table declares them after its DO_STRUCT, one fields mask (bit i: the
+// field at name::value::<field>_field) per group from group 1 on, every
+// field in none of them is in group 0:
+//
+//   DO_COLUMN_GROUPS(warehouse, COLUMN_GROUP_FIELD(warehouse, w_ytd))
+//
+// column_groups<T>::of_fields() maps a fields mask to the groups holding
+// them, for tables without groups that is every group
+template <typename T>
+struct column_groups {
+  static inline uint8_t
+  of_fields(uint64_t fields_mask)
+  {
+    return ALL_COLUMN_GROUPS;
+  }
+};
+
+#define COLUMN_GROUP_FIELD(name, field) \
+  (1UL << name::value::field ## _field)
+
+#define DO_COLUMN_GROUPS(name, ...) \
+  template <> \
+  struct column_groups< name::value > { \
+    static inline uint8_t \
+    of_fields(uint64_t fields_mask) \
+    { \
+      static const uint64_t groups[] = { __VA_ARGS__ }; \
+      static_assert(ARRAY_NELEMS(groups) < MAX_COLUMN_GROUPS, \
+                    "too many column groups"); \
+      uint64_t rest = fields_mask; \
+      uint8_t ret = 0; \
+      for (size_t g = 0; g < ARRAY_NELEMS(groups); g++) \
+        if (fields_mask & groups[g]) { \
+          ret |= 1 << (g + 1); \
+          rest &= ~groups[g]; \
+        } \
+      return rest ? (ret | 1) : ret; \
+    } \
+  };
+
 #endif /* _NDB_BENCH_ENCODER_H_ */
@@ -1,9 +1,14 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <functional>
 #include <unordered_map>
 #include <tuple>
 #include <set>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <math.h>
 
 #include "circbuf.h"
 #include "pxqueue.h"
@@ -17,6 +22,11 @@
 #include "small_unordered_map.h"
 #include "static_unordered_map.h"
 #include "counter.h"
+#include "policy.h"
+#include "policy_library.h"
+#include "access_trace.h"
+#include "hot_records.h"
+#include "hash_index.h"
 #include "record/encoder.h"
 #include "record/inline_str.h"
 #include "record/cursor.h"
@@ -229,6 +239,424 @@ CircbufTest()
   cout << "circbuf test passed" << endl;
 }
 
+void
+ConflictGraphTest()
+{
+  // two txn types of two steps, the first step of each a commutative add
+  conflict_graph g(2);
+  g.init_txn(1, 2);
+  g.init_txn(2, 2);
+  g.set_commutative(1, 1, CommutativeAdd);
+  g.set_commutative(2, 1, CommutativeAdd);
+  g.set_conflict(1, 1, 2, 1);
+  g.set_conflict(1, 2, 2, 2);
+  g.freeze();
+
+  // the adds conflict neither with each other nor with themselves
+  ALWAYS_ASSERT(g.conflict_step(2, 1, 1) == 0);
+  ALWAYS_ASSERT(g.conflict_step(1, 2, 1) == 0);
+  ALWAYS_ASSERT(g.conflict_step(1, 1, 1) == 0);
+  ALWAYS_ASSERT(g.conflict_step(2, 2, 1) == 0);
+  // the other steps still do
+  ALWAYS_ASSERT(g.conflict_step(2, 1, 2) == 2);
+  ALWAYS_ASSERT(g.conflict_step(1, 1, 2) == 2);
+  ALWAYS_ASSERT(g.first_conflict_step(1, 1, 1) == 2);
+  ALWAYS_ASSERT(g.first_conflict_step(1, 2, 1) == 2);
+
+  // an add commutes with neither a min nor an escrow add on the same column,
+  // and an escrow add commutes with escrow adds only
+  conflict_graph h(3);
+  h.init_txn(1, 1);
+  h.init_txn(2, 1);
+  h.init_txn(3, 1);
+  h.set_commutative(1, 1, CommutativeAdd);
+  h.set_commutative(2, 1, CommutativeMin);
+  h.set_commutative(3, 1, CommutativeBoundedAdd);
+  h.set_conflict(1, 1, 2, 1);
+  h.set_conflict(1, 1, 3, 1);
+  h.set_conflict(2, 1, 3, 1);
+  h.freeze();
+  ALWAYS_ASSERT(h.conflict_step(1, 2, 1) == 1);
+  ALWAYS_ASSERT(h.conflict_step(1, 3, 1) == 1);
+  ALWAYS_ASSERT(h.conflict_step(2, 3, 1) == 1);
+  ALWAYS_ASSERT(h.conflict_step(3, 3, 1) == 0);
+
+  cout << "conflict graph test passed" << endl;
+}
+
+namespace policytabletest {
+
+struct action {
+  int v;
+  action(int v = 0) : v(v) {}
+  bool same_as(const action &that) const { return v == that.v; }
+};
+
+void
+Test()
+{
+  typedef policy_table<action> table;
+  table t(action(7));
+  ALWAYS_ASSERT(t.capacity() == 0);
+  t.reserve(3 * table::PageSize + 1);
+  ALWAYS_ASSERT(t.capacity() == 4 * table::PageSize);
+  ALWAYS_ASSERT(t.npages() == 0);
+  // the states share the default page until their own page is set
+  for (uint32_t s = 0; s < t.capacity(); s++) {
+    ALWAYS_ASSERT(t.lookup(s)->v == 7);
+    ALWAYS_ASSERT(t.is_default(t.lookup(s)));
+    ALWAYS_ASSERT(!t.is_set(s));
+  }
+
+  t.at(table::PageSize + 2).v = 1;
+  ALWAYS_ASSERT(t.npages() == 1);
+  ALWAYS_ASSERT(t.is_set(table::PageSize));
+  ALWAYS_ASSERT(!t.is_set(0));
+  ALWAYS_ASSERT(t.lookup(table::PageSize + 2)->v == 1);
+  ALWAYS_ASSERT(!t.is_default(t.lookup(table::PageSize + 2)));
+  // the rest of the page keeps the default action
+  ALWAYS_ASSERT(t.lookup(table::PageSize + 3)->v == 7);
+  ALWAYS_ASSERT(t.lookup(0)->v == 7);
+
+  // at() grows the table for states past its capacity
+  t.at(10 * table::PageSize).v = 2;
+  ALWAYS_ASSERT(t.capacity() == 11 * table::PageSize);
+  ALWAYS_ASSERT(t.npages() == 2);
+  ALWAYS_ASSERT(t.lookup(10 * table::PageSize)->v == 2);
+  ALWAYS_ASSERT(t.lookup(table::PageSize + 2)->v == 1);
+  ALWAYS_ASSERT(!t.is_set(11 * table::PageSize));
+
+  // pages set back to the default action are given up
+  t.at(10 * table::PageSize).v = 7;
+  t.compact();
+  ALWAYS_ASSERT(t.npages() == 1);
+  ALWAYS_ASSERT(!t.is_set(10 * table::PageSize));
+  ALWAYS_ASSERT(t.is_set(table::PageSize));
+
+  t.reset(action(3));
+  ALWAYS_ASSERT(t.npages() == 0);
+  ALWAYS_ASSERT(t.capacity() == 11 * table::PageSize);
+  ALWAYS_ASSERT(t.default_action().v == 3);
+  for (uint32_t s = 0; s < t.capacity(); s++)
+    ALWAYS_ASSERT(t.lookup(s)->v == 3);
+
+  cout << "policy table test passed" << endl;
+}
+
+}
+
+namespace policylibrarytest {
+
+void
+Test()
+{
+  typedef policy_library lib;
+  lib::fingerprint a, b;
+  // nothing in common, nothing apart
+  ALWAYS_ASSERT(a.distance(b) == 0.0);
+  ALWAYS_ASSERT(a.str() == "");
+
+  a.v_[lib::FpMix] = 0.5; a.set_[lib::FpMix] = true;
+  a.v_[lib::FpMix + 1] = 0.5; a.set_[lib::FpMix + 1] = true;
+  a.v_[lib::FpAbortRate] = 0.1; a.set_[lib::FpAbortRate] = true;
+  b.v_[lib::FpMix] = 0.25; b.set_[lib::FpMix] = true;
+  b.v_[lib::FpMix + 1] = 0.75; b.set_[lib::FpMix + 1] = true;
+  b.v_[lib::FpHot] = 0.9; b.set_[lib::FpHot] = true;
+  // only the mix is set in both
+  ALWAYS_ASSERT(fabs(a.distance(b) - 0.25) < 1e-9);
+  ALWAYS_ASSERT(fabs(b.distance(a) - 0.25) < 1e-9);
+  ALWAYS_ASSERT(a.distance(a) == 0.0);
+
+  b.v_[lib::FpAbortRate] = 0.4; b.set_[lib::FpAbortRate] = true;
+  ALWAYS_ASSERT(fabs(a.distance(b) - (0.25 + 0.25 + 0.3) / 3) < 1e-9);
+
+  ALWAYS_ASSERT(a.str() == "mix 0.5,0.5 abort_rate 0.1");
+  ALWAYS_ASSERT(b.str() == "mix 0.25,0.75 abort_rate 0.4 hot 0.9");
+
+  // a policy for a mix of mostly kind 0 and one for mostly kind 1, the
+  // first one running
+  Policy pa, pb;
+  lib::entry ea, eb;
+  ea.file_ = "a";
+  ea.pg_ = &pa;
+  eb.file_ = "b";
+  eb.pg_ = &pb;
+  for (size_t k = 0; k < 2; k++) {
+    ea.fp_.v_[lib::FpMix + k] = k ? 0.1 : 0.9;
+    eb.fp_.v_[lib::FpMix + k] = k ? 0.9 : 0.1;
+    ea.fp_.set_[lib::FpMix + k] = eb.fp_.set_[lib::FpMix + k] = true;
+  }
+  lib::g_entries = {ea, eb};
+  lib::g_current.store(&pa);
+  uint64_t tick = 0;
+  // one window of n txns, per mille of kind 0
+  auto window = [&tick](size_t n, size_t permille0) {
+    for (size_t i = 0; i < n; i++)
+      lib::NoteTxn(i % 1000 < permille0 ? 0 : 1, true);
+    lib::Sample(tick += lib::WindowTicks);
+  };
+
+  for (size_t i = 0; i < lib::NWindows; i++)
+    window(1000, 900);
+  ALWAYS_ASSERT(lib::Current() == &pa);
+  // closer to b, but by less than Margin. the aborts of kind 1 are not
+  // part of the mix, they would make it b's
+  for (size_t i = 0; i < 2 * lib::NWindows; i++) {
+    for (size_t j = 0; j < 5000; j++)
+      lib::NoteTxn(1, false);
+    window(1000, 495);
+    ALWAYS_ASSERT(lib::Current() == &pa);
+  }
+  // b's mix takes over after SwitchWindows windows closer to it
+  for (size_t i = 1; i < lib::SwitchWindows; i++) {
+    window(1000, 100);
+    ALWAYS_ASSERT(lib::Current() == &pa);
+  }
+  window(1000, 100);
+  ALWAYS_ASSERT(lib::Current() == &pb);
+
+  lib::g_entries.clear();
+  lib::g_current.store(nullptr);
+  cout << "policy library test passed" << endl;
+}
+
+}
+
+namespace policyfiletest {
+
+typedef basic_policy<tpcc_workload> tpcc_policy;
+
+static string
+Slurp(const string &f)
+{
+  ifstream in(f, ios::binary);
+  return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+static void
+Spit(const string &f, const string &bytes)
+{
+  ofstream out(f, ios::binary | ios::trunc);
+  ALWAYS_ASSERT(out.write(bytes.data(), bytes.size()));
+}
+
+// whether the policy file loads. loading one which does not aborts, so it
+// is loaded in a child
+static bool
+Loads(const string &f, const contention_encoder *enc)
+{
+  const pid_t pid = fork();
+  ALWAYS_ASSERT(pid >= 0);
+  if (!pid) {
+    const struct rlimit no_core = {0, 0};
+    setrlimit(RLIMIT_CORE, &no_core);
+    ALWAYS_ASSERT(freopen("/dev/null", "w", stderr));
+    tpcc_policy p(f, enc);
+    _exit(0);
+  }
+  int status;
+  ALWAYS_ASSERT(waitpid(pid, &status, 0) == pid);
+  return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+void
+Test()
+{
+  contention_encoder enc;
+  enc.load<tpcc_workload>("step");
+  const int n = enc.max_state;
+  const int ntypes = tpcc_workload::txn_types;
+  const string prefix = "/tmp/policy_file_test." + to_string(getpid());
+
+  // a policy in the text format, with every state set
+  ostringstream text;
+  text << "access" << endl;
+  for (int s = 0; s < n; s++)
+    text << "031"[s % 3];
+  text << endl << "rank" << endl;
+  for (int s = 0; s < n; s++)
+    text << s * 0.5 << " ";
+  text << endl << "timeout" << endl;
+  for (int s = 0; s < n; s++)
+    text << s * 10 << " ";
+  text << endl << "expose" << endl;
+  for (int s = 0; s < n; s++)
+    text << s % 2;
+  text << endl << "wait chop" << endl;
+  for (int i = 0; i < ntypes * n; i++)
+    text << i % 5 << " ";
+  text << endl << "extra" << endl << 8;
+  for (int i = 0; i < 2 * RETRY_TIMES; i++)
+    text << " " << i + 1;
+  text << endl;
+  Spit(prefix + ".txt", text.str());
+
+  // text -> binary -> binary keeps every action and the bytes
+  tpcc_policy p1(prefix + ".txt", &enc);
+  p1.save(prefix + ".1");
+  tpcc_policy p2(prefix + ".1", &enc);
+  ALWAYS_ASSERT(p2.get_txn_buf_size() == 8);
+  for (int s = 0; s < n; s++) {
+    const tpcc_policy::action_type *a = p1.inference(s), *b = p2.inference(s);
+    ALWAYS_ASSERT(a->access == b->access);
+    ALWAYS_ASSERT(a->rank == b->rank);
+    ALWAYS_ASSERT(a->expose == b->expose);
+    ALWAYS_ASSERT(a->timeout == b->timeout);
+    ALWAYS_ASSERT(!memcmp(a->safeguard, b->safeguard, sizeof a->safeguard));
+  }
+  ALWAYS_ASSERT(p2.inference(1)->access == detect_all);
+  ALWAYS_ASSERT(p2.inference(3)->rank == 1.5);
+  ALWAYS_ASSERT(p2.inference(3)->expose);
+  p2.save(prefix + ".2");
+  const string bytes = Slurp(prefix + ".1");
+  ALWAYS_ASSERT(bytes == Slurp(prefix + ".2"));
+
+  // the header is checked before anything of it is used. txn_buf_size is
+  // at offsetof(policy_file_header, txn_buf_size)
+  const size_t txn_buf_size_at = 48;
+  auto with_txn_buf_size = [&](uint32_t v) {
+    string b = bytes;
+    memcpy(&b[txn_buf_size_at], &v, sizeof v);
+    Spit(prefix + ".bad", b);
+  };
+  with_txn_buf_size(MAX_TXN_BUF_SIZE);
+  tpcc_policy p3(prefix + ".bad", &enc);
+  ALWAYS_ASSERT(p3.get_txn_buf_size() == MAX_TXN_BUF_SIZE);
+  with_txn_buf_size(0);
+  ALWAYS_ASSERT(!Loads(prefix + ".bad", &enc));
+  with_txn_buf_size(MAX_TXN_BUF_SIZE + 1);
+  ALWAYS_ASSERT(!Loads(prefix + ".bad", &enc));
+  with_txn_buf_size(~0u);
+  ALWAYS_ASSERT(!Loads(prefix + ".bad", &enc));
+  Spit(prefix + ".bad", bytes.substr(0, bytes.size() - 1));
+  ALWAYS_ASSERT(!Loads(prefix + ".bad", &enc));
+  ALWAYS_ASSERT(Loads(prefix + ".1", &enc));
+
+  // another encoder's policy does not load either
+  contention_encoder other;
+  other.load<tpcc_workload>("step");
+  other.max_state++;
+  ALWAYS_ASSERT(!Loads(prefix + ".1", &other));
+
+  for (auto ext : {".txt", ".1", ".2", ".bad"})
+    unlink((prefix + ext).c_str());
+  cout << "policy file test passed" << endl;
+}
+
+}
+
+namespace hashindextest {
+
+void
+Test()
+{
+  // entries go through rcu
+  scoped_rcu_region guard;
+  hash_index<uintptr_t> h(hash_index<uintptr_t>::NLocks);
+  ALWAYS_ASSERT(h.nbuckets() == hash_index<uintptr_t>::NLocks);
+
+  // more keys than buckets, so the chains get walked, and lengths on both
+  // sides of the 8 byte words Hash() reads
+  vector<string> keys;
+  for (size_t i = 0; i < 4 * h.nbuckets(); i++)
+    keys.push_back(string(i % 19, 'k') + to_string(i));
+  for (size_t i = 0; i < keys.size(); i++)
+    h.put(keys[i].data(), keys[i].size(), i);
+
+  uintptr_t v = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    ALWAYS_ASSERT(h.search(keys[i].data(), keys[i].size(), v));
+    ALWAYS_ASSERT(v == i);
+  }
+  // a prefix of a key is not that key
+  ALWAYS_ASSERT(!h.search(keys[100].data(), keys[100].size() - 1, v));
+  ALWAYS_ASSERT(!h.search("missing", 7, v));
+
+  // put() replaces
+  h.put(keys[5].data(), keys[5].size(), 1000);
+  ALWAYS_ASSERT(h.search(keys[5].data(), keys[5].size(), v) && v == 1000);
+
+  for (size_t i = 0; i < keys.size(); i += 2)
+    h.erase(keys[i].data(), keys[i].size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    const bool found = h.search(keys[i].data(), keys[i].size(), v);
+    ALWAYS_ASSERT(found == (i % 2 == 1));
+    if (found)
+      ALWAYS_ASSERT(v == (i == 5 ? 1000 : i));
+  }
+  // erasing what is not there does nothing
+  h.erase(keys[0].data(), keys[0].size());
+  h.erase("missing", 7);
+  ALWAYS_ASSERT(h.search(keys[1].data(), keys[1].size(), v) && v == 1);
+
+  cout << "hash index test passed" << endl;
+}
+
+}
+
+namespace hotrecordstest {
+
+void
+Test()
+{
+  static int hot, cold, table;
+  access_trace::RegisterTable(&table, "hot_table");
+  const string key("\x01\xab", 2);
+  uint64_t nrecorded0, nhot0;
+  hot_records::Totals(nrecorded0, nhot0);
+
+  const uint32_t threshold = 16;
+  // named by a later blame only
+  hot_records::Record(&hot, 1);
+  for (size_t i = 1; i < 4 * threshold; i++)
+    hot_records::Record(&hot, 1, &table, &key);
+  hot_records::Record(&cold, 2);
+  uint64_t nrecorded, nhot;
+  hot_records::Totals(nrecorded, nhot);
+  ALWAYS_ASSERT(nrecorded - nrecorded0 == 4 * threshold + 1);
+  // nothing is hot before the ticker folds the counts
+  ALWAYS_ASSERT(nhot == nhot0);
+  ALWAYS_ASSERT(!hot_records::IsHot(&hot));
+
+  hot_records::Enable(threshold);
+  for (size_t i = 0; i < 100 && !hot_records::IsHot(&hot); i++)
+    usleep(ticker::tick_us);
+  // a decay may have halved the count already
+  ALWAYS_ASSERT(hot_records::IsHot(&hot));
+  ALWAYS_ASSERT(hot_records::Estimate(&hot) >= 2 * threshold);
+  ALWAYS_ASSERT(!hot_records::IsHot(&cold));
+
+  hot_records::Record(&hot, 3);
+  hot_records::Totals(nrecorded, nhot);
+  ALWAYS_ASSERT(nhot == nhot0 + 1);
+
+  // the record blamed most comes first, by table and key, with the access
+  // which blamed it last. a record never named has no table and key
+  const string f = "/tmp/hot_records_test." + to_string(getpid());
+  hot_records::Dump(f);
+  ifstream in(f);
+  string line;
+  ALWAYS_ASSERT(getline(in, line) && line[0] == '#');
+  ALWAYS_ASSERT(getline(in, line));
+  istringstream toks(line);
+  string tbl, k;
+  uint32_t acc_id;
+  uint64_t count;
+  ALWAYS_ASSERT(toks >> tbl >> k >> acc_id >> count);
+  ALWAYS_ASSERT(tbl == "hot_table" && k == util::hexify(key));
+  ALWAYS_ASSERT(acc_id == 3 && count == 4 * threshold + 1);
+  ALWAYS_ASSERT(getline(in, line));
+  istringstream cold_toks(line);
+  ALWAYS_ASSERT(cold_toks >> tbl >> k >> acc_id >> count);
+  ALWAYS_ASSERT(tbl == "<unknown>" && k == "-" && acc_id == 2 && count == 1);
+  unlink(f.c_str());
+
+  hot_records::g_enabled = false;
+  cout << "hot records test passed" << endl;
+}
+
+}
+
 void
 CounterTest()
 {
@@ -970,6 +1398,12 @@ public:
     cerr << "PID: " << getpid() << endl;
 
     CircbufTest();
+    ConflictGraphTest();
+    policytabletest::Test();
+    policylibrarytest::Test();
+    policyfiletest::Test();
+    hashindextest::Test();
+    hotrecordstest::Test();
 
     // initialize the numa allocator subsystem with the number of CPUs running
     // + reasonable size per core
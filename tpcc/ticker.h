@@ -18,9 +18,17 @@ public:
   static const uint64_t tick_us = 40 * 1000; /* 40 ms */
 #endif
 
+  // called by the ticker thread right before it starts tick, so no thread
+  // can have seen tick yet
+  typedef void (*tick_callback)(uint64_t tick);
+
+  static const size_t MaxTickCallbacks = 4;
+
   ticker()
     : current_tick_(1), last_tick_inclusive_(0)
   {
+    for (size_t i = 0; i < MaxTickCallbacks; i++)
+      tick_callbacks_[i].store(nullptr, std::memory_order_relaxed);
     std::thread thd(&ticker::tickerloop, this);
     thd.detach();
   }
@@ -53,6 +61,24 @@ public:
     return e;
   }
 
+  // cb runs before every tick from now on, after the callbacks added
+  // before it. adding a cb twice is the same as adding it once
+  void
+  add_tick_callback(tick_callback cb)
+  {
+    lock_guard<spinlock> lg(tick_callbacks_lock_);
+    size_t i = 0;
+    for (; i < MaxTickCallbacks; i++) {
+      const tick_callback c = tick_callbacks_[i].load(std::memory_order_relaxed);
+      if (c == cb)
+        return;
+      if (!c)
+        break;
+    }
+    ALWAYS_ASSERT(i < MaxTickCallbacks);
+    tick_callbacks_[i].store(cb, std::memory_order_release);
+  }
+
   // returns true if guard is currently active, along with filling
   // cur_epoch out
   inline bool
@@ -195,6 +221,13 @@ private:
         loop_timer.lap(); // since we slept away the lag
       }
 
+      for (size_t i = 0; i < MaxTickCallbacks; i++) {
+        const tick_callback cb = tick_callbacks_[i].load(std::memory_order_acquire);
+        if (!cb)
+          break;
+        cb(current_tick_.load(std::memory_order_acquire) + 1);
+      }
+
       // bump the current tick
       // XXX: ignore overflow
       const uint64_t last_tick = util::non_atomic_fetch_add(current_tick_, 1UL);
@@ -238,4 +271,6 @@ private:
   std::atomic<uint64_t> last_tick_inclusive_;
     // all threads have *completed* ticks <= last_tick_inclusive_
     // (< current_tick_)
+  spinlock tick_callbacks_lock_;
+  std::atomic<tick_callback> tick_callbacks_[MaxTickCallbacks];
 };
@@ -21,7 +21,14 @@ event_counter dbtuple::g_evt_dbtuple_inplace_buf_insufficient("dbtuple_inplace_b
 event_counter dbtuple::g_evt_dbtuple_inplace_buf_insufficient_on_spill("dbtuple_inplace_buf_insufficient_on_spill");
 
 event_avg_counter dbtuple::g_evt_avg_record_spill_len("avg_record_spill_len");
+atomic<uint32_t> *dbtuple::g_cg_commits = nullptr;
 static event_avg_counter evt_avg_dbtuple_chain_length("avg_dbtuple_chain_len");
+#ifdef ENABLE_EVENT_COUNTERS
+event_counter dbtuple::g_evt_dbtuple_chain_walk[dbtuple::NChainWalkBuckets] = {
+  {"chain_walk_1"}, {"chain_walk_2_3"}, {"chain_walk_4_7"},
+  {"chain_walk_8_15"}, {"chain_walk_16_plus"},
+};
+#endif
 
 dbtuple::~dbtuple()
 {
@@ -44,6 +51,17 @@ dbtuple::~dbtuple()
 
 }
 
+void
+dbtuple::EnableColumnGroups()
+{
+  if (g_cg_commits)
+    return;
+  atomic<uint32_t> *cells = new atomic<uint32_t>[NCgCommits];
+  for (size_t i = 0; i < NCgCommits; i++)
+    cells[i].store(0, memory_order_relaxed);
+  g_cg_commits = cells;
+}
+
 void
 dbtuple::gc_this()
 {
@@ -149,6 +149,12 @@ public:
                  // GC is capable of reaping it at certain (well defined)
                  // points, and will not bother to set it to null
 
+  // next (and every version behind it up to the first one owned by the
+  // background GC) is owned by the chain compactor, which frees it itself
+  // once no snapshot can see it. such versions are never reaped behind the
+  // back of a writer holding the lock, so next can always be followed
+  bool next_compactor_owned;
+
   
   access_entry* access_head;
   access_entry* access_tail;
@@ -205,6 +211,7 @@ private:
       , size(CheckBounds(size))
       , alloc_size(CheckBounds(alloc_size))
       , next(nullptr)
+      , next_compactor_owned(false)
       , access_head(nullptr)
       , access_tail(nullptr)
       , tail_lock(0)
@@ -255,6 +262,7 @@ private:
       , size(base->size)
       , alloc_size(CheckBounds(alloc_size))
       , next(base->next)
+      , next_compactor_owned(base->next_compactor_owned)
       , access_head(nullptr)
       , access_tail(nullptr)
       , tail_lock(0)
@@ -305,6 +313,7 @@ private:
       , size(CheckBounds(new_size))
       , alloc_size(CheckBounds(alloc_size))
       , next(next)
+      , next_compactor_owned(false)
       , access_head(head)
       , access_tail(tail)
       , tail_lock(0)
@@ -336,8 +345,30 @@ private:
   static event_avg_counter g_evt_avg_dbtuple_lock_acquire_spins;
   static event_avg_counter g_evt_avg_dbtuple_read_retries;
 
+  // commits which changed each column group of a row (see access_cgroups in
+  // policy.h), lets a read of some groups tell whether it is still current
+  // after writes to the others bumped the version. kept aside, indexed by a
+  // hash of the tuple and group, and only once EnableColumnGroups() ran. a
+  // read checks its stamp against the tuple it read, so tuples sharing a
+  // cell only see more commits, which fails a check but never passes one
+  static const size_t NCgCommits = 1 << 20; // power of two
+  static std::atomic<uint32_t> *g_cg_commits;
+
+  static inline std::atomic<uint32_t> &
+  cg_commits(const dbtuple *t, size_t g)
+  {
+    uint64_t h = uintptr_t(t) + g;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return g_cg_commits[h & (NCgCommits - 1)];
+  }
+
 public:
 
+  // before the workers start, with access_cgroups declared
+  static void EnableColumnGroups();
+
   enum ReadStatus {
     READ_FAILED,
     READ_EMPTY,
@@ -383,6 +414,21 @@ public:
 #endif    
   }
 
+  // the latest write entry which shares a column group with cgroups, a
+  // read only depends on the writers of the groups it reads
+  inline access_entry*
+  get_dependent_entry(bool write, uint8_t cgroups)
+  {
+    if(write || cgroups == ALL_COLUMN_GROUPS)
+      return get_dependent_entry(write);
+
+    access_entry* dep = access_tail;
+    while(dep != nullptr && !(dep->is_write() && (dep->cgroups & cgroups)))
+      dep = dep->prev;
+
+    return dep;
+  }
+
   inline bool
   check_no_write_entry(uint64_t tid)
   {
@@ -394,6 +440,17 @@ public:
     return true;
   }
 
+  inline bool
+  check_no_write_entry(uint64_t tid, uint8_t cgroups)
+  {
+    access_entry* dep = access_tail;
+    while(dep != nullptr) {
+      if (dep->is_write() && (dep->cgroups & cgroups) && dep->get_tid() != tid) return false;
+      dep = dep->prev;
+    }
+    return true;
+  }
+
   inline bool
   is_first_active_entry(access_entry* e)
   {
@@ -932,6 +989,23 @@ private:
   private:
     unsigned long *n;
   };
+
+  // histogram of how many versions a read walked past the head of the chain
+  // before finding its version (1, 2-3, 4-7, 8-15, 16+), i.e. how long the
+  // chains are that snapshot readers actually pay for
+  static const size_t NChainWalkBuckets = 5;
+  struct scoped_chain_walk_recorder {
+    scoped_chain_walk_recorder(unsigned long &n) : n(&n) {}
+    ~scoped_chain_walk_recorder()
+    {
+      size_t b = 0;
+      while (b + 1 < NChainWalkBuckets && (*n >> (b + 1)))
+        b++;
+      ++g_evt_dbtuple_chain_walk[b];
+    }
+  private:
+    unsigned long *n;
+  };
 #endif
 
   // written to be non-recursive
@@ -944,6 +1018,8 @@ private:
 #ifdef ENABLE_EVENT_COUNTERS
     unsigned long nretries = 0;
     scoped_recorder rec(nretries);
+    unsigned long depth = 1;
+    scoped_chain_walk_recorder wrec(depth);
 #endif
     const dbtuple *current = starting;
   loop:
@@ -954,10 +1030,12 @@ private:
     if (found) {
       start_t = current->version;
       const size_t read_sz = IsDeleting(v) ? 0 : current->size;
-      if (unlikely(read_sz && !reader(current->get_value_start(), read_sz, sa)))
-        goto retry;
+      const bool ok = !read_sz || reader(current->get_value_start(), read_sz, sa);
       if (unlikely(!current->reader_check_version(v)))
         goto retry;
+      // see note in record_at()
+      if (unlikely(!ok))
+        return READ_FAILED;
       return read_sz ? READ_RECORD : READ_EMPTY;
     } else {
       p = current->get_next();
@@ -966,6 +1044,9 @@ private:
       goto retry;
     if (p) {
       current = p;
+#ifdef ENABLE_EVENT_COUNTERS
+      ++depth;
+#endif
       goto loop;
     }
     // see note in record_at()
@@ -1008,10 +1089,14 @@ private:
       //  return READ_FAILED;
       start_t = version;
       const size_t read_sz = IsDeleting(v) ? 0 : size;
-      if (unlikely(read_sz && !reader(get_value_start(), read_sz, sa)))
-        goto retry;
+      const bool ok = !read_sz || reader(get_value_start(), read_sz, sa);
       if (unlikely(!reader_check_version(v)))
         goto retry;
+      // a reader which rejects bytes that did not change under it (e.g. a
+      // decoder hitting a malformed record) would reject them again on every
+      // retry, so that is a failed read rather than a torn one
+      if (unlikely(!ok))
+        return READ_FAILED;
       return read_sz ? READ_RECORD : READ_EMPTY;
     } else {
       p = get_next();
@@ -1051,6 +1136,9 @@ private:
   static event_counter g_evt_dbtuple_inplace_buf_insufficient;
   static event_counter g_evt_dbtuple_inplace_buf_insufficient_on_spill;
   static event_avg_counter g_evt_avg_record_spill_len;
+#ifdef ENABLE_EVENT_COUNTERS
+  static event_counter g_evt_dbtuple_chain_walk[NChainWalkBuckets];
+#endif
 
 public:
 
@@ -1086,6 +1174,12 @@ public:
   inline ALWAYS_INLINE bool
   ic3_read(Reader &reader, StringAllocator &sa, access_entry* e);
 
+  //Called when a lock is hold. reads the value the write entry de left,
+  //the committed one if de is nullptr
+  template <typename Reader, typename StringAllocator>
+  inline ALWAYS_INLINE bool
+  ic3_read_from(Reader &reader, StringAllocator &sa, access_entry* de);
+
   //Called when a lock is hold
   template <typename Reader, typename StringAllocator>
   inline ALWAYS_INLINE bool
@@ -1132,6 +1226,53 @@ public:
       return false;
   }
 
+  inline uint64_t
+  cgroups_stamp(uint8_t cgroups) const
+  {
+    if (!g_cg_commits)
+      return 0;
+    // the counters only grow, so their sum only stays put if none moved
+    uint64_t ret = 0;
+    for (size_t g = 0; g < MAX_COLUMN_GROUPS; g++)
+      if (cgroups & (1 << g))
+        ret += cg_commits(this, g).load(std::memory_order_relaxed);
+    return ret;
+  }
+
+  // called by the commit of a write to cgroups, before it unlocks the row
+  inline void
+  bump_cgroups(uint8_t cgroups)
+  {
+    if (!g_cg_commits)
+      return;
+    for (size_t g = 0; g < MAX_COLUMN_GROUPS; g++)
+      if (cgroups & (1 << g))
+        cg_commits(this, g).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // whether nothing committed to cgroups since they were at stamp, which
+  // a read of cgroups accepts even if the version moved on. never without
+  // the counters
+  inline bool
+  is_latest_cgroups(uint8_t cgroups, uint64_t stamp) const
+  {
+    return g_cg_commits && is_latest() && !is_deleting() &&
+           cgroups_stamp(cgroups) == stamp;
+  }
+
+  bool
+  stable_is_latest_cgroups(uint8_t cgroups, uint64_t stamp) const
+  {
+    version_t v = 0;
+    if (!g_cg_commits || !try_writer_stable_version(v, 16))
+      return false;
+    INVARIANT(!IsWriteIntent(v));
+    INVARIANT(!IsModifying(v));
+    const bool ret = IsLatest(v) && !IsDeleting(v) &&
+                     cgroups_stamp(cgroups) == stamp;
+    return ret && writer_check_version(v);
+  }
+
   inline bool
   latest_value_is_nil() const
   {
@@ -1178,7 +1319,9 @@ public:
   };
   
   typedef size_t (*tuple_writer_t)(TupleWriterMode, const void *, uint8_t *, size_t);
-  typedef void (*tuple_commutative_act)(std::string*, uint64_t);
+  // applied in place to the latest committed value at commit time, returns
+  // false to abort the txn (e.g. an escrow bound would be violated)
+  typedef bool (*tuple_commutative_act)(std::string*, uint64_t);
 
   bool 
   no_append_entry()
@@ -1284,6 +1427,7 @@ public:
       INVARIANT(!spill->is_latest());
       mark_modifying();
       set_next(spill);
+      next_compactor_owned = false;
       if (v)
         writer(TUPLE_WRITER_DO_WRITE, v, get_value_start(), size);
       version = t;
@@ -212,6 +212,23 @@ dbtuple::ic3_read(Reader &reader, StringAllocator &sa, access_entry* e)
 }
 
 
+template <typename Reader, typename StringAllocator>
+inline ALWAYS_INLINE bool
+dbtuple::ic3_read_from(Reader &reader, StringAllocator &sa, access_entry* de)
+{
+    INVARIANT(is_locked());
+    INVARIANT(!de || de->is_write());
+
+    memory_barrier();
+    if (nullptr == de) {
+      if (version == MAX_TID || is_deleting())
+        return false;
+      return reader(get_value_start(), size, sa);
+    }
+    return de->read_record(reader, sa);
+}
+
+
 template <typename Reader, typename StringAllocator>
 inline ALWAYS_INLINE bool
 dbtuple::profile_ic3_read(Reader &reader, StringAllocator &sa, access_entry* e, ic3_profile* prof)
@@ -65,3 +65,10 @@ event_counter transaction_base::g_evt_dbtuple_write_insert_failed
 event_counter transaction_base::evt_local_search_lookups("local_search_lookups");
 event_counter transaction_base::evt_local_search_write_set_hits("local_search_write_set_hits");
 event_counter transaction_base::evt_dbtuple_latest_replacement("dbtuple_latest_replacement");
+event_counter transaction_base::g_evt_multi_op_batches("multi_op_batches");
+event_counter transaction_base::g_evt_multi_op_keys("multi_op_keys");
+event_counter transaction_base::g_evt_dep_txns("dep_txns");
+event_counter transaction_base::g_evt_dep_edges("dep_edges");
+event_counter transaction_base::g_evt_cgroup_skipped_deps("cgroup_skipped_deps");
+event_counter transaction_base::g_evt_status_aborts("status_aborts");
+event_avg_counter transaction_base::g_evt_avg_abort_unwind_cycles("avg_abort_unwind_cycles");
@@ -18,11 +18,13 @@
 
 #include <unordered_map>
 
+#include "access_trace.h"
 #include "amd64.h"
 #include "btree_choice.h"
 #include "conflict_graph.h"
 #include "core.h"
 #include "counter.h"
+#include "hot_records.h"
 #include "learn.h"
 //#include "lock_graph.h"
 #include "macros.h"
@@ -30,6 +32,7 @@
 #include "ndb_type_traits.h"
 #include "piece.h"
 #include "policy.h"
+#include "policy_library.h"
 #include "prefetch.h"
 #include "rcu.h"
 #include "scopedperf.hh"
@@ -81,6 +84,12 @@ public:
     // txn is aborted
     TXN_FLAG_READ_ONLY = 0x2,
 
+    // a policy wait which has to abort the txn marks it aborted and fails
+    // the access instead of throwing transaction_abort_exception. the caller
+    // checks should_abort() when an access fails, every other abort still
+    // throws
+    TXN_FLAG_STATUS_ABORTS = 0x4,
+
     // XXX: more flags in the future, things like consistency levels
   };
 
@@ -98,7 +107,8 @@ public:
     x(ABORT_REASON_READ_ABSENCE_INTEREFERENCE) \
     x(ABORT_REASON_LOCK_FAIL) \
     x(ABORT_REASON_TIMEOUT) \
-    x(ABORT_REASON_EARLY_VALIDATION)
+    x(ABORT_REASON_EARLY_VALIDATION) \
+    x(ABORT_REASON_COMMUTATIVE_BOUND)
 
   enum abort_reason {
 #define ENUM_X(x) x,
@@ -150,6 +160,31 @@ protected:
     return 0;
   }
 
+  // the class of an abort reason in the fingerprint of policy_library
+  static unsigned
+  AbortClass(abort_reason reason)
+  {
+    switch (reason) {
+    case ABORT_REASON_CASCADING:
+      return policy_library::AbortCascading;
+    case ABORT_REASON_TIMEOUT:
+      return policy_library::AbortTimeout;
+    case ABORT_REASON_UNSTABLE_READ:
+    case ABORT_REASON_FUTURE_TID_READ:
+    case ABORT_REASON_NODE_SCAN_WRITE_VERSION_CHANGED:
+    case ABORT_REASON_NODE_SCAN_READ_VERSION_CHANGED:
+    case ABORT_REASON_WRITE_NODE_INTERFERENCE:
+    case ABORT_REASON_INSERT_NODE_INTERFERENCE:
+    case ABORT_REASON_READ_NODE_INTEREFERENCE:
+    case ABORT_REASON_READ_ABSENCE_INTEREFERENCE:
+    case ABORT_REASON_LOCK_FAIL:
+    case ABORT_REASON_EARLY_VALIDATION:
+      return policy_library::AbortValidation;
+    default:
+      return policy_library::AbortOther;
+    }
+  }
+
 public:
 
   // only fires during invariant checking
@@ -183,7 +218,8 @@ protected:
   struct read_record_t {
     //constexpr read_record_t() : tuple(), t() {}
     constexpr read_record_t(const dbtuple *tuple, tid_t cur_pid, uint64_t pid, uint64_t tid, void* txn, uint64_t clean_tid, bool occ_ = false, uint16_t record_contention = 0, access_entry *re = nullptr)
-      : tuple(tuple), t(cur_pid), entry(re), clean_t(clean_tid), occ(occ_), dep_txn(nullptr), dep_tid(0), dep_write_seq(-1), contention(record_contention) {}
+      : tuple(tuple), t(cur_pid), entry(re), clean_t(clean_tid), occ(occ_), dep_txn(nullptr), dep_tid(0), dep_write_seq(-1), contention(record_contention),
+        cgroups(ALL_COLUMN_GROUPS), cg_stamp(0) {}
     inline const dbtuple *
     get_tuple() const
     {
@@ -257,6 +293,24 @@ protected:
     {
       return contention;
     }
+    // the column groups read, and their commit stamp when read (see
+    // dbtuple::cgroups_stamp())
+    inline uint8_t
+    get_cgroups() const
+    {
+      return cgroups;
+    }
+    inline uint64_t
+    get_cg_stamp() const
+    {
+      return cg_stamp;
+    }
+    inline void
+    set_cgroups(uint8_t g, uint64_t stamp)
+    {
+      cgroups = g;
+      cg_stamp = stamp;
+    }
   private:
     const dbtuple *tuple;
     tid_t t;
@@ -267,6 +321,8 @@ protected:
     tid_t dep_tid;
     int dep_write_seq;
     uint16_t contention;
+    uint8_t cgroups;
+    uint64_t cg_stamp;
   };
 
   friend std::ostream &
@@ -277,10 +333,12 @@ protected:
     enum {
       FLAGS_INSERT  = 0x1,
       FLAGS_DOWRITE = 0x1 << 1,
+      FLAGS_COMMUTATIVE = 0x1 << 2,
     };
 
     constexpr inline write_record_t()
-      : tuple(), k(), n(), r(), w(), btr(), entry(nullptr), read_entry(nullptr), occ(false), contention(0)
+      : tuple(), k(), n(), r(), w(), btr(), entry(nullptr), read_entry(nullptr), occ(false), contention(0),
+        cgroups(ALL_COLUMN_GROUPS)
     {}
 
     // all inputs are assumed to be stable
@@ -307,7 +365,8 @@ protected:
         entry(we),
         read_entry(e),
         occ(occ),
-        contention(record_contention)
+        contention(record_contention),
+        cgroups(ALL_COLUMN_GROUPS)
     {
       this->btr.set_flags(insert ? FLAGS_INSERT : 0);
     }
@@ -351,6 +410,17 @@ protected:
     {
       btr.clear_flags(FLAGS_DOWRITE);
     }
+    // value is computed from commutative_set at commit
+    inline bool
+    is_commutative() const
+    {
+      return btr.get_flags() & FLAGS_COMMUTATIVE;
+    }
+    inline void
+    set_commutative()
+    {
+      btr.or_flags(FLAGS_COMMUTATIVE);
+    }
     inline concurrent_btree *
     get_btree() const
     {
@@ -417,6 +487,18 @@ protected:
     {
       return n;
     }
+    // the column groups the write changes, all of them for inserts and
+    // deletes
+    inline uint8_t
+    get_cgroups() const
+    {
+      return cgroups;
+    }
+    inline void
+    set_cgroups(uint8_t g)
+    {
+      cgroups = g;
+    }
   private:
     dbtuple *tuple;
     const string_type *k;
@@ -428,6 +510,7 @@ protected:
     access_entry* read_entry;
     bool occ;
     uint16_t contention;
+    uint8_t cgroups;
   };
 
 
@@ -687,6 +770,25 @@ protected:
   static event_counter evt_local_search_write_set_hits;
   static event_counter evt_dbtuple_latest_replacement;
 
+  // multi_get()/multi_put() batches, and the keys they covered
+  static event_counter g_evt_multi_op_batches;
+  static event_counter g_evt_multi_op_keys;
+
+  // dependencies on other txns tracked, every dependency an access took
+  // (before those on the same txn are merged), and the ones a read or write
+  // did not take since it shares no column group with the access it would
+  // have depended on. cgroup_skipped_deps / (dep_edges + cgroup_skipped_deps)
+  // is the share of dependencies column groups remove, whatever the
+  // interleaving of the run
+  static event_counter g_evt_dep_txns;
+  static event_counter g_evt_dep_edges;
+  static event_counter g_evt_cgroup_skipped_deps;
+
+  // accesses failed by fail_access(), and the cycles from there until the
+  // procedure called abort(), which is what unwinding the abort costs
+  static event_counter g_evt_status_aborts;
+  static event_avg_counter g_evt_avg_abort_unwind_cycles;
+
   CLASS_STATIC_COUNTER_DECL(scopedperf::tsc_ctr, g_txn_commit_probe0, g_txn_commit_probe0_cg);
   CLASS_STATIC_COUNTER_DECL(scopedperf::tsc_ctr, g_txn_commit_probe1, g_txn_commit_probe1_cg);
   CLASS_STATIC_COUNTER_DECL(scopedperf::tsc_ctr, g_txn_commit_probe2, g_txn_commit_probe2_cg);
@@ -990,14 +1092,14 @@ protected:
 
   typedef std::vector<struct insert_record_t> insert_set_map;
 
-  //For simple
-  typedef std::vector<struct commutative_record_t> commutative_map;
+  typedef small_vector<commutative_record_t, 4> commutative_map;
 
 #else
   typedef std::vector<read_record_t> read_set_map;
   typedef std::vector<write_record_t> write_set_map;
   typedef std::vector<absent_record_t> absent_set_map;
   typedef std::vector<uint32_t> write_set_u32_vec;
+  typedef std::vector<commutative_record_t> commutative_map;
 #endif
 
   template <typename T>
@@ -1107,6 +1209,8 @@ public:
   inline void
   abort()
   {
+    if (access_abort_tsc)
+      g_evt_avg_abort_unwind_cycles.offer(rdtsc() - access_abort_tsc);
     abort_impl(ABORT_REASON_USER);
   }
 
@@ -1127,6 +1231,8 @@ public:
   {
     global_listener.abort_distribution[reason] ++;
     AbortReasonCounter(reason)->inc();
+    if (unlikely(policy_library::g_enabled))
+      policy_library::NoteAbort(AbortClass(reason));
   }
 #endif
 
@@ -1267,6 +1373,11 @@ public:
   bool 
   do_get(concurrent_btree &btr, const std::string* key_str, ValueReader& value_reader, uint32_t acc_id);
 
+  // k need only live for the call, see mix_op::do_get(const varkey &)
+  template <typename ValueReader>
+  bool
+  do_get(concurrent_btree &btr, const varkey &k, ValueReader& value_reader, uint32_t acc_id);
+
   template <typename ValueReader> 
   bool 
   profile_do_get(concurrent_btree &btr, const std::string* key_str, ValueReader& value_reader, ic3_profile* prof);
@@ -1287,6 +1398,17 @@ public:
   do_update(concurrent_btree &btr, const std::string *key_str, ValueReader &value_reader, update_callback *callback,
             ValueWriter &value_writer, uint32_t acc_id);
 
+  // see mix_op::do_multi_get()/do_multi_put(), n <= MULTI_OP_BATCH
+  template <typename ReaderAt>
+  size_t
+  do_multi_get(concurrent_btree &btr, const std::string *const *key_strs, size_t n,
+               ReaderAt &reader_at, bool *found, uint32_t acc_id);
+
+  template <typename ValueWriter>
+  bool
+  do_multi_put(concurrent_btree &btr, const std::string *const *key_strs, void *const *val_strs,
+               size_t n, ValueWriter &value_writer, uint32_t acc_id);
+
   inline void update_txn_step(uint32_t acc_id) {
     if (txn_type == 0 || acc_id == MAX_ACC_ID)
       return;
@@ -1300,27 +1422,69 @@ public:
     }
   }
 
-  ALWAYS_INLINE void before_access_operation(PolicyAction *pa = nullptr) {
-    if (pa == nullptr) return;
+  // see access_trace, called right after refresh_policy() by every access
+  inline void trace_access(const concurrent_btree &btr, size_t klen,
+                           uint32_t acc_id, OpType type,
+                           commutative_kind kind = CommutativeNone) {
+    if (likely(!access_trace::g_enabled) || txn_type == 0 || acc_id == MAX_ACC_ID)
+      return;
+    access_trace::Record(txn_type, acc_id, &btr, klen, type, kind);
+  }
+
+  // see hot_records, called by the accesses which know the key of the
+  // record they are about to wait on, before they wait
+  inline void name_rec(const dbtuple *rec, const concurrent_btree &btr,
+                       const varkey &k) {
+    if (likely(!hot_records::g_enabled) || !rec)
+      return;
+    named_rec = rec;
+    named_btr = &btr;
+    named_key.assign((const char *) k.data(), k.size());
+  }
+
+  // see hot_records, called on the aborts and waits rec is to blame for.
+  // rec is named by the last name_rec() or else by the write set, if either
+  // knows it
+  inline void note_conflict(const dbtuple *rec) {
+    if (likely(!hot_records::g_enabled) || !rec)
+      return;
+    if (rec == named_rec) {
+      hot_records::Record(rec, feature->cur_acc_id, named_btr, &named_key);
+      return;
+    }
+    for (auto &w : write_set)
+      if (w.get_tuple() == rec) {
+        hot_records::Record(rec, feature->cur_acc_id, w.get_btree(), &w.get_key());
+        return;
+      }
+    hot_records::Record(rec, feature->cur_acc_id);
+  }
+
+  // false iff the wait failed the access, see fail_access()
+  ALWAYS_INLINE bool before_access_operation(PolicyAction *pa = nullptr) {
+    if (pa == nullptr) return true;
     txn_current_rank = pa->rank;
-    do_wait(pa->access,
-            pa->rank,
-            pa->timeout,
-            pa->safeguard);
+    // cur_step is this access, see update_txn_step()
+    return do_wait(pa->access,
+                   pa->rank,
+                   pa->timeout,
+                   pa->safeguard,
+                   txn_type && cur_step && cur_step <= MAX_TXN_ACCESSES ?
+                     txn_guard[txn_type - 1][cur_step - 1] : nullptr);
   }
 
-  ALWAYS_INLINE void before_commit_piece_operation(PolicyAction *pa, bool is_final) {
-    if(pa == nullptr) return;
+  ALWAYS_INLINE bool before_commit_piece_operation(PolicyAction *pa, bool is_final) {
+    if(pa == nullptr) return true;
     if (unlikely(is_final)) {
-      do_wait(before_commit_policy.access,
-              before_commit_policy.rank,
-              before_commit_policy.timeout,
-              before_commit_policy.safeguard);
+      return do_wait(before_commit_policy.access,
+                     before_commit_policy.rank,
+                     before_commit_policy.timeout,
+                     before_commit_policy.safeguard);
     } else {
-      do_wait(pa->expose_access,
-              pa->expose_rank,
-              pa->expose_timeout,
-              pa->expose_safeguard);
+      return do_wait(pa->expose_access,
+                     pa->expose_rank,
+                     pa->expose_timeout,
+                     pa->expose_safeguard);
     }
   }
 
@@ -1348,10 +1512,14 @@ public:
     return tid;
   }
 
-  ALWAYS_INLINE PolicyAction* refresh_policy(uint32_t acc_id, OpType type) {
+  // rec is the record accessed, if it is known before the access
+  ALWAYS_INLINE PolicyAction* refresh_policy(uint32_t acc_id, OpType type,
+                                             const dbtuple *rec = nullptr) {
     if (acc_id == MAX_ACC_ID || type == OpNone || txn_type == 0) {
       return nullptr;
     }
+    cur_rec = rec;
+    feature->rec_hot = rec && hot_records::IsHot(rec);
     if (acc_id >= ACCESSES) {
       assert(type == OpCommit);
       acc_id -= ACCESSES;
@@ -1399,8 +1567,23 @@ public:
   bool
   atomic_piece_abort();
 
-  // execute the waiting logic according to the agent decision
-  void do_wait(AccessPolicy access, double rank, uint32_t timeout, uint32_t safeguard[TXN_TYPE]);
+  // execute the waiting logic according to the agent decision, returns
+  // false iff it failed the access (see fail_access())
+  // guard: the steps of the profile's static chopping (see txn_guard) a
+  // detect_guarded wait waits for at least, nullptr for none
+  bool do_wait(AccessPolicy access, double rank, uint32_t timeout, uint32_t safeguard[TXN_TYPE],
+               const uint32_t *guard = nullptr);
+
+  // aborts the txn from within an access: marks it aborted and throws r,
+  // or with TXN_FLAG_STATUS_ABORTS returns false for the access to fail;
+  // the conflict is charged to rec, or to cur_rec if none
+  bool fail_access(abort_reason r, const dbtuple *rec = nullptr);
+
+  inline bool
+  status_aborted() const
+  {
+    return (get_flags() & TXN_FLAG_STATUS_ABORTS) && state == TXN_ABRT;
+  }
 
 protected:
   // expected protected overrides
@@ -1506,7 +1689,8 @@ public:
     
   // }
 
-  inline void add_dep_txn(uint64_t tid, void* txn, bool dirty_read_dep = false);
+  // rec: the record the dependency came through, nullptr for none
+  inline void add_dep_txn(uint64_t tid, void* txn, const dbtuple *rec, bool dirty_read_dep = false);
 
 
 public:
@@ -1560,11 +1744,23 @@ public:
   handle_last_tuple_in_group_expose_piece(
       dbtuple_read_write_info &info, bool is_write, bool lock_mode);
 
+  // appends one private write per tuple in commutative_set, so those tuples
+  // are locked in order with the rest of the write set
+  inline void fold_commutative_set();
+
+  // fills in the folded writes once every write lock is held. returns
+  // ABORT_REASON_NONE, ABORT_REASON_COMMUTATIVE_BOUND if an act refuses
+  // (escrow bound), ABORT_REASON_WRITE_NODE_INTERFERENCE if another txn
+  // deleted the tuple or ABORT_REASON_USER if this one did
+  inline abort_reason apply_commutative_set();
+
 
   const uint8_t txn_type;
   const tid_t tid;
   uint64_t cur_step;
   volatile double txn_current_rank = lowest_priority;
+  // rdtsc() when fail_access() aborted the txn, 0 if it did not
+  uint64_t access_abort_tsc = 0;
 #if COUNT_TX_BLOCK
   uint32_t txn_current_blocking = 0;
 #endif
@@ -1587,7 +1783,9 @@ public:
   // insert_set_map insert_set;
 
   dep_queue_map  dep_queue;
-  // commutative_map commutative_set;
+  // add/min/max style ops which only touch the committed value, kept out of
+  // the read/write sets so they never conflict with each other
+  commutative_map commutative_set;
 
   // read_unexposed_map read_unexposed;
   // write_unexposed_map write_unexposed;
@@ -1595,6 +1793,8 @@ public:
   uint32_t read_set_start;
   uint32_t read_access_start;
   uint32_t write_set_start;
+  uint32_t commutative_write_start;
+  uint32_t commutative_start;
   uint32_t write_access_start;
   // uint32_t insert_set_start;
   uint32_t dep_queue_start;
@@ -1607,6 +1807,11 @@ protected:
   uint32_t valid_acc_id;
   uint32_t last_commit_piece_acc_id;
 
+  const dbtuple *cur_rec; // of the last refresh_policy(), blamed for waits on no record
+  const dbtuple *named_rec; // see name_rec()
+  const concurrent_btree *named_btr;
+  std::string named_key;
+
   uint16_t rw_highest_contention; // the highest contention this txn has ever seen
   uint16_t piece_contention;
   std::vector<void *> clean_read_failed_tuples;
@@ -1680,6 +1885,11 @@ struct txn_epoch_sync {
     compute_ntxn_persisted() { return {0, 0.0}; }
   // reset the persisted counters
   static inline void reset_ntxn_persisted() {}
+  // the epoch the last txn this thread committed has to wait for before it
+  // is acknowledged, 0 if none
+  static inline uint64_t take_commit_epoch() { return 0; }
+  // whether every txn of epoch e is durable
+  static inline bool is_epoch_persisted(uint64_t e) { return true; }
 };
 
 #endif /* _NDB_TXN_H_ */
@@ -124,6 +124,37 @@ struct txn_btree_ {
     size_t max_bytes_read;
   };
 
+  // hands the record bytes to a decoder instead of copying them, so they
+  // are decoded straight out of the tuple (or the uncommitted value being
+  // read). Decoder implements bool operator()(const uint8_t *, size_t) like
+  // abstract_ordered_index::value_decoder: it is called again whenever the
+  // bytes changed under it, and returning false for bytes which did not
+  // change fails the read (READ_FAILED, which aborts the txn)
+  template <typename Decoder>
+  class decoding_value_reader {
+  public:
+    typedef std::string value_type;
+
+    constexpr decoding_value_reader(Decoder *d) : d(d) {}
+
+    template <typename StringAllocator>
+    inline bool
+    operator()(const uint8_t *data, size_t sz, StringAllocator &sa)
+    {
+      return (*d)(data, sz);
+    }
+
+    template <typename StringAllocator>
+    inline void
+    dup(const std::string &vdup, StringAllocator &sa)
+    {
+      ALWAYS_ASSERT((*d)((const uint8_t *) vdup.data(), vdup.size()));
+    }
+
+  private:
+    Decoder *d;
+  };
+
   class value_writer {
   public:
     constexpr value_writer(const std::string *v) : v(v) {}
@@ -326,7 +357,8 @@ public:
          size_t max_bytes_read = string_type::npos,
          uint32_t acc_id = MAX_ACC_ID)
   {
-    return search(t, to_string_type(k), v, max_bytes_read, acc_id);
+    single_value_reader_type r(&v, max_bytes_read);
+    return this->do_search_key(t, k, r, acc_id);
   }
 
   // either returns false or v is set to not-empty with value
@@ -343,6 +375,30 @@ public:
     return this->do_search(t, k, r, acc_id);
   }
 
+  // like search(), but decodes the record in place instead of copying it
+  // into a string, see txn_btree_::decoding_value_reader
+  template <typename Traits, typename Decoder>
+  inline bool
+  search_decoded(Transaction<Traits> &t,
+                 const key_type &k,
+                 Decoder &decoder,
+                 uint32_t acc_id = MAX_ACC_ID)
+  {
+    txn_btree_::decoding_value_reader<Decoder> r(&decoder);
+    return this->do_search(t, k, r, acc_id);
+  }
+
+  template <typename Traits, typename Decoder>
+  inline bool
+  search_decoded(Transaction<Traits> &t,
+                 const varkey &k,
+                 Decoder &decoder,
+                 uint32_t acc_id = MAX_ACC_ID)
+  {
+    txn_btree_::decoding_value_reader<Decoder> r(&decoder);
+    return this->do_search_key(t, k, r, acc_id);
+  }
+
   template <typename Traits>
   inline bool
   profile_search(Transaction<Traits> &t,
@@ -477,9 +533,11 @@ public:
   commutative_act(Transaction<Traits> &t, 
                   const key_type &key, 
                   dbtuple::tuple_commutative_act act,
-                  uint64_t param)
+                  uint64_t param,
+                  commutative_kind kind,
+                  uint32_t acc_id = MAX_ACC_ID)
   {
-    this->do_commutative_act(t, stablize(t, key), act, param, txn_btree_::tuple_writer);
+    this->do_commutative_act(t, stablize(t, key), act, param, kind, txn_btree_::tuple_writer, acc_id);
   }
 
   template <typename Traits>
@@ -492,6 +550,45 @@ public:
         txn_btree_::tuple_writer, false, acc_id);
   }
 
+  // search()/put() of n keys at once, for a txn which knows its key set up
+  // front (see base_txn_btree::do_multi_search()). found[i] tells if keys[i]
+  // was found, returns how many were
+  template <typename Traits>
+  inline size_t
+  multi_search(Transaction<Traits> &t,
+               const key_type *keys,
+               value_type *values,
+               size_t n,
+               bool *found,
+               uint32_t acc_id = MAX_ACC_ID)
+  {
+    auto reader_at = [values](size_t i) {
+      return single_value_reader_type(&values[i], string_type::npos);
+    };
+    return this->do_multi_search(t, keys, n, reader_at, found, acc_id);
+  }
+
+  template <typename Traits>
+  inline void
+  multi_put(Transaction<Traits> &t,
+            const key_type *keys,
+            const value_type *values,
+            size_t n,
+            uint32_t acc_id = MAX_ACC_ID)
+  {
+    const std::string *ks[MULTI_OP_BATCH];
+    const std::string *vs[MULTI_OP_BATCH];
+    for (size_t off = 0; off < n; off += MULTI_OP_BATCH) {
+      const size_t m = std::min(n - off, size_t(MULTI_OP_BATCH));
+      for (size_t i = 0; i < m; i++) {
+        assert(!values[off + i].empty());
+        ks[i] = stablize(t, keys[off + i]);
+        vs[i] = stablize(t, values[off + i]);
+      }
+      this->do_multi_tree_put(t, ks, vs, m, txn_btree_::tuple_writer, acc_id);
+    }
+  }
+
   template <typename Traits>
   inline void
   update(Transaction<Traits> &t, const key_type &k, value_type &v, update_callback *callback, uint32_t acc_id = MAX_ACC_ID)
@@ -39,7 +39,7 @@ struct ic3_profile {
   
 } CACHE_ALIGNED;
 
-// struct dbtuple;
+struct dbtuple;
 
 struct txn_entry {
 
@@ -59,11 +59,13 @@ struct txn_wait_entry
   bool dirty_read_dep;
   uint64_t tid;
   void* txn;
-  
-  constexpr txn_wait_entry(bool dirty_read_dep, uint64_t tid, void *txn)
+  const dbtuple *rec; // the dependency came through, blamed for waits on it
+
+  constexpr txn_wait_entry(bool dirty_read_dep, uint64_t tid, void *txn, const dbtuple *rec)
     :dirty_read_dep(dirty_read_dep)
      ,tid(tid)
-     ,txn(txn){} 
+     ,txn(txn)
+     ,rec(rec){}
 };
 
 
@@ -110,6 +112,9 @@ public:
   //MAXCPU is 256
   volatile uint16_t readers;
 
+  // column groups read or written, see access_cgroups in policy.h
+  uint8_t cgroups;
+
 protected:
   access_entry* volatile prev;
   access_entry* volatile next;
@@ -125,6 +130,7 @@ public:
     , txn(pid, tid, txn)
     , sflag(0)
     , readers(0)
+    , cgroups(ALL_COLUMN_GROUPS)
     , prev(nullptr)
     , next(nullptr)
     , write_seq(-1) {}
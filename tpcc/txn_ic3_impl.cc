@@ -16,9 +16,14 @@ using namespace util;
                     /** logger subsystem **/
 /*{{{*/
 bool txn_logger::g_persist = false;
+__thread uint64_t txn_logger::tl_last_commit_epoch = 0;
 bool txn_logger::g_call_fsync = true;
 bool txn_logger::g_use_compression = false;
 bool txn_logger::g_fake_writes = false;
+int txn_logger::g_catalog_fd = -1;
+int txn_logger::g_pepoch_fd = -1;
+uint32_t txn_logger::g_ntables = 0;
+spinlock txn_logger::g_catalog_lock;
 size_t txn_logger::g_nworkers = 0;
 txn_logger::epoch_array
   txn_logger::per_thread_sync_epochs_[txn_logger::g_nmax_loggers];
@@ -40,6 +45,10 @@ event_counter
   txn_logger::g_evt_logger_writev_limit_met("logger_writev_limit_met");
 event_counter
   txn_logger::g_evt_logger_max_lag_wait("logger_max_lag_wait");
+event_counter
+  txn_logger::g_evt_logger_prealloc_extend("logger_prealloc_extend");
+event_counter
+  txn_logger::g_evt_logger_short_writev("logger_short_writev");
 event_avg_counter
   txn_logger::g_evt_avg_log_buffer_compress_time_us("avg_log_buffer_compress_time_us");
 event_avg_counter
@@ -77,15 +86,29 @@ txn_logger::Init(
     }
     fds.push_back(fd);
   }
+  g_catalog_fd = open(
+      CatalogFileName(logfiles[0]).c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0664);
+  g_pepoch_fd = open(
+      PersistentEpochFileName(logfiles[0]).c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0664);
+  if (g_catalog_fd == -1 || g_pepoch_fd == -1) {
+    perror("open");
+    ALWAYS_ASSERT(false);
+  }
+  const string hdr = "compress " + to_string(use_compression ? 1 : 0) + "\n";
+  ALWAYS_ASSERT(write(g_catalog_fd, hdr.data(), hdr.size()) == ssize_t(hdr.size()));
+  const uint64_t zero = 0;
+  ALWAYS_ASSERT(pwrite(g_pepoch_fd, &zero, sizeof(zero), 0) == sizeof(zero));
   g_persist = true;
   g_call_fsync = call_fsync;
   g_use_compression = use_compression;
   g_fake_writes = fake_writes;
   g_nworkers = nworkers;
 
-  for (size_t i = 0; i < g_nmax_loggers; i++)
+  for (size_t i = 0; i < g_nmax_loggers; i++) {
     for (size_t j = 0; j < g_nworkers; j++)
       per_thread_sync_epochs_[i].epochs_[j].store(0, memory_order_release);
+    per_thread_sync_epochs_[i].nwrites_.store(0, memory_order_release);
+  }
 
   vector<thread> writers;
   vector<vector<unsigned>> assignments(assignments_given);
@@ -125,21 +148,52 @@ txn_logger::Init(
     *assignments_used = assignments;
 }
 
+uint32_t
+txn_logger::RegisterTable(const string &name)
+{
+  if (!g_persist)
+    return 0;
+  ::lock_guard<spinlock> l(g_catalog_lock);
+  const uint32_t id = ++g_ntables;
+  const string line = to_string(id) + " " + name + "\n";
+  if (write(g_catalog_fd, line.data(), line.size()) != ssize_t(line.size()) ||
+      (g_call_fsync && fdatasync(g_catalog_fd) == -1)) {
+    perror("catalog");
+    ALWAYS_ASSERT(false);
+  }
+  return id;
+}
+
 void
 txn_logger::persister(
     vector<vector<unsigned>> assignments)
 {
+  // poll several times per epoch, and advance as soon as any logger
+  // finished a write: a whole epoch group of commits becomes durable (and
+  // can be acked) right when its last buffer hits the disk, instead of up
+  // to a tick later. idle cores still get advanced at least once a tick
+  const uint64_t poll_usec =
+    max<uint64_t>(1, ticker::tick_us / g_persister_polls_per_epoch);
+  uint64_t last_nwrites = 0, last_advance_us = 0;
   timer loop_timer;
   for (;;) {
     const uint64_t last_loop_usec = loop_timer.lap();
-    const uint64_t delay_time_usec = ticker::tick_us;
-    if (last_loop_usec < delay_time_usec) {
-      const uint64_t sleep_ns = (delay_time_usec - last_loop_usec) * 1000;
+    if (last_loop_usec < poll_usec) {
+      const uint64_t sleep_ns = (poll_usec - last_loop_usec) * 1000;
       struct timespec t;
       t.tv_sec  = sleep_ns / ONE_SECOND_NS;
       t.tv_nsec = sleep_ns % ONE_SECOND_NS;
       nanosleep(&t, nullptr);
     }
+    uint64_t nwrites = 0;
+    for (size_t i = 0; i < assignments.size(); i++)
+      nwrites += per_thread_sync_epochs_[i].nwrites_.load(memory_order_acquire);
+    const uint64_t now_us = timer::cur_usec();
+    if (nwrites == last_nwrites &&
+        now_us - last_advance_us < ticker::tick_us)
+      continue;
+    last_nwrites = nwrites;
+    last_advance_us = now_us;
     advance_system_sync_epoch(assignments);
   }
 }
@@ -218,6 +272,16 @@ txn_logger::advance_system_sync_epoch(
   }
 
   system_sync_epoch_->store(min_so_far, memory_order_release);
+
+  // every logger has already synced the epochs up to min_so_far, so
+  // recording it afterwards is enough for recovery to find a consistent cut
+  if (min_so_far > syssync && !g_fake_writes) {
+    if (pwrite(g_pepoch_fd, &min_so_far, sizeof(min_so_far), 0) != sizeof(min_so_far) ||
+        (g_call_fsync && fdatasync(g_pepoch_fd) == -1)) {
+      perror("pepoch");
+      ALWAYS_ASSERT(false);
+    }
+  }
 }
 
 void
@@ -236,6 +300,11 @@ txn_logger::writer(
   vector<pbuffer *> pxs;
   timer loop_timer;
 
+  // the file is grown g_log_prealloc_size at a time ahead of the writes, so
+  // a write (and its fdatasync) never has to extend the file. the tail past
+  // file_off stays zeroed, which readers see as a buffer with no entries
+  off_t file_off = 0, file_alloc = 0;
+
   // XXX: sense is not useful for now, unless we want to
   // fsync in the background...
   bool sense = false; // cur is at sense, prev is at !sense
@@ -345,10 +414,48 @@ txn_logger::writer(
 #ifdef ENABLE_EVENT_COUNTERS
       timer write_timer;
 #endif
-      const ssize_t ret = writev(fd, &iovs[0], nbufswritten);
-      if (unlikely(ret == -1)) {
-        perror("writev");
-        ALWAYS_ASSERT(false);
+      if (unlikely(file_off + off_t(nbyteswritten) > file_alloc)) {
+        const off_t grow =
+          max(off_t(g_log_prealloc_size),
+              off_t(util::iceil(nbyteswritten, g_log_prealloc_size)));
+        const int aret = posix_fallocate(fd, file_alloc, grow);
+        if (unlikely(aret)) {
+          errno = aret;
+          perror("posix_fallocate");
+          ALWAYS_ASSERT(false);
+        }
+        file_alloc += grow;
+        ++g_evt_logger_prealloc_extend;
+      }
+
+      // pwritev() may write less than asked for, the rest is written from
+      // the first iov not fully written on
+      struct iovec *iov = &iovs[0];
+      size_t niovs = nbufswritten;
+      size_t nleft = nbyteswritten;
+      while (nleft) {
+        const ssize_t ret = pwritev(fd, iov, niovs, file_off);
+        if (unlikely(ret == -1)) {
+          if (errno == EINTR)
+            continue;
+          perror("pwritev");
+          ALWAYS_ASSERT(false);
+        }
+        ALWAYS_ASSERT(ret > 0);
+        file_off += ret;
+        nleft -= ret;
+        size_t n = ret;
+        while (niovs && n >= iov->iov_len) {
+          n -= iov->iov_len;
+          iov++;
+          niovs--;
+        }
+        if (n) {
+          iov->iov_base = (char *) iov->iov_base + n;
+          iov->iov_len -= n;
+        }
+        if (nleft)
+          ++g_evt_logger_short_writev;
       }
 
       if (g_call_fsync) {
@@ -403,6 +510,7 @@ txn_logger::writer(
         }
       }
     }
+    non_atomic_fetch_add(ea.nwrites_, 1UL);
 
     // bump the sense
     sense = !sense;
@@ -487,7 +595,8 @@ transaction_ic3_static::InitGC()
 static void
 sleep_ro_epoch()
 {
-  const uint64_t sleep_ns = transaction_ic3_static::ReadOnlyEpochUsec * 1000;
+  const uint64_t sleep_ns =
+    transaction_ic3_static::CurrentReadOnlyEpochUsec() * 1000;
   struct timespec t;
   t.tv_sec  = sleep_ns / ONE_SECOND_NS;
   t.tv_nsec = sleep_ns % ONE_SECOND_NS;
@@ -525,6 +634,206 @@ transaction_ic3_static::PurgeThreadOutstandingGCTasks()
   INVARIANT(ctx.queue_.empty());
 }
 
+static uint64_t
+ms_to_read_only_multiplier(uint64_t ms)
+{
+  return max<uint64_t>(1, (ms * 1000 + ticker::tick_us / 2) / ticker::tick_us);
+}
+
+void
+transaction_ic3_static::SetReadOnlyEpoch(uint64_t ms)
+{
+  SetAdaptiveReadOnlyEpoch(ms, ms, 0);
+}
+
+void
+transaction_ic3_static::SetAdaptiveReadOnlyEpoch(
+    uint64_t min_ms, uint64_t max_ms, uint64_t max_versions)
+{
+  ALWAYS_ASSERT(min_ms <= max_ms);
+  g_ro_config->min_multiplier_.store(
+      ms_to_read_only_multiplier(min_ms), memory_order_release);
+  g_ro_config->max_multiplier_.store(
+      ms_to_read_only_multiplier(max_ms), memory_order_release);
+  g_ro_config->max_versions_.store(max_versions, memory_order_release);
+  ticker::s_instance.add_tick_callback(&transaction_ic3_static::on_tick);
+}
+
+void
+transaction_ic3_static::on_tick(uint64_t tick)
+{
+  // only runs on the ticker thread, so it is the only writer of the segments
+  const ro_epoch_segment &s = *ro_segment_of_tick(tick);
+  if ((tick - s.start_tick_) % s.multiplier_)
+    return;
+  const uint64_t ro_tick = s.ro_tick_ + (tick - s.start_tick_) / s.multiplier_;
+
+  // what happened during the read only epoch which just ended
+  static uint64_t last_nspills = 0, last_nro_txns = 0;
+  uint64_t nspills = 0, nro_txns = 0;
+  for (size_t i = 0; i < NMAXCORES; i++) {
+    const threadctx *ctx = g_threadctxs.view(i);
+    if (!ctx)
+      continue;
+    nspills += ctx->nspills_;
+    nro_txns += ctx->nro_txns_;
+  }
+  const uint64_t spills = nspills - last_nspills;
+  const uint64_t ro_txns = nro_txns - last_nro_txns;
+  last_nspills = nspills;
+  last_nro_txns = nro_txns;
+  g_evt_avg_ro_epoch_ms.offer(s.multiplier_ * ticker::tick_us / 1000);
+
+  const uint64_t lo = g_ro_config->min_multiplier_.load(memory_order_acquire);
+  const uint64_t hi = g_ro_config->max_multiplier_.load(memory_order_acquire);
+  const uint64_t max_versions = g_ro_config->max_versions_.load(memory_order_acquire);
+  uint64_t m = s.multiplier_;
+  if (lo == hi) {
+    m = lo;
+  } else {
+    const bool pressure = max_versions && 2 * spills > max_versions;
+    if (pressure || ro_txns)
+      m = max(lo, m / 2);
+    else if (!max_versions || 8 * spills < max_versions)
+      m = min(hi, m * 2);
+    m = min(hi, max(lo, m));
+  }
+  if (m == s.multiplier_)
+    return;
+
+  const size_t n = g_ro_nsegments.load(memory_order_acquire);
+  size_t first = g_ro_first_segment.load(memory_order_acquire);
+  if (n - first == MaxReadOnlyEpochSegments) {
+    // give up the segments which end before the oldest read only epoch a
+    // live txn can read from, see gc_maybe_clean()
+    const uint64_t last_tick_ex = ticker::s_instance.global_last_tick_exclusive();
+    const uint64_t ro_tick_ex = last_tick_ex ? to_read_only_tick(last_tick_ex - 1) : 0;
+    if (ro_tick_ex) {
+      const uint64_t oldest_tick = read_only_tick_start(ro_tick_ex - 1);
+      const size_t first0 = first;
+      while (n - first > 1 && ro_segment(first + 1).start_tick_ <= oldest_tick)
+        first++;
+      g_evt_ro_epoch_segments_reclaimed += first - first0;
+      // readers which still look at a slot we reuse notice, see
+      // ro_segment_of_tick()
+      g_ro_first_segment.store(first, memory_order_release);
+      atomic_thread_fence(memory_order_release);
+    }
+  }
+  if (unlikely(n - first == MaxReadOnlyEpochSegments)) {
+    // every segment is still needed: the length stays as it is until
+    // the snapshots of some of them are gone
+    static bool s_reported = false;
+    if (!s_reported) {
+      cerr << "[WARNING] read only epoch: " << MaxReadOnlyEpochSegments
+           << " lengths in use by live snapshots, not adapting until some"
+           << " are reclaimed" << endl;
+      s_reported = true;
+    }
+    ++g_evt_ro_epoch_changes_dropped;
+    return;
+  }
+  ro_epoch_segment &ns = g_ro_segments[n % MaxReadOnlyEpochSegments];
+  ns.start_tick_ = tick;
+  ns.ro_tick_ = ro_tick;
+  ns.multiplier_ = m;
+  g_ro_nsegments.store(n + 1, memory_order_release);
+  ++g_evt_ro_epoch_changes;
+}
+
+bool
+transaction_ic3_static::compact_chain(
+    threadctx &ctx, dbtuple *head, uint64_t guard_tick, uint64_t ro_tick)
+{
+  INVARIANT(head->is_locked());
+  dbtuple * const spill = head->get_next();
+  INVARIANT(spill);
+  INVARIANT(!head->next_compactor_owned);
+
+  // every running or future snapshot reads all epochs before horizon, so
+  // the first version older than that is the last one anybody can see.
+  // while we hold guard_tick the background GC only reaps versions behind
+  // one older than safe_epoch, so next can be followed from younger ones
+  // (and from any version whose next the compactor owns)
+  const uint64_t last_tick_ex = ticker::s_instance.global_last_tick_exclusive();
+  const uint64_t horizon =
+    read_only_tick_start(to_read_only_tick(last_tick_ex - 1));
+  const uint64_t safe_epoch =
+    read_only_tick_start(to_read_only_tick(guard_tick - 1));
+  INVARIANT(horizon <= safe_epoch);
+
+  size_t len = 1;
+  dbtuple *p = spill, *cut = nullptr;
+  for (;;) {
+    if (p->version != dbtuple::MAX_TID && EpochId(p->version) < horizon) {
+      cut = p;
+      break;
+    }
+    dbtuple * const n = p->get_next();
+    if (!n ||
+        !(p->next_compactor_owned ||
+          p->version == dbtuple::MAX_TID || EpochId(p->version) >= safe_epoch))
+      break;
+    p = n;
+    len++;
+  }
+
+  if (cut && cut->get_next()) {
+    // free the versions we own, the rest of the tail belongs to the
+    // background GC and is unreachable now as well
+    dbtuple *q = cut->get_next();
+    bool owned = cut->next_compactor_owned;
+    cut->clear_next();
+    cut->next_compactor_owned = false;
+    size_t n = 0, nbytes = 0;
+    while (q && owned) {
+      dbtuple * const nq = q->get_next();
+      owned = q->next_compactor_owned;
+      nbytes += q->alloc_size + sizeof(dbtuple);
+      n++;
+      rcu::s_instance.free_with_fn(q, dbtuple::deleter);
+      q = nq;
+    }
+    if (n) {
+      ++g_evt_chain_compactions;
+      g_evt_chain_compact_versions_reclaimed += n;
+      g_evt_chain_compact_bytes_reclaimed += nbytes;
+    }
+  }
+  g_evt_avg_chain_compact_len.offer(len);
+
+  if (len >= ChainCompactThreshold()) {
+    head->next_compactor_owned = true;
+    return true;
+  }
+  // cold again: the background GC takes the spill, and whatever we still
+  // own behind it, since we may not be able to get past the spill later
+  if (spill->next_compactor_owned)
+    hand_off_chain(ctx, spill, ro_tick);
+  return false;
+}
+
+void
+transaction_ic3_static::hand_off_chain(
+    threadctx &ctx, dbtuple *head, uint64_t ro_tick)
+{
+  dbtuple *p = head;
+  while (p->next_compactor_owned) {
+    dbtuple * const n = p->get_next();
+    INVARIANT(n);
+    p->next_compactor_owned = false;
+#ifdef CHECK_INVARIANTS
+    uint64_t exp = 0;
+    INVARIANT(n->opaque.compare_exchange_strong(exp, 1, memory_order_acq_rel));
+#endif
+    ctx.queue_.enqueue(
+        delete_entry(p, p->version, n, marked_ptr<string>(), nullptr),
+        ro_tick);
+    ++g_evt_chain_compact_handoffs;
+    p = n;
+  }
+}
+
 //#ifdef CHECK_INVARIANTS
 //// make sure hidden is blocked by version e, when traversing from start
 //static bool
@@ -642,7 +951,7 @@ transaction_ic3_static::clean_up_to_including(threadctx &ctx, uint64_t ro_tick_g
         ctx.queue_.enqueue(
             delete_entry(
               nullptr,
-              MakeTid(CoreMask, NumIdMask >> NumIdShift, (my_ro_tick + 1) * ReadOnlyEpochMultiplier - 1),
+              MakeTid(CoreMask, NumIdMask >> NumIdShift, read_only_tick_start(my_ro_tick + 1) - 1),
               delent.tuple(),
               marked_ptr<string>(),
               nullptr),
@@ -705,6 +1014,16 @@ aligned_padded_elem<transaction_ic3_static::flags>
   transaction_ic3_static::g_flags;
 percore_lazy<transaction_ic3_static::threadctx>
   transaction_ic3_static::g_threadctxs;
+transaction_ic3_static::ro_epoch_segment
+  transaction_ic3_static::g_ro_segments[MaxReadOnlyEpochSegments] = {
+    {0, 0, ReadOnlyEpochMultiplier},
+  };
+atomic<size_t>
+  transaction_ic3_static::g_ro_first_segment(0);
+atomic<size_t>
+  transaction_ic3_static::g_ro_nsegments(1);
+aligned_padded_elem<transaction_ic3_static::ro_epoch_config>
+  transaction_ic3_static::g_ro_config;
 event_counter
   transaction_ic3_static::g_evt_worker_thread_wait_log_buffer(
       "worker_thread_wait_log_buffer");
@@ -720,3 +1039,33 @@ event_avg_counter
 event_avg_counter
   transaction_ic3_static::g_evt_avg_proto_gc_queue_len(
       "avg_proto_gc_queue_len");
+event_counter
+  transaction_ic3_static::g_evt_chain_compactions(
+      "chain_compactions");
+event_counter
+  transaction_ic3_static::g_evt_chain_compact_versions_reclaimed(
+      "chain_compact_versions_reclaimed");
+event_counter
+  transaction_ic3_static::g_evt_chain_compact_bytes_reclaimed(
+      "chain_compact_bytes_reclaimed");
+event_counter
+  transaction_ic3_static::g_evt_chain_compact_handoffs(
+      "chain_compact_handoffs");
+event_avg_counter
+  transaction_ic3_static::g_evt_avg_chain_compact_len(
+      "avg_chain_compact_len");
+event_counter
+  transaction_ic3_static::g_evt_ro_epoch_changes(
+      "ro_epoch_changes");
+event_counter
+  transaction_ic3_static::g_evt_ro_epoch_changes_dropped(
+      "ro_epoch_changes_dropped");
+event_counter
+  transaction_ic3_static::g_evt_ro_epoch_segments_reclaimed(
+      "ro_epoch_segments_reclaimed");
+event_avg_counter
+  transaction_ic3_static::g_evt_avg_ro_epoch_ms(
+      "avg_ro_epoch_ms");
+event_avg_counter
+  transaction_ic3_static::g_evt_avg_ro_snapshot_staleness_ms(
+      "avg_ro_snapshot_staleness_ms");
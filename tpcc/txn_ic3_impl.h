@@ -38,6 +38,8 @@ public:
   static const size_t g_horizon_buffer_size = 2 * (1<<16); // in bytes
   static const size_t g_max_lag_epochs = 128; // cannot lag more than 128 epochs
   static const bool   g_pin_loggers_to_numa_nodes = false;
+  static const size_t g_log_prealloc_size = (1<<26); // log files grow 64MB at a time
+  static const size_t g_persister_polls_per_epoch = 8;
 
   static inline bool
   IsPersistenceEnabled()
@@ -64,6 +66,26 @@ public:
       bool use_compression = false,
       bool fake_writes = false);
 
+  // registers a tree in the log catalog and returns the id its records are
+  // logged under (ids start at 1, 0 means not logged). must be called after
+  // Init(), before the tree is written to
+  static uint32_t RegisterTable(const std::string &name);
+
+  // side files kept next to the first log file: the catalog maps table ids
+  // to names, the pepoch file holds the last fully persisted epoch (every
+  // txn with a later epoch must be dropped on recovery)
+  static inline std::string
+  CatalogFileName(const std::string &logfile)
+  {
+    return logfile + ".catalog";
+  }
+
+  static inline std::string
+  PersistentEpochFileName(const std::string &logfile)
+  {
+    return logfile + ".pepoch";
+  }
+
   struct logbuf_header {
     uint64_t nentries_; // > 0 for all valid log buffers
     uint64_t last_tid_; // TID of the last commit
@@ -198,6 +220,18 @@ public:
   static void
   wait_until_current_point_persisted();
 
+  // all txns in epochs <= persisted_epoch() are durable. commits are
+  // acknowledged a whole epoch at a time: a txn committed in epoch e may be
+  // acked once e <= persisted_epoch(), see txn_epoch_sync::take_commit_epoch()
+  static inline uint64_t
+  persisted_epoch()
+  {
+    return system_sync_epoch_->load(std::memory_order_acquire);
+  }
+
+  // the epoch of the last txn this thread logged, 0 once taken
+  static __thread uint64_t tl_last_commit_epoch;
+
 private:
 
   // data structures
@@ -206,6 +240,7 @@ private:
     // don't use percore<std::atomic<uint64_t>> because we don't want padding
     std::atomic<uint64_t> epochs_[NMAXCORES];
     std::atomic<uint64_t> dummy_work_; // so we can do some fake work
+    std::atomic<uint64_t> nwrites_; // # of writes completed, wakes the persister
     CACHE_PADOUT;
   };
 
@@ -310,6 +345,11 @@ private:
   static bool g_fake_writes; // whether or not to fake doing writes (to measure
                              // pure overhead of disk)
 
+  static int g_catalog_fd; // see CatalogFileName()
+  static int g_pepoch_fd; // see PersistentEpochFileName()
+  static uint32_t g_ntables; // # of ids handed out by RegisterTable()
+  static spinlock g_catalog_lock;
+
   static size_t g_nworkers; // assignments are computed based on g_nworkers
                             // but a logger responsible for core i is really
                             // responsible for cores i + k * g_nworkers, for k
@@ -340,6 +380,8 @@ private:
   static event_counter g_evt_log_buffer_bytes_after_compress;
   static event_counter g_evt_logger_writev_limit_met;
   static event_counter g_evt_logger_max_lag_wait;
+  static event_counter g_evt_logger_prealloc_extend;
+  static event_counter g_evt_logger_short_writev;
   static event_avg_counter g_evt_avg_log_entry_ntxns;
   static event_avg_counter g_evt_avg_log_buffer_compress_time_us;
   static event_avg_counter g_evt_avg_logger_bytes_per_writev;
@@ -361,8 +403,14 @@ public:
   // each epoch is tied (1:1) to the ticker subsystem's tick. this is the
   // speed of the persistence layer.
   //
-  // however, read only txns and GC are tied to multiples of the ticker
-  // subsystem's tick
+  // however, read only txns and GC are tied to read only epochs, which span
+  // a whole number of ticks: a snapshot can be up to one read only epoch
+  // stale, and old versions are kept for about two of them. by default a
+  // read only epoch is 1 second; SetReadOnlyEpoch() and
+  // SetAdaptiveReadOnlyEpoch() change that at runtime. a new length only
+  // takes effect when the next read only epoch starts, so the tick => read
+  // only tick mapping stays monotonic and never changes for a tick which
+  // already started
 
 #ifdef CHECK_INVARIANTS
   static const uint64_t ReadOnlyEpochMultiplier = 10; /* 10 * 1 ms */
@@ -373,15 +421,91 @@ public:
 
   static_assert(ReadOnlyEpochMultiplier >= 1, "XX");
 
-  static const uint64_t ReadOnlyEpochUsec =
-    ticker::tick_us * ReadOnlyEpochMultiplier;
+  // the mapping is piecewise linear, segment i maps the ticks in
+  // [start_tick_, start_tick_ of segment i + 1) to the read only ticks
+  // ro_tick_ + (tick - start_tick_) / multiplier_. segments are only
+  // appended (by the ticker thread), so readers need no locking. they live
+  // in a ring: segments are numbered from 0 on, segment i is in slot
+  // i % MaxReadOnlyEpochSegments, and the ticker thread reclaims the ones
+  // which end before the oldest read only epoch a live txn can read (see
+  // on_tick()). ticks older than every segment kept map to read only tick
+  // 0, before any snapshot still taken
+  struct ro_epoch_segment {
+    uint64_t start_tick_;
+    uint64_t ro_tick_;
+    uint64_t multiplier_;
+  };
+
+  static const size_t MaxReadOnlyEpochSegments = 4096;
 
-  static inline uint64_t constexpr
+  static inline const ro_epoch_segment &
+  ro_segment(size_t i)
+  {
+    return g_ro_segments[i % MaxReadOnlyEpochSegments];
+  }
+
+  // the segment of epoch_tick, nullptr if it was reclaimed
+  static inline const ro_epoch_segment *
+  ro_segment_of_tick(uint64_t epoch_tick)
+  {
+    // the newest segment covers all but very old ticks
+    size_t i = g_ro_nsegments.load(std::memory_order_acquire) - 1;
+    while (ro_segment(i).start_tick_ > epoch_tick) {
+      if (i == g_ro_first_segment.load(std::memory_order_acquire))
+        return nullptr;
+      i--;
+    }
+    // the slot may have been reused while we read it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (unlikely(i < g_ro_first_segment.load(std::memory_order_relaxed)))
+      return nullptr;
+    return &ro_segment(i);
+  }
+
+  static inline uint64_t
   to_read_only_tick(uint64_t epoch_tick)
   {
-    return epoch_tick / ReadOnlyEpochMultiplier;
+    const ro_epoch_segment *s = ro_segment_of_tick(epoch_tick);
+    if (unlikely(!s))
+      return 0;
+    return s->ro_tick_ + (epoch_tick - s->start_tick_) / s->multiplier_;
+  }
+
+  // the first tick of ro_tick (read only ticks which did not start yet are
+  // extrapolated with the current length). only read only ticks a live txn
+  // can still read are asked for, so their segment is kept
+  static inline uint64_t
+  read_only_tick_start(uint64_t ro_tick)
+  {
+    size_t i = g_ro_nsegments.load(std::memory_order_acquire) - 1;
+    const size_t first = g_ro_first_segment.load(std::memory_order_acquire);
+    while (i > first && ro_segment(i).ro_tick_ > ro_tick)
+      i--;
+    const ro_epoch_segment &s = ro_segment(i);
+    INVARIANT(s.ro_tick_ <= ro_tick);
+    return s.start_tick_ + (ro_tick - s.ro_tick_) * s.multiplier_;
   }
 
+  static inline uint64_t
+  CurrentReadOnlyEpochUsec()
+  {
+    const size_t n = g_ro_nsegments.load(std::memory_order_acquire);
+    return ticker::tick_us * ro_segment(n - 1).multiplier_;
+  }
+
+  // read only epochs of ms milliseconds (rounded to ticks) from the next
+  // read only epoch on
+  static void SetReadOnlyEpoch(uint64_t ms);
+
+  // let the length of the read only epochs adapt within [min_ms, max_ms],
+  // decided anew at the start of each one. the length is halved while read
+  // only txns run (fresher snapshots) or while the versions spilled in one
+  // read only epoch, which stay around for about two, exceed max_versions.
+  // it is doubled when nobody takes snapshots and there are few spills,
+  // since longer epochs let more writes overwrite their record in place
+  static void SetAdaptiveReadOnlyEpoch(uint64_t min_ms, uint64_t max_ms,
+                                       uint64_t max_versions);
+
   // in this protocol, the version number is:
   // (note that for tid_t's, the top bit is reserved and
   // *must* be set to zero
@@ -429,8 +553,8 @@ public:
   static uint64_t
   ComputeReadOnlyTid(uint64_t global_tick_ex)
   {
-    const uint64_t a = (global_tick_ex / ReadOnlyEpochMultiplier);
-    const uint64_t b = a * ReadOnlyEpochMultiplier;
+    const uint64_t b =
+      read_only_tick_start(to_read_only_tick(global_tick_ex));
 
     // want to read entries <= b-1, special casing for b=0
     if (!b)
@@ -489,6 +613,18 @@ public:
   }
 #endif
 
+  // 0 disables chain compaction, see compact_chain()
+  static void
+  SetChainCompactThreshold(unsigned n)
+  {
+    g_flags->g_chain_compact_threshold.store(n, std::memory_order_release);
+  }
+  static inline unsigned
+  ChainCompactThreshold()
+  {
+    return g_flags->g_chain_compact_threshold.load(std::memory_order_acquire);
+  }
+
 #ifdef PROTO2_CAN_DISABLE_SNAPSHOTS
   static void
   DisableSnapshots()
@@ -549,6 +685,10 @@ protected:
   struct threadctx {
     uint64_t last_commit_tid_;
     unsigned last_reaped_epoch_;
+    // only written by the owning core, the ticker thread sums them up to
+    // adapt the read only epoch
+    uint64_t nspills_;
+    uint64_t nro_txns_;
 #ifdef ENABLE_EVENT_COUNTERS
     uint64_t last_reaped_timestamp_us_;
 #endif
@@ -558,6 +698,8 @@ protected:
     threadctx() :
         last_commit_tid_(0)
       , last_reaped_epoch_(0)
+      , nspills_(0)
+      , nro_txns_(0)
 #ifdef ENABLE_EVENT_COUNTERS
       , last_reaped_timestamp_us_(0)
 #endif
@@ -571,6 +713,22 @@ protected:
   static void
   clean_up_to_including(threadctx &ctx, uint64_t ro_tick_geq);
 
+  // ticker callback: picks the length of the read only epoch starting at
+  // tick, if one does
+  static void on_tick(uint64_t tick);
+
+  // chain compaction, run by the writer of head (holding its lock) when it
+  // spilled head->next: trims the versions no snapshot can see anymore off
+  // the end of the chain, freeing the ones the compactor owns. returns true
+  // if the compactor also keeps the new spill, which it does while the
+  // chain is at least ChainCompactThreshold() versions long; otherwise it
+  // is left to the background GC (and so is the rest of the chain)
+  static bool compact_chain(threadctx &ctx, dbtuple *head,
+                            uint64_t guard_tick, uint64_t ro_tick);
+
+  // gives the versions the compactor owns behind head to the background GC
+  static void hand_off_chain(threadctx &ctx, dbtuple *head, uint64_t ro_tick);
+
   // helper methods
   static inline txn_logger::pbuffer *
   wait_for_head(txn_logger::pbuffer_circbuf &pull_buf)
@@ -685,17 +843,46 @@ protected:
   struct flags {
     std::atomic<bool> g_gc_init;
     std::atomic<bool> g_disable_snapshots;
-    constexpr flags() : g_gc_init(false), g_disable_snapshots(false) {}
+    std::atomic<unsigned> g_chain_compact_threshold;
+    constexpr flags()
+      : g_gc_init(false), g_disable_snapshots(false),
+        g_chain_compact_threshold(0) {}
   };
   static util::aligned_padded_elem<flags> g_flags;
 
   static percore_lazy<threadctx> g_threadctxs;
 
+  static ro_epoch_segment g_ro_segments[MaxReadOnlyEpochSegments];
+  // segments [g_ro_first_segment, g_ro_nsegments) are kept
+  static std::atomic<size_t> g_ro_first_segment;
+  static std::atomic<size_t> g_ro_nsegments;
+
+  struct ro_epoch_config {
+    std::atomic<uint64_t> min_multiplier_;
+    std::atomic<uint64_t> max_multiplier_;
+    std::atomic<uint64_t> max_versions_;
+    constexpr ro_epoch_config()
+      : min_multiplier_(ReadOnlyEpochMultiplier),
+        max_multiplier_(ReadOnlyEpochMultiplier),
+        max_versions_(0) {}
+  };
+  static util::aligned_padded_elem<ro_epoch_config> g_ro_config;
+
   static event_counter g_evt_worker_thread_wait_log_buffer;
   static event_counter g_evt_dbtuple_no_space_for_delkey;
   static event_counter g_evt_proto_gc_delete_requeue;
   static event_avg_counter g_evt_avg_log_entry_size;
   static event_avg_counter g_evt_avg_proto_gc_queue_len;
+  static event_counter g_evt_chain_compactions;
+  static event_counter g_evt_chain_compact_versions_reclaimed;
+  static event_counter g_evt_chain_compact_bytes_reclaimed;
+  static event_counter g_evt_chain_compact_handoffs;
+  static event_avg_counter g_evt_avg_chain_compact_len;
+  static event_counter g_evt_ro_epoch_changes;
+  static event_counter g_evt_ro_epoch_changes_dropped;
+  static event_counter g_evt_ro_epoch_segments_reclaimed;
+  static event_avg_counter g_evt_avg_ro_epoch_ms;
+  static event_avg_counter g_evt_avg_ro_snapshot_staleness_ms;
 };
 
 bool
@@ -734,6 +921,13 @@ public:
       const uint64_t global_tick_ex =
         this->rcu_guard_->guard()->impl().global_last_tick_exclusive();
       u_.last_consistent_tid = ComputeReadOnlyTid(global_tick_ex);
+      g_threadctxs.my().nro_txns_++;
+#ifdef ENABLE_EVENT_COUNTERS
+      g_evt_avg_ro_snapshot_staleness_ms.offer(
+          (global_tick_ex -
+           read_only_tick_start(to_read_only_tick(global_tick_ex))) *
+          ticker::tick_us / 1000);
+#endif
     }
 #ifdef TUPLE_LOCK_OWNERSHIP_CHECKING
     dbtuple::TupleLockRegionBegin();
@@ -782,6 +976,7 @@ public:
     if (!txn_logger::IsPersistenceEnabled() ||
         this->state != transaction_base::TXN_COMMITED)
       return;
+    txn_logger::tl_last_commit_epoch = EpochId(commit_tid);
     // need to write into log buffer
 
     serializer<uint32_t, true> vs_uint32_t;
@@ -805,6 +1000,8 @@ public:
     write_set_u32_vec value_sizes;
     for (unsigned idx = 0; idx < nwrites; idx++) {
       const transaction_base::write_record_t &rec = this->write_set[idx];
+      const uint32_t table_id = rec.get_btree()->log_id();
+      space_needed += vs_uint32_t.nbytes(&table_id);
       const uint32_t k_nbytes = rec.get_key().size();
       space_needed += vs_uint32_t.nbytes(&k_nbytes);
       space_needed += k_nbytes;
@@ -890,6 +1087,10 @@ public:
 private:
 
   // assumes enough space in px to hold this txn
+  //
+  // record format (read back by dbrecover): tid (8 bytes), # of writes,
+  // then per write: table id, key length, key, value length, value. all
+  // counts/lengths are varints, a zero length value is a delete
   inline uint64_t
   write_current_txn_into_buffer(
       txn_logger::pbuffer *px,
@@ -921,6 +1122,7 @@ private:
 
     for (unsigned idx = 0; idx < nwrites; idx++) {
       const transaction_base::write_record_t &rec = this->write_set[idx];
+      p = vs_uint32_t.write(p, rec.get_btree()->log_id());
       const uint32_t k_nbytes = rec.get_key().size();
       p = vs_uint32_t.write(p, k_nbytes);
       NDB_MEMCPY(p, rec.get_key().data(), k_nbytes);
@@ -989,19 +1191,8 @@ public:
     if (g_hack->status_.load(std::memory_order_acquire))
       g_hack->global_tid_.fetch_add(1, std::memory_order_acq_rel);
 
-    //XXX(stephentu): I believe this is correct, but not 100% sure
-    // if(!this->commutative_set.empty())
-    // {
-    //   auto it  = this->commutative_set.begin();
-    //   for (; it != this->commutative_set.end(); ++it) {
-
-    //     const tid_t t = it->tuple->version;
-
-    //     INVARIANT(EpochId(t) <= u_.commit_epoch || t == dbtuple::MAX_TID);
-    //     if (t != dbtuple::MAX_TID && t > ret)
-    //       ret = t;
-    //   }
-    // }
+    // commutative ops are folded into the write set before this point, so
+    // the write set loop below covers their tuples
 
     {
       typename read_set_map::const_iterator it     = this->read_set.begin();
@@ -1071,6 +1262,14 @@ public:
     INVARIANT(tuple->version == dbtuple::MAX_TID ||
               to_read_only_tick(EpochId(tuple->version)) <= ro_tick);
 
+    threadctx &ctx = g_threadctxs.my();
+    ctx.nspills_++;
+    if (ChainCompactThreshold() &&
+        compact_chain(ctx, tuple_ahead, this->rcu_guard_->guard()->tick(),
+                      ro_tick))
+      // hot tuple, the compactor keeps it
+      return;
+
 #ifdef CHECK_INVARIANTS
     uint64_t exp = 0;
     INVARIANT(tuple->opaque.compare_exchange_strong(exp, 1, std::memory_order_acq_rel));
@@ -1078,7 +1277,6 @@ public:
 
     // when all snapshots are happening >= the current epoch,
     // then we can safely remove tuple
-    threadctx &ctx = g_threadctxs.my();
     ctx.queue_.enqueue(
         delete_entry(tuple_ahead, tuple_ahead->version,
           tuple, marked_ptr<std::string>(), nullptr),
@@ -1104,6 +1302,10 @@ public:
     const uint64_t ro_tick = to_read_only_tick(this->u_.commit_epoch);
     threadctx &ctx = g_threadctxs.my();
 
+    // the compactor won't see this chain again once the key is gone
+    if (tuple->next_compactor_owned)
+      hand_off_chain(ctx, tuple, ro_tick);
+
 #ifdef CHECK_INVARIANTS
     uint64_t exp = 0;
     INVARIANT(tuple->opaque.compare_exchange_strong(exp, 1, std::memory_order_acq_rel));
@@ -1264,6 +1466,18 @@ struct txn_epoch_sync<transaction_ic3> : public transaction_ic3_static {
       return;
     txn_logger::clear_ntxns_persisted_statistics();
   }
+  static inline uint64_t
+  take_commit_epoch()
+  {
+    const uint64_t e = txn_logger::tl_last_commit_epoch;
+    txn_logger::tl_last_commit_epoch = 0;
+    return e;
+  }
+  static inline bool
+  is_epoch_persisted(uint64_t e)
+  {
+    return e <= txn_logger::persisted_epoch();
+  }
 };
 
 #endif /* _NDB_TXN_PROTO2_IMPL_H_ */
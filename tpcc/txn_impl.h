@@ -33,6 +33,8 @@ transaction<Protocol, Traits>::transaction(uint64_t flags, string_allocator_type
 
   read_set_start = 0;
   write_set_start = 0;
+  commutative_write_start = 0;
+  commutative_start = 0;
   // insert_set_start = 0;
   dep_queue_start = 0;
 
@@ -43,6 +45,9 @@ transaction<Protocol, Traits>::transaction(uint64_t flags, string_allocator_type
   ongoing_acc_id = MAX_ACC_ID;
   valid_acc_id = MAX_ACC_ID;
   last_commit_piece_acc_id = MAX_ACC_ID;
+  cur_rec = nullptr;
+  named_rec = nullptr;
+  named_btr = nullptr;
 
   rw_highest_contention = 0;
   piece_contention = 0;
@@ -408,6 +413,63 @@ transaction<Protocol, Traits>::handle_last_tuple_in_group(
   return true;
 }
 
+template <template <typename> class Protocol, typename Traits>
+void
+transaction<Protocol, Traits>::fold_commutative_set()
+{
+  commutative_write_start = write_set.size();
+  for (auto &c : commutative_set) {
+    // re-resolve the key, a spill may have replaced the tuple since the op
+    typename concurrent_btree::value_type bv = 0;
+    if (likely(c.btr.get()->search(varkey(*c.k), bv)))
+      c.tuple = reinterpret_cast<dbtuple *>(bv);
+    bool folded = false;
+    for (size_t i = commutative_write_start; i < write_set.size(); i++) {
+      if (write_set[i].get_tuple() == c.tuple) {
+        folded = true;
+        break;
+      }
+    }
+    if (folded)
+      continue;
+    write_set.emplace_back(c.tuple, c.k, nullptr, string_allocator()(), c.get_writer(),
+                           c.btr.get(), false, nullptr, dbtuple::MIN_TID, get_tid(),
+                           this, true /*occ*/, 0);
+    write_set.back().set_commutative();
+  }
+}
+
+template <template <typename> class Protocol, typename Traits>
+transaction_base::abort_reason
+transaction<Protocol, Traits>::apply_commutative_set()
+{
+  for (size_t i = commutative_write_start; i < write_set.size(); i++) {
+    dbtuple *tuple = write_set[i].get_tuple();
+    std::string *v = reinterpret_cast<std::string *>(write_set[i].get_value());
+
+    // the base is this txn's own last plain write to the tuple if there is
+    // one, otherwise the latest committed value (stable, we hold the lock)
+    int base = commutative_write_start - 1;
+    for (; base >= 0; base--)
+      if (write_set[base].get_tuple() == tuple)
+        break;
+    if (base >= 0) {
+      if (!write_set[base].get_value())
+        return ABORT_REASON_USER;
+      v->assign(*reinterpret_cast<const std::string *>(write_set[base].get_value()));
+    } else {
+      if (unlikely(tuple->is_deleting() || !tuple->size))
+        return ABORT_REASON_WRITE_NODE_INTERFERENCE;
+      v->assign(reinterpret_cast<const char *>(tuple->get_value_start()), tuple->size);
+    }
+
+    for (auto &c : commutative_set)
+      if (c.tuple == tuple && !c.act(v, c.param))
+        return ABORT_REASON_COMMUTATIVE_BOUND;
+  }
+  return ABORT_REASON_NONE;
+}
+
 
 template <template <typename> class Protocol, typename Traits>
 template <typename ValueReader>
@@ -441,6 +503,20 @@ transaction<Protocol, Traits>::do_get(concurrent_btree &btr,
   }
 }
 
+template <template <typename> class Protocol, typename Traits>
+template <typename ValueReader>
+bool
+transaction<Protocol, Traits>::do_get(concurrent_btree &btr,
+                                  const varkey &k, ValueReader& value_reader,
+                                  uint32_t acc_id)
+{
+  if (likely(!is_snapshot()))
+    return mix_op.do_get(btr, k, value_reader, acc_id);
+  std::string * const px = string_allocator()();
+  px->assign((const char *) k.data(), k.size());
+  return do_snapshot_get(btr, px, value_reader);
+}
+
 
 template <template <typename> class Protocol, typename Traits>
 template <typename ValueReader>
@@ -479,6 +555,34 @@ transaction<Protocol, Traits>::do_update(concurrent_btree &btr, const std::strin
   return mix_op.do_update(btr, key_str, value_reader, callback, value_writer, acc_id);
 }
 
+template <template <typename> class Protocol, typename Traits>
+template <typename ReaderAt>
+size_t
+transaction<Protocol, Traits>::do_multi_get(concurrent_btree &btr,
+                                            const std::string *const *key_strs, size_t n,
+                                            ReaderAt &reader_at, bool *found, uint32_t acc_id)
+{
+  if (!is_snapshot())
+    return mix_op.do_multi_get(btr, key_strs, n, reader_at, found, acc_id);
+  size_t nfound = 0;
+  for (size_t i = 0; i < n; i++) {
+    auto reader = reader_at(i);
+    found[i] = do_snapshot_get(btr, key_strs[i], reader);
+    nfound += found[i];
+  }
+  return nfound;
+}
+
+template <template <typename> class Protocol, typename Traits>
+template <typename ValueWriter>
+bool
+transaction<Protocol, Traits>::do_multi_put(concurrent_btree &btr,
+                                            const std::string *const *key_strs, void *const *val_strs,
+                                            size_t n, ValueWriter &value_writer, uint32_t acc_id)
+{
+  return mix_op.do_multi_put(btr, key_strs, val_strs, n, value_writer, acc_id);
+}
+
 template <template <typename> class Protocol, typename Traits>
 bool
 transaction<Protocol, Traits>::handle_last_tuple_in_group_expose_piece(
@@ -523,7 +627,8 @@ transaction<Protocol, Traits>::expose_uncommitted(uint32_t acc_id) {
     return std::pair<bool, uint32_t>(true, 0);
   // there is no reason for us to expose the final operation w/o wait commit.
   assert(cur_step == tmp - txn_first_acc_id + 1);
-  before_commit_piece_operation(pa, tmp - txn_first_acc_id + 1 == txn_access_num[txn_type]);
+  if (!before_commit_piece_operation(pa, tmp - txn_first_acc_id + 1 == txn_access_num[txn_type]))
+    return std::pair<bool, uint32_t>(false, std::numeric_limits<uint32_t>::max());
 
   bool lock_mode = true;
 
@@ -534,6 +639,7 @@ transaction<Protocol, Traits>::expose_uncommitted(uint32_t acc_id) {
   for(int i = read_set_start; i < read_set.size(); i++) {
     if(read_set[i].get_access_entry() == nullptr) {
       read_set[i].set_access_entry(insert_read_access_entry(dbtuple::MIN_TID, get_tid(), this));
+      read_set[i].get_access_entry()->cgroups = read_set[i].get_cgroups();
     }
     // all reads need validation
     dirty_read_idx[dirty_read_count++] = i;
@@ -542,6 +648,7 @@ transaction<Protocol, Traits>::expose_uncommitted(uint32_t acc_id) {
   for(int i = write_set_start; i < write_set.size(); i++) {
     if(write_set[i].get_access_entry() == nullptr) {
       write_set[i].set_access_entry(insert_write_access_entry(dbtuple::MIN_TID, get_tid(), this));
+      write_set[i].get_access_entry()->cgroups = write_set[i].get_cgroups();
     }
   }
 
@@ -667,6 +774,7 @@ transaction<Protocol, Traits>::expose_uncommitted(uint32_t acc_id) {
     read_access_start = read_access_map.size();
     write_set_start = write_set.size();
     write_access_start = write_access_map.size();
+    commutative_start = commutative_set.size();
     dep_queue_start = dep_queue.size();
     // insert_set_start = insert_set.size();
     valid_absent_set = absent_set;
@@ -684,6 +792,7 @@ transaction<Protocol, Traits>::expose_uncommitted(uint32_t acc_id) {
     read_access_map.shrink(read_access_start);
     write_set.shrink(write_set_start);
     write_access_map.shrink(write_access_start);
+    commutative_set.shrink(commutative_start);
     dep_queue.shrink(dep_queue_start);
     feature->tx_n_dep_on = dep_queue_start;
     // insert_set.erase(insert_set.begin() + insert_set_start, insert_set.end());
@@ -779,6 +888,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
 
     if(read_set[i].get_access_entry() == nullptr) {
       read_set[i].set_access_entry(insert_read_access_entry(dbtuple::MIN_TID, get_tid(), this));
+      read_set[i].get_access_entry()->cgroups = read_set[i].get_cgroups();
     }
     access_entry *entry = read_set[i].get_access_entry();
     dbtuple *tuple = read_set[i].get_tuple();
@@ -787,7 +897,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
     ALWAYS_ASSERT(!entry->is_linked());
     ALWAYS_ASSERT(!entry->is_prepare());
 
-    access_entry *de = tuple->get_dependent_entry(entry->is_write());
+    access_entry *de = tuple->get_dependent_entry(entry->is_write(), entry->cgroups);
     if (likely(de)) {
       transaction<Protocol, Traits>* d_txn = (transaction<Protocol, Traits>*) de->get_txn();
       uint64_t d_tid = de->get_tid();
@@ -795,7 +905,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
       if (!d_txn->is_commit(d_tid)
           && d_tid != get_tid()
           && d_txn != this) {
-        add_dep_txn(de->get_tid(), de->get_txn(), true/*dirty_read_dep*/);
+        add_dep_txn(de->get_tid(), de->get_txn(), tuple, true/*dirty_read_dep*/);
       }
     }
   }
@@ -824,6 +934,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
           d_txn->txn_current_blocking --;
           global_listener.tx_n_blocked --;
 #endif
+          note_conflict(it->rec);
           abort_trap((reason = ABORT_REASON_TIMEOUT));
           goto do_abort;
         }
@@ -834,6 +945,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
         global_listener.tx_n_blocked --;
 #endif
         VERBOSE(std::cerr << "Cascading abort happen sue to txn id -  " << d_txn->tid << std::endl);
+        note_conflict(it->rec);
         abort_trap((reason = ABORT_REASON_CASCADING));
         goto do_abort;
       }
@@ -849,6 +961,8 @@ transaction<Protocol, Traits>::commit(bool doThrow)
 
   state = TXN_FINISH_EXEC;
 
+  if (!commutative_set.empty())
+    fold_commutative_set();
 
   //Phase2. Lock write set
   // copy write tuples to vector for sorting
@@ -890,6 +1004,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
       if (likely(last_px && last_px->tuple != it->tuple)) {
         // on boundary
         if (unlikely(!handle_last_tuple_in_group(*last_px, inserted_last_run, lock_mode))) {
+          note_conflict(last_px->get_tuple());
           abort_trap((reason = ABORT_REASON_WRITE_NODE_INTERFERENCE));
           goto do_abort;
         }
@@ -909,6 +1024,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
     }
     if (likely(last_px) &&
         unlikely(!handle_last_tuple_in_group(*last_px, inserted_last_run, lock_mode))) {
+      note_conflict(last_px->get_tuple());
       abort_trap((reason = ABORT_REASON_WRITE_NODE_INTERFERENCE));
       goto do_abort;
     }
@@ -936,6 +1052,11 @@ transaction<Protocol, Traits>::commit(bool doThrow)
                      it->get_tuple()->is_latest_version(it->clean_tid()) :
                      it->get_tuple()->stable_is_latest_version(it->clean_tid())))
             continue;
+          // a read of some column groups survives commits to the others,
+          // unless we overwrite the row, whose other groups we then carry
+          if (!it->is_occ() && !found && it->get_cgroups() != ALL_COLUMN_GROUPS &&
+              it->get_tuple()->stable_is_latest_cgroups(it->get_cgroups(), it->get_cg_stamp()))
+            continue;
 
           // occ action fail, increase the contention counter
           // if (it->is_occ() && add_clean_read_failed_tuples(it->get_tuple())) {
@@ -956,6 +1077,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
           // have to guarantee dependent txn has already committed
           if (unlikely(!d_txn->is_commit(it->get_dep_tid()))) {
             VERBOSE(std::cerr << "Cascading abort happen sue to txn id -  " << d_txn->tid << std::endl);
+            note_conflict(it->get_tuple());
             abort_trap((reason = ABORT_REASON_CASCADING));
             goto do_abort;
           }
@@ -975,6 +1097,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
                             << ", Current tid: " << tuple->version
                             << ", Txn Type: " << int(txn_type) << std::endl);
         }
+        note_conflict(it->get_tuple());
         abort_trap((reason = ABORT_REASON_READ_NODE_INTEREFERENCE));
         goto do_abort;
       }
@@ -996,6 +1119,13 @@ transaction<Protocol, Traits>::commit(bool doThrow)
     }
   }
 
+  //Phase3.5. Compute the commutative writes, every written tuple is locked
+  if (!commutative_set.empty() &&
+      unlikely((reason = apply_commutative_set()) != ABORT_REASON_NONE)) {
+    abort_trap(reason);
+    goto do_abort;
+  }
+
   // XXX(Jiachen): Stamp all the tree node in the absent set
   if (!absent_set.empty()) {
     auto it = absent_set.begin();
@@ -1064,6 +1194,7 @@ transaction<Protocol, Traits>::commit(bool doThrow)
               it->get_value(), it->get_writer());
 
       tuple->set_last_writer_seq(seq);
+      ret.head_->bump_cgroups(it->get_value() ? it->get_cgroups() : ALL_COLUMN_GROUPS);
 
       bool unlock_head = false;
 
@@ -1339,8 +1470,9 @@ transaction<Protocol, Traits>::do_node_read(
 
 template <template <typename> class Protocol, typename Traits>
 inline void
-transaction<Protocol, Traits>::add_dep_txn(uint64_t tid, void* txn, bool dirty_read_dep = false)
+transaction<Protocol, Traits>::add_dep_txn(uint64_t tid, void* txn, const dbtuple *rec, bool dirty_read_dep)
 {
+  ++g_evt_dep_edges;
 
   typename dep_queue_map::iterator it = dep_queue.begin();
   for (; it != dep_queue.end(); ++it) {
@@ -1351,8 +1483,9 @@ transaction<Protocol, Traits>::add_dep_txn(uint64_t tid, void* txn, bool dirty_r
   }
 
   assert(dep_queue.size() < traits_type::dep_queue_expected_size);
-  dep_queue.emplace_back(dirty_read_dep, tid, txn);
+  dep_queue.emplace_back(dirty_read_dep, tid, txn, rec);
   feature->tx_n_dep_on ++;
+  ++g_evt_dep_txns;
 
 }
 
@@ -1382,24 +1515,48 @@ void
 transaction<Protocol, Traits>::atomic_piece_begin(bool one_tuple){}
 
 
+// the pieces are not atomic units of their own here, so there is nothing
+// which could fail to end or abort
 template <template <typename> class Protocol, typename Traits>
 bool
-transaction<Protocol, Traits>::atomic_piece_end(){}
+transaction<Protocol, Traits>::atomic_piece_end() { return true; }
 
 template <template <typename> class Protocol, typename Traits>
 bool
-transaction<Protocol, Traits>::atomic_piece_abort() {}
+transaction<Protocol, Traits>::atomic_piece_abort() { return true; }
 
 template <template <typename> class Protocol, typename Traits>
-void
-transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_t timeout, uint32_t safeguard[TXN_TYPE])
+bool
+transaction<Protocol, Traits>::fail_access(abort_reason r, const dbtuple *rec)
+{
+  state = TXN_ABRT;
+  access_abort_tsc = rdtsc();
+  note_conflict(rec ? rec : cur_rec);
+  if (unlikely(policy_library::g_enabled)) {
+    // the access could not go on, so it counts as blocked
+    policy_library::NoteWait(true);
+    policy_library::NoteAbort(AbortClass(r));
+  }
+  if (!(get_flags() & TXN_FLAG_STATUS_ABORTS))
+    throw transaction_abort_exception(r);
+  reason = r;
+  ++g_evt_status_aborts;
+  return false;
+}
+
+template <template <typename> class Protocol, typename Traits>
+bool
+transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_t timeout, uint32_t safeguard[TXN_TYPE],
+                                       const uint32_t *guard)
 {
   if (access == detect_track_dirty || access == no_detect)
     // do not detect any conflict --> no need to wait.
-    return ;
+    return true;
 
   uint64_t start_time = util::timer::cur_usec();
   typename dep_queue_map::iterator it = dep_queue.begin();
+  bool waited = false;
+  const dbtuple *blamed = nullptr; // the record of the first dependency waited on
 #ifdef COUNT_TX_BLOCK
   global_listener.tx_n_blocked ++;
 #endif
@@ -1414,6 +1571,10 @@ transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_
         while (!(d_txn->is_commit(it->tid) || d_txn->is_abort(it->tid))) {
           memory_barrier();
           nop_pause();
+          if (!waited) {
+            waited = true;
+            blamed = it->rec;
+          }
 
           // check timeout
           if (unlikely((util::timer::cur_usec() - start_time) > timeout)) {
@@ -1421,9 +1582,7 @@ transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_
             global_listener.tx_n_blocked--;
             d_txn->txn_current_blocking--;
 #endif
-            state = TXN_ABRT;
-            const transaction_base::abort_reason r = transaction_base::ABORT_REASON_TIMEOUT;
-            throw transaction_abort_exception(r);
+            return fail_access(transaction_base::ABORT_REASON_TIMEOUT, it->rec);
           }
         }
         if (d_txn->is_abort(it->tid) && it->dirty_read_dep) {
@@ -1431,9 +1590,7 @@ transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_
           global_listener.tx_n_blocked--;
           d_txn->txn_current_blocking--;
 #endif
-          state = TXN_ABRT;
-          const transaction_base::abort_reason r = transaction_base::ABORT_REASON_CASCADING;
-          throw transaction_abort_exception(r);
+          return fail_access(transaction_base::ABORT_REASON_CASCADING, it->rec);
         }
 #ifdef COUNT_TX_BLOCK
         d_txn->txn_current_blocking--;
@@ -1448,9 +1605,15 @@ transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_
         if (d_txn->txn_type == 0)
           continue ;
         auto to_step = safeguard[d_txn->txn_type-1];
+        if (guard)
+          to_step = std::max(to_step, guard[d_txn->txn_type-1]);
         while (!(d_txn->is_commit(it->tid) || d_txn->is_abort(it->tid) || to_step < d_txn->cur_step)) {
           memory_barrier();
           nop_pause();
+          if (!waited) {
+            waited = true;
+            blamed = it->rec;
+          }
 
           // check timeout
           if (unlikely((util::timer::cur_usec() - start_time) > timeout)) {
@@ -1458,9 +1621,7 @@ transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_
             global_listener.tx_n_blocked--;
             d_txn->txn_current_blocking--;
 #endif
-            state = TXN_ABRT;
-            const transaction_base::abort_reason r = transaction_base::ABORT_REASON_TIMEOUT;
-            throw transaction_abort_exception(r);
+            return fail_access(transaction_base::ABORT_REASON_TIMEOUT, it->rec);
           }
         }
         if (d_txn->is_abort(it->tid) && it->dirty_read_dep) {
@@ -1468,9 +1629,7 @@ transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_
           global_listener.tx_n_blocked--;
           d_txn->txn_current_blocking--;
 #endif
-          state = TXN_ABRT;
-          const transaction_base::abort_reason r = transaction_base::ABORT_REASON_CASCADING;
-          throw transaction_abort_exception(r);
+          return fail_access(transaction_base::ABORT_REASON_CASCADING, it->rec);
         }
 #ifdef COUNT_TX_BLOCK
         d_txn->txn_current_blocking--;
@@ -1480,6 +1639,11 @@ transaction<Protocol, Traits>::do_wait(AccessPolicy access, double rank, uint32_
 #ifdef COUNT_TX_BLOCK
   global_listener.tx_n_blocked --;
 #endif
+  if (unlikely(waited))
+    note_conflict(blamed ? blamed : cur_rec);
+  if (unlikely(policy_library::g_enabled))
+    policy_library::NoteWait(waited);
+  return true;
 }
 
 #endif /* _NDB_TXN_IMPL_H_ */
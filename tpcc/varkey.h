@@ -219,4 +219,55 @@ typedef obj_varkey<int32_t>  s32_varkey;
 typedef obj_varkey<uint64_t> u64_varkey;
 typedef obj_varkey<int64_t>  s64_varkey;
 
+// a key of at most MaxSize bytes (the fixed-width integer keys of the
+// benchmarks, see EncodeKey() in benchmarks/bench.h) encoded in place
+// instead of into a std::string, which the index copies once into the txn
+// arena. the bytes are the same as those of Encode(), so the trees cannot
+// tell the difference
+class packed_key {
+public:
+  static const size_t MaxSize = 16;
+
+  inline packed_key() : l(0) {}
+
+  // the bytes of k, e.g. of a u64_varkey
+  explicit inline packed_key(const varkey &k) : l(k.size())
+  {
+    INVARIANT(l <= MaxSize);
+    memcpy(&b[0], k.data(), l);
+  }
+
+  inline uint8_t *
+  buf()
+  {
+    return &b[0];
+  }
+
+  inline void
+  resize(size_t n)
+  {
+    INVARIANT(n <= MaxSize);
+    l = n;
+  }
+
+  inline size_t size() const { return l; }
+  inline const uint8_t *data() const { return &b[0]; }
+
+  inline operator varkey() const
+  {
+    return varkey(&b[0], l);
+  }
+
+  inline std::string &
+  str(std::string &buf) const
+  {
+    buf.assign((const char *) &b[0], l);
+    return buf;
+  }
+
+private:
+  uint8_t b[MaxSize];
+  size_t l;
+};
+
 #endif /* _NDB_VARKEY_H_ */
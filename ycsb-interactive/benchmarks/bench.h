@@ -180,6 +180,20 @@ public:
 
   inline ssize_t get_size_delta() const { return size_delta; }
 
+  // for workers whose txns are not driven by run(), e.g. the servers of
+  // client sessions (see session.h)
+  inline void
+  account_txn(size_t i, bool committed, uint64_t latency_us)
+  {
+    if (committed) {
+      ++ntxn_commits;
+      latency_numer_us += latency_us;
+      txn_counts[i]++;
+    } else {
+      ++ntxn_aborts;
+    }
+  }
+
   virtual void final_check() {}
 
   void increase_commit(){ntxn_commits++;}
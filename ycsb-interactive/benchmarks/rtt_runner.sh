@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# throughput and latency against the client round trip: YCSB in client/server
+# mode (see benchmarks/session.h) with many more sessions than workers, one run
+# per injected RTT. compare agg_throughput, avg_latency and the
+# session_txn_latency_* histogram across the runs. a policy is trained for a
+# given RTT by passing the same --client-server --rtt-us options in the
+# --bench-opts of training/flexi_policy_benchmark.py
+#
+#   ./benchmarks/rtt_runner.sh <prefix> [policy]
+
+set -x
+
+BENCH=./out-perf.masstree/benchmarks/dbtest
+NTHREADS=${NTHREADS:-$(nproc)}
+NSESSIONS=${NSESSIONS:-64}
+RUNTIME=${RUNTIME:-30}
+THINK_US=${THINK_US:-0}
+PREFIX=$1
+POLICY=${2:-2pl}
+OPTS="--length 10 --access-dist 0.9,0.9,0.9,0.9,0.9,0.9,0.9,0.9,0.9,0.9 --opt-dist w,w,r,r,r,r,r,r,r,r --partition"
+
+mkdir -p results
+
+for RTT in 0 20 100 500 2000; do
+  $BENCH \
+    --verbose \
+    --bench ycsb \
+    --db-type ndb-proto2 \
+    --scale-factor 10 \
+    --num-threads $NTHREADS \
+    --runtime $RUNTIME \
+    --retry-aborted-transactions \
+    --policy $POLICY \
+    --encoder ./encoder/default_ycsb_encoder.txt \
+    --bench-opts "$OPTS --client-server --sessions $NSESSIONS --rtt-us $RTT --think-us $THINK_US" 2>&1 | \
+    grep -E "agg_throughput|avg_latency|agg_abort|session_txn_latency_" \
+    > results/$PREFIX-rtt-$RTT.txt
+done
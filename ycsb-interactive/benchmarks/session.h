@@ -0,0 +1,129 @@
+#ifndef _NDB_BENCH_SESSION_H_
+#define _NDB_BENCH_SESSION_H_
+
+#include <stdint.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "../macros.h"
+#include "../amd64.h"
+#include "../circbuf.h"
+#include "../util.h"
+
+// in-process client/server harness for interactive txns.
+//
+// a client drives each session: it sends the operations of a txn one at a
+// time to the server worker owning the session, and waits for each reply
+// before it sends the next, so the locks the txn takes stay held across the
+// round trips like they would for a remote client. there is exactly one
+// message in flight per session, which both ends pass back and forth over
+// two single producer/single consumer circbufs
+//
+// every message is delivered rtt/2 after it was sent. both ends poll the
+// channels of many sessions from one thread (the server workers and the
+// client driver), so there can be many more sessions than cores: while a
+// session waits on its round trip, its thread serves the others
+
+struct session_msg {
+  enum type_t : uint8_t {
+    MsgOp = 0,  // run op_ in the open txn, begins one if none is open
+    MsgCommit,  // commit the open txn
+    MsgClose,   // the client is done, no reply
+  };
+
+  type_t type_;
+  uint8_t op_;        // workload defined
+  bool ok_;           // reply: false iff the txn aborted
+  uint32_t acc_id_;
+  uint64_t key_;
+  uint64_t txn_start_us_;  // when the client sent the first op of the txn
+  uint64_t deliver_at_us_;
+};
+
+class session_channel {
+public:
+  static const uint64_t SpinUsec = 50;
+
+  session_channel(uint64_t rtt_us)
+    : rtt_us_(rtt_us) {}
+
+  session_channel(const session_channel &) = delete;
+  session_channel &operator=(const session_channel &) = delete;
+
+  inline uint64_t rtt_us() const { return rtt_us_; }
+
+  // client side
+  inline void
+  send(session_msg *m)
+  {
+    m->deliver_at_us_ = util::timer::cur_usec() + rtt_us_ / 2;
+    to_server_.enq(m);
+  }
+
+  inline session_msg *
+  poll_reply(uint64_t now, uint64_t *wake_us)
+  {
+    return poll(to_client_, now, wake_us);
+  }
+
+  // server side
+  inline session_msg *
+  poll_request(uint64_t now, uint64_t *wake_us)
+  {
+    return poll(to_server_, now, wake_us);
+  }
+
+  inline void
+  reply(session_msg *m)
+  {
+    m->deliver_at_us_ = util::timer::cur_usec() + rtt_us_ / 2;
+    to_client_.enq(m);
+  }
+
+  // for a thread which found nothing to do: nothing sent from now on is
+  // delivered before now + rtt/2
+  inline uint64_t
+  next_wake_us(uint64_t now) const
+  {
+    return now + rtt_us_ / 2;
+  }
+
+  static inline void
+  wait_until(uint64_t t)
+  {
+    uint64_t now = util::timer::cur_usec();
+    if (now >= t) {
+      sched_yield();
+      return;
+    }
+    for (; now < t; now = util::timer::cur_usec()) {
+      if (t - now > SpinUsec)
+        usleep(t - now - SpinUsec);
+      else
+        sched_yield();  // the other end may share our cpu
+    }
+  }
+
+private:
+  // the message in q once it is delivered, else nullptr. *wake_us is
+  // lowered to the delivery of one still on its way
+  static inline session_msg *
+  poll(circbuf<session_msg, 2> &q, uint64_t now, uint64_t *wake_us)
+  {
+    session_msg *m = q.peek();
+    if (!m)
+      return nullptr;
+    if (m->deliver_at_us_ > now) {
+      if (m->deliver_at_us_ < *wake_us)
+        *wake_us = m->deliver_at_us_;
+      return nullptr;
+    }
+    return q.deq();
+  }
+
+  const uint64_t rtt_us_;
+  circbuf<session_msg, 2> to_server_;
+  circbuf<session_msg, 2> to_client_;
+};
+
+#endif /* _NDB_BENCH_SESSION_H_ */
@@ -22,6 +22,7 @@
 #include "../txn.h"
 
 #include "bench.h"
+#include "session.h"
 
 using namespace std;
 using namespace util;
@@ -45,6 +46,14 @@ static bool g_access_partitioned = false;
 
 static int key_distribution[100] = {0};
 
+// client/server mode (see session.h): the workers serve the txns of
+// g_nsessions sessions (one per worker if 0), whose clients wait think_us
+// between their txns
+static bool g_client_server = false;
+static uint64_t g_rtt_us = 0;
+static uint64_t g_think_us = 0;
+static size_t g_nsessions = 0;
+
 enum ycsb_tx_types
 {
   ycsb_type = 1,
@@ -134,53 +143,64 @@ public:
     obj_v.reserve(str_arena::MinStrReserveLength);
   }
 
+  // the key of the i-th access of a txn
+  static uint64_t
+  next_key(size_t i)
+  {
+    const uint64_t partition_size = nkeys / g_txn_length;
+    uint64_t key;
+    if (g_access_partitioned) {
+      // all accesses locate at different partition.
+      if (g_txn_op_distribution[i] == ScanWriteOpt ||
+          g_txn_op_distribution[i] == ScanReadOpt) {
+        key = key_gen_list[i]->next_value() % (partition_size-10) +
+              i * partition_size;
+      }
+      else key = key_gen_list[i]->next_value()  % partition_size + i * partition_size;
+    } else {
+      if (g_txn_op_distribution[i] == ScanWriteOpt ||
+          g_txn_op_distribution[i] == ScanReadOpt)
+        key = key_gen_list[i]->next_value() % (nkeys/-10);
+      else key = key_gen_list[i]->next_value() % nkeys;
+    }
+    if (key < 100) {
+      key_distribution[key] ++;
+    }
+    return key;
+  }
+
+  // runs the acc_id-th access of txn, whose strings come from a, throws if
+  // txn aborts
+  void
+  run_op(void *txn, str_arena &a, YCSBOpt op, uint64_t row_id, int acc_id)
+  {
+    obj_key0 = u64_varkey(row_id).str(obj_key0);
+    if (op == ReadOpt) {
+      // read operation,
+      ALWAYS_ASSERT(tbl->get_for_read(txn, u64_varkey(row_id).str(obj_key0), obj_v, std::string::npos, acc_id));
+    } else if (op == WriteOpt) {
+      // read modify write.
+      ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v, std::string::npos, acc_id));
+      tbl->put(txn, obj_key0, a.next()->assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
+    } else {
+      // unsupported yet.
+      assert(false);
+    }
+  }
+
   txn_result
   txn()
   {
     void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_KV_GET_PUT);
-    auto partition_size = (int)nkeys/g_txn_length;
 
     scoped_str_arena s_arena(arena);
     try {
-        auto keys = new uint64_t [int(g_txn_length)];
-        for (int i=0;i<g_txn_length;i++) {
-          if (g_access_partitioned) {
-            // all accesses locate at different partition.
-            if (g_txn_op_distribution[i] == ScanWriteOpt ||
-                g_txn_op_distribution[i] == ScanReadOpt) {
-              keys[i] = key_gen_list[i]->next_value() % (partition_size-10) +
-                        i * partition_size;
-            }
-            else keys[i] = key_gen_list[i]->next_value()  % partition_size + i * partition_size;
-            if (keys[i] < 100) {
-              key_distribution[keys[i]] ++;
-            }
-          } else {
-            if (g_txn_op_distribution[i] == ScanWriteOpt ||
-                g_txn_op_distribution[i] == ScanReadOpt)
-              keys[i] = key_gen_list[i]->next_value() % (nkeys/-10);
-            else keys[i] = key_gen_list[i]->next_value() % nkeys;
-            if (keys[i] < 100) {
-              key_distribution[keys[i]] ++;
-            }
-          }
-        }
+        uint64_t keys[32];
+        for (int i=0;i<g_txn_length;i++)
+          keys[i] = next_key(i);
         int acc_id = 0; // 0 <= acc_id <= txn_length *2
         for (int i=0;i<g_txn_length;) {
-          auto row_id = keys[i];
-          auto op = g_txn_op_distribution[i];
-          obj_key0 = u64_varkey(row_id).str(obj_key0);
-          if (op == ReadOpt) {
-            // read operation,
-            ALWAYS_ASSERT(tbl->get_for_read(txn, u64_varkey(row_id).str(obj_key0), obj_v, std::string::npos, acc_id));
-          } else if (op == WriteOpt) {
-            // read modify write.
-            ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v, std::string::npos, acc_id));
-            tbl->put(txn, obj_key0, str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
-          } else {
-            // unsupported yet.
-            assert(false);
-          }
+          run_op(txn, arena, g_txn_op_distribution[i], keys[i], acc_id);
           i ++;
           acc_id ++;
         }
@@ -250,6 +270,220 @@ private:
   uint64_t computation_n;
 };
 
+static event_counter evt_session_latency_lt_1ms("session_txn_latency_lt_1ms");
+static event_counter evt_session_latency_1_10ms("session_txn_latency_1_10ms");
+static event_counter evt_session_latency_10_100ms("session_txn_latency_10_100ms");
+static event_counter evt_session_latency_100ms_plus("session_txn_latency_100ms_plus");
+
+// one client/server session. the client fields are only touched by the
+// driver, the server fields by the worker owning the session
+struct ycsb_session {
+  ycsb_session(abstract_db *db, uint64_t txn_flags)
+    : chan(g_rtt_us)
+  {
+    txn_obj_buf.reserve(str_arena::MinStrReserveLength);
+    txn_obj_buf.resize(db->sizeof_txn_object(txn_flags));
+  }
+
+  session_channel chan;
+  session_msg msg;
+
+  // client
+  const bench_worker *server = nullptr;
+  uint64_t keys[32];
+  int next_op = -1;        // g_txn_length: the commit, -1: between txns
+  bool in_flight = false;  // msg is with the server
+  bool closed = false;
+  uint64_t start_at_us = 0;
+
+  // server: the open txn lives in txn_obj_buf, its strings in arena
+  str_arena arena;
+  std::string txn_obj_buf;
+  void *txn = nullptr;
+  bool done = false;
+};
+
+// the clients of all sessions, from one thread. a client sends the
+// accesses of its txn one by one, then the commit. an aborted txn is
+// retried with the same keys if retry_aborted_transaction is set
+class ycsb_session_driver : public ndb_thread {
+public:
+  ycsb_session_driver(const vector<ycsb_session *> &sessions)
+    : ndb_thread(false, "session-driver"), sessions(sessions) {}
+
+  virtual void
+  run()
+  {
+    size_t nopen = sessions.size();
+    while (nopen) {
+      const uint64_t now = timer::cur_usec();
+      uint64_t wake = sessions[0]->chan.next_wake_us(now);
+      for (ycsb_session *s : sessions) {
+        if (s->closed)
+          continue;
+        if (s->in_flight) {
+          session_msg *m = s->chan.poll_reply(now, &wake);
+          if (!m)
+            continue;
+          s->in_flight = false;
+          if (!m->ok_)
+            s->next_op = (retry_aborted_transaction && running) ? 0 : -1;
+          else if (s->next_op++ == int(g_txn_length))
+            s->next_op = -1;
+          if (s->next_op < 0)
+            s->start_at_us = now + g_think_us;
+        }
+        if (s->next_op < 0) {
+          if (!running || (run_mode == RUNMODE_OPS &&
+                           s->server->get_ntxn_commits() >= ops_per_worker)) {
+            s->msg.type_ = session_msg::MsgClose;
+            s->chan.send(&s->msg);
+            s->closed = true;
+            nopen--;
+            continue;
+          }
+          if (s->start_at_us > now) {
+            wake = min(wake, s->start_at_us);
+            continue;
+          }
+          for (int i = 0; i < g_txn_length; i++)
+            s->keys[i] = ycsb_worker::next_key(i);
+          s->msg.txn_start_us_ = now;
+          s->next_op = 0;
+        }
+        send(s);
+      }
+      session_channel::wait_until(wake);
+    }
+  }
+
+private:
+  void
+  send(ycsb_session *s)
+  {
+    const int i = s->next_op;
+    if (i < int(g_txn_length)) {
+      s->msg.type_ = session_msg::MsgOp;
+      s->msg.op_ = g_txn_op_distribution[i];
+      s->msg.acc_id_ = i;
+      s->msg.key_ = s->keys[i];
+    } else {
+      s->msg.type_ = session_msg::MsgCommit;
+    }
+    s->in_flight = true;
+    s->chan.send(&s->msg);
+  }
+
+  const vector<ycsb_session *> sessions;
+};
+
+// serves the requests of its sessions, each keeping its txn open across
+// the requests of its client. the first server also runs the driver, so
+// the clients start with the measured run
+class ycsb_session_server : public ycsb_worker {
+public:
+  ycsb_session_server(unsigned int worker_id,
+                      unsigned long seed, abstract_db *db,
+                      const map<string, abstract_ordered_index *> &open_tables,
+                      spin_barrier *barrier_a, spin_barrier *barrier_b,
+                      const vector<ycsb_session *> &sessions,
+                      ycsb_session_driver *driver)
+    : ycsb_worker(worker_id, seed, db, open_tables, barrier_a, barrier_b),
+      sessions(sessions), driver(driver)
+  {
+    for (ycsb_session *s : sessions)
+      s->server = this;
+  }
+
+  virtual void
+  run()
+  {
+    if (set_core_id)
+      coreid::set_core_id(worker_id);
+    {
+      scoped_rcu_region r; // register this thread in rcu region
+    }
+    on_run_setup();
+    scoped_db_thread_ctx ctx(db, false);
+    txn_counts.resize(get_workload().size());
+    barrier_a->count_down();
+    barrier_b->wait_for();
+    if (driver)
+      driver->start();
+
+    size_t nopen = sessions.size();
+    while (nopen) {
+      const uint64_t now = timer::cur_usec();
+      uint64_t wake = sessions[0]->chan.next_wake_us(now);
+      for (ycsb_session *s : sessions) {
+        if (s->done)
+          continue;
+        session_msg *m = s->chan.poll_request(now, &wake);
+        if (!m)
+          continue;
+        if (m->type_ == session_msg::MsgClose) {
+          if (s->txn)
+            db->abort_txn(s->txn);
+          s->done = true;
+          nopen--;
+          continue;
+        }
+        serve(s, m);
+        s->chan.reply(m);
+      }
+      session_channel::wait_until(wake);
+    }
+    if (driver)
+      driver->join();
+  }
+
+private:
+  void
+  serve(ycsb_session *s, session_msg *m)
+  {
+    if (m->type_ == session_msg::MsgOp) {
+      if (!s->txn) {
+        s->arena.reset();
+        s->txn = db->new_txn(txn_flags, s->arena, (void *) s->txn_obj_buf.data(),
+                             abstract_db::HINT_KV_GET_PUT);
+      }
+      try {
+        run_op(s->txn, s->arena, YCSBOpt(m->op_), m->key_, m->acc_id_);
+        m->ok_ = true;
+      } catch (transaction_abort_exception &ex) {
+        db->abort_txn(s->txn);
+        m->ok_ = false;
+      } catch (abstract_db::abstract_abort_exception &ex) {
+        db->abort_txn(s->txn);
+        m->ok_ = false;
+      }
+    } else {
+      INVARIANT(s->txn);
+      m->ok_ = db->commit_txn(s->txn);
+    }
+    if (m->type_ == session_msg::MsgCommit || !m->ok_) {
+      s->txn = nullptr;
+      // as seen by the client, which gets the reply rtt/2 from now
+      const uint64_t latency_us =
+        timer::cur_usec() + s->chan.rtt_us() / 2 - m->txn_start_us_;
+      account_txn(0, m->ok_, latency_us);
+      if (m->ok_) {
+        if (latency_us < 1000)
+          ++evt_session_latency_lt_1ms;
+        else if (latency_us < 10000)
+          ++evt_session_latency_1_10ms;
+        else if (latency_us < 100000)
+          ++evt_session_latency_10_100ms;
+        else
+          ++evt_session_latency_100ms_plus;
+      }
+    }
+  }
+
+  const vector<ycsb_session *> sessions;
+  ycsb_session_driver *const driver;
+};
+
 static void
 ycsb_load_keyrange(
     uint64_t keystart,
@@ -443,6 +677,28 @@ protected:
     ALWAYS_ASSERT((blockstart % alignment) == 0);
     fast_random r(8544290);
     vector<bench_worker *> ret;
+    if (g_client_server) {
+      // session j is served by worker j % nthreads
+      const size_t nsessions = g_nsessions ? g_nsessions : nthreads;
+      if (nsessions > nthreads) {
+        // long enough for the owner's client to finish its txn
+        lock_wait_cap_us = max<uint64_t>(g_txn_length * g_rtt_us, 1000);
+        lock_shared_workers = true;
+      }
+      vector<ycsb_session *> all;
+      vector<vector<ycsb_session *>> owned(nthreads);
+      for (size_t j = 0; j < nsessions; j++) {
+        all.push_back(new ycsb_session(db, txn_flags));
+        owned[j % nthreads].push_back(all.back());
+      }
+      ycsb_session_driver *driver = new ycsb_session_driver(all);
+      for (size_t i = 0; i < nthreads; i++)
+        ret.push_back(
+            new ycsb_session_server(
+                blockstart + i, r.next(), db, open_tables,
+                &barrier_a, &barrier_b, owned[i], i ? nullptr : driver));
+      return ret;
+    }
     for (size_t i = 0; i < nthreads; i++)
       ret.push_back(
           new ycsb_worker(
@@ -509,10 +765,14 @@ ycsb_do_test(abstract_db *db, int argc, char **argv)
         // for single part only.
         {"length", required_argument, 0, 'l'},
         {"partition", no_argument, 0, 'p'},
+        {"client-server", no_argument, 0, 'c'},
+        {"rtt-us", required_argument, 0, 'r'},
+        {"think-us", required_argument, 0, 't'},
+        {"sessions", required_argument, 0, 's'},
         {0, 0, 0, 0}
     };
     int option_index = 0;
-    int c = getopt_long(argc, argv, "a:o:p:l", long_options, &option_index);
+    int c = getopt_long(argc, argv, "a:o:p:lcr:t:s:", long_options, &option_index);
     if (c == -1)
       break;
     switch (c) {
@@ -562,6 +822,18 @@ ycsb_do_test(abstract_db *db, int argc, char **argv)
       }
       break;
 
+    case 'c':
+      g_client_server = true;
+      break;
+    case 'r':
+      g_rtt_us = strtoul(optarg, nullptr, 10);
+      break;
+    case 't':
+      g_think_us = strtoul(optarg, nullptr, 10);
+      break;
+    case 's':
+      g_nsessions = strtoul(optarg, nullptr, 10);
+      break;
     case '?':
       /* getopt_long already printed an error message. */
       exit(1);
@@ -584,6 +856,10 @@ ycsb_do_test(abstract_db *db, int argc, char **argv)
          << "  table size: "
          << nkeys
          << std::endl;
+    if (g_client_server)
+      cerr << "  client-server: rtt_us=" << g_rtt_us
+           << " think_us=" << g_think_us
+           << " sessions=" << (g_nsessions ? g_nsessions : nthreads) << endl;
   }
 
   ycsb_bench_runner r(db);
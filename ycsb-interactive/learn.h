@@ -159,6 +159,7 @@ extern contention_encoder global_encoder;
 
 struct xact {
     uint64_t tid;
+    unsigned core;  // the worker running the transaction.
     uint8_t conflict_mask;
     bool validating;
     bool is_blocked;
@@ -194,8 +195,9 @@ struct xact {
         return global_encoder.inference(feature);
     }
 
-    explicit xact(uint64_t _tid) {
+    xact(uint64_t _tid, unsigned _core) {
         tid = _tid;
+        core = _core;
         conflict_mask = 0;
         is_blocked = false;
         cached_policy = nullptr;
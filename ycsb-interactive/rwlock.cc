@@ -2,6 +2,9 @@
 #include "ctime"
 #include "chrono"
 
+uint64_t lock_wait_cap_us = 0;
+bool lock_shared_workers = false;
+
 LockEntry::LockEntry() {
     type = LOCK_NONE;
     tid = 0;
@@ -87,7 +90,14 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
 
     if (conflict) {
         bool can_wait = true;
-        if (not_sorted) {
+        if (lock_shared_workers) {
+            for (auto en = owners; en != nullptr && can_wait; en = en->next) {
+                // a worker serving many sessions runs one transaction at a time,
+                // so the owner could never release while we spin.
+                if (en->locked_xact != xact && en->locked_xact->core == xact->core) can_wait = false;
+                else if (not_sorted && xact->has_deadlock(en->locked_xact)) can_wait = false;
+            }
+        } else if (not_sorted) {
             for (auto en = owners; en != nullptr && can_wait; en = en->next) {
                 if (xact->has_deadlock(en->locked_xact)) can_wait = false;
             }
@@ -123,7 +133,10 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
             INC_TIME_SPAN(blocking_span[stage++], get_clock_ts() - begin_ts);
             begin_ts = get_clock_ts();
 #endif
-            if (timeout == 0)
+            uint64_t limit_us = uint64_t(timeout) * 1000;
+            if (lock_wait_cap_us && (limit_us == 0 || limit_us > lock_wait_cap_us))
+                limit_us = lock_wait_cap_us;
+            if (limit_us == 0)
                 while (!entry->lock_ready) nop_pause();
             else
             {
@@ -133,7 +146,7 @@ bool RWLock::lock_get(uint16_t type, uint64_t tid, bool not_sorted, xact* xact)
                 {
                     clock_gettime(CLOCK_MONOTONIC, &now);
                     long elapsed = (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
-                    if (elapsed >= timeout * 1000) break;
+                    if (elapsed >= long(limit_us)) break;
                     nop_pause();
                 }
             }
@@ -12,6 +12,14 @@
 #include "learn.h"
 #include "math.h"
 
+// when nonzero, bounds every lock wait. a worker serving many sessions
+// spins in a wait on behalf of one of them, so waits can form cycles
+// through the workers that no transaction level check sees.
+extern uint64_t lock_wait_cap_us;
+// set when a worker serves several sessions, so a lock may be held by
+// another transaction of the waiter's own worker.
+extern bool lock_shared_workers;
+
 /************************************************/
 // LIST helper (read from head & write to tail)
 /************************************************/
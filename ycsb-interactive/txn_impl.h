@@ -13,7 +13,7 @@ transaction<Protocol, Traits>::transaction(uint64_t flags, string_allocator_type
   tid = cast()->MakeTid(coreid::core_id(), coreid::core_count(), 0);
   lock_table = 0;
   lock_key = "";
-  feature = new xact(tid);
+  feature = new xact(tid, coreid::core_id());
   INVARIANT(rcu::s_instance.in_rcu_region());
 #ifdef BTREE_LOCK_OWNERSHIP_CHECKING
   concurrent_btree::NodeLockRegionBegin();
@@ -82,6 +82,7 @@ public:
     HINT_KV_GET_PUT, // KV workloads over a single key
     HINT_KV_RMW, // get/put over a single key
     HINT_KV_SCAN, // KV scan workloads (~100 keys)
+    HINT_KV_CORE, // YCSB core workloads (mixed gets, puts, inserts, scans)
 
     // tpcc profiles
     HINT_TPCC_NEW_ORDER,
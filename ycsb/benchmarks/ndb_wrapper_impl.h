@@ -57,6 +57,20 @@ struct hint_kv_scan_traits {
   typedef str_arena StringAllocator;
 };
 
+// a core workload txn runs up to ACCESSES / 2 ops, each of which may be a
+// scan of up to YCSB's max scan length, so the read set is sized for
+// ~10 scans of 100 keys
+struct hint_kv_core_traits {
+  static const size_t read_set_expected_size = 1024;
+  static const size_t write_set_expected_size = 128;
+  static const size_t absent_set_expected_size = 256;
+  static const bool stable_input_memory = true;
+  static const bool hard_expected_sizes = true;
+  static const bool read_own_writes = false;
+  static const size_t dep_queue_expected_size = 128;
+  typedef str_arena StringAllocator;
+};
+
 // tpcc profiles
 
 struct hint_read_only_traits {
@@ -292,6 +306,7 @@ struct hint_seats_read_only_traits {
   x(abstract_db::HINT_KV_GET_PUT, hint_kv_get_put_traits) \
   x(abstract_db::HINT_KV_RMW, hint_kv_rmw_traits) \
   x(abstract_db::HINT_KV_SCAN, hint_kv_scan_traits) \
+  x(abstract_db::HINT_KV_CORE, hint_kv_core_traits) \
   x(abstract_db::HINT_TPCC_NEW_ORDER, hint_tpcc_new_order_traits) \
   x(abstract_db::HINT_TPCC_PAYMENT, hint_tpcc_payment_traits) \
   x(abstract_db::HINT_TPCC_DELIVERY, hint_tpcc_delivery_traits) \
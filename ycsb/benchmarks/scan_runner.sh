@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# YCSB-E (95% short range scans, 5% inserts) under the occ, 2pl, pipe and the
+# sample learned policy; the scan_*_tuple_reads counters tell how many scanned
+# tuples were read occ style vs. tracked as dirty reads.
+# A scan's policy action picks occ validation or dirty read for the whole
+# range; its wait is the ordinary wait before the access. Ranges are tracked
+# per leaf by the node set, there is no separate range wait or range lock.
+# Only this ycsb copy routes scans by policy, the tpcc/ scans (stock-level,
+# broker-volume, customer-position) still read occ style.
+set -x
+
+BENCH=./dbtest
+NTHREADS=28
+PREFIX=$1
+YCSB_MEM=`python -c "print int(100+1.4*$NTHREADS)"`
+
+for POLICY in occ 2pl pipe ../training/samples/ic3.txt; do
+  if [ $POLICY == occ ]; then POLICY_OPT=""; else POLICY_OPT="--policy $POLICY"; fi
+  $BENCH \
+    --verbose \
+    --bench ycsb \
+    --db-type ndb-proto2 \
+    --scale-factor 320000 \
+    --num-threads $NTHREADS \
+    --bench-opts '--workload E' \
+    --numa-memory ${YCSB_MEM}G \
+    --parallel-loading \
+    --runtime 60 \
+    $POLICY_OPT 2>&1 | grep -E 'agg_throughput|agg_abort_rate|scan_.*_tuple_reads' \
+    > results/$PREFIX-ycsb-e-`basename $POLICY .txt`.txt
+done
@@ -4,6 +4,7 @@
 #include <utility>
 #include <string>
 #include <set>
+#include <atomic>
 
 #include "math.h"
 #include <getopt.h>
@@ -18,6 +19,8 @@
 #include "../thread.h"
 #include "../util.h"
 #include "../spinbarrier.h"
+#include "../spinlock.h"
+#include "../lockguard.h"
 #include "../core.h"
 #include "../txn.h"
 
@@ -45,6 +48,60 @@ static bool g_access_partitioned = false;
 
 static int key_distribution[100] = {0};
 
+// YCSB core workloads (A-F): each txn runs g_txn_length ops drawn from
+// g_core_op_proportion, over keys chosen by g_request_dist
+enum YCSBCoreOpt {
+  CoreReadOpt = 0,
+  CoreUpdateOpt,
+  CoreInsertOpt,
+  CoreScanOpt,
+  CoreRMWOpt,
+  CoreOptN
+};
+
+enum YCSBRequestDist {
+  UniformDist = 0,
+  ZipfianDist,
+  LatestDist,
+  HotspotDist
+};
+
+static char g_core_workload = 0; // 0 means the custom --opt-dist list
+static double g_core_op_proportion[CoreOptN] = {0};
+static YCSBRequestDist g_request_dist = ZipfianDist;
+static double g_zipf_theta = 0.99;
+static size_t g_max_scan_length = 100;
+static double g_hotspot_data_fraction = 0.2;
+static double g_hotspot_op_fraction = 0.8;
+
+// keys [0, g_key_horizon) have been handed out, inserts claim the next one.
+// the reads only go up to g_key_acked, below which every insert committed
+// (YCSB's acknowledged counter), so they never look for a key whose insert
+// is still running, or waits to be retried with it (see claim_core_key())
+static std::atomic<uint64_t> g_key_horizon(0);
+static std::atomic<uint64_t> g_key_acked(0);
+
+// the committed keys at or above g_key_acked, by key modulo the window
+static const size_t KeyAckWindow = 1 << 22;
+static std::atomic<bool> g_key_committed[KeyAckWindow];
+static spinlock g_key_ack_lock;
+
+static void
+ack_core_key(uint64_t k)
+{
+  // keys are only reused by the insert which claimed them, so at most the
+  // inserts in flight are claimed and not acked
+  ALWAYS_ASSERT(k - g_key_acked.load(std::memory_order_relaxed) < KeyAckWindow);
+  g_key_committed[k % KeyAckWindow].store(true, std::memory_order_release);
+  ::lock_guard<spinlock> l(g_key_ack_lock);
+  uint64_t a = g_key_acked.load(std::memory_order_relaxed);
+  while (g_key_committed[a % KeyAckWindow].load(std::memory_order_acquire)) {
+    g_key_committed[a % KeyAckWindow].store(false, std::memory_order_relaxed);
+    a++;
+  }
+  g_key_acked.store(a, std::memory_order_release);
+}
+
 enum ycsb_tx_types
 {
   ycsb_type = 1,
@@ -116,6 +173,59 @@ private:
   }
 };
 
+// zipfian draws over [0, items) following Gray et al. The constants are
+// computed once at setup, so workers draw with their own fast_random and
+// never take a lock
+struct ycsb_zipf_params {
+  uint64_t items;
+  double theta;
+  double alpha;
+  double zetan;
+  double eta;
+
+  void
+  init(uint64_t n, double th)
+  {
+    ALWAYS_ASSERT(n > 0);
+    ALWAYS_ASSERT(th > 0 && th < 1);
+    items = n;
+    theta = th;
+    alpha = 1.0 / (1.0 - theta);
+    zetan = zeta(n, theta);
+    eta = (1 - pow(2.0 / static_cast<double>(n), 1 - theta)) /
+          (1 - zeta(2, theta) / zetan);
+  }
+
+  inline uint64_t
+  next(fast_random &r) const
+  {
+    const double u = r.next_uniform();
+    const double uz = u * zetan;
+    if (uz < 1.0)
+      return 0;
+    if (uz < 1.0 + pow(0.5, theta))
+      return 1;
+    return std::min(items - 1,
+        static_cast<uint64_t>(items * pow(eta * u - eta + 1, alpha)));
+  }
+};
+
+static ycsb_zipf_params g_core_zipf;
+
+// spreads the popular zipfian ranks over the key space, as YCSB's
+// scrambled zipfian does, so the hot keys do not share one leaf
+static inline uint64_t
+ycsb_fnv64(uint64_t v)
+{
+  uint64_t h = 0xCBF29CE484222325ul;
+  for (int i = 0; i < 8; i++) {
+    h ^= v & 0xff;
+    h *= 1099511628211ul;
+    v >>= 8;
+  }
+  return h;
+}
+
 static conflict_graph* cgraph = NULL;
 ZipfianGenerator * key_gen_list[32] = {nullptr};
 
@@ -176,22 +286,25 @@ public:
           obj_key0 = u64_varkey(row_id).str(obj_key0);
           if (op == ReadOpt) {
             // read operation,
-            ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v, acc_id));
+            ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v,
+                                   std::string::npos, acc_id));
           } else if (op == WriteOpt) {
             // read modify write.
-            ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v, acc_id));
+            ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id).str(obj_key0), obj_v,
+                                   std::string::npos, acc_id));
             tbl->put(txn, obj_key0, str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
           } else if (op == ScanReadOpt) {
-            for (int j = 0; j < 10; j++) {
-              ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id + j).str(obj_key0),
-                                     obj_v, acc_id));
-            }
+            // one policy controlled range access over the next 10 rows
+            u64_varkey(row_id + 10).str(obj_key1);
+            worker_scan_callback c;
+            tbl->scan(txn, obj_key0, &obj_key1, c, s_arena.get(), acc_id);
           } else if (op == ScanWriteOpt) {
-            for (int j = 0; j < 10; j++) {
-              ALWAYS_ASSERT(tbl->get(txn, u64_varkey(row_id + j).str(obj_key0),
-                                     obj_v, acc_id));
-              tbl->put(txn, obj_key0, str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
-            }
+            u64_varkey(row_id + 10).str(obj_key1);
+            worker_scan_callback c;
+            tbl->scan(txn, obj_key0, &obj_key1, c, s_arena.get(), acc_id);
+            for (int j = 0; j < 10; j++)
+              tbl->put(txn, u64_varkey(row_id + j).str(obj_key0),
+                       str().assign(YCSBRecordSize, 'a' + rand() % 26), acc_id+1);
           } else {
             // unsupported yet.
             assert(false);
@@ -225,6 +338,93 @@ public:
     return static_cast<ycsb_worker *>(w)->txn();
   }
 
+  txn_result
+  txn_core()
+  {
+    void *txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_KV_CORE, ycsb_type);
+    db->init_txn(txn, cgraph, ycsb_type, pg);
+    db->set_failed_records(txn, failed_records);
+
+    // draw every op up front so a partial retry replays the same ops
+    for (size_t i = 0; i < g_txn_length; i++) {
+      core_ops[i] = next_core_op();
+      core_keys[i] = core_ops[i] == CoreInsertOpt ? claim_core_key() : next_core_key();
+      core_scan_length[i] = core_ops[i] == CoreScanOpt ?
+          1 + r.next() % g_max_scan_length : 0;
+    }
+
+    scoped_str_arena s_arena(arena);
+    std::pair<bool, uint32_t> expose_ret;
+    try {
+      for (size_t i = 0; i < g_txn_length;) {
+        // op i owns access ids 2i (its first access) and 2i+1 (the write of
+        // a read-modify-write), so ids do not shift with the op mix
+        const uint32_t acc_id = 2 * i;
+        uint32_t last_acc_id = acc_id;
+        u64_varkey(core_keys[i]).str(obj_key0);
+        switch (core_ops[i]) {
+        case CoreReadOpt:
+          tbl->get(txn, obj_key0, obj_v, std::string::npos, acc_id);
+          break;
+        case CoreUpdateOpt:
+          tbl->put(txn, obj_key0, str().assign(YCSBRecordSize, 'a' + r.next() % 26), acc_id);
+          break;
+        case CoreInsertOpt:
+          tbl->insert(txn, obj_key0, str().assign(YCSBRecordSize, 'a' + r.next() % 26), acc_id);
+          break;
+        case CoreScanOpt:
+          {
+            u64_varkey(core_keys[i] + core_scan_length[i]).str(obj_key1);
+            worker_scan_callback c;
+            tbl->scan(txn, obj_key0, &obj_key1, c, s_arena.get(), acc_id);
+          }
+          break;
+        case CoreRMWOpt:
+          if (tbl->get(txn, obj_key0, obj_v, std::string::npos, acc_id)) {
+            string &v = str();
+            v.assign(obj_v);
+            v[r.next() % v.size()] = 'a' + r.next() % 26;
+            tbl->put(txn, obj_key0, v, acc_id + 1);
+          }
+          last_acc_id = acc_id + 1;
+          break;
+        default:
+          ALWAYS_ASSERT(false);
+        }
+        expose_ret = db->expose_uncommitted(txn, last_acc_id + ACCESSES /*access_id*/);
+        if (!expose_ret.first) {
+          // the retry point is the access id after the last exposed op,
+          // which is 2i+1 or 2i+2 for op i, so round up to the next op
+          const uint32_t next = expose_ret.second == MAX_ACC_ID ? 0 : expose_ret.second;
+          i = (next + 1) / 2;
+        } else {
+          i++;
+        }
+      }
+      measure_txn_counters(txn, "txn_core");
+      bool res = db->commit_txn(txn);
+      set_failed_records(db->get_failed_records(txn));
+      finished_txn_contention = db->get_txn_contention(txn);
+      if (res)
+        ack_core_keys();
+      else
+        release_core_keys();
+      return txn_result(res, ycsb_type);
+    } catch(transaction_abort_exception &ex) {
+      db->abort_txn(txn);
+    } catch (abstract_db::abstract_abort_exception &ex) {
+      db->abort_txn(txn);
+    }
+    release_core_keys();
+    return txn_result(false, 0);
+  }
+
+  static txn_result
+  TxnCore(bench_worker *w)
+  {
+    return static_cast<ycsb_worker *>(w)->txn_core();
+  }
+
 
   class worker_scan_callback : public abstract_ordered_index::scan_callback {
   public:
@@ -242,7 +442,10 @@ public:
   get_workload() const
   {
     workload_desc_vec w;
-    w.emplace_back("RW_TX",  1.0, Txn);
+    if (g_core_workload)
+      w.emplace_back(string("YCSB_") + g_core_workload, 1.0, TxnCore);
+    else
+      w.emplace_back("RW_TX",  1.0, Txn);
     return w;
   }
 
@@ -263,6 +466,76 @@ protected:
     return *arena.next();
   }
 
+  YCSBCoreOpt
+  next_core_op()
+  {
+    double d = r.next_uniform();
+    for (int op = 0; op < CoreOptN - 1; op++) {
+      if (d < g_core_op_proportion[op])
+        return static_cast<YCSBCoreOpt>(op);
+      d -= g_core_op_proportion[op];
+    }
+    return static_cast<YCSBCoreOpt>(CoreOptN - 1);
+  }
+
+  // the key of an insert. the keys of an aborted try are claimed again
+  // first, so its retry inserts the same keys and an abort leaves no hole
+  // in the key space for the reads to miss
+  uint64_t
+  claim_core_key()
+  {
+    if (core_unused_keys.empty())
+      return g_key_horizon.fetch_add(1, std::memory_order_acq_rel);
+    const uint64_t k = core_unused_keys.back();
+    core_unused_keys.pop_back();
+    return k;
+  }
+
+  void
+  ack_core_keys()
+  {
+    for (size_t i = 0; i < g_txn_length; i++)
+      if (core_ops[i] == CoreInsertOpt)
+        ack_core_key(core_keys[i]);
+  }
+
+  // gives back the insert keys of the try which aborted, the first one
+  // last, so they are claimed again in the same order
+  void
+  release_core_keys()
+  {
+    for (size_t i = g_txn_length; i-- > 0;)
+      if (core_ops[i] == CoreInsertOpt)
+        core_unused_keys.push_back(core_keys[i]);
+  }
+
+  uint64_t
+  next_core_key()
+  {
+    const uint64_t horizon = g_key_acked.load(std::memory_order_acquire);
+    switch (g_request_dist) {
+    case UniformDist:
+      return r.next() % horizon;
+    case ZipfianDist:
+      return ycsb_fnv64(g_core_zipf.next(r)) % horizon;
+    case LatestDist:
+      {
+        // rank 0 is the most recently inserted key
+        const uint64_t rank = g_core_zipf.next(r);
+        return rank >= horizon ? 0 : horizon - 1 - rank;
+      }
+    case HotspotDist:
+      {
+        const uint64_t hot = std::max<uint64_t>(1, horizon * g_hotspot_data_fraction);
+        if (hot >= horizon || r.next_uniform() < g_hotspot_op_fraction)
+          return r.next() % hot;
+        return hot + r.next() % (horizon - hot);
+      }
+    }
+    ALWAYS_ASSERT(false);
+    return 0;
+  }
+
 private:
   abstract_ordered_index *tbl;
 
@@ -270,6 +543,11 @@ private:
   string obj_key1;
   string obj_v;
 
+  YCSBCoreOpt core_ops[ACCESSES / 2];
+  uint64_t core_keys[ACCESSES / 2];
+  size_t core_scan_length[ACCESSES / 2];
+  std::vector<uint64_t> core_unused_keys; // see claim_core_key()
+
   uint64_t computation_n;
 };
 
@@ -532,10 +810,19 @@ ycsb_do_test(abstract_db *db, int argc, char **argv)
         // for single part only.
         {"length", required_argument, 0, 'l'},
         {"partition", no_argument, 0, 'p'},
+
+        // YCSB core workloads, these ignore access-dist/opt-dist/partition.
+        {"workload", required_argument, 0, 'w'},
+        {"request-dist", required_argument, 0, 'd'},
+        {"zipf-theta", required_argument, 0, 'z'},
+        {"max-scan-length", required_argument, 0, 's'},
+        {"hotspot-data-fraction", required_argument, 0, 'h'},
+        {"hotspot-op-fraction", required_argument, 0, 'H'},
         {0, 0, 0, 0}
     };
+    bool request_dist_set = false;
     int option_index = 0;
-    int c = getopt_long(argc, argv, "a:o:p:l", long_options, &option_index);
+    int c = getopt_long(argc, argv, "a:o:pl:w:d:z:s:h:H:", long_options, &option_index);
     if (c == -1)
       break;
     switch (c) {
@@ -585,6 +872,67 @@ ycsb_do_test(abstract_db *db, int argc, char **argv)
       }
       break;
 
+    case 'w':
+      {
+        const string w(optarg);
+        ALWAYS_ASSERT(w.size() == 1);
+        g_core_workload = toupper(w[0]);
+        double *p = g_core_op_proportion;
+        switch (g_core_workload) {
+        case 'A': p[CoreReadOpt] = 0.5; p[CoreUpdateOpt] = 0.5; break;
+        case 'B': p[CoreReadOpt] = 0.95; p[CoreUpdateOpt] = 0.05; break;
+        case 'C': p[CoreReadOpt] = 1.0; break;
+        case 'D': p[CoreReadOpt] = 0.95; p[CoreInsertOpt] = 0.05; break;
+        case 'E': p[CoreScanOpt] = 0.95; p[CoreInsertOpt] = 0.05; break;
+        case 'F': p[CoreReadOpt] = 0.5; p[CoreRMWOpt] = 0.5; break;
+        default:
+          cerr << "[ERROR] unknown YCSB workload: " << optarg << endl;
+          exit(1);
+        }
+        if (!request_dist_set)
+          g_request_dist = g_core_workload == 'D' ? LatestDist : ZipfianDist;
+      }
+      break;
+
+    case 'd':
+      {
+        const string d(optarg);
+        if (d == "uniform")
+          g_request_dist = UniformDist;
+        else if (d == "zipfian")
+          g_request_dist = ZipfianDist;
+        else if (d == "latest")
+          g_request_dist = LatestDist;
+        else if (d == "hotspot")
+          g_request_dist = HotspotDist;
+        else {
+          cerr << "[ERROR] unknown request distribution: " << d << endl;
+          exit(1);
+        }
+        request_dist_set = true;
+      }
+      break;
+
+    case 'z':
+      g_zipf_theta = strtod(optarg, nullptr);
+      ALWAYS_ASSERT(g_zipf_theta > 0 && g_zipf_theta < 1);
+      break;
+
+    case 's':
+      g_max_scan_length = strtoul(optarg, nullptr, 10);
+      ALWAYS_ASSERT(g_max_scan_length > 0);
+      break;
+
+    case 'h':
+      g_hotspot_data_fraction = strtod(optarg, nullptr);
+      ALWAYS_ASSERT(g_hotspot_data_fraction > 0 && g_hotspot_data_fraction <= 1);
+      break;
+
+    case 'H':
+      g_hotspot_op_fraction = strtod(optarg, nullptr);
+      ALWAYS_ASSERT(g_hotspot_op_fraction >= 0 && g_hotspot_op_fraction <= 1);
+      break;
+
     case '?':
       /* getopt_long already printed an error message. */
       exit(1);
@@ -594,11 +942,29 @@ ycsb_do_test(abstract_db *db, int argc, char **argv)
     }
   }
 
-  for (int i=0;i<g_txn_length;i++)
-    key_gen_list[i] =
-        new ZipfianGenerator(int(ycsb_records_per_partition), g_txn_access_distribution[i]);
+  g_key_horizon.store(nkeys);
+  g_key_acked.store(nkeys);
+  if (g_core_workload) {
+    // two access ids per op, and the scans must fit hint_kv_core_traits
+    ALWAYS_ASSERT(2 * g_txn_length <= ACCESSES);
+    ALWAYS_ASSERT(g_txn_length * g_max_scan_length <= 1024);
+    g_core_zipf.init(nkeys, g_zipf_theta);
+  } else {
+    for (int i=0;i<g_txn_length;i++)
+      key_gen_list[i] =
+          new ZipfianGenerator(int(ycsb_records_per_partition), g_txn_access_distribution[i]);
+  }
 
-  if (verbose) {
+  if (verbose && g_core_workload) {
+    static const char *dist_names[] = {"uniform", "zipfian", "latest", "hotspot"};
+    cerr << "ycsb settings:" << endl;
+    cerr << "  workload: " << g_core_workload << endl
+         << "  op proportions (r/u/i/s/rmw): "
+         << format_list(g_core_op_proportion, g_core_op_proportion + CoreOptN) << endl
+         << "  request_dist: " << dist_names[g_request_dist] << endl
+         << "  max_scan_length: " << g_max_scan_length << endl
+         << "  table size: " << nkeys << endl;
+  } else if (verbose) {
     cerr << "ycsb settings:" << endl;
     cerr << "  access_dist: "
          << format_list(g_txn_access_distribution, g_txn_access_distribution + (g_txn_length)) << std::endl
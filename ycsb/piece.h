@@ -224,6 +224,8 @@ protected:
   std::pair< dbtuple *, bool>
   try_insert_new_tuple(concurrent_btree &btr, const std::string* key, void* value, ValueWriter& writer, bool occ = true, concurrent_btree::node_opaque_t **node = nullptr);
   access_entry* read_set_find(dbtuple* tuple);
+  template <typename ValueReader>
+  bool do_dirty_tuple_read(dbtuple* tuple, ValueReader& value_reader, uint16_t record_contention, bool lock_mode = true);
 
 private:
   Transaction* txn;
@@ -93,9 +93,20 @@ bool mix_op<Transaction>::do_get(
     return ret;
   }
 
+  return do_dirty_tuple_read(tuple, value_reader, record_contention, lock_mode);
+}
+
+template <typename Transaction>
+template <typename ValueReader>
+bool mix_op<Transaction>::do_dirty_tuple_read(
+  dbtuple* tuple,
+  ValueReader& value_reader,
+  uint16_t record_contention,
+  bool lock_mode)
+{
   // start dirty read action stuff
   tuple->prefetch();
-  access_entry *e = txn->insert_read_set(tuple, dbtuple::MIN_TID, dbtuple::MIN_TID, txn->get_tid(), txn, occ, record_contention,
+  access_entry *e = txn->insert_read_set(tuple, dbtuple::MIN_TID, dbtuple::MIN_TID, txn->get_tid(), txn, false /*occ*/, record_contention,
                                           tuple->version);
   tuple->chamcc_lock(lock_mode, nullptr);
   bool result = tuple->ic3_read(value_reader, txn->string_allocator(), nullptr);
@@ -132,6 +143,13 @@ bool mix_op<Transaction>::do_get(
    if(tuple == nullptr)
      return false;
 
+   // scans whose policy action does not leave them to occ (see
+   // inference_scan_access()) read like point reads do: they
+   // see dirty versions and depend on their writers, the leaf nodes are
+   // stamped with the scanned range on expose (see do_expose_ic3_action())
+   if (!occ)
+     return do_dirty_tuple_read(tuple, reader, record_contention);
+
    tuple->prefetch();
    transaction_base::tid_t start_t = 0;
    const auto snapshot_tid = static_cast<transaction_base::tid_t>(dbtuple::MAX_TID);
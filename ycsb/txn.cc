@@ -63,5 +63,7 @@ event_counter transaction_base::g_evt_dbtuple_write_insert_failed
     ("dbtuple_write_insert_failed");
 
 event_counter transaction_base::evt_local_search_lookups("local_search_lookups");
+event_counter transaction_base::evt_scan_occ_tuple_reads("scan_occ_tuple_reads");
+event_counter transaction_base::evt_scan_tracked_tuple_reads("scan_tracked_tuple_reads");
 event_counter transaction_base::evt_local_search_write_set_hits("local_search_write_set_hits");
 event_counter transaction_base::evt_dbtuple_latest_replacement("dbtuple_latest_replacement");
@@ -684,6 +684,10 @@ protected:
   static event_counter g_evt_dbtuple_write_insert_failed;
 
   static event_counter evt_local_search_lookups;
+  // tuples read by scans, occ validated vs dependency tracked (see
+  // mix_op::do_tuple_read())
+  static event_counter evt_scan_occ_tuple_reads;
+  static event_counter evt_scan_tracked_tuple_reads;
   static event_counter evt_local_search_write_set_hits;
   static event_counter evt_dbtuple_latest_replacement;
 
@@ -1330,9 +1334,10 @@ public:
     return pa->expose;
   }
 
-  // return true to do the piece commit
+  // return true to scan occ style; a scan without a policy action keeps the
+  // stable occ read, like get() does
   ALWAYS_INLINE bool inference_scan_access(PolicyAction *pa = nullptr) {
-    if (pa == nullptr) return false;
+    if (pa == nullptr) return true;
     return pa->access == no_detect;
   }
 
@@ -1264,8 +1264,13 @@ transaction<Protocol, Traits>::do_tuple_read(
 
   const bool is_snapshot_txn = is_snapshot();
 
-  if(!is_snapshot_txn)
+  if(!is_snapshot_txn) {
+    if (occ)
+      ++evt_scan_occ_tuple_reads;
+    else
+      ++evt_scan_tracked_tuple_reads;
     return mix_op.do_tuple_read(const_cast<dbtuple*>(tuple), value_reader, occ);
+  }
 
   const transaction_base::tid_t snapshot_tid = is_snapshot_txn ?
     cast()->snapshot_tid() : static_cast<transaction_base::tid_t>(dbtuple::MAX_TID);